@@ -52,6 +52,16 @@ if exist('qpboMex', 'file') ~= 3  ||  forceBuild
     cd(curDir);
 end
 
+if exist('qpboDynamicMex', 'file') ~= 3 || ...
+   exist('updateUnaryQpboDynamicMex', 'file') ~= 3 || ...
+   exist('deleteQpboDynamicMex', 'file') ~= 3  ||  forceBuild
+    % build qpboDynamicMex
+    fprintf('Building qpboDynamicMex...\n')
+    cd(fullfile(smrRootDir, 'mexWrappers', 'qpboDynamicMex'));
+    build_qpboDynamicMex;
+    cd(curDir);
+end
+
 if exist('trwsMex_time', 'file') ~= 3  ||  forceBuild
     % build trwsMex_time
     fprintf('Building trwsMex_time...\n')
@@ -60,7 +70,22 @@ if exist('trwsMex_time', 'file') ~= 3  ||  forceBuild
     cd(curDir);
 end
 
-if exist('viterbiPottsMex', 'file') ~= 3  ||  forceBuild
+if exist('trwsDynamicMex', 'file') ~= 3 || ...
+   exist('runTrwsDynamicMex', 'file') ~= 3 || ...
+   exist('updateUnaryTrwsDynamicMex', 'file') ~= 3 || ...
+   exist('deleteTrwsDynamicMex', 'file') ~= 3  ||  forceBuild
+    % build trwsDynamicMex
+    fprintf('Building trwsDynamicMex...\n')
+    cd(fullfile(smrRootDir, 'mexWrappers', 'trwsDynamicMex'));
+    build_trwsDynamicMex;
+    cd(curDir);
+end
+
+if exist('viterbiPottsMex', 'file') ~= 3 || ...
+   exist('viterbiGridPottsMex', 'file') ~= 3 || ...
+   exist('viterbiGridDynamicMex', 'file') ~= 3 || ...
+   exist('updateUnaryViterbiGridDynamicMex', 'file') ~= 3 || ...
+   exist('deleteViterbiGridDynamicMex', 'file') ~= 3  ||  forceBuild
     % build viterbiPottsMex
     fprintf('Building viterbiPottsMex...\n')
     cd(fullfile(smrRootDir, 'mexWrappers', 'viterbiPottsMex'));
@@ -5,6 +5,7 @@
 using std::vector;
 
 #include "mex.h"
+#include "threadPool.h"
 
 #include "robust/expand.h"
 
@@ -18,29 +19,154 @@ typedef int mwIndex;
 double round(double a);
 int isInteger(double a);
 
+struct RobustPottsProblem
+{
+	mwSize numNodes;
+	mwSize numLabels;
+	double* termW;
+
+	mwIndex colNum;
+	const mwIndex* ir;
+	const mwIndex* jc;
+	double*        pr;
+	mwSize numEdges;
+
+	int numHO;
+	vector< vector< int > > highOrderInd;
+	vector< vector< double > > highOrderParam;
+};
+
+struct RobustPottsResult
+{
+	double energy;
+	vector<double> segment;
+	vector<double> timePlot;
+	vector<double> energyPlot;
+};
+
+// checks the input and fills problem, called from the MATLAB thread only
+void readProblem(const mxArray *uInPtr, const mxArray *pInPtr, const mxArray *hoInPtr, const mxArray *hopInPtr, RobustPottsProblem& problem);
+// runs alpha-expansion, does not call MATLAB API and thus can be run on the thread pool
+void solveProblem(const RobustPottsProblem& problem, RobustPottsResult& result);
+mxArray* createColumn(const vector<double>& values);
 
 void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
 {
-	MATLAB_ASSERT(nrhs == 2 || nrhs == 4, "Wrong number of input argumets, expected 2 or 4" ); \
-	
+	MATLAB_ASSERT(nrhs == 2 || nrhs == 4 || nrhs == 5, "Wrong number of input argumets, expected 2, 4 or 5" ); \
+
 	MATLAB_ASSERT(nlhs <= 4, "Too many output arguments, expected 1 - 4");
-	
+
 	//Fix input parameter order:
 	const mxArray *uInPtr = (nrhs > 0) ? prhs[0] : NULL; //unary
 	const mxArray *pInPtr = (nrhs > 1) ? prhs[1] : NULL; //pairwise
 	const mxArray *hoInPtr = (nrhs > 2) ? prhs[2] : NULL; // high-order indices
 	const mxArray *hopInPtr = (nrhs > 3) ? prhs[3] : NULL; // high-order parameters
-	
+	const mxArray *tInPtr = (nrhs > 4) ? prhs[4] : NULL; // number of threads
+
 	//Fix output parameter order:
 	mxArray **eOutPtr = (nlhs > 1) ? &plhs[1] : NULL; //energy
 	mxArray **sOutPtr = (nlhs > 0) ? &plhs[0] : NULL; //solution
-	mxArray **timePlotOutPtr = (nlhs > 3) ? &plhs[3] : NULL; //time plot 
-	mxArray **energyPlotOutPtr = (nlhs > 2) ? &plhs[2] : NULL; //energy plot 
+	mxArray **timePlotOutPtr = (nlhs > 3) ? &plhs[3] : NULL; //time plot
+	mxArray **energyPlotOutPtr = (nlhs > 2) ? &plhs[2] : NULL; //energy plot
+
+	if (!mxIsCell(uInPtr)) {
+		MATLAB_ASSERT(tInPtr == NULL, "The number of threads can be specified only in the batch mode");
+
+		RobustPottsProblem problem;
+		readProblem(uInPtr, pInPtr, hoInPtr, hopInPtr, problem);
+
+		RobustPottsResult result;
+		solveProblem(problem, result);
+
+		//output the best energy value
+		if(eOutPtr != NULL)	{
+			*eOutPtr = mxCreateNumericMatrix(1, 1, mxDOUBLE_CLASS, mxREAL);
+			*(double*)mxGetData(*eOutPtr) = (double)result.energy;
+		}
+
+		//output the best solution
+		if(sOutPtr != NULL)
+			*sOutPtr = createColumn(result.segment);
+
+		//output time plot
+		if(timePlotOutPtr != NULL)
+			*timePlotOutPtr = createColumn(result.timePlot);
+
+		//output energy plot
+		if(energyPlotOutPtr != NULL)
+			*energyPlotOutPtr = createColumn(result.energyPlot);
+		return;
+	}
+
+	// batch mode: independent problems are solved in parallel
+	mwSize numProblems = mxGetNumberOfElements(uInPtr);
+	MATLAB_ASSERT(numProblems >= 1, "Cell array of unary terms is empty");
+	MATLAB_ASSERT(!mxIsCell(pInPtr) || mxGetNumberOfElements(pInPtr) == numProblems, "Cell arrays of unary and pairwise terms are of different sizes");
+
+	// HO is a cell array itself, so HO of the batch is a cell array of cell arrays
+	bool hoBatch = hoInPtr != NULL && mxIsCell(hoInPtr) && mxGetNumberOfElements(hoInPtr) > 0 && mxIsCell(mxGetCell(hoInPtr, 0));
+	bool hopBatch = hopInPtr != NULL && mxIsCell(hopInPtr);
+	MATLAB_ASSERT(!hoBatch || mxGetNumberOfElements(hoInPtr) == numProblems, "Cell arrays of unary terms and HO are of different sizes");
+	MATLAB_ASSERT(!hopBatch || mxGetNumberOfElements(hopInPtr) == numProblems, "Cell arrays of unary terms and HOP are of different sizes");
+
+	int numThreads = 0;
+	if (tInPtr != NULL && !mxIsEmpty(tInPtr)) {
+		MATLAB_ASSERT(mxIsNumeric(tInPtr) && mxGetNumberOfElements(tInPtr) == 1, "The number of threads should be a numeric scalar");
+		double numThreadsValue = mxGetScalar(tInPtr);
+		MATLAB_ASSERT(numThreadsValue >= 1 && floor(numThreadsValue) == numThreadsValue, "The number of threads should be a positive integer");
+		numThreads = (int)numThreadsValue;
+	}
+
+	vector<RobustPottsProblem> problems(numProblems);
+	for(mwSize iProblem = 0; iProblem < numProblems; ++iProblem) {
+		const mxArray *curUInPtr = mxGetCell(uInPtr, iProblem);
+		const mxArray *curPInPtr = mxIsCell(pInPtr) ? mxGetCell(pInPtr, iProblem) : pInPtr;
+		const mxArray *curHoInPtr = hoBatch ? mxGetCell(hoInPtr, iProblem) : hoInPtr;
+		const mxArray *curHopInPtr = hopBatch ? mxGetCell(hopInPtr, iProblem) : hopInPtr;
+		MATLAB_ASSERT(curUInPtr != NULL && curPInPtr != NULL, "Some cell of the batch is empty");
+		MATLAB_ASSERT((hoInPtr == NULL || curHoInPtr != NULL) && (hopInPtr == NULL || curHopInPtr != NULL), "Some cell of the batch is empty");
+		readProblem(curUInPtr, curPInPtr, curHoInPtr, curHopInPtr, problems[iProblem]);
+	}
+
+	vector<RobustPottsResult> results(numProblems);
+	try {
+		getThreadPool(numThreads) -> parallelFor((int)numProblems, [&](int iProblem, int iThread) {
+			solveProblem(problems[iProblem], results[iProblem]);
+		});
+	}
+	catch (...) {
+		mexErrMsgTaskException("alphaExpansionRobustHighOrderPottsMex:threadPool");
+	}
+
+	if(eOutPtr != NULL)	{
+		*eOutPtr = mxCreateNumericMatrix(numProblems, 1, mxDOUBLE_CLASS, mxREAL);
+		double* energy = (double*)mxGetData(*eOutPtr);
+		for(mwSize iProblem = 0; iProblem < numProblems; ++iProblem)
+			energy[iProblem] = results[iProblem].energy;
+	}
+	if(sOutPtr != NULL)	{
+		*sOutPtr = mxCreateCellMatrix(numProblems, 1);
+		for(mwSize iProblem = 0; iProblem < numProblems; ++iProblem)
+			mxSetCell(*sOutPtr, iProblem, createColumn(results[iProblem].segment));
+	}
+	if(timePlotOutPtr != NULL)	{
+		*timePlotOutPtr = mxCreateCellMatrix(numProblems, 1);
+		for(mwSize iProblem = 0; iProblem < numProblems; ++iProblem)
+			mxSetCell(*timePlotOutPtr, iProblem, createColumn(results[iProblem].timePlot));
+	}
+	if(energyPlotOutPtr != NULL)	{
+		*energyPlotOutPtr = mxCreateCellMatrix(numProblems, 1);
+		for(mwSize iProblem = 0; iProblem < numProblems; ++iProblem)
+			mxSetCell(*energyPlotOutPtr, iProblem, createColumn(results[iProblem].energyPlot));
+	}
+}
 
+void readProblem(const mxArray *uInPtr, const mxArray *pInPtr, const mxArray *hoInPtr, const mxArray *hopInPtr, RobustPottsProblem& problem)
+{
 	// get unary potentials
 	MATLAB_ASSERT(mxGetNumberOfDimensions(uInPtr) == 2, "Unary term array is not 2-dimensional");
 	MATLAB_ASSERT(mxGetPi(uInPtr) == NULL, "Unary potentials should not be complex");
-	
+
 	mwSize numNodes = mxGetN(uInPtr);
 	mwSize numLabels = mxGetM(uInPtr);
 
@@ -63,8 +189,10 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
 
 	// get high-order indices
 	int numHO = 0;
-	vector< vector< int > > highOrderInd;
-	vector< vector< double > > highOrderParam;
+	vector< vector< int > >& highOrderInd = problem.highOrderInd;
+	vector< vector< double > >& highOrderParam = problem.highOrderParam;
+	highOrderInd.clear();
+	highOrderParam.clear();
 	if (hoInPtr != NULL) {
 		MATLAB_ASSERT(mxIsCell( hoInPtr ), "HO parameter shoulf be cell array");
 		numHO = mxGetNumberOfElements( hoInPtr );
@@ -75,10 +203,11 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
 		for(int iPot = 0; iPot < numHO; ++iPot) {
 			mxArray *cellPtr = mxGetCell( hoInPtr, iPot );
 
+			MATLAB_ASSERT(cellPtr != NULL, "Elements of HO parameter should not be empty");
 			MATLAB_ASSERT(mxGetClassID(cellPtr) == mxDOUBLE_CLASS, "Expected mxDOUBLE_CLASS for elements of HO parameter");
 			MATLAB_ASSERT(mxGetNumberOfDimensions(cellPtr) == 2, "Elements of HO parameter should be 2-dimensional");
 			MATLAB_ASSERT(mxGetPi(cellPtr) == NULL, "Elements of HO parameter should not be complex");
-			
+
 			mwSize curLength = mxGetM(cellPtr);
 			MATLAB_ASSERT(mxGetN(cellPtr) == 1, "Elements of HO parameter should not be column vectors");
 
@@ -100,7 +229,7 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
 
         MATLAB_ASSERT(mxGetNumberOfDimensions( hopInPtr ) == 2, "HOP should be 2-dimensional");
 		MATLAB_ASSERT(mxGetPi( hopInPtr ) == NULL, "HOP should not be complex");
-			
+
 		MATLAB_ASSERT(mxGetM(hopInPtr) == numHO && mxGetN(hopInPtr) == 2, "HOP parameter should be of size numHO x 2");
 
 		double* curVector = (double*)mxGetData(hopInPtr);
@@ -121,17 +250,42 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
 	//check pairwise terms
 	mwSize numEdges = 0;
 	for (mwIndex c = 0; c < colNum; ++c) {
-			mwIndex rowStart = jc[c]; 
-			mwIndex rowEnd   = jc[c+1]; 
+			mwIndex rowStart = jc[c];
+			mwIndex rowEnd   = jc[c+1];
 			for (mwIndex ri = rowStart; ri < rowEnd; ++ri)  {
 				mwIndex r = ir[ri];
-	
+
 				double dw = pr[ri];
 				if( r < c) numEdges++;
 				MATLAB_ASSERT( dw >=0, "Some Potts edge have negative coefficient!");
 			}
 		}
 
+	problem.numNodes = numNodes;
+	problem.numLabels = numLabels;
+	problem.termW = termW;
+	problem.colNum = colNum;
+	problem.ir = ir;
+	problem.jc = jc;
+	problem.pr = pr;
+	problem.numEdges = numEdges;
+	problem.numHO = numHO;
+}
+
+void solveProblem(const RobustPottsProblem& problem, RobustPottsResult& result)
+{
+	mwSize numNodes = problem.numNodes;
+	mwSize numLabels = problem.numLabels;
+	double* termW = problem.termW;
+	mwIndex colNum = problem.colNum;
+	const mwIndex* ir = problem.ir;
+	const mwIndex* jc = problem.jc;
+	double*        pr = problem.pr;
+	mwSize numEdges = problem.numEdges;
+	int numHO = problem.numHO;
+	const vector< vector< int > >& highOrderInd = problem.highOrderInd;
+	const vector< vector< double > >& highOrderParam = problem.highOrderParam;
+
 	// create the energy
 	Energy<double> *energy = new Energy<double>(numLabels, numNodes, numEdges, numHO);
 
@@ -144,11 +298,11 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
 	//add edges
 	int iEdge = 0;
 	for (mwIndex c = 0; c < colNum; ++c) {
-			mwIndex rowStart = jc[c]; 
-			mwIndex rowEnd   = jc[c+1]; 
+			mwIndex rowStart = jc[c];
+			mwIndex rowEnd   = jc[c+1];
 			for (mwIndex ri = rowStart; ri < rowEnd; ++ri)  {
 				mwIndex r = ir[ri];
-	
+
 				double dw = pr[ri];
 				if( r < c) {
 
@@ -161,12 +315,12 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
 			}
 		}
 
-	
+
 	//initialize number of elements in each segment
 	for( int iHO = 0; iHO < numHO; ++iHO){
 		energy->higherElements[ iHO ] = highOrderInd[ iHO ].size();
 	}
-	
+
 	//allocate energy for higher order indexes
 	energy->AllocateHigherIndexes();
 
@@ -175,7 +329,7 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
 		for (int iNode = 0; iNode < highOrderInd[ iHO ].size(); ++iNode) {
 			energy->higherIndex[ iHO ][ iNode ] = highOrderInd[ iHO ][ iNode ];
 		}
-	
+
 	//initialize truncation ratio Q, gamma_k and gamma_max for each clique
 	for(int iHO = 0; iHO < numHO; ++iHO)
 	{
@@ -183,7 +337,7 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
 		energy->higherTruncation[ iHO ] = highOrderParam[ iHO ][1];
 
 		//gamma_k
-		for(int iLabel = 0; iLabel < numLabels; ++iLabel) 
+		for(int iLabel = 0; iLabel < numLabels; ++iLabel)
 			energy->higherCost[iHO * (numLabels + 1) + iLabel] = 0;
 
 		//gamma_max
@@ -198,44 +352,28 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
 	memset(solution, 0, numNodes * sizeof(int));
 
 	//solve CRF
-	double energyValue = expand->minimize(solution);
-
-	//output the best energy value
-	if(eOutPtr != NULL)	{
-		*eOutPtr = mxCreateNumericMatrix(1, 1, mxDOUBLE_CLASS, mxREAL);
-		*(double*)mxGetData(*eOutPtr) = (double)energyValue;
-	}
-
-	//output the best solution
-	if(sOutPtr != NULL)	{
-		*sOutPtr = mxCreateNumericMatrix(numNodes, 1, mxDOUBLE_CLASS, mxREAL);
-		double* segment = (double*)mxGetData(*sOutPtr);
-		for(int i = 0; i < numNodes; ++i)
-			segment[i] = solution[i] + 1;
-	}
-
-	//output time plot
-	if(timePlotOutPtr != NULL)	{
-		*timePlotOutPtr = mxCreateNumericMatrix(expand->timePlot.size(), 1, mxDOUBLE_CLASS, mxREAL);
-		double* time = (double*)mxGetData(*timePlotOutPtr);
-		for(int i = 0; i < expand->timePlot.size(); ++i)
-			time[i] = expand->timePlot[i];
-	}
+	result.energy = expand->minimize(solution);
 
-	//output energy plot
-	if(energyPlotOutPtr != NULL)	{
-		*energyPlotOutPtr = mxCreateNumericMatrix(expand->energyPlot.size(), 1, mxDOUBLE_CLASS, mxREAL);
-		double* curE = (double*)mxGetData(*energyPlotOutPtr);
-		for(int i = 0; i < expand->energyPlot.size(); ++i)
-			curE[i] = expand->energyPlot[i];
-	}
+	// save solution
+	result.segment.resize(numNodes);
+	for(int i = 0; i < numNodes; ++i)
+		result.segment[i] = solution[i] + 1;
+	result.timePlot.assign(expand->timePlot.begin(), expand->timePlot.end());
+	result.energyPlot.assign(expand->energyPlot.begin(), expand->energyPlot.end());
 
     delete[] solution;
 	delete expand;
 	delete energy;
 }
 
-
+mxArray* createColumn(const vector<double>& values)
+{
+	mxArray* column = mxCreateNumericMatrix(values.size(), 1, mxDOUBLE_CLASS, mxREAL);
+	double* data = (double*)mxGetData(column);
+	for(size_t i = 0; i < values.size(); ++i)
+		data[i] = values[i];
+	return column;
+}
 
 
 inline double round(double a)
@@ -247,4 +385,3 @@ inline int isInteger(double a)
 {
 	return (a - round(a) < 1e-6);
 }
-
@@ -15,6 +15,7 @@
 % Output examples:
 %   [S, E] = alphaExpansionRobustHighOrderPottsMex(U, P, HO, HOC)
 %   [S, E, energyPlot, timePlot] = alphaExpansionRobustHighOrderPottsMex(U, P, HO, HOC)
+%   [S, E] = alphaExpansionRobustHighOrderPottsMex(UBatch, PBatch, HOBatch, HOPBatch, numThreads)
 %   
 % INPUT:
 % 	U		- unary terms (double[numLabels, numNodes])
@@ -27,4 +28,12 @@
 %   E       - energy of labeling S
 % 	energyPlot, timePlot - plots of energy and time
 % 
+% BATCH MODE:
+% 	UBatch		- cell array of unary terms of numProblems independent problems, the problems are solved in parallel
+% 	PBatch		- cell array of the corresponding edge coefficients (or a single sparse matrix shared by all problems)
+% 	HOBatch		- cell array of HO parameters (or a single HO shared by all problems)
+% 	HOPBatch	- cell array of HOP parameters (or a single HOP shared by all problems)
+% 	numThreads	- the number of threads (optional); by default, the environment variable SMR_NUM_THREADS or the number of cores is used
+%   S, energyPlot, timePlot are then numProblems x 1 cell arrays, E is a numProblems x 1 vector.
+% 
 %  Anton Osokin (firstname.lastname@gmail.com),  31.05.2013
@@ -3,4 +3,12 @@ function build_alphaExpansionRobustHighOrderPottsMex
 %
 % Anton Osokin (firstname.lastname@gmail.com),  19.05.2013
 
-mex alphaExpansionRobustHighOrderPottsMex.cpp -output alphaExpansionRobustHighOrderPottsMex -largeArrayDims
+% the batch mode uses std::thread
+threadPoolPath = fullfile('..', 'threadPool');
+mexFlags = [' -I', threadPoolPath, ' '];
+if isunix
+    mexFlags = [mexFlags, ' CXXFLAGS="$CXXFLAGS -std=c++11 -pthread" LDFLAGS="$LDFLAGS -pthread" '];
+end
+
+mexCmd = ['mex alphaExpansionRobustHighOrderPottsMex.cpp -output alphaExpansionRobustHighOrderPottsMex -largeArrayDims', mexFlags];
+eval(mexCmd);
@@ -0,0 +1,158 @@
+#ifndef __EXTREMECUT_H__
+#define __EXTREMECUT_H__
+
+// extremeCut.h - selection of a particular minimum cut after the maxflow is computed
+//
+// If the minimum cut is not unique, Graph::what_segment() returns an arbitrary one (it depends on the search trees).
+// The source-minimal cut is the one with the smallest source set: the nodes reachable from the SOURCE in the residual graph.
+// The sink-minimal cut is the one with the smallest sink set: the nodes from which the SINK is reachable in the residual graph.
+// Any other minimum cut lies between these two.
+//
+// The functions do not call MATLAB API and thus can be run on the thread pool.
+// The header is shared by graphCutMex and graphCutDynamicMex, each of them provides its own graph.h.
+
+#include <vector>
+
+#include "graph.h"
+
+enum CutType
+{
+	CUT_ANY = 0,			// the cut given by what_segment()
+	CUT_SOURCE_MINIMAL = 1,	// the smallest source set, i.e. the largest number of ones in the labeling
+	CUT_SINK_MINIMAL = 2,	// the smallest sink set, i.e. the largest number of zeros in the labeling
+	CUT_BOTH = 3			// two columns: source-minimal and sink-minimal
+};
+
+// number of columns of the labeling for the given cut type
+inline int getNumCutColumns(int cutType)
+{
+	return (cutType == CUT_BOTH) ? 2 : 1;
+}
+
+// the residual graph in the CSR format: the outgoing arcs of node i are outArcs[p], firstArc[i] <= p < firstArc[i + 1];
+// the arcs are created in pairs by add_edge(), so the reverse of arc k is arc (k ^ 1)
+template <typename captype>
+struct ResidualGraph
+{
+	std::vector<int> arcHead;
+	std::vector<captype> arcCap;
+	std::vector<int> firstArc;
+	std::vector<int> outArcs;
+};
+
+template <typename captype, typename tcaptype, typename flowtype>
+void buildResidualGraph(Graph<captype, tcaptype, flowtype>* g, ResidualGraph<captype>& residualGraph)
+{
+	typedef Graph<captype, tcaptype, flowtype> GraphT;
+
+	int numNodes = g -> get_node_num();
+	int numArcs = g -> get_arc_num();
+
+	std::vector<int> arcTail(numArcs);
+	std::vector<int>& arcHead = residualGraph.arcHead;
+	std::vector<captype>& arcCap = residualGraph.arcCap;
+	std::vector<int>& firstArc = residualGraph.firstArc;
+	arcHead.resize(numArcs);
+	arcCap.resize(numArcs);
+	firstArc.assign(numNodes + 1, 0);
+	typename GraphT::arc_id a = g -> get_first_arc();
+	for(int k = 0; k < numArcs; ++k, a = g -> get_next_arc(a))
+	{
+		typename GraphT::node_id i, j;
+		g -> get_arc_ends(a, i, j);
+		arcTail[k] = i;
+		arcHead[k] = j;
+		arcCap[k] = g -> get_rcap(a);
+		++firstArc[i + 1];
+	}
+	for(int i = 0; i < numNodes; ++i)
+		firstArc[i + 1] += firstArc[i];
+
+	std::vector<int>& outArcs = residualGraph.outArcs;
+	outArcs.resize(numArcs);
+	std::vector<int> curPosition(firstArc.begin(), firstArc.end() - 1);
+	for(int k = 0; k < numArcs; ++k)
+		outArcs[curPosition[arcTail[k]]++] = k;
+}
+
+// computes the source-minimal (if fromSource) or the sink-minimal cut by a BFS in the residual graph;
+// segment[i] is 0 (SOURCE) or 1 (SINK)
+template <typename captype, typename tcaptype, typename flowtype, typename LabelT>
+void computeExtremeCut(Graph<captype, tcaptype, flowtype>* g, const ResidualGraph<captype>& residualGraph, bool fromSource, LabelT* segment)
+{
+	typedef Graph<captype, tcaptype, flowtype> GraphT;
+
+	int numNodes = g -> get_node_num();
+	const std::vector<int>& arcHead = residualGraph.arcHead;
+	const std::vector<captype>& arcCap = residualGraph.arcCap;
+	const std::vector<int>& firstArc = residualGraph.firstArc;
+	const std::vector<int>& outArcs = residualGraph.outArcs;
+
+	// BFS from the terminal
+	std::vector<char> reached(numNodes, 0);
+	std::vector<int> queue;
+	queue.reserve(numNodes);
+	for(int i = 0; i < numNodes; ++i)
+	{
+		tcaptype trCap = g -> get_trcap(i);
+		if ((fromSource && trCap > 0) || (!fromSource && trCap < 0))
+		{
+			reached[i] = 1;
+			queue.push_back(i);
+		}
+	}
+
+	for(size_t iQueue = 0; iQueue < queue.size(); ++iQueue)
+	{
+		int i = queue[iQueue];
+		for(int p = firstArc[i]; p < firstArc[i + 1]; ++p)
+		{
+			int k = outArcs[p];
+			int j = arcHead[k];
+			// from the source we go along the arcs i->j, to the sink we go back along the arcs j->i
+			captype residual = fromSource ? arcCap[k] : arcCap[k ^ 1];
+			if (!reached[j] && residual > 0)
+			{
+				reached[j] = 1;
+				queue.push_back(j);
+			}
+		}
+	}
+
+	for(int i = 0; i < numNodes; ++i)
+		if (fromSource)
+			segment[i] = reached[i] ? GraphT::SOURCE : GraphT::SINK;
+		else
+			segment[i] = reached[i] ? GraphT::SINK : GraphT::SOURCE;
+}
+
+// writes the cut of the given type to segment (numNodes x getNumCutColumns(cutType), column-major)
+template <typename captype, typename tcaptype, typename flowtype, typename LabelT>
+void getMinimumCut(Graph<captype, tcaptype, flowtype>* g, int cutType, LabelT* segment)
+{
+	int numNodes = g -> get_node_num();
+	if (cutType != CUT_SOURCE_MINIMAL && cutType != CUT_SINK_MINIMAL && cutType != CUT_BOTH)
+	{
+		for(int i = 0; i < numNodes; i++)
+			segment[i] = g -> what_segment(i);
+		return;
+	}
+
+	// both BFS passes of CUT_BOTH use the same residual graph
+	ResidualGraph<captype> residualGraph;
+	buildResidualGraph(g, residualGraph);
+	switch (cutType)
+	{
+		case CUT_SOURCE_MINIMAL:
+			computeExtremeCut(g, residualGraph, true, segment);
+			break;
+		case CUT_SINK_MINIMAL:
+			computeExtremeCut(g, residualGraph, false, segment);
+			break;
+		default:
+			computeExtremeCut(g, residualGraph, true, segment);
+			computeExtremeCut(g, residualGraph, false, segment + numNodes);
+	}
+}
+
+#endif
@@ -8,8 +8,14 @@ if ~isempty(strfind(mexext, '64'))
     mexFlags = [mexFlags, ' -DA64BITS '];
 end
 maxFlowPath = 'maxflow-v3.03.src';
+threadPoolPath = fullfile('..', 'threadPool');
+extremeCutPath = fullfile('..', 'extremeCut');
 
- mexFlags = [mexFlags, ' -I', maxFlowPath, ' '];
+ mexFlags = [mexFlags, ' -I', maxFlowPath, ' -I', threadPoolPath, ' -I', extremeCutPath, ' '];
+% the batch mode uses std::thread
+if isunix
+    mexFlags = [mexFlags, ' CXXFLAGS="$CXXFLAGS -std=c++11 -pthread" LDFLAGS="$LDFLAGS -pthread" '];
+end
 
 mexcmd = ['mex  src/graphCutDynamicMex.cpp src/graphCutMemory.cpp ', ...
             [maxFlowPath,'/graph.cpp'], ' ', ...
@@ -8,7 +8,7 @@
 % 	deleteGraphCutDynamicMex( graphHandle );
 % 	 
 % 	Inputs:
-% 	graphHandle - a single number given by graphCutDynamicMex
+% 	graphHandle - a single number given by graphCutDynamicMex or an array of handles created in the batch mode
 % 
 %     See also updateUnaryGraphCutDynamicMex, graphCutDynamicMex
 % 
@@ -8,6 +8,9 @@
 %	[cut] = graphCutDynamicMex(unaryTerms, pairwiseTerms);
 % 	[cut, labels] = graphCutDynamicMex(unaryTerms, pairwiseTerms);
 % 	[cut, labels, graphHandle] = graphCutDynamicMex(unaryTerms, pairwiseTerms);
+% 	[cut, labels, graphHandle] = graphCutDynamicMex(unaryTerms, pairwiseTerms, cutType);
+% 	[cut, labels, graphHandle] = graphCutDynamicMex(unaryTermsBatch, pairwiseTerms, numThreads);
+% 	[cut, labels, graphHandle] = graphCutDynamicMex(unaryTermsBatch, pairwiseTerms, cutType, numThreads);
 % 
 % 	if graphHandle is not requested all memory is cleaned up, otherwise function deleteGraphCutDynamicMex needs to be called
 %  
@@ -20,12 +23,25 @@
 % 				edgeWeights(i, 3) connects node #edgeWeights(i, 1) to node #edgeWeights(i, 2)
 % 				edgeWeights(i, 4) connects node #edgeWeights(i, 2) to node #edgeWeights(i, 1)
 %				The only requirement on edge weights is submodularity: edgeWeights(i, 3) + edgeWeights(i, 4) >= 0
+%	cutType	-	which minimum cut to return if there are several of them (string, optional):
+%				'any' (default) - the cut found by the algorithm;
+%				'source' - the source-minimal cut, i.e. the labeling with the largest number of ones;
+%				'sink' - the sink-minimal cut, i.e. the labeling with the largest number of zeros;
+%				'both' - labels has two columns: the source-minimal and the sink-minimal cuts.
 % 
 % 	Outputs:
 % 	cut           -	the minimum cut value (type double)
-% 	labels		-	a vector of length numNodes, where labels(i) is 0 or 1 if node #i belongs to S (source) or T (sink) respectively.
+% 	labels		-	a vector of length numNodes, where labels(i) is 0 or 1 if node #i belongs to S (source) or T (sink) respectively;
+%				a matrix numNodes x 2 if cutType is 'both'.
 % 	graphHandle	- a single number, for direct usage in deleteGraphCutDynamicMex and updateUnaryGraphCutDynamicMex only
 %
+%	Batch mode:
+%	unaryTermsBatch	-	cell array of numProblems unaryTerms matrices; the graphs are constructed and cut in parallel
+%	pairwiseTerms	-	either a single matrix shared by all problems or a cell array of the same size as unaryTermsBatch
+%	numThreads	-	the number of threads (optional); by default, the environment variable SMR_NUM_THREADS or the number of cores is used
+%	In the batch mode, cut and graphHandle are vectors of length numProblems, labels is a cell array of numProblems label vectors.
+%	All the handles can be passed to updateUnaryGraphCutDynamicMex and deleteGraphCutDynamicMex at once.
+%
 % 	To build the code in Matlab choose reasonable compiler and run build_graphCutDymanicMex.m
 % 	Run example_graphCutDymanicMex.m to test the code
 %
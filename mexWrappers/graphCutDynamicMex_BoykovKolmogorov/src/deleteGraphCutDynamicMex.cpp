@@ -10,12 +10,15 @@ void mexFunction(int nlhs, mxArray *plhs[],
     }
 	
 
-	 // get graph handle
-	GraphType *g = NULL;
-    g = getGraphHandle(prhs[0]);
+	 // get graph handles, several graphs created in the batch mode can be deleted at once
+	std::vector<GraphType*> graphs;
+    getGraphHandles(prhs[0], graphs);
 
 	//free memory
-	delete g;
-	g = NULL;
+	for(size_t iGraph = 0; iGraph < graphs.size(); ++iGraph)
+	{
+		delete graphs[iGraph];
+		graphs[iGraph] = NULL;
+	}
 }
 
@@ -1,16 +1,31 @@
 #include "graphCutMemory.h"
 #include "graphCutMex.h"
+#include "extremeCut.h"
 #include "mex.h"
+#include "threadPool.h"
 
 #include <limits>
 #include <cmath>
+#include <vector>
 
+struct GraphCutProblem
+{
+	int numNodes;
+	int numEdges;
+	EnergyTermType* termW;
+	EnergyTermType* edges;
+};
+
+// checks the input and fills problem, called from the MATLAB thread only
+void readProblem(const mxArray* unaryInPtr, const mxArray* pairwiseInPtr, GraphCutProblem& problem);
+// constructs the graph and computes the min cut, does not call MATLAB API and thus can be run on the thread pool
+GraphType* solveProblem(const GraphCutProblem& problem, int cutType, EnergyType* flow, LabelType* segment);
 
-void mexFunction(int nlhs, mxArray *plhs[], 
+void mexFunction(int nlhs, mxArray *plhs[],
     int nrhs, const mxArray *prhs[])
 {
-	if ( nrhs != 2 ) {
-		mexErrMsgIdAndTxt("graphCutDynamicMex:parameters", "Wrong number of input input arguments, expected 2");
+	if ( nrhs < 2 || nrhs > 4 ) {
+		mexErrMsgIdAndTxt("graphCutDynamicMex:parameters", "Wrong number of input input arguments, expected 2 - 4");
     }
 	if (nlhs > 3) {
 		mexErrMsgIdAndTxt("graphCutDynamicMex:parameters", "Too many output arguments, expected 1 - 3");
@@ -19,15 +34,121 @@ void mexFunction(int nlhs, mxArray *plhs[],
 	// set up pointers for input/ output parameters
 	const mxArray* unaryInPtr = prhs[0]; //unary terms
 	const mxArray* pairwiseInPtr = prhs[1]; //pairwise terms
+	const mxArray* numThreadsInPtr = NULL; //number of threads
+	const mxArray* cutTypeInPtr = NULL; //type of the cut
+	getOptionalParameters(nrhs, prhs, &numThreadsInPtr, &cutTypeInPtr);
+	int cutType = getCutType( cutTypeInPtr );
 	mxArray **energyOutPtr = (nlhs > 0) ? &plhs[0] : NULL; //energy
 	mxArray **labelsOutPtr = (nlhs > 1) ? &plhs[1] : NULL; //labeling
 	mxArray **graphHandleOutPtr = (nlhs > 2) ? &plhs[2] : NULL; //graphHandle
 
+	if ( !mxIsCell( unaryInPtr ) ) {
+		if ( mxIsCell( pairwiseInPtr ) ) {
+			mexErrMsgIdAndTxt("graphCutDynamicMex:pairwisePotentials", "pairwiseTerms can be a cell array only in the batch mode");
+		}
+		if ( numThreadsInPtr != NULL && !mxIsEmpty( numThreadsInPtr ) ) {
+			mexErrMsgIdAndTxt("graphCutDynamicMex:numThreads", "numThreads can be specified only in the batch mode");
+		}
+
+		GraphCutProblem problem;
+		readProblem(unaryInPtr, pairwiseInPtr, problem);
+
+		// start computing
+		EnergyType flow = 0;
+		LabelType* segment = NULL;
+		if ( labelsOutPtr != NULL ){
+			*labelsOutPtr = mxCreateNumericMatrix(problem.numNodes, getNumCutColumns(cutType), MATLAB_LABEL_TYPE, mxREAL);
+			segment = (LabelType*)mxGetData( *labelsOutPtr );
+		}
+
+		GraphType *g = solveProblem(problem, cutType, &flow, segment);
+
+		//output minimum value
+		if (energyOutPtr != NULL){
+			*energyOutPtr = mxCreateNumericMatrix(1, 1, MATLAB_ENERGY_TYPE, mxREAL);
+			*(EnergyType*)mxGetData( *energyOutPtr ) = (EnergyType)flow;
+		}
+
+		if ( graphHandleOutPtr != NULL ) {
+				//create a container for the pointer
+				*graphHandleOutPtr = mxCreateNumericMatrix(1, 1, MATLAB_POINTER_TYPE, mxREAL);
+
+				*(GraphHandle*)mxGetData( *graphHandleOutPtr ) = (GraphHandle)g;
+		}
+		else
+			delete g;
+		return;
+	}
+
+	// batch mode: independent graphs are constructed and cut in parallel
+	int numProblems = (int)mxGetNumberOfElements( unaryInPtr );
+	if ( numProblems < 1 ) {
+		mexErrMsgIdAndTxt("graphCutDynamicMex:unaryPotentials", "cell array unaryTerms is empty");
+	}
+	if ( mxIsCell( pairwiseInPtr ) && (int)mxGetNumberOfElements( pairwiseInPtr ) != numProblems ) {
+		mexErrMsgIdAndTxt("graphCutDynamicMex:pairwisePotentials", "cell arrays unaryTerms and pairwiseTerms are of different sizes");
+	}
+	int numThreads = getNumThreads( numThreadsInPtr );
+
+	std::vector<GraphCutProblem> problems(numProblems);
+	for(int iProblem = 0; iProblem < numProblems; ++iProblem)
+	{
+		const mxArray* curUnaryInPtr = mxGetCell(unaryInPtr, iProblem);
+		const mxArray* curPairwiseInPtr = mxIsCell(pairwiseInPtr) ? mxGetCell(pairwiseInPtr, iProblem) : pairwiseInPtr;
+		if ( curUnaryInPtr == NULL || curPairwiseInPtr == NULL ) {
+			mexErrMsgIdAndTxt("graphCutDynamicMex:parameters", "Some cell of the batch is empty");
+		}
+		readProblem(curUnaryInPtr, curPairwiseInPtr, problems[iProblem]);
+	}
+
+	// outputs are allocated before the parallel part
+	std::vector<EnergyType> flows(numProblems, 0);
+	std::vector<LabelType*> segments(numProblems, (LabelType*)NULL);
+	if ( labelsOutPtr != NULL ){
+		*labelsOutPtr = mxCreateCellMatrix(numProblems, 1);
+		for(int iProblem = 0; iProblem < numProblems; ++iProblem)
+		{
+			mxArray* curLabels = mxCreateNumericMatrix(problems[iProblem].numNodes, getNumCutColumns(cutType), MATLAB_LABEL_TYPE, mxREAL);
+			segments[iProblem] = (LabelType*)mxGetData( curLabels );
+			mxSetCell(*labelsOutPtr, iProblem, curLabels);
+		}
+	}
+	std::vector<GraphType*> graphs(numProblems, (GraphType*)NULL);
+
+	try {
+		getThreadPool(numThreads) -> parallelFor(numProblems, [&](int iProblem, int iThread) {
+			graphs[iProblem] = solveProblem(problems[iProblem], cutType, &flows[iProblem], segments[iProblem]);
+		});
+	}
+	catch (...) {
+		mexErrMsgTaskException("graphCutDynamicMex:threadPool");
+	}
+
+	if (energyOutPtr != NULL){
+		*energyOutPtr = mxCreateNumericMatrix(numProblems, 1, MATLAB_ENERGY_TYPE, mxREAL);
+		EnergyType* energy = (EnergyType*)mxGetData( *energyOutPtr );
+		for(int iProblem = 0; iProblem < numProblems; ++iProblem)
+			energy[iProblem] = flows[iProblem];
+	}
+
+	if ( graphHandleOutPtr != NULL ) {
+		*graphHandleOutPtr = mxCreateNumericMatrix(numProblems, 1, MATLAB_POINTER_TYPE, mxREAL);
+		GraphHandle* handles = (GraphHandle*)mxGetData( *graphHandleOutPtr );
+		for(int iProblem = 0; iProblem < numProblems; ++iProblem)
+			handles[iProblem] = (GraphHandle)graphs[iProblem];
+	}
+	else
+		for(int iProblem = 0; iProblem < numProblems; ++iProblem)
+			delete graphs[iProblem];
+}
+
+void readProblem(const mxArray* unaryInPtr, const mxArray* pairwiseInPtr, GraphCutProblem& problem)
+{
 	int numNodes = 0;
 	int numEdges = 0;
 	EnergyTermType* termW = NULL;
 	EnergyTermType* edges = NULL;
-	
+
 	// get unary potentials
 	if ( mxGetClassID( unaryInPtr ) != MATLAB_ENERGYTERM_TYPE ) {
 		mexErrMsgIdAndTxt("graphCutDynamicMex:unaryPotentials", "unaryTerms is of wrong type, expected double");
@@ -39,7 +160,7 @@ void mexFunction(int nlhs, mxArray *plhs[],
 	if ( mxGetN( unaryInPtr ) != 2 ) {
 		mexErrMsgIdAndTxt("graphCutDynamicMex:unaryPotentials","unaryTerms is of wrong size, expected #node x 2");
 	}
-	
+
 	termW = (EnergyTermType*)mxGetData(unaryInPtr);
 
 
@@ -55,19 +176,7 @@ void mexFunction(int nlhs, mxArray *plhs[],
 		mexErrMsgIdAndTxt("graphCutDynamicMex:pairwisePotentials","pairwiseTerms is of wrong size, expected #edges x 4");
 	}
 	edges = (EnergyTermType*)mxGetData(pairwiseInPtr);
-	
-	
-	// start computing
-	
-	//prepare graph
-	GraphType *g = new GraphType( numNodes, numEdges); 
-	
-	for(int i = 0; i < numNodes; ++i)
-	{
-		g -> add_node(); 
-		g -> add_tweights( i, termW[i], termW[numNodes + i]); 
-	}
-	
+
 	for(int i = 0; i < numEdges; ++i)
 		if(edges[i] < 1 || edges[i] > numNodes || edges[numEdges + i] < 1 || edges[numEdges + i] > numNodes || edges[i] == edges[numEdges + i] || !isInteger(edges[i]) || !isInteger(edges[numEdges + i])){
 			mexErrMsgIdAndTxt("graphCutDynamicMex:pairwisePotentialsWrongIndices", "Some edge has invalid vertex numbers");
@@ -76,54 +185,57 @@ void mexFunction(int nlhs, mxArray *plhs[],
 			if(edges[2 * numEdges + i] + edges[3 * numEdges + i] < 0){
 				mexErrMsgIdAndTxt("graphCutDynamicMex:pairwisePotentialsNonsubmodular", "Some edge is non-submodular");
 			}
+
+	problem.numNodes = numNodes;
+	problem.numEdges = numEdges;
+	problem.termW = termW;
+	problem.edges = edges;
+}
+
+GraphType* solveProblem(const GraphCutProblem& problem, int cutType, EnergyType* flow, LabelType* segment)
+{
+	int numNodes = problem.numNodes;
+	int numEdges = problem.numEdges;
+	EnergyTermType* termW = problem.termW;
+	EnergyTermType* edges = problem.edges;
+
+	//prepare graph
+	GraphType *g = new GraphType( numNodes, numEdges);
+
+	for(int i = 0; i < numNodes; ++i)
+	{
+		g -> add_node();
+		g -> add_tweights( i, termW[i], termW[numNodes + i]);
+	}
+
+	// all edges are valid and submodular (checked in readProblem)
+	for(int i = 0; i < numEdges; ++i)
+	{
+		if (edges[2 * numEdges + i] >= 0 && edges[3 * numEdges + i] >= 0)
+			g -> add_edge((GraphType::node_id)round(edges[i] - 1), (GraphType::node_id)round(edges[numEdges + i] - 1), edges[2 * numEdges + i], edges[3 * numEdges + i]);
+		else
+			if (edges[2 * numEdges + i] <= 0 && edges[3 * numEdges + i] >= 0)
+			{
+				g -> add_edge((GraphType::node_id)round(edges[i] - 1), (GraphType::node_id)round(edges[numEdges + i] - 1), 0, edges[3 * numEdges + i] + edges[2 * numEdges + i]);
+				g -> add_tweights((GraphType::node_id)round(edges[i] - 1), 0, edges[2 * numEdges + i]);
+				g -> add_tweights((GraphType::node_id)round(edges[numEdges + i] - 1), 0 , -edges[2 * numEdges + i]);
+			}
 			else
 			{
-				if (edges[2 * numEdges + i] >= 0 && edges[3 * numEdges + i] >= 0)
-					g -> add_edge((GraphType::node_id)round(edges[i] - 1), (GraphType::node_id)round(edges[numEdges + i] - 1), edges[2 * numEdges + i], edges[3 * numEdges + i]);
-				else
-					if (edges[2 * numEdges + i] <= 0 && edges[3 * numEdges + i] >= 0)
-					{
-						g -> add_edge((GraphType::node_id)round(edges[i] - 1), (GraphType::node_id)round(edges[numEdges + i] - 1), 0, edges[3 * numEdges + i] + edges[2 * numEdges + i]);
-						g -> add_tweights((GraphType::node_id)round(edges[i] - 1), 0, edges[2 * numEdges + i]); 
-						g -> add_tweights((GraphType::node_id)round(edges[numEdges + i] - 1), 0 , -edges[2 * numEdges + i]); 
-					}
-					else
-						if (edges[2 * numEdges + i] >= 0 && edges[3 * numEdges + i] <= 0)
-						{
-							g -> add_edge((GraphType::node_id)round(edges[i] - 1), (GraphType::node_id)round(edges[numEdges + i] - 1), edges[3 * numEdges + i] + edges[2 * numEdges + i], 0);
-							g -> add_tweights((GraphType::node_id)round(edges[i] - 1),0 , -edges[3 * numEdges + i]); 
-							g -> add_tweights((GraphType::node_id)round(edges[numEdges + i] - 1), 0, edges[3 * numEdges + i]); 
-						}
-						else
-							mexErrMsgIdAndTxt("computeMarginalsMex:pairwisePotentialsStrangeError", "Something strange with an edge: you should never see this message");
+				g -> add_edge((GraphType::node_id)round(edges[i] - 1), (GraphType::node_id)round(edges[numEdges + i] - 1), edges[3 * numEdges + i] + edges[2 * numEdges + i], 0);
+				g -> add_tweights((GraphType::node_id)round(edges[i] - 1),0 , -edges[3 * numEdges + i]);
+				g -> add_tweights((GraphType::node_id)round(edges[numEdges + i] - 1), 0, edges[3 * numEdges + i]);
 			}
+	}
 
 	//compute flow
-	EnergyType flow = g -> maxflow();
+	*flow = g -> maxflow();
 
-	//output minimum value
-	if (energyOutPtr != NULL){
-		*energyOutPtr = mxCreateNumericMatrix(1, 1, MATLAB_ENERGY_TYPE, mxREAL);
-		*(EnergyType*)mxGetData( *energyOutPtr ) = (EnergyType)flow;
-	}
-
-	
 	//output minimum cut
-	if ( labelsOutPtr != NULL ){
-
-		*labelsOutPtr = mxCreateNumericMatrix(numNodes, 1, MATLAB_LABEL_TYPE, mxREAL);
-		LabelType* segment = (LabelType*)mxGetData( *labelsOutPtr );
-		for(int i = 0; i < numNodes; i++)
-			segment[i] = g -> what_segment(i);
+	if ( segment != NULL ){
+		getMinimumCut(g, cutType, segment);
 	}
 
-	if ( graphHandleOutPtr != NULL ) {
-			//create a container for the pointer 
-			*graphHandleOutPtr = mxCreateNumericMatrix(1, 1, MATLAB_POINTER_TYPE, mxREAL);
-    
-			*(GraphHandle*)mxGetData( *graphHandleOutPtr ) = (GraphHandle)g;
-	}
-	else
-		delete g;
+	return g;
 }
 
@@ -1,31 +1,39 @@
 #include "graphCutMemory.h"
+#include "extremeCut.h"
+
+#include <cstdlib>
+#include <new>
+#include <cstring>
 
 /* memory management */
 void* operator new(size_t size)
 {
     void *ptr = NULL;
 //    mexWarnMsgTxt("Overloaded new operator");
-    ptr = mxMalloc(size);
-    mexMakeMemoryPersistent(ptr);
+    // mxMalloc can not be used here: it is not thread safe 
+    ptr = malloc(size);
+    if ( ptr == NULL ) 
+        throw std::bad_alloc();
     return ptr;
 }
 void* operator new[](size_t size)
 {
     void *ptr = NULL;
 //    mexWarnMsgTxt("Overloaded new[] operator");
-    ptr = mxMalloc(size);
-    mexMakeMemoryPersistent(ptr);
+    ptr = malloc(size);
+    if ( ptr == NULL ) 
+        throw std::bad_alloc();
     return ptr;
 }
 void operator delete(void* ptr)
 {
 //    mexWarnMsgTxt("Overloaded delete operator");
-    mxFree(ptr);
+    free(ptr);
 }
 void operator delete[](void* ptr)
 {
 //    mexWarnMsgTxt("Overloaded delete[] operator");
-    mxFree(ptr);
+    free(ptr);
 }
 
 GraphType* getGraphHandle(const mxArray *x)
@@ -47,3 +55,64 @@ GraphType* getGraphHandle(const mxArray *x)
     }
     return g;
 }
+
+void getGraphHandles(const mxArray *x, std::vector<GraphType*>& graphs)
+{
+    if ( mxGetClassID(x) != MATLAB_POINTER_TYPE ) {
+        mexErrMsgIdAndTxt("graphCutMemory:handleWrongType", "Graph handle argument is not of proper type");
+    }
+    int numGraphs = (int)mxGetNumberOfElements(x);
+    if ( numGraphs < 1 ) {
+        mexErrMsgIdAndTxt("graphCutMemory:handleWrongSize", "No graph handles");
+    }
+
+    POINTER_CAST* gch = (POINTER_CAST*)mxGetData(x);
+    graphs.resize(numGraphs);
+    for(int iGraph = 0; iGraph < numGraphs; ++iGraph) {
+        graphs[iGraph] = (GraphType*)gch[iGraph];
+        if ( graphs[iGraph] == NULL ) {
+            mexErrMsgIdAndTxt("graphCutMemory:badHandle", "Graph handle is not valid");
+        }
+    }
+}
+
+int getNumThreads(const mxArray *x)
+{
+    if ( x == NULL || mxIsEmpty(x) )
+        return 0;
+    double numThreads = 0;
+    GetScalar(x, numThreads);
+    if ( numThreads < 1 || floor(numThreads) != numThreads ) {
+        mexErrMsgIdAndTxt("graphCutMemory:badNumThreads", "The number of threads should be a positive integer");
+    }
+    return (int)round(numThreads);
+}
+
+int getCutType(const mxArray *x)
+{
+    if ( x == NULL )
+        return CUT_ANY;
+    char buf[16];
+    if ( !mxIsChar(x) || mxGetString(x, buf, sizeof(buf)) != 0 ) {
+        mexErrMsgIdAndTxt("graphCutMemory:badCutType", "Unknown type of the cut: expected 'any', 'source', 'sink' or 'both'");
+    }
+    if ( !strcmp(buf, "any") ) return CUT_ANY;
+    if ( !strcmp(buf, "source") ) return CUT_SOURCE_MINIMAL;
+    if ( !strcmp(buf, "sink") ) return CUT_SINK_MINIMAL;
+    if ( !strcmp(buf, "both") ) return CUT_BOTH;
+    mexErrMsgIdAndTxt("graphCutMemory:badCutType", "Unknown type of the cut: expected 'any', 'source', 'sink' or 'both'");
+    return CUT_ANY;
+}
+
+void getOptionalParameters(int nrhs, const mxArray *prhs[], const mxArray** numThreadsInPtr, const mxArray** cutTypeInPtr)
+{
+    *numThreadsInPtr = NULL;
+    *cutTypeInPtr = NULL;
+    for(int iArg = 2; iArg < nrhs; ++iArg) {
+        const mxArray** curInPtr = mxIsChar(prhs[iArg]) ? cutTypeInPtr : numThreadsInPtr;
+        if ( *curInPtr != NULL ) {
+            mexErrMsgIdAndTxt("graphCutMemory:parameters", "The number of threads or the type of the cut is given twice");
+        }
+        *curInPtr = prhs[iArg];
+    }
+}
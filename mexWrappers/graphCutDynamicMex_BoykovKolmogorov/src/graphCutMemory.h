@@ -5,6 +5,7 @@
 #include <tmwtypes.h>
 #include <limits>
 #include <cmath>
+#include <vector>
 
 #include "graphCutMex.h"
 #include "mex.h"
@@ -92,13 +93,19 @@ void GetScalar(const mxArray* x, T& scalar)
     }
 }
 
-/* memory allocations - redirect to MATLAB memory menager */
+/* memory allocations - all three mex-files use the same allocator for the graphs; 
+   the allocator is thread safe because the batch mode builds and cuts graphs on the worker threads */
 void* operator new(size_t size);
 void* operator new[](size_t size);
 void operator delete(void* ptr);
 void operator delete[](void* ptr);
 
 GraphType* getGraphHandle(const mxArray *x); // extract handle from mxArray 
+void getGraphHandles(const mxArray *x, std::vector<GraphType*>& graphs); // extract an array of handles from mxArray 
+int getNumThreads(const mxArray *x); // number of threads for the batch mode, 0 stands for default
+int getCutType(const mxArray *x); // type of the minimum cut (see extremeCut.h), NULL stands for CUT_ANY
+// the optional parameters (number of threads and type of the cut) can go in any order after the first two
+void getOptionalParameters(int nrhs, const mxArray *prhs[], const mxArray** numThreadsInPtr, const mxArray** cutTypeInPtr);
 
 inline double round(double a)
 {
@@ -1,35 +1,130 @@
 #include "graphCutMemory.h"
 #include "graphCutMex.h"
+#include "extremeCut.h"
 #include "mex.h"
+#include "threadPool.h"
 
 #include <limits>
 #include <cmath>
+#include <vector>
+#include <algorithm>
 
+// checks the update, called from the MATLAB thread only
+EnergyTermType* readUpdate(const mxArray* updateInPtr, int numNodes, int* numChanges);
+// apply the update and recompute the min cut, do not call MATLAB API and thus can be run on the thread pool
+void updateGraph(GraphType *g, const EnergyTermType* changes, int numChanges);
+EnergyType recomputeCut(GraphType *g, int cutType, LabelType* segment);
 
 
-
-void mexFunction(int nlhs, mxArray *plhs[], 
+void mexFunction(int nlhs, mxArray *plhs[],
     int nrhs, const mxArray *prhs[])
 {
-	if ( nrhs != 2 ) {
-		mexErrMsgIdAndTxt("updateUnaryGraphCutDynamicMex:parameters","Wrong number of input parameter, expected 2");
+	if ( nrhs < 2 || nrhs > 4 ) {
+		mexErrMsgIdAndTxt("updateUnaryGraphCutDynamicMex:parameters","Wrong number of input parameter, expected 2 - 4");
     }
-	
+
 	// set up pointers for input/ output parameters
 	const mxArray* graphHandleInPtr = prhs[0]; //graphHandle
-	const mxArray* updateInPtr = prhs[1]; // the update array 
+	const mxArray* updateInPtr = prhs[1]; // the update array
+	const mxArray* numThreadsInPtr = NULL; //number of threads
+	const mxArray* cutTypeInPtr = NULL; //type of the cut
+	getOptionalParameters(nrhs, prhs, &numThreadsInPtr, &cutTypeInPtr);
+	int cutType = getCutType( cutTypeInPtr );
 	mxArray **energyOutPtr = (nlhs > 0) ? &plhs[0] : NULL; //energy
 	mxArray **labelsOutPtr = (nlhs > 1) ? &plhs[1] : NULL; //labeling
-	
-	 // get graph handle
-	GraphType *g = NULL;
-    g = getGraphHandle( graphHandleInPtr );
 
-	// get the cnahges
+	if ( mxGetNumberOfElements( graphHandleInPtr ) == 1 && !mxIsCell( updateInPtr ) && numThreadsInPtr == NULL ) {
+		 // get graph handle
+		GraphType *g = NULL;
+		g = getGraphHandle( graphHandleInPtr );
+
+		int numNodes = g -> get_node_num();
+
+		// get the cnahges
+		int numChanges = 0;
+		EnergyTermType* changes = readUpdate(updateInPtr, numNodes, &numChanges);
+
+		//start editing graph
+		updateGraph(g, changes, numChanges);
+
+		if (energyOutPtr == NULL) return;
+
+		LabelType* segment = NULL;
+		if( labelsOutPtr != NULL )	{
+			*labelsOutPtr = mxCreateNumericMatrix(numNodes, getNumCutColumns(cutType), MATLAB_LABEL_TYPE, mxREAL);
+			segment = (LabelType*)mxGetData(*labelsOutPtr);
+		}
+
+		*energyOutPtr = mxCreateNumericMatrix(1, 1, MATLAB_ENERGY_TYPE, mxREAL);
+		*(EnergyType*)mxGetData(*energyOutPtr) = recomputeCut(g, cutType, segment);
+		return;
+	}
+
+	// batch mode: several graphs are updated in parallel
+	std::vector<GraphType*> graphs;
+	getGraphHandles( graphHandleInPtr, graphs );
+	int numGraphs = (int)graphs.size();
+
+	std::vector<GraphType*> sortedGraphs(graphs);
+	std::sort(sortedGraphs.begin(), sortedGraphs.end());
+	if ( std::adjacent_find(sortedGraphs.begin(), sortedGraphs.end()) != sortedGraphs.end() ) {
+		mexErrMsgIdAndTxt("updateUnaryGraphCutDynamicMex:repeatedHandles","graphHandle contains the same graph several times");
+	}
+
+	if ( mxIsCell( updateInPtr ) && (int)mxGetNumberOfElements( updateInPtr ) != numGraphs ) {
+		mexErrMsgIdAndTxt("updateUnaryGraphCutDynamicMex:updateUnaryWrongDimension","cell array updateUnary is not of the same size as graphHandle");
+	}
+	int numThreads = getNumThreads( numThreadsInPtr );
+
+	std::vector<EnergyTermType*> changes(numGraphs, (EnergyTermType*)NULL);
+	std::vector<int> numChanges(numGraphs, 0);
+	for(int iGraph = 0; iGraph < numGraphs; ++iGraph)
+	{
+		const mxArray* curUpdateInPtr = mxIsCell( updateInPtr ) ? mxGetCell( updateInPtr, iGraph ) : updateInPtr;
+		if ( curUpdateInPtr == NULL ) {
+			mexErrMsgIdAndTxt("updateUnaryGraphCutDynamicMex:updateUnaryWrongDimension","Some cell of updateUnary is empty");
+		}
+		changes[iGraph] = readUpdate(curUpdateInPtr, graphs[iGraph] -> get_node_num(), &numChanges[iGraph]);
+	}
+
+	// outputs are allocated before the parallel part
+	std::vector<EnergyType> flows(numGraphs, 0);
+	std::vector<LabelType*> segments(numGraphs, (LabelType*)NULL);
+	if( labelsOutPtr != NULL )	{
+		*labelsOutPtr = mxCreateCellMatrix(numGraphs, 1);
+		for(int iGraph = 0; iGraph < numGraphs; ++iGraph)
+		{
+			mxArray* curLabels = mxCreateNumericMatrix(graphs[iGraph] -> get_node_num(), getNumCutColumns(cutType), MATLAB_LABEL_TYPE, mxREAL);
+			segments[iGraph] = (LabelType*)mxGetData(curLabels);
+			mxSetCell(*labelsOutPtr, iGraph, curLabels);
+		}
+	}
+
+	try {
+		getThreadPool(numThreads) -> parallelFor(numGraphs, [&](int iGraph, int iThread) {
+			updateGraph(graphs[iGraph], changes[iGraph], numChanges[iGraph]);
+			if (energyOutPtr != NULL)
+				flows[iGraph] = recomputeCut(graphs[iGraph], cutType, segments[iGraph]);
+		});
+	}
+	catch (...) {
+		mexErrMsgTaskException("updateUnaryGraphCutDynamicMex:threadPool");
+	}
+
+	if (energyOutPtr != NULL) {
+		*energyOutPtr = mxCreateNumericMatrix(numGraphs, 1, MATLAB_ENERGY_TYPE, mxREAL);
+		EnergyType* energy = (EnergyType*)mxGetData(*energyOutPtr);
+		for(int iGraph = 0; iGraph < numGraphs; ++iGraph)
+			energy[iGraph] = flows[iGraph];
+	}
+}
+
+EnergyTermType* readUpdate(const mxArray* updateInPtr, int numNodes, int* numChanges)
+{
 	if (mxGetNumberOfDimensions( updateInPtr ) != 2)	{
 			mexErrMsgIdAndTxt("updateUnaryGraphCutDynamicMex:updateUnaryWrongDimension","updateUnary is not 2-dimensional");
 	}
-	int numChanges = mxGetM( updateInPtr );
+	*numChanges = mxGetM( updateInPtr );
 	if (mxGetN( updateInPtr ) != 3){
 		mexErrMsgIdAndTxt("updateUnaryGraphCutDynamicMex:updateUnaryWrongDimension","updateUnary is not of size #changes x 3");
 	}
@@ -38,31 +133,30 @@ void mexFunction(int nlhs, mxArray *plhs[],
 	}
 	EnergyTermType* changes = (EnergyTermType*)mxGetData( updateInPtr );
 
-	int numNodes = g -> get_node_num();
-	
-	//start editing graph
-	for(int i = 0; i < numChanges; ++i)
+	for(int i = 0; i < *numChanges; ++i)
 		if(!isInteger(changes[i]) || changes[i] < 1 || changes[i] > numNodes){
 			mexErrMsgIdAndTxt("updateUnaryGraphCutDynamicMex:updateUnaryWrongNodeId", "updateUnary has one nodeId incorrect");
 		}
-		else
-		{
-			GraphType::node_id j = (GraphType::node_id)round(changes[i] - 1);
-			g -> add_tweights(j, changes[i + numChanges], changes[i + 2 * numChanges]);
-			g -> mark_node(j);
-		}
-
-	if (energyOutPtr == NULL) return;
-	
-	*energyOutPtr = mxCreateNumericMatrix(1, 1, MATLAB_ENERGY_TYPE, mxREAL);
-	*(EnergyType*)mxGetData(*energyOutPtr) = (EnergyType)(g -> maxflow(true));
+	return changes;
+}
 
-	if( labelsOutPtr != NULL )	{
-		*labelsOutPtr = mxCreateNumericMatrix(numNodes, 1, MATLAB_LABEL_TYPE, mxREAL);
-		LabelType* segment = (LabelType*)mxGetData(*labelsOutPtr);
-		for(int i = 0; i < numNodes; i++)
-			segment[i] = g -> what_segment(i);
+void updateGraph(GraphType *g, const EnergyTermType* changes, int numChanges)
+{
+	for(int i = 0; i < numChanges; ++i)
+	{
+		GraphType::node_id j = (GraphType::node_id)round(changes[i] - 1);
+		g -> add_tweights(j, changes[i + numChanges], changes[i + 2 * numChanges]);
+		g -> mark_node(j);
 	}
 }
 
+EnergyType recomputeCut(GraphType *g, int cutType, LabelType* segment)
+{
+	EnergyType flow = g -> maxflow(true);
+
+	if( segment != NULL )	{
+		getMinimumCut(g, cutType, segment);
+	}
+	return flow;
+}
 
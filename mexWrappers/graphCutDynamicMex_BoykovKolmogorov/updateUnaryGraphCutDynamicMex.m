@@ -7,14 +7,25 @@
 %	Usage:
 %	[cut] = updateUnaryGraphCutDynamicMex(graphHandle, changedVertices);
 %	[cut, labels] = updateUnaryGraphCutDynamicMex(graphHandle, changedVertices);
+%	[cut, labels] = updateUnaryGraphCutDynamicMex(graphHandle, changedVertices, cutType);
+%	[cut, labels] = updateUnaryGraphCutDynamicMex(graphHandles, changedVertices, numThreads);
+%	[cut, labels] = updateUnaryGraphCutDynamicMex(graphHandles, changedVertices, cutType, numThreads);
 %  
 %	Inputs:
 %	graphHandle - a single number given by graphCutDynamicMex
 %	updateUnary - of type double, array size [numChanges, 3];  ([p, sourceLink, sinkLink]); the extra cost of the terminal links of node #p
+%	cutType		- 'any' (default), 'source', 'sink' or 'both', see graphCutDynamicMex
 % 
 %	Outputs:
 %	cut         -	the minimum cut value (type double)
-%	labels		-	a vector of length numNodes, where labels(i) is 0 or 1 if node #i belongs to S (source) or T (sink) respectively.
+%	labels		-	a vector of length numNodes, where labels(i) is 0 or 1 if node #i belongs to S (source) or T (sink) respectively;
+%					a matrix numNodes x 2 if cutType is 'both'.
+% 
+%	Batch mode (several handles, cell array updateUnary or numThreads given):
+%	graphHandles	- an array of different handles given by graphCutDynamicMex; the graphs are updated and cut in parallel
+%	updateUnary	- either a single update applied to all graphs or a cell array with an update for each graph
+%	numThreads	- the number of threads (optional); by default, the environment variable SMR_NUM_THREADS or the number of cores is used
+%	In the batch mode, cut is a vector and labels is a cell array of label vectors.
 % 
 %	See also deleteGraphCutDynamicMex, graphCutDynamicMex
 % 
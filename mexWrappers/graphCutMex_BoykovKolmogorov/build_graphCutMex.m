@@ -4,6 +4,14 @@ function build_graphCutMex
 % Anton Osokin (firstname.lastname@gmail.com),  19.05.2013
 
 maxFlowPath = 'maxflow-v3.03.src';
+threadPoolPath = fullfile('..', 'threadPool');
+extremeCutPath = fullfile('..', 'extremeCut');
 
-mexCmd = ['mex graphCutMex.cpp -output graphCutMex -largeArrayDims ', '-I', maxFlowPath];
+% the batch mode uses std::thread
+mexFlags = [' -I', threadPoolPath, ' -I', extremeCutPath, ' '];
+if isunix
+    mexFlags = [mexFlags, ' CXXFLAGS="$CXXFLAGS -std=c++11 -pthread" LDFLAGS="$LDFLAGS -pthread" '];
+end
+
+mexCmd = ['mex graphCutMex.cpp -output graphCutMex -largeArrayDims ', '-I', maxFlowPath, mexFlags];
 eval(mexCmd);
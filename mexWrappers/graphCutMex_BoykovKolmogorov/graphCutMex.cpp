@@ -1,9 +1,13 @@
 
 #include "graphCutMex.h"
+#include "extremeCut.h"
 #include "mex.h"
+#include "threadPool.h"
 
 #include <limits>
 #include <cmath>
+#include <cstring>
+#include <vector>
 
 #define INFTY INT_MAX
 
@@ -27,7 +31,7 @@ typedef int LabelType;
 mxClassID MATLAB_LABEL_TYPE = mxINT32_CLASS;
 */
 
-typedef Graph<EnergyTermType,EnergyTermType,EnergyType> GraphType; 
+typedef Graph<EnergyTermType,EnergyTermType,EnergyType> GraphType;
 
 double round(double a);
 int isInteger(double a);
@@ -39,40 +43,145 @@ typedef int mwSize;
 typedef int mwIndex;
 #endif
 
+struct GraphCutProblem
+{
+	int numNodes;
+	mwSize numEdges;
+	EnergyTermType* termW;
+	EnergyTermType* edges;
+};
+
+// checks the input and fills problem, called from the MATLAB thread only
+void readProblem(const mxArray *uInPtr, const mxArray *pInPtr, GraphCutProblem& problem);
+// computes the min cut, does not call MATLAB API and thus can be run on the thread pool
+EnergyType solveProblem(const GraphCutProblem& problem, int cutType, LabelType* segment);
+int getNumThreads(const mxArray *tInPtr);
+int getCutType(const mxArray *cInPtr);
 
 
-void mexFunction(int nlhs, mxArray *plhs[], 
+void mexFunction(int nlhs, mxArray *plhs[],
     int nrhs, const mxArray *prhs[])
 {
-	MATLAB_ASSERT( nrhs == 2, "graphCutMex: Wrong number of input parameters: expected 2");
+	MATLAB_ASSERT( nrhs >= 2 && nrhs <= 4, "graphCutMex: Wrong number of input parameters: expected 2 - 4");
     MATLAB_ASSERT( nlhs <= 2, "graphCutMex: Too many output arguments: expected 2 or less");
-	
+
 	//Fix input parameter order:
 	const mxArray *uInPtr = (nrhs >= 1) ? prhs[0] : NULL; //unary
 	const mxArray *pInPtr = (nrhs >= 2) ? prhs[1] : NULL; //pairwise
-	
+
+	// the optional parameters can go in any order
+	const mxArray *tInPtr = NULL; //number of threads
+	const mxArray *cInPtr = NULL; //type of the cut
+	for(int iArg = 2; iArg < nrhs; ++iArg)
+		if (mxIsChar(prhs[iArg]))
+		{
+			MATLAB_ASSERT(cInPtr == NULL, "graphCutMex: The type of the cut is given twice");
+			cInPtr = prhs[iArg];
+		}
+		else
+		{
+			MATLAB_ASSERT(tInPtr == NULL, "graphCutMex: The number of threads is given twice");
+			tInPtr = prhs[iArg];
+		}
+	int cutType = getCutType(cInPtr);
+
 	//Fix output parameter order:
 	mxArray **cOutPtr = (nlhs >= 1) ? &plhs[0] : NULL; //cut
 	mxArray **lOutPtr = (nlhs >= 2) ? &plhs[1] : NULL; //labels
 
+	if (!mxIsCell(uInPtr))
+	{
+		MATLAB_ASSERT(!mxIsCell(pInPtr), "graphCutMex: Pairwise potentials can be a cell array only in the batch mode");
+		MATLAB_ASSERT(tInPtr == NULL || mxIsEmpty(tInPtr), "graphCutMex: The number of threads can be specified only in the batch mode");
+
+		GraphCutProblem problem;
+		readProblem(uInPtr, pInPtr, problem);
+
+		// start computing
+		if (nlhs == 0){
+			return;
+		}
+
+		LabelType* segment = NULL;
+		if (lOutPtr != NULL){
+			*lOutPtr = mxCreateNumericMatrix(problem.numNodes, getNumCutColumns(cutType), MATLAB_LABEL_TYPE, mxREAL);
+			segment = (LabelType*)mxGetData(*lOutPtr);
+		}
+
+		EnergyType flow = solveProblem(problem, cutType, segment);
+
+		//output minimum value
+		if (cOutPtr != NULL){
+			*cOutPtr = mxCreateNumericMatrix(1, 1, MATLAB_ENERGY_TYPE, mxREAL);
+			*(EnergyType*)mxGetData(*cOutPtr) = (EnergyType)flow;
+		}
+		return;
+	}
+
+	// batch mode: independent problems are solved in parallel
+	int numProblems = (int)mxGetNumberOfElements(uInPtr);
+	MATLAB_ASSERT(numProblems >= 1, "graphCutMex: The cell array of unary potentials is empty");
+	MATLAB_ASSERT(!mxIsCell(pInPtr) || (int)mxGetNumberOfElements(pInPtr) == numProblems, "graphCutMex: The cell arrays of unary and pairwise potentials are of different sizes");
+	int numThreads = getNumThreads(tInPtr);
+
+	std::vector<GraphCutProblem> problems(numProblems);
+	for(int iProblem = 0; iProblem < numProblems; ++iProblem)
+	{
+		const mxArray *curUInPtr = mxGetCell(uInPtr, iProblem);
+		const mxArray *curPInPtr = mxIsCell(pInPtr) ? mxGetCell(pInPtr, iProblem) : pInPtr;
+		MATLAB_ASSERT(curUInPtr != NULL && curPInPtr != NULL, "graphCutMex: Some cell of the batch is empty");
+		readProblem(curUInPtr, curPInPtr, problems[iProblem]);
+	}
+
+	if (nlhs == 0){
+		return;
+	}
+
+	// outputs are allocated before the parallel part
+	*cOutPtr = mxCreateNumericMatrix(numProblems, 1, MATLAB_ENERGY_TYPE, mxREAL);
+	EnergyType* cut = (EnergyType*)mxGetData(*cOutPtr);
+
+	std::vector<LabelType*> segments(numProblems, (LabelType*)NULL);
+	if (lOutPtr != NULL){
+		*lOutPtr = mxCreateCellMatrix(numProblems, 1);
+		for(int iProblem = 0; iProblem < numProblems; ++iProblem)
+		{
+			mxArray* curLabels = mxCreateNumericMatrix(problems[iProblem].numNodes, getNumCutColumns(cutType), MATLAB_LABEL_TYPE, mxREAL);
+			segments[iProblem] = (LabelType*)mxGetData(curLabels);
+			mxSetCell(*lOutPtr, iProblem, curLabels);
+		}
+	}
+
+	try {
+		getThreadPool(numThreads) -> parallelFor(numProblems, [&](int iProblem, int iThread) {
+			cut[iProblem] = solveProblem(problems[iProblem], cutType, segments[iProblem]);
+		});
+	}
+	catch (...) {
+		mexErrMsgTaskException("graphCutMex:threadPool");
+	}
+}
+
+void readProblem(const mxArray *uInPtr, const mxArray *pInPtr, GraphCutProblem& problem)
+{
 	 //node number
 	int numNodes;
-    
+
 	// get unary potentials
 	MATLAB_ASSERT(mxGetNumberOfDimensions(uInPtr) == 2, "graphCutMex: The first paramater is not 2-dimensional");
 	MATLAB_ASSERT(mxGetClassID(uInPtr) == MATLAB_ENERGYTERM_TYPE, "graphCutMex: Unary potentials are of wrong type");
 	MATLAB_ASSERT(mxGetPi(uInPtr) == NULL, "graphCutMex: Unary potentials should not be complex");
-	
+
 	numNodes = mxGetM(uInPtr);
-	
+
 	MATLAB_ASSERT(numNodes >= 1, "graphCutMex: The number of nodes is not positive");
 	MATLAB_ASSERT(mxGetN(uInPtr) == 2, "graphCutMex: The first paramater is not of size #nodes x 2");
-	
+
 	EnergyTermType* termW = (EnergyTermType*)mxGetData(uInPtr);
 
 	//get pairwise potentials
 	MATLAB_ASSERT(mxGetNumberOfDimensions(pInPtr) == 2, "graphCutMex: The second paramater is not 2-dimensional");
-	
+
 	mwSize numEdges = mxGetM(pInPtr);
 
 	MATLAB_ASSERT( mxGetN(pInPtr) == 4, "graphCutMex: The second paramater is not of size #edges x 4");
@@ -88,69 +197,91 @@ void mexFunction(int nlhs, mxArray *plhs[],
 		MATLAB_ASSERT(edges[i + 2 * numEdges] + edges[i + 3 * numEdges] >= 0, "graphCutMex: error in pairwise terms array: nonsubmodular edge");
 	}
 
+	// the warning is issued here because solveProblem can be run outside of the MATLAB thread
+	for(int i = 0; i < numEdges; i++)
+		if(edges[i] == edges[numEdges + i]){
+			mexWarnMsgIdAndTxt("graphCutMex:pairwisePotentials", "Some edge has invalid vertex numbers and therefore it is ignored");
+			break;
+		}
 
-	// start computing
-	if (nlhs == 0){
-		return;
-	}
+	problem.numNodes = numNodes;
+	problem.numEdges = numEdges;
+	problem.termW = termW;
+	problem.edges = edges;
+}
+
+EnergyType solveProblem(const GraphCutProblem& problem, int cutType, LabelType* segment)
+{
+	int numNodes = problem.numNodes;
+	mwSize numEdges = problem.numEdges;
+	EnergyTermType* termW = problem.termW;
+	EnergyTermType* edges = problem.edges;
 
 	//prepare graph
-	GraphType *g = new GraphType( numNodes, numEdges); 
-	
+	GraphType *g = new GraphType( numNodes, numEdges);
+
 	for(int i = 0; i < numNodes; i++)
 	{
-		g -> add_node(); 
-		g -> add_tweights( i, termW[i], termW[numNodes + i]); 
+		g -> add_node();
+		g -> add_tweights( i, termW[i], termW[numNodes + i]);
 	}
-	
+
+	// all edges are valid and submodular (checked in readProblem), loops are ignored
 	for(int i = 0; i < numEdges; i++)
-		if(edges[i] < 1 || edges[i] > numNodes || edges[numEdges + i] < 1 || edges[numEdges + i] > numNodes || edges[i] == edges[numEdges + i] || !isInteger(edges[i]) || !isInteger(edges[numEdges + i])){
-			mexWarnMsgIdAndTxt("graphCutMex:pairwisePotentials", "Some edge has invalid vertex numbers and therefore it is ignored");
-		}
-		else
-			if(edges[2 * numEdges + i] + edges[3 * numEdges + i] < 0){
-				mexWarnMsgIdAndTxt("graphCutMex:pairwisePotentials", "Some edge is non-submodular and therefore it is ignored");
-			}
+		if(edges[i] != edges[numEdges + i])
+		{
+			if (edges[2 * numEdges + i] >= 0 && edges[3 * numEdges + i] >= 0)
+				g -> add_edge((GraphType::node_id)round(edges[i] - 1), (GraphType::node_id)round(edges[numEdges + i] - 1), edges[2 * numEdges + i], edges[3 * numEdges + i]);
 			else
-			{
-				if (edges[2 * numEdges + i] >= 0 && edges[3 * numEdges + i] >= 0)
-					g -> add_edge((GraphType::node_id)round(edges[i] - 1), (GraphType::node_id)round(edges[numEdges + i] - 1), edges[2 * numEdges + i], edges[3 * numEdges + i]);
+				if (edges[2 * numEdges + i] <= 0 && edges[3 * numEdges + i] >= 0)
+				{
+					g -> add_edge((GraphType::node_id)round(edges[i] - 1), (GraphType::node_id)round(edges[numEdges + i] - 1), 0, edges[3 * numEdges + i] + edges[2 * numEdges + i]);
+					g -> add_tweights((GraphType::node_id)round(edges[i] - 1), 0, edges[2 * numEdges + i]);
+					g -> add_tweights((GraphType::node_id)round(edges[numEdges + i] - 1),0 , -edges[2 * numEdges + i]);
+				}
 				else
-					if (edges[2 * numEdges + i] <= 0 && edges[3 * numEdges + i] >= 0)
+					if (edges[2 * numEdges + i] >= 0 && edges[3 * numEdges + i] <= 0)
 					{
-						g -> add_edge((GraphType::node_id)round(edges[i] - 1), (GraphType::node_id)round(edges[numEdges + i] - 1), 0, edges[3 * numEdges + i] + edges[2 * numEdges + i]);
-						g -> add_tweights((GraphType::node_id)round(edges[i] - 1), 0, edges[2 * numEdges + i]); 
-						g -> add_tweights((GraphType::node_id)round(edges[numEdges + i] - 1),0 , -edges[2 * numEdges + i]); 
+						g -> add_edge((GraphType::node_id)round(edges[i] - 1), (GraphType::node_id)round(edges[numEdges + i] - 1), edges[3 * numEdges + i] + edges[2 * numEdges + i], 0);
+						g -> add_tweights((GraphType::node_id)round(edges[i] - 1),0 , -edges[3 * numEdges + i]);
+						g -> add_tweights((GraphType::node_id)round(edges[numEdges + i] - 1), 0, edges[3 * numEdges + i]);
 					}
-					else
-						if (edges[2 * numEdges + i] >= 0 && edges[3 * numEdges + i] <= 0)
-						{
-							g -> add_edge((GraphType::node_id)round(edges[i] - 1), (GraphType::node_id)round(edges[numEdges + i] - 1), edges[3 * numEdges + i] + edges[2 * numEdges + i], 0);
-							g -> add_tweights((GraphType::node_id)round(edges[i] - 1),0 , -edges[3 * numEdges + i]); 
-							g -> add_tweights((GraphType::node_id)round(edges[numEdges + i] - 1), 0, edges[3 * numEdges + i]); 
-						}
-						else
-							mexWarnMsgIdAndTxt("graphCutMex:pairwisePotentials", "Something strange with an edge and therefore it is ignored");
-			}
+		}
 
 	//compute flow
 	EnergyType flow = g -> maxflow();
 
-	//output minimum value
-	if (cOutPtr != NULL){
-		*cOutPtr = mxCreateNumericMatrix(1, 1, MATLAB_ENERGY_TYPE, mxREAL);
-		*(EnergyType*)mxGetData(*cOutPtr) = (EnergyType)flow;
-	}
-
 	//output minimum cut
-	if (lOutPtr != NULL){
-		*lOutPtr = mxCreateNumericMatrix(numNodes, 1, MATLAB_LABEL_TYPE, mxREAL);
-		LabelType* segment = (LabelType*)mxGetData(*lOutPtr);
-		for(int i = 0; i < numNodes; i++)
-			segment[i] = g -> what_segment(i);
+	if (segment != NULL){
+		getMinimumCut(g, cutType, segment);
 	}
-    
+
     delete g;
+	return flow;
+}
+
+int getNumThreads(const mxArray *tInPtr)
+{
+	if (tInPtr == NULL || mxIsEmpty(tInPtr))
+		return 0;
+	MATLAB_ASSERT(mxIsNumeric(tInPtr) && mxGetNumberOfElements(tInPtr) == 1, "graphCutMex: The number of threads should be a numeric scalar");
+	double numThreads = mxGetScalar(tInPtr);
+	MATLAB_ASSERT(numThreads >= 1 && floor(numThreads) == numThreads, "graphCutMex: The number of threads should be a positive integer");
+	return (int)round(numThreads);
+}
+
+int getCutType(const mxArray *cInPtr)
+{
+	if (cInPtr == NULL)
+		return CUT_ANY;
+	char buf[16];
+	MATLAB_ASSERT(mxGetString(cInPtr, buf, sizeof(buf)) == 0, "graphCutMex: Unknown type of the cut: expected 'any', 'source', 'sink' or 'both'");
+	if (!strcmp(buf, "any")) return CUT_ANY;
+	if (!strcmp(buf, "source")) return CUT_SOURCE_MINIMAL;
+	if (!strcmp(buf, "sink")) return CUT_SINK_MINIMAL;
+	if (!strcmp(buf, "both")) return CUT_BOTH;
+	mexErrMsgTxt("graphCutMex: Unknown type of the cut: expected 'any', 'source', 'sink' or 'both'");
+	return CUT_ANY;
 }
 
 double round(double a)
@@ -163,3 +294,4 @@ int isInteger(double a)
 {
 	return (abs(a - round(a)) < 1e-6);
 }
+
@@ -10,6 +10,9 @@
 % Usage:
 % [cut] = graphCutMex(termWeights, edgeWeights);
 % [cut, labels] = graphCutMex(termWeights, edgeWeights);
+% [cut, labels] = graphCutMex(termWeights, edgeWeights, cutType);
+% [cut, labels] = graphCutMex(termWeightsBatch, edgeWeights, numThreads);
+% [cut, labels] = graphCutMex(termWeightsBatch, edgeWeights, cutType, numThreads);
 % 
 % Inputs:
 % termWeights	-	the edges connecting the source and the sink with the regular nodes (array of type double, size : [numNodes, 2])
@@ -20,10 +23,25 @@
 % 				edgeWeights(i, 3) connects node #edgeWeights(i, 1) to node #edgeWeights(i, 2)
 % 				edgeWeights(i, 4) connects node #edgeWeights(i, 2) to node #edgeWeights(i, 1)
 %				The only requirement on edge weights is submodularity: edgeWeights(i, 3) + edgeWeights(i, 4) >= 0
+% cutType	-	which minimum cut to return if there are several of them (string, optional):
+%				'any' (default) - the cut found by the algorithm;
+%				'source' - the source-minimal cut, i.e. the labeling with the largest number of ones;
+%				'sink' - the sink-minimal cut, i.e. the labeling with the largest number of zeros;
+%				'both' - labels has two columns: the source-minimal and the sink-minimal cuts.
+%				The extreme cuts are found by a BFS in the residual graph from the corresponding terminal.
+%
+% Batch mode:
+% termWeightsBatch	-	cell array of numProblems termWeights matrices; the problems are solved in parallel
+% edgeWeights	-	can be either a single edgeWeights matrix shared by all problems or a cell array of the same size as termWeightsBatch
+% numThreads	-	the number of threads (optional);
+%				by default, the environment variable SMR_NUM_THREADS or the number of cores is used.
+%				The worker threads are kept alive between the calls and are stopped on "clear graphCutMex".
+% In the batch mode, cut is a vector of length numProblems and labels is a cell array of numProblems label vectors.
 %
 % Outputs:
 % cut           -	the minimum cut value (type double)
-% labels		-	a vector of length numNodes, where labels(i) is 0 or 1 if node #i belongs to S (source) or T (sink) respectively.
+% labels		-	a vector of length numNodes, where labels(i) is 0 or 1 if node #i belongs to S (source) or T (sink) respectively;
+%				a matrix numNodes x 2 if cutType is 'both'.
 % 
 % To build the code in Matlab choose reasonable compiler and run build_graphCutMex.m
 % Run example_graphCutMex.m to test the code
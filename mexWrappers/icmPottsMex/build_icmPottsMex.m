@@ -3,4 +3,12 @@ function build_icmPottsMex
 %
 % Anton Osokin (firstname.lastname@gmail.com),  14.10.2014
 
-mex icmPottsMex.cpp -output icmPottsMex -largeArrayDims
+% the batch mode uses std::thread
+threadPoolPath = fullfile('..', 'threadPool');
+mexFlags = [' -I', threadPoolPath, ' '];
+if isunix
+    mexFlags = [mexFlags, ' CXXFLAGS="$CXXFLAGS -std=c++11 -pthread" LDFLAGS="$LDFLAGS -pthread" '];
+end
+
+mexCmd = ['mex icmPottsMex.cpp -output icmPottsMex -largeArrayDims', mexFlags];
+eval(mexCmd);
@@ -20,3 +20,21 @@ if ~isequal(labels, [2; 2])
     warning('Wrong value of labels!')
 end
 
+
+% worklist mode: only the neighbors of the changed nodes are revisited
+[energy, labels] = icmPottsMex(dataCost, neighbors, [1; 2], maxIter, [], 'worklist');
+if ~isequal(energy, 1)
+    warning('Wrong value of energy in the worklist mode!')
+end
+if ~isequal(labels, [2; 2])
+    warning('Wrong value of labels in the worklist mode!')
+end
+
+% colored mode: the color classes are updated in parallel
+[energy, labels] = icmPottsMex(dataCost, neighbors, [1; 2], maxIter, 2, 'colored');
+if ~isequal(energy, 1)
+    warning('Wrong value of energy in the colored mode!')
+end
+if ~isequal(labels, [2; 2])
+    warning('Wrong value of labels in the colored mode!')
+end
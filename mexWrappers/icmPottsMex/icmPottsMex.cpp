@@ -1,20 +1,71 @@
 
 #include "mex.h"
+#include "threadPool.h"
 
 #include <vector>
 using std::vector;
 
 #include <cmath>
+#include <cstring>
 
 #define MATLAB_ASSERT(expr,errorId,msg) if (!(expr)) {mexErrMsgIdAndTxt(errorId,msg);}
 
 double round(double a);
 int isInteger(double a);
 
-void mexFunction(int nlhs, mxArray *plhs[], 
+enum IcmMode
+{
+	ICM_SWEEP,		// all nodes are visited in their natural order in every sweep
+	ICM_WORKLIST,	// only the neighbors of the changed nodes are revisited
+	ICM_COLORED		// the color classes of a greedy coloring are visited one by one, the nodes of one class are updated in parallel
+};
+
+struct IcmProblem
+{
+	int numNodes;
+	int numLabels;
+	double* dataCost;
+
+	mwIndex colNum;
+	const mwIndex* ir;
+	const mwIndex* jc;
+	double* pr;
+
+	vector<int> initLabeling;
+	int maxIter;
+	IcmMode mode;
+};
+
+// buffers reused by the consecutive problems processed by one thread
+struct IcmWorkspace
+{
+	vector<int> labeling;
+	// the adjacency in the CSR format: the neighbors of node i are neighborIds[k] with weights neighborWeights[k], neighborsBegin[i] <= k < neighborsBegin[i + 1]
+	vector<mwIndex> neighborsBegin;
+	vector<int> neighborIds;
+	vector<double> neighborWeights;
+	vector<double> labelWeights; // the total weight of the neighbors of the current node at every label, zero between the nodes
+	// the worklist mode: a FIFO queue of the nodes to be visited stored as a ring buffer, each node is in the queue at most once
+	vector<int> queue;
+	vector<char> isInQueue;
+	// the colored mode: the nodes of color c are colorNodes[k], colorsBegin[c] <= k < colorsBegin[c + 1], sorted by the node index
+	vector<int> nodeColors;
+	vector<int> colorsBegin;
+	vector<int> colorNodes;
+	vector<double> threadLabelWeights; // labelWeights of every thread of the pool
+	vector<char> isChangedByThread;
+};
+
+// checks the input and fills problem (including the random initial labeling), called from the MATLAB thread only
+void readProblem(const mxArray* unaryInPtr, const mxArray* pairwiseInPtr, const mxArray* initLabelsInPtr, int maxIter, IcmMode mode, IcmProblem& problem);
+// runs ICM, does not call MATLAB API and thus can be run on the thread pool;
+// in the colored mode the color classes are processed on pool (if not NULL), the result does not depend on the number of threads
+double runIcm(const IcmProblem& problem, IcmWorkspace& workspace, double* segment, ThreadPool* pool = NULL);
+
+void mexFunction(int nlhs, mxArray *plhs[],
     int nrhs, const mxArray *prhs[])
 {
-	MATLAB_ASSERT( nrhs >= 2  && nrhs <= 4, "icmPottsMex:inputParameters", "Wrong number of input input arguments, expected 2 - 4");
+	MATLAB_ASSERT( nrhs >= 2  && nrhs <= 6, "icmPottsMex:inputParameters", "Wrong number of input input arguments, expected 2 - 6");
 	MATLAB_ASSERT( nlhs <= 2, "icmPottsMex:outputParameters", "Too many output arguments, expected 0 - 2");
 
 	// set up pointers for input/ output parameters
@@ -22,15 +73,134 @@ void mexFunction(int nlhs, mxArray *plhs[],
 	const mxArray* pairwiseInPtr = prhs[1]; //pairwise terms
 	const mxArray* initLabelsInPtr = (nrhs > 2) ? prhs[2] : NULL; // the initial labeling
 	const mxArray* maxNumIterInPtr = (nrhs > 3) ? prhs[3] : NULL; // the maximum number of iterations
+	const mxArray* numThreadsInPtr = (nrhs > 4) ? prhs[4] : NULL; // the number of threads
+	const mxArray* modeInPtr = (nrhs > 5) ? prhs[5] : NULL; // 'sweep', 'worklist' or 'colored'
 
 	mxArray **energyOutPtr = (nlhs > 0) ? &plhs[0] : NULL; //energy
 	mxArray **labelsOutPtr = (nlhs > 1) ? &plhs[1] : NULL; //labeling
-	
+
+	int maxIter = 10;
+
+	// get the maximum number of iterations
+	if ( maxNumIterInPtr != NULL) {
+		if ( !mxIsEmpty(maxNumIterInPtr) ) {
+			MATLAB_ASSERT(  mxGetClassID( maxNumIterInPtr ) == mxDOUBLE_CLASS, "icmPottsMex:maxNumIterWrongType", "maxNumIter is of wrong type, expected double");
+			MATLAB_ASSERT(  mxGetPi(maxNumIterInPtr) == NULL, "icmPottsMex:maxNumIterComplex",  "maxNumIter should not be complex");
+			MATLAB_ASSERT(  mxGetNumberOfElements( maxNumIterInPtr ) == 1, "icmPottsMex:maxNumIterWrongSize", "maxNumIter is not scalar");
+
+			maxIter = (int)(*((double*) mxGetData( maxNumIterInPtr )));
+			MATLAB_ASSERT( maxIter >= 0 , "icmPottsMex:maxNumIterNegativeValue", "maxNumIter is negative");
+		}
+	}
+
+	// get the mode
+	IcmMode mode = ICM_SWEEP;
+	if ( modeInPtr != NULL && !mxIsEmpty(modeInPtr) ) {
+		MATLAB_ASSERT( mxIsChar(modeInPtr), "icmPottsMex:modeWrongType", "mode should be a string");
+		char modeName[16];
+		MATLAB_ASSERT( mxGetString(modeInPtr, modeName, sizeof(modeName)) == 0, "icmPottsMex:modeWrongValue", "mode should be 'sweep', 'worklist' or 'colored'");
+		if ( strcmp(modeName, "worklist") == 0 ) {
+			mode = ICM_WORKLIST;
+		} else if ( strcmp(modeName, "colored") == 0 ) {
+			mode = ICM_COLORED;
+		} else {
+			MATLAB_ASSERT( strcmp(modeName, "sweep") == 0, "icmPottsMex:modeWrongValue", "mode should be 'sweep', 'worklist' or 'colored'");
+		}
+	}
+
+	int numThreads = 0;
+	if (numThreadsInPtr != NULL && !mxIsEmpty(numThreadsInPtr)) {
+		MATLAB_ASSERT( mxIsNumeric(numThreadsInPtr) && mxGetNumberOfElements(numThreadsInPtr) == 1, "icmPottsMex:numThreadsWrongType", "numThreads should be a numeric scalar");
+		double numThreadsValue = mxGetScalar(numThreadsInPtr);
+		MATLAB_ASSERT( numThreadsValue >= 1 && floor(numThreadsValue) == numThreadsValue, "icmPottsMex:numThreadsWrongValue", "numThreads should be a positive integer");
+		numThreads = (int)numThreadsValue;
+	}
+
+	if ( !mxIsCell(unaryInPtr) ) {
+		MATLAB_ASSERT( !mxIsCell(pairwiseInPtr) && (initLabelsInPtr == NULL || !mxIsCell(initLabelsInPtr)), "icmPottsMex:inputParameters", "Cell arrays are accepted only in the batch mode");
+		MATLAB_ASSERT( numThreads == 0 || mode == ICM_COLORED, "icmPottsMex:inputParameters", "numThreads can be specified only in the batch mode or in the colored mode");
+
+		IcmProblem problem;
+		readProblem(unaryInPtr, pairwiseInPtr, initLabelsInPtr, maxIter, mode, problem);
+
+		// start computing
+		double* segment = NULL;
+		if ( labelsOutPtr != NULL ){
+			*labelsOutPtr = mxCreateNumericMatrix(problem.numNodes, 1, mxDOUBLE_CLASS, mxREAL);
+			segment = (double*)mxGetData( *labelsOutPtr );
+		}
+
+		IcmWorkspace workspace;
+		double energy = 0.0;
+		try {
+			energy = runIcm(problem, workspace, segment, (mode == ICM_COLORED) ? getThreadPool(numThreads) : NULL);
+		}
+		catch (...) {
+			mexErrMsgTaskException("icmPottsMex:threadPool");
+		}
+
+		//output minimum value
+		if (energyOutPtr != NULL){
+			*energyOutPtr = mxCreateNumericMatrix(1, 1, mxDOUBLE_CLASS, mxREAL);
+			*(double*)mxGetData( *energyOutPtr ) = energy;
+		}
+		return;
+	}
+
+	// batch mode: independent problems are processed in parallel
+	int numProblems = (int)mxGetNumberOfElements(unaryInPtr);
+	MATLAB_ASSERT( numProblems >= 1, "icmPottsMex:unaryPotentialsWrongType", "cell array unaryTerms is empty");
+	MATLAB_ASSERT( !mxIsCell(pairwiseInPtr) || (int)mxGetNumberOfElements(pairwiseInPtr) == numProblems, "icmPottsMex:pairwisePotentialsWrongSize", "Cell arrays unaryTerms and pairwiseTerms are of different sizes");
+	bool isInitLabelsCell = initLabelsInPtr != NULL && mxIsCell(initLabelsInPtr);
+	MATLAB_ASSERT( !isInitLabelsCell || (int)mxGetNumberOfElements(initLabelsInPtr) == numProblems, "icmPottsMex:initLabelsWrongSize", "Cell arrays unaryTerms and initLabels are of different sizes");
+
+	vector<IcmProblem> problems(numProblems);
+	for(int iProblem = 0; iProblem < numProblems; ++iProblem) {
+		const mxArray* curUnaryInPtr = mxGetCell(unaryInPtr, iProblem);
+		const mxArray* curPairwiseInPtr = mxIsCell(pairwiseInPtr) ? mxGetCell(pairwiseInPtr, iProblem) : pairwiseInPtr;
+		const mxArray* curInitLabelsInPtr = isInitLabelsCell ? mxGetCell(initLabelsInPtr, iProblem) : initLabelsInPtr;
+		MATLAB_ASSERT( curUnaryInPtr != NULL && curPairwiseInPtr != NULL, "icmPottsMex:inputParameters", "Some cell of the batch is empty");
+		readProblem(curUnaryInPtr, curPairwiseInPtr, curInitLabelsInPtr, maxIter, mode, problems[iProblem]);
+	}
+
+	// outputs are allocated before the parallel part
+	mxArray* energyArray = mxCreateNumericMatrix(numProblems, 1, mxDOUBLE_CLASS, mxREAL);
+	double* energy = (double*)mxGetData( energyArray );
+	if (energyOutPtr != NULL)
+		*energyOutPtr = energyArray;
+
+	vector<double*> segments(numProblems, (double*)NULL);
+	if ( labelsOutPtr != NULL ){
+		*labelsOutPtr = mxCreateCellMatrix(numProblems, 1);
+		for(int iProblem = 0; iProblem < numProblems; ++iProblem) {
+			mxArray* curLabels = mxCreateNumericMatrix(problems[iProblem].numNodes, 1, mxDOUBLE_CLASS, mxREAL);
+			segments[iProblem] = (double*)mxGetData( curLabels );
+			mxSetCell(*labelsOutPtr, iProblem, curLabels);
+		}
+	}
+
+	ThreadPool* pool = getThreadPool(numThreads);
+	vector<IcmWorkspace> workspaces( pool -> getNumThreads() );
+	// the problems are already processed in parallel, so the color classes of the colored mode are processed sequentially (parallelFor cannot be nested)
+	try {
+		pool -> parallelFor(numProblems, [&](int iProblem, int iThread) {
+			energy[iProblem] = runIcm(problems[iProblem], workspaces[iThread], segments[iProblem]);
+		});
+	}
+	catch (...) {
+		mexErrMsgTaskException("icmPottsMex:threadPool");
+	}
+
+	if (energyOutPtr == NULL)
+		mxDestroyArray(energyArray);
+}
+
+void readProblem(const mxArray* unaryInPtr, const mxArray* pairwiseInPtr, const mxArray* initLabelsInPtr, int maxIter, IcmMode mode, IcmProblem& problem)
+{
 	int numNodes = 0;
 	int numLabels = 0;
 	int numEdges = 0;
-	int maxIter = 10;
-	
+
 	// get unary potentials
 	MATLAB_ASSERT(  mxGetClassID( unaryInPtr ) == mxDOUBLE_CLASS, "icmPottsMex:unaryPotentialsWrongType", "unaryTerms is of wrong type, expected double");
 	MATLAB_ASSERT(  mxGetNumberOfDimensions( unaryInPtr ) == 2, "icmPottsMex:unaryPotentialsWrongDimensionality", "unaryTerms is not 2-dimensional");
@@ -41,7 +211,7 @@ void mexFunction(int nlhs, mxArray *plhs[],
 	MATLAB_ASSERT(numLabels >= 1, "icmPottsMex:unaryPotentialsWrongNumLabels", "The number of labels is not positive");
 
 	double* dataCost = (double*)mxGetData(unaryInPtr);
-	
+
 
 	//get pairwise potentials
 	MATLAB_ASSERT(mxGetClassID(pairwiseInPtr) == mxDOUBLE_CLASS, "icmPottsMex:pairwisePotentialsWrongType", "Expected mxDOUBLE_CLASS for neighbours array");
@@ -56,8 +226,8 @@ void mexFunction(int nlhs, mxArray *plhs[],
 
 	//check pairwise terms
 	for (mwIndex c = 0; c < colNum; ++c) {
-		mwIndex rowStart = jc[c]; 
-		mwIndex rowEnd   = jc[c+1]; 
+		mwIndex rowStart = jc[c];
+		mwIndex rowEnd   = jc[c+1];
 		for (mwIndex ri = rowStart; ri < rowEnd; ++ri)  {
 			mwIndex r = ir[ri];
 
@@ -70,7 +240,8 @@ void mexFunction(int nlhs, mxArray *plhs[],
 	}
 
 	// get the initial labeling
-	vector<int> curLabeling(numNodes);
+	vector<int>& curLabeling = problem.initLabeling;
+	curLabeling.resize(numNodes);
 	if ( initLabelsInPtr != NULL ) {
 		if ( mxIsEmpty(initLabelsInPtr) ) {
 			initLabelsInPtr = NULL;
@@ -80,7 +251,7 @@ void mexFunction(int nlhs, mxArray *plhs[],
 			MATLAB_ASSERT(  mxGetNumberOfDimensions( initLabelsInPtr ) == 2, "icmPottsMex:initLabelsWrongDimensionality", "initLabels is not 2-dimensional");
 			MATLAB_ASSERT(  mxGetPi(initLabelsInPtr) == NULL, "icmPottsMex:initLabelsComplex",  "initLabels should not be complex");
 			MATLAB_ASSERT(  mxGetM(initLabelsInPtr) == numNodes && mxGetN(initLabelsInPtr) == 1, "icmPottsMex:initLabelsComplex",  "initLabels is of wrong size, expected numNodes x 1");
-			
+
 			double* labelsPtr = (double*)mxGetData(initLabelsInPtr);
 
 			for( int iNode = 0; iNode < numNodes; ++iNode ) {
@@ -89,47 +260,56 @@ void mexFunction(int nlhs, mxArray *plhs[],
 				curLabeling[iNode] = round(tmp) - 1;
 			}
 		}
-	} 
-	
+	}
+
+	// the random labeling is generated here because rand() should not be called from the worker threads
 	if( initLabelsInPtr == NULL ) {
 		for( int iNode = 0; iNode < numNodes; ++iNode ) {
 			curLabeling[iNode] = rand() % numLabels;
 		}
 	}
 
-	// get the maximum number of iterations
-	if ( maxNumIterInPtr != NULL) {
-		if ( !mxIsEmpty(maxNumIterInPtr) ) {
-			MATLAB_ASSERT(  mxGetClassID( maxNumIterInPtr ) == mxDOUBLE_CLASS, "icmPottsMex:maxNumIterWrongType", "maxNumIter is of wrong type, expected double");
-			MATLAB_ASSERT(  mxGetPi(maxNumIterInPtr) == NULL, "icmPottsMex:maxNumIterComplex",  "maxNumIter should not be complex");
-			MATLAB_ASSERT(  mxGetNumberOfElements( maxNumIterInPtr ) == 1, "icmPottsMex:maxNumIterWrongSize", "maxNumIter is not scalar");
-
-			maxIter = (int)(*((double*) mxGetData( maxNumIterInPtr )));
-			MATLAB_ASSERT( maxIter >= 0 , "icmPottsMex:maxNumIterNegativeValue", "maxNumIter is negative");
-		}
-	}
-
-		
-	// start computing
-
-	double energy = 0.0;	
-	vector< vector<int> > graphIds(numNodes);
-	vector< vector<double> > graphWeights(numNodes);
+	problem.numNodes = numNodes;
+	problem.numLabels = numLabels;
+	problem.dataCost = dataCost;
+	problem.colNum = colNum;
+	problem.ir = ir;
+	problem.jc = jc;
+	problem.pr = pr;
+	problem.maxIter = maxIter;
+	problem.mode = mode;
+}
 
-	//construct and compute pairwise terms
+double runIcm(const IcmProblem& problem, IcmWorkspace& workspace, double* segment, ThreadPool* pool)
+{
+	int numNodes = problem.numNodes;
+	int numLabels = problem.numLabels;
+	double* dataCost = problem.dataCost;
+	mwIndex colNum = problem.colNum;
+	const mwIndex* ir = problem.ir;
+	const mwIndex* jc = problem.jc;
+	double*        pr = problem.pr;
+	int maxIter = problem.maxIter;
+
+	vector<int>& curLabeling = workspace.labeling;
+	curLabeling.assign(problem.initLabeling.begin(), problem.initLabeling.end());
+
+	double energy = 0.0;
+
+	// count the neighbors and compute pairwise terms; the degree of node i goes to neighborsBegin[i + 2],
+	// so after the prefix sums neighborsBegin[i + 1] is the position where the neighbors of node i are written
+	vector<mwIndex>& neighborsBegin = workspace.neighborsBegin;
+	neighborsBegin.assign(numNodes + 2, 0);
 	for (mwIndex c = 0; c < colNum; ++c) {
-		mwIndex rowStart = jc[c]; 
-		mwIndex rowEnd   = jc[c+1]; 
+		mwIndex rowStart = jc[c];
+		mwIndex rowEnd   = jc[c+1];
 		for (mwIndex ri = rowStart; ri < rowEnd; ++ri)  {
 			mwIndex r = ir[ri];
 
 			double dw = pr[ri];
 			if( r < c) {
-				graphIds[r].push_back(c);
-				graphWeights[r].push_back(dw);
-
-				graphIds[c].push_back(r);
-				graphWeights[c].push_back(dw);
+				++neighborsBegin[r + 2];
+				++neighborsBegin[c + 2];
 
 				if  ( curLabeling[r] != curLabeling[c]) {
 					energy += dw;
@@ -137,57 +317,202 @@ void mexFunction(int nlhs, mxArray *plhs[],
 			}
 		}
 	}
+	for (int iNode = 2; iNode < numNodes + 2; ++iNode)
+		neighborsBegin[iNode] += neighborsBegin[iNode - 1];
+
+	// the neighbors are stored in the order of the sparse matrix, so the sums below are the same as with the lists of every node
+	workspace.neighborIds.resize(neighborsBegin[numNodes + 1]);
+	workspace.neighborWeights.resize(neighborsBegin[numNodes + 1]);
+	int* neighborIds = workspace.neighborIds.empty() ? NULL : &workspace.neighborIds[0];
+	double* neighborWeights = workspace.neighborWeights.empty() ? NULL : &workspace.neighborWeights[0];
+	for (mwIndex c = 0; c < colNum; ++c) {
+		for (mwIndex ri = jc[c]; ri < jc[c+1]; ++ri)  {
+			mwIndex r = ir[ri];
+			if( r < c) {
+				mwIndex rPos = neighborsBegin[r + 1]++;
+				neighborIds[rPos] = (int)c;
+				neighborWeights[rPos] = pr[ri];
+
+				mwIndex cPos = neighborsBegin[c + 1]++;
+				neighborIds[cPos] = (int)r;
+				neighborWeights[cPos] = pr[ri];
+			}
+		}
+	}
+
 	// add unary terms
 	for( int iNode = 0; iNode < numNodes; ++iNode ) {
 		energy += dataCost[ curLabeling[iNode] + iNode * numLabels ];
 	}
 
-	
-	for ( int iIter = 0; iIter < maxIter; ++iIter ) {
+	// moves node iNode to the best label given the labels of its neighbors, returns true if the label has changed;
+	// neighWeights is a zero buffer of size numLabels, which is zero again at exit
+	auto updateNode = [&](int iNode, double* neighWeights, double& curEnergy) -> bool {
 		bool changed = false;
+		mwIndex edgeBegin = neighborsBegin[iNode];
+		mwIndex edgeEnd = neighborsBegin[iNode + 1];
+		for ( mwIndex iEdge = edgeBegin; iEdge < edgeEnd; ++iEdge) {
+			neighWeights[ curLabeling[ neighborIds[iEdge] ] ] += neighborWeights[iEdge];
+		}
 
-		for (int iNode = 0; iNode < numNodes; ++iNode ) {
-			vector<double> neighWeights(numLabels, 0.0);
-			for ( int iEdge = 0; iEdge < graphIds[iNode].size(); ++iEdge) {
-				neighWeights[ curLabeling[ graphIds[iNode][iEdge] ] ] += graphWeights[iNode][iEdge];
+		// try different labels
+		for( int iLabel = 0; iLabel < numLabels; ++iLabel) {
+			double diff = dataCost[ iLabel  + iNode * numLabels ] - dataCost[ curLabeling[iNode] + iNode * numLabels ];
+
+			diff += -neighWeights[ iLabel ] + neighWeights[ curLabeling[iNode] ];
+
+			if ( diff < 0 ) {
+				curLabeling[ iNode ] = iLabel;
+				curEnergy += diff;
+				changed = true;
 			}
 
-			// try different labels
-			for( int iLabel = 0; iLabel < numLabels; ++iLabel) {
-				double diff = dataCost[ iLabel  + iNode * numLabels ] - dataCost[ curLabeling[iNode] + iNode * numLabels ];
+		}
 
-				diff += -neighWeights[ iLabel ] + neighWeights[ curLabeling[iNode] ];
+		// the labels of the neighbors have not changed, only their entries are cleared
+		for ( mwIndex iEdge = edgeBegin; iEdge < edgeEnd; ++iEdge) {
+			neighWeights[ curLabeling[ neighborIds[iEdge] ] ] = 0.0;
+		}
+		return changed;
+	};
 
-				if ( diff < 0 ) {
-					curLabeling[ iNode ] = iLabel;
-					energy += diff;
+	workspace.labelWeights.assign(numLabels, 0.0);
+	double* neighWeights = &workspace.labelWeights[0];
+
+	if ( problem.mode == ICM_SWEEP ) {
+		for ( int iIter = 0; iIter < maxIter; ++iIter ) {
+			bool changed = false;
+
+			for (int iNode = 0; iNode < numNodes; ++iNode ) {
+				if ( updateNode(iNode, neighWeights, energy) )
 					changed = true;
+			}
+			if (!changed)
+				break;
+		}
+	} else if ( problem.mode == ICM_WORKLIST ) {
+		// worklist mode: initially all nodes are in the queue in their natural order (so the first numNodes visits are exactly the first sweep),
+		// when a node changes its label its neighbors are added to the queue; the budget is maxIter * numNodes visits
+		vector<int>& queue = workspace.queue;
+		vector<char>& isInQueue = workspace.isInQueue;
+		queue.resize(numNodes);
+		isInQueue.assign(numNodes, 1);
+		for (int iNode = 0; iNode < numNodes; ++iNode )
+			queue[iNode] = iNode;
+		int queueHead = 0;
+		int queueSize = numNodes;
+
+		double numVisitsLeft = (double)maxIter * numNodes;
+		while ( queueSize > 0 && numVisitsLeft > 0 ) {
+			int iNode = queue[queueHead];
+			queueHead = (queueHead + 1 < numNodes) ? queueHead + 1 : 0;
+			--queueSize;
+			isInQueue[iNode] = 0;
+			--numVisitsLeft;
+
+			if ( updateNode(iNode, neighWeights, energy) ) {
+				for ( mwIndex iEdge = neighborsBegin[iNode]; iEdge < neighborsBegin[iNode + 1]; ++iEdge) {
+					int iNeighbor = neighborIds[iEdge];
+					if ( !isInQueue[iNeighbor] ) {
+						int queueTail = queueHead + queueSize;
+						queue[ (queueTail < numNodes) ? queueTail : queueTail - numNodes ] = iNeighbor;
+						++queueSize;
+						isInQueue[iNeighbor] = 1;
+					}
 				}
-
 			}
 		}
-		if (!changed)
-			break;		
-	}
+	} else {
+		// colored mode: the greedy coloring in the natural order of the nodes (on 4-connected grids this is the checkerboard),
+		// the nodes of one color are not adjacent, so their updates do not depend on each other and on the order of the updates
+		vector<int>& nodeColors = workspace.nodeColors;
+		nodeColors.assign(numNodes, -1);
+		vector<int>& colorsBegin = workspace.colorsBegin;
+		colorsBegin.assign(1, 0);
+		vector<int>& colorMarkedBy = workspace.colorNodes; // the last node whose neighbor has the color, reused below
+		colorMarkedBy.assign(numNodes + 1, -1);
+		int numColors = 0;
+		for (int iNode = 0; iNode < numNodes; ++iNode ) {
+			for ( mwIndex iEdge = neighborsBegin[iNode]; iEdge < neighborsBegin[iNode + 1]; ++iEdge) {
+				int iNeighbor = neighborIds[iEdge];
+				if ( nodeColors[iNeighbor] >= 0 )
+					colorMarkedBy[ nodeColors[iNeighbor] ] = iNode;
+			}
+			int iColor = 0;
+			while ( colorMarkedBy[iColor] == iNode )
+				++iColor;
+			nodeColors[iNode] = iColor;
+			if ( iColor == numColors ) {
+				++numColors;
+				colorsBegin.push_back(0);
+			}
+			++colorsBegin[iColor + 1];
+		}
+		for (int iColor = 0; iColor < numColors; ++iColor)
+			colorsBegin[iColor + 1] += colorsBegin[iColor];
+
+		vector<int>& colorNodes = workspace.colorNodes;
+		colorNodes.resize(numNodes);
+		vector<int> colorEnd(colorsBegin.begin(), colorsBegin.end() - 1);
+		for (int iNode = 0; iNode < numNodes; ++iNode )
+			colorNodes[ colorEnd[ nodeColors[iNode] ]++ ] = iNode;
+
+		int numThreads = (pool != NULL) ? pool -> getNumThreads() : 1;
+		workspace.threadLabelWeights.assign((size_t)numThreads * numLabels, 0.0);
+		workspace.isChangedByThread.resize(numThreads);
+		double* threadLabelWeights = &workspace.threadLabelWeights[0];
+		char* isChangedByThread = &workspace.isChangedByThread[0];
+
+		for ( int iIter = 0; iIter < maxIter; ++iIter ) {
+			for (int iThread = 0; iThread < numThreads; ++iThread)
+				isChangedByThread[iThread] = 0;
+
+			for (int iColor = 0; iColor < numColors; ++iColor) {
+				const int* curNodes = &colorNodes[ colorsBegin[iColor] ];
+				auto updateColorNode = [&](int k, int iThread) {
+					double energyChange = 0.0; // the energy is recomputed after the sweeps
+					if ( updateNode(curNodes[k], threadLabelWeights + (size_t)iThread * numLabels, energyChange) )
+						isChangedByThread[iThread] = 1;
+				};
+				int numColorNodes = colorsBegin[iColor + 1] - colorsBegin[iColor];
+				if ( pool != NULL ) {
+					pool -> parallelFor(numColorNodes, updateColorNode, 256);
+				} else {
+					for (int k = 0; k < numColorNodes; ++k)
+						updateColorNode(k, 0);
+				}
+			}
 
+			bool changed = false;
+			for (int iThread = 0; iThread < numThreads; ++iThread)
+				if ( isChangedByThread[iThread] )
+					changed = true;
+			if (!changed)
+				break;
+		}
 
-	
-	
-	//output minimum value
-	if (energyOutPtr != NULL){
-		*energyOutPtr = mxCreateNumericMatrix(1, 1, mxDOUBLE_CLASS, mxREAL);
-		*(double*)mxGetData( *energyOutPtr ) = energy;
+		// the energy of the final labeling in the same order as above, so it does not depend on the number of threads
+		energy = 0.0;
+		for (mwIndex c = 0; c < colNum; ++c) {
+			for (mwIndex ri = jc[c]; ri < jc[c+1]; ++ri)  {
+				mwIndex r = ir[ri];
+				if( r < c && curLabeling[r] != curLabeling[c]) {
+					energy += pr[ri];
+				}
+			}
+		}
+		for( int iNode = 0; iNode < numNodes; ++iNode ) {
+			energy += dataCost[ curLabeling[iNode] + iNode * numLabels ];
+		}
 	}
 
-	
 	//output minimum cut
-	if ( labelsOutPtr != NULL ){
-
-		*labelsOutPtr = mxCreateNumericMatrix(numNodes, 1, mxDOUBLE_CLASS, mxREAL);
-		double* segment = (double*)mxGetData( *labelsOutPtr );
+	if ( segment != NULL ){
 		for(int iNode = 0; iNode < numNodes; ++iNode)
 			segment[ iNode ] = curLabeling[ iNode ] + 1;
 	}
+
+	return energy;
 }
 
 double round(double a)
@@ -7,15 +7,32 @@
 % 	Usage:
 % 	[energy] = icmPottsMex(unaryTerms, pairwiseTerms, initLabels, maxNumIter);
 % 	[energy, newLabels] = icmPottsMex(unaryTerms, pairwiseTerms, initLabels, maxNumIter);
+% 	[energy, newLabels] = icmPottsMex(unaryTermsBatch, pairwiseTerms, initLabels, maxNumIter, numThreads);
+% 	[energy, newLabels] = icmPottsMex(unaryTerms, pairwiseTerms, initLabels, maxNumIter, [], mode);
+% 	[energy, newLabels] = icmPottsMex(unaryTerms, pairwiseTerms, initLabels, maxNumIter, numThreads, 'colored');
 % 	
 % 	Inputs:
 % 	unaryTerms - of type double, array size [numLabels, numNodes]; 
 % 	pairwiseTerms - sparse matrix of type double, size [numNodes, numNodes], only upper triangle is used
 % 	initLabels - the initial labeling, double, size [numNodes, 1], default : random
 % 	maxNumIter - maximum number of ICM sweeps (default: 10)
+% 	mode - 'sweep' (default) visits all nodes in every sweep;
+% 		'worklist' starts with all nodes in a queue and enqueues only the neighbors of the nodes that change their labels,
+% 		stops when the queue is empty (a local minimum) or after maxNumIter * numNodes node visits;
+% 		cheap when initLabels is already close to a local minimum;
+% 		'colored' computes a greedy coloring of the graph (a checkerboard for 4-connected grids) and sweeps the color classes one by one,
+% 		the nodes of one class are updated in parallel on numThreads threads, the result does not depend on numThreads;
+% 		the order of updates differs from 'sweep', so the labeling can differ as well
 % 
 % 	Outputs:
 % 	energy - of type double, a single number; optimal energy value
 % 	newLabels - best found labeling
+% 
+% 	Batch mode:
+% 	unaryTermsBatch - cell array of unaryTerms of numProblems independent problems, the problems are processed in parallel
+% 	pairwiseTerms - a single sparse matrix shared by all problems or a cell array of the same size as unaryTermsBatch
+% 	initLabels - empty (random), a single labeling shared by all problems or a cell array of the same size as unaryTermsBatch
+% 	numThreads - the number of threads (optional); by default, the environment variable SMR_NUM_THREADS or the number of cores is used
+% 	energy is then a numProblems x 1 vector and newLabels is a numProblems x 1 cell array
 % 	
 % 	Anton Osokin (firstname.lastname@gmail.com),  22.05.2013
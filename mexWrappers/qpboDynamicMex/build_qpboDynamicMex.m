@@ -0,0 +1,30 @@
+function build_qpboDynamicMex
+% build_qpboDynamicMex builds package qpboDynamicMex
+
+mexFlags = ' -largeArrayDims ';
+if ~isempty(strfind(mexext, '64'))
+    mexFlags = [mexFlags, ' -DA64BITS '];
+end
+% the QPBO code is shared with qpboMex
+codePath = fullfile('..', 'qpboMex', 'QPBO-v1.32.src');
+threadPoolPath = fullfile('..', 'threadPool');
+
+mexFlags = [mexFlags, ' -I', codePath, ' -I', threadPoolPath, ' -Isrc '];
+% the batch mode uses std::thread
+if isunix
+    mexFlags = [mexFlags, ' CXXFLAGS="$CXXFLAGS -std=c++11 -pthread" LDFLAGS="$LDFLAGS -pthread" '];
+end
+
+qpboFiles = [' ', fullfile(codePath, 'QPBO.cpp'), ...
+             ' ', fullfile(codePath, 'QPBO_maxflow.cpp'), ...
+             ' ', fullfile(codePath, 'QPBO_postprocessing.cpp'), ...
+             ' ', fullfile(codePath, 'QPBO_extra.cpp'), ' '];
+
+mexcmd = ['mex src/qpboDynamicMex.cpp src/qpboMemory.cpp ', qpboFiles, ' -output qpboDynamicMex', mexFlags];
+eval(mexcmd);
+
+mexcmd = ['mex src/updateUnaryQpboDynamicMex.cpp src/qpboMemory.cpp ', qpboFiles, ' -output updateUnaryQpboDynamicMex', mexFlags];
+eval(mexcmd);
+
+mexcmd = ['mex src/deleteQpboDynamicMex.cpp src/qpboMemory.cpp ', qpboFiles, ' -output deleteQpboDynamicMex', mexFlags];
+eval(mexcmd);
@@ -0,0 +1,13 @@
+% 	deleteQpboDynamicMex - a part of qpboDynamicMex:
+%		Matlab interface to Vladimir Kolmogorov's implementation of QPBO algorithm:
+%		http://www.cs.ucl.ac.uk/staff/V.Kolmogorov/software.html
+%
+% 	deleteQpboDynamicMex function frees the memory given a pointer
+%
+% 	Usage:
+% 	deleteQpboDynamicMex( qpboHandle );
+%
+% 	Inputs:
+% 	qpboHandle - a single number given by qpboDynamicMex or an array of handles created in the batch mode
+%
+%     See also updateUnaryQpboDynamicMex, qpboDynamicMex
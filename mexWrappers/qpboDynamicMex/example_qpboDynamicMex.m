@@ -0,0 +1,40 @@
+% example of usage of package qpboDynamicMex
+
+% [Dp(0), Dp(1)] - unary terms
+terminalWeights=[
+    0,16;
+    0,13;
+    20,0;
+    4,0
+];
+
+% [p, q, Vpq(0, 0), Vpq(0, 1), Vpq(1,0), Vpq(1, 1)] - pairwise terms
+edgeWeights=[
+    1,2,0,10,4,0;
+    1,3,0,12,-1,0;
+    2,3,0,-1,9,0;
+    2,4,0,14,0,0;
+    3,4,0,0,7,0
+    ];
+
+[lowerBound, labels, qpboHandle] = qpboDynamicMex(terminalWeights, edgeWeights);
+
+if ~isequal(lowerBound, 22)
+    warning('Wrong value of lowerBound!')
+end
+if ~isequal(labels, [0; 0; 1; 0])
+    warning('Wrong value of labels!')
+end
+
+unaryUpdate = [3, 0, 30];
+
+[lowerBound, labels] = updateUnaryQpboDynamicMex(qpboHandle, unaryUpdate);
+
+if ~isequal(lowerBound, 24)
+    warning('Wrong value of lowerBound!')
+end
+if ~isequal(labels, [0; 0; 0; 0])
+    warning('Wrong value of labels!')
+end
+
+deleteQpboDynamicMex( qpboHandle );
@@ -0,0 +1,39 @@
+% 	qpboDynamicMex - Matlab interface to Vladimir Kolmogorov's implementation of QPBO algorithm:
+% 	http://www.cs.ucl.ac.uk/staff/V.Kolmogorov/software.html
+%
+% 	This version supports dynamic updates of unary potentials: the graph is kept in memory and
+% 	updateUnaryQpboDynamicMex reruns QPBO reusing the search trees of the previous maxflow.
+%
+%	Energy function:
+%	E(x)   =   \sum_p D_p(x_p)   +   \sum_pq V_pq(x_p,x_q)
+%	where x_p \in {0, 1}, Vpq(0,0), Vpq(0, 1), Vpq(1,0), Vpq(1,1) can be arbitrary
+%
+%	Usage:
+%	[LB] = qpboDynamicMex(unaryTerms, pairwiseTerms);
+% 	[LB, labels] = qpboDynamicMex(unaryTerms, pairwiseTerms);
+% 	[LB, labels, qpboHandle] = qpboDynamicMex(unaryTerms, pairwiseTerms);
+% 	[LB, labels, qpboHandle] = qpboDynamicMex(unaryTermsBatch, pairwiseTerms, numThreads);
+%
+% 	if qpboHandle is not requested all memory is cleaned up, otherwise function deleteQpboDynamicMex needs to be called
+%
+%	Inputs:
+%	unaryTerms - of type double, array size [numNodes, 2]; the cost of assigning 0, 1 to the corresponding unary term ([Dp(0), Dp(1)])
+%	pairwiseTerms - of type double, array size [numEdges, 6]; each line corresponds to an edge [p, q, Vpq(0,0), Vpq(0, 1), Vpq(1,0), Vpq(1,1)];
+%				p and q - indices of vertices from 1,...,numNodes, p != q;
+%
+%	Outputs:
+%	LB - of type double, a single number; lower bound found by QPBO
+%	labels - of type double, array size [numNodes, 1] of {0, 1, -1}; weakly persistent labeling found by QPBO; -1 means refusal to label the vertex
+%	qpboHandle - a single number, for direct usage in deleteQpboDynamicMex and updateUnaryQpboDynamicMex only
+%
+%	Batch mode:
+%	unaryTermsBatch	-	cell array of numProblems unaryTerms matrices; the problems are constructed and solved in parallel
+%	pairwiseTerms	-	either a single matrix shared by all problems or a cell array of the same size as unaryTermsBatch
+%	numThreads	-	the number of threads (optional); by default, the environment variable SMR_NUM_THREADS or the number of cores is used
+%	In the batch mode, LB and qpboHandle are vectors of length numProblems, labels is a cell array of numProblems label vectors.
+%	All the handles can be passed to updateUnaryQpboDynamicMex and deleteQpboDynamicMex at once.
+%
+% 	To build the code in Matlab choose reasonable compiler and run build_qpboDynamicMex.m
+% 	Run example_qpboDynamicMex.m to test the code
+%
+%   See also deleteQpboDynamicMex, updateUnaryQpboDynamicMex, qpboMex
@@ -0,0 +1,21 @@
+#include "qpboMemory.h"
+#include "mex.h"
+
+void mexFunction(int nlhs, mxArray *plhs[],
+    int nrhs, const mxArray *prhs[])
+{
+	if ( nrhs != 1 ) {
+		mexErrMsgIdAndTxt("deleteQpboDynamicMex:inputArguments","Wrong number of input arguments, expected 1");
+    }
+
+	 // get QPBO handles, several graphs created in the batch mode can be deleted at once
+	std::vector<QpboType*> graphs;
+    getQpboHandles(prhs[0], graphs);
+
+	//free memory
+	for(size_t iGraph = 0; iGraph < graphs.size(); ++iGraph)
+	{
+		delete graphs[iGraph];
+		graphs[iGraph] = NULL;
+	}
+}
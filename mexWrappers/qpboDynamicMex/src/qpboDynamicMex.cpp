@@ -0,0 +1,219 @@
+#include "qpboMemory.h"
+#include "mex.h"
+#include "threadPool.h"
+
+#include <limits>
+#include <cmath>
+#include <vector>
+
+struct QpboProblem
+{
+	int numNodes;
+	int numEdges;
+	EnergyTermType* termW;
+	EnergyTermType* edges;
+};
+
+// checks the input and fills problem, called from the MATLAB thread only
+void readProblem(const mxArray* unaryInPtr, const mxArray* pairwiseInPtr, QpboProblem& problem);
+// constructs the graph and runs QPBO, does not call MATLAB API and thus can be run on the thread pool
+QpboType* solveProblem(const QpboProblem& problem, EnergyType* lowerBound, LabelType* segment);
+
+void mexFunction(int nlhs, mxArray *plhs[],
+    int nrhs, const mxArray *prhs[])
+{
+	if ( nrhs < 2 || nrhs > 3 ) {
+		mexErrMsgIdAndTxt("qpboDynamicMex:parameters", "Wrong number of input input arguments, expected 2 or 3");
+    }
+	if (nlhs > 3) {
+		mexErrMsgIdAndTxt("qpboDynamicMex:parameters", "Too many output arguments, expected 1 - 3");
+	}
+
+	// set up pointers for input/ output parameters
+	const mxArray* unaryInPtr = prhs[0]; //unary terms
+	const mxArray* pairwiseInPtr = prhs[1]; //pairwise terms
+	const mxArray* numThreadsInPtr = (nrhs > 2) ? prhs[2] : NULL; //number of threads
+	mxArray **lowerBoundOutPtr = (nlhs > 0) ? &plhs[0] : NULL; //lower bound
+	mxArray **labelsOutPtr = (nlhs > 1) ? &plhs[1] : NULL; //labeling
+	mxArray **qpboHandleOutPtr = (nlhs > 2) ? &plhs[2] : NULL; //qpboHandle
+
+	if ( !mxIsCell( unaryInPtr ) ) {
+		if ( mxIsCell( pairwiseInPtr ) ) {
+			mexErrMsgIdAndTxt("qpboDynamicMex:pairwisePotentials", "pairwiseTerms can be a cell array only in the batch mode");
+		}
+		if ( numThreadsInPtr != NULL && !mxIsEmpty( numThreadsInPtr ) ) {
+			mexErrMsgIdAndTxt("qpboDynamicMex:numThreads", "numThreads can be specified only in the batch mode");
+		}
+
+		QpboProblem problem;
+		readProblem(unaryInPtr, pairwiseInPtr, problem);
+
+		// start computing
+		EnergyType lowerBound = 0;
+		LabelType* segment = NULL;
+		if ( labelsOutPtr != NULL ){
+			*labelsOutPtr = mxCreateNumericMatrix(problem.numNodes, 1, MATLAB_LABEL_TYPE, mxREAL);
+			segment = (LabelType*)mxGetData( *labelsOutPtr );
+		}
+
+		QpboType *g = solveProblem(problem, &lowerBound, segment);
+
+		//output the lower bound
+		if (lowerBoundOutPtr != NULL){
+			*lowerBoundOutPtr = mxCreateNumericMatrix(1, 1, MATLAB_ENERGY_TYPE, mxREAL);
+			*(EnergyType*)mxGetData( *lowerBoundOutPtr ) = lowerBound;
+		}
+
+		if ( qpboHandleOutPtr != NULL ) {
+				//create a container for the pointer
+				*qpboHandleOutPtr = mxCreateNumericMatrix(1, 1, MATLAB_POINTER_TYPE, mxREAL);
+
+				*(QpboHandle*)mxGetData( *qpboHandleOutPtr ) = (QpboHandle)g;
+		}
+		else
+			delete g;
+		return;
+	}
+
+	// batch mode: independent problems are constructed and solved in parallel
+	int numProblems = (int)mxGetNumberOfElements( unaryInPtr );
+	if ( numProblems < 1 ) {
+		mexErrMsgIdAndTxt("qpboDynamicMex:unaryPotentials", "cell array unaryTerms is empty");
+	}
+	if ( mxIsCell( pairwiseInPtr ) && (int)mxGetNumberOfElements( pairwiseInPtr ) != numProblems ) {
+		mexErrMsgIdAndTxt("qpboDynamicMex:pairwisePotentials", "cell arrays unaryTerms and pairwiseTerms are of different sizes");
+	}
+	int numThreads = getNumThreads( numThreadsInPtr );
+
+	std::vector<QpboProblem> problems(numProblems);
+	for(int iProblem = 0; iProblem < numProblems; ++iProblem)
+	{
+		const mxArray* curUnaryInPtr = mxGetCell(unaryInPtr, iProblem);
+		const mxArray* curPairwiseInPtr = mxIsCell(pairwiseInPtr) ? mxGetCell(pairwiseInPtr, iProblem) : pairwiseInPtr;
+		if ( curUnaryInPtr == NULL || curPairwiseInPtr == NULL ) {
+			mexErrMsgIdAndTxt("qpboDynamicMex:parameters", "Some cell of the batch is empty");
+		}
+		readProblem(curUnaryInPtr, curPairwiseInPtr, problems[iProblem]);
+	}
+
+	// outputs are allocated before the parallel part
+	std::vector<EnergyType> lowerBounds(numProblems, 0);
+	std::vector<LabelType*> segments(numProblems, (LabelType*)NULL);
+	if ( labelsOutPtr != NULL ){
+		*labelsOutPtr = mxCreateCellMatrix(numProblems, 1);
+		for(int iProblem = 0; iProblem < numProblems; ++iProblem)
+		{
+			mxArray* curLabels = mxCreateNumericMatrix(problems[iProblem].numNodes, 1, MATLAB_LABEL_TYPE, mxREAL);
+			segments[iProblem] = (LabelType*)mxGetData( curLabels );
+			mxSetCell(*labelsOutPtr, iProblem, curLabels);
+		}
+	}
+	std::vector<QpboType*> graphs(numProblems, (QpboType*)NULL);
+
+	try {
+		getThreadPool(numThreads) -> parallelFor(numProblems, [&](int iProblem, int iThread) {
+			graphs[iProblem] = solveProblem(problems[iProblem], &lowerBounds[iProblem], segments[iProblem]);
+		});
+	}
+	catch (...) {
+		mexErrMsgTaskException("qpboDynamicMex:threadPool");
+	}
+
+	if (lowerBoundOutPtr != NULL){
+		*lowerBoundOutPtr = mxCreateNumericMatrix(numProblems, 1, MATLAB_ENERGY_TYPE, mxREAL);
+		EnergyType* lowerBoundData = (EnergyType*)mxGetData( *lowerBoundOutPtr );
+		for(int iProblem = 0; iProblem < numProblems; ++iProblem)
+			lowerBoundData[iProblem] = lowerBounds[iProblem];
+	}
+
+	if ( qpboHandleOutPtr != NULL ) {
+		*qpboHandleOutPtr = mxCreateNumericMatrix(numProblems, 1, MATLAB_POINTER_TYPE, mxREAL);
+		QpboHandle* handles = (QpboHandle*)mxGetData( *qpboHandleOutPtr );
+		for(int iProblem = 0; iProblem < numProblems; ++iProblem)
+			handles[iProblem] = (QpboHandle)graphs[iProblem];
+	}
+	else
+		for(int iProblem = 0; iProblem < numProblems; ++iProblem)
+			delete graphs[iProblem];
+}
+
+void readProblem(const mxArray* unaryInPtr, const mxArray* pairwiseInPtr, QpboProblem& problem)
+{
+	int numNodes = 0;
+	int numEdges = 0;
+	EnergyTermType* termW = NULL;
+	EnergyTermType* edges = NULL;
+
+	// get unary potentials
+	if ( mxGetClassID( unaryInPtr ) != MATLAB_ENERGYTERM_TYPE ) {
+		mexErrMsgIdAndTxt("qpboDynamicMex:unaryPotentials", "unaryTerms is of wrong type, expected double");
+	}
+	if ( mxGetNumberOfDimensions( unaryInPtr ) != 2 )	{
+		mexErrMsgIdAndTxt("qpboDynamicMex:unaryPotentials","unaryTerms is not 2-dimensional");
+	}
+	numNodes = mxGetM(unaryInPtr);
+	if ( numNodes < 1 ) {
+		mexErrMsgIdAndTxt("qpboDynamicMex:unaryPotentials","The number of nodes is not positive");
+	}
+	if ( mxGetN( unaryInPtr ) != 2 ) {
+		mexErrMsgIdAndTxt("qpboDynamicMex:unaryPotentials","unaryTerms is of wrong size, expected #node x 2");
+	}
+
+	termW = (EnergyTermType*)mxGetData(unaryInPtr);
+
+
+	// get pairwise potentials
+	if (mxGetClassID(pairwiseInPtr) != MATLAB_ENERGYTERM_TYPE ) {
+		mexErrMsgIdAndTxt("qpboDynamicMex:pairwisePotentials", "pairwiseTerms is of wrong type, expected double");
+	}
+	if (mxGetNumberOfDimensions(pairwiseInPtr) != 2)	{
+		mexErrMsgIdAndTxt("qpboDynamicMex:pairwisePotentials","pairwiseTerms is not 2-dimensional");
+	}
+	numEdges = mxGetM(pairwiseInPtr);
+	if (mxGetN(pairwiseInPtr) != 6){
+		mexErrMsgIdAndTxt("qpboDynamicMex:pairwisePotentials","pairwiseTerms is of wrong size, expected #edges x 6");
+	}
+	edges = (EnergyTermType*)mxGetData(pairwiseInPtr);
+
+	for(int i = 0; i < numEdges; ++i)
+		if(edges[i] < 1 || edges[i] > numNodes || edges[numEdges + i] < 1 || edges[numEdges + i] > numNodes || edges[i] == edges[numEdges + i] || !isInteger(edges[i]) || !isInteger(edges[numEdges + i])){
+			mexErrMsgIdAndTxt("qpboDynamicMex:pairwisePotentialsWrongIndices", "Some edge has invalid vertex numbers");
+		}
+
+	problem.numNodes = numNodes;
+	problem.numEdges = numEdges;
+	problem.termW = termW;
+	problem.edges = edges;
+}
+
+QpboType* solveProblem(const QpboProblem& problem, EnergyType* lowerBound, LabelType* segment)
+{
+	int numNodes = problem.numNodes;
+	int numEdges = problem.numEdges;
+	EnergyTermType* termW = problem.termW;
+	EnergyTermType* edges = problem.edges;
+
+	//prepare graph
+	QpboType *g = new QpboType( numNodes, numEdges);
+
+	g -> AddNode(numNodes);
+	for(int i = 0; i < numNodes; ++i)
+		g -> AddUnaryTerm(i, termW[i], termW[numNodes + i]);
+
+	// all edges are valid (checked in readProblem)
+	for(int i = 0; i < numEdges; ++i)
+		g -> AddPairwiseTerm((QpboType::NodeId)round(edges[i] - 1), (QpboType::NodeId)round(edges[numEdges + i] - 1), edges[2 * numEdges + i], edges[3 * numEdges + i], edges[4 * numEdges + i], edges[5 * numEdges + i]);
+
+	g -> MergeParallelEdges();
+
+	//run QPBO
+	g -> Solve();
+	*lowerBound = getLowerBound(g);
+
+	//output the labeling
+	if ( segment != NULL ){
+		getLabeling(g, segment);
+	}
+
+	return g;
+}
@@ -0,0 +1,70 @@
+#include "qpboMemory.h"
+
+QpboType* getQpboHandle(const mxArray *x)
+{
+    QpboHandle qh = 0;
+    QpboType* g = 0;
+
+    if ( mxGetClassID(x) != MATLAB_POINTER_TYPE ) {
+        mexErrMsgIdAndTxt("qpboMemory:handleWrongType", "QPBO handle argument is not of proper type");
+    }
+	if ( mxGetNumberOfElements(x) != 1 ) {
+        mexErrMsgIdAndTxt("qpboMemory:handleWrongSize", "Too many QPBO handles");
+    }
+
+    qh = (QpboHandle*)mxGetData(x);
+	g = (QpboType*)(*(POINTER_CAST*)qh);
+    if ( g == NULL ) {
+        mexErrMsgIdAndTxt("qpboMemory:badHandle", "QPBO handle is not valid");
+    }
+    return g;
+}
+
+void getQpboHandles(const mxArray *x, std::vector<QpboType*>& graphs)
+{
+    if ( mxGetClassID(x) != MATLAB_POINTER_TYPE ) {
+        mexErrMsgIdAndTxt("qpboMemory:handleWrongType", "QPBO handle argument is not of proper type");
+    }
+    int numGraphs = (int)mxGetNumberOfElements(x);
+    if ( numGraphs < 1 ) {
+        mexErrMsgIdAndTxt("qpboMemory:handleWrongSize", "No QPBO handles");
+    }
+
+    POINTER_CAST* qh = (POINTER_CAST*)mxGetData(x);
+    graphs.resize(numGraphs);
+    for(int iGraph = 0; iGraph < numGraphs; ++iGraph) {
+        graphs[iGraph] = (QpboType*)qh[iGraph];
+        if ( graphs[iGraph] == NULL ) {
+            mexErrMsgIdAndTxt("qpboMemory:badHandle", "QPBO handle is not valid");
+        }
+    }
+}
+
+int getNumThreads(const mxArray *x)
+{
+    if ( x == NULL || mxIsEmpty(x) )
+        return 0;
+    if ( !mxIsNumeric(x) || mxGetNumberOfElements(x) != 1 ) {
+        mexErrMsgIdAndTxt("qpboMemory:badNumThreads", "The number of threads should be a numeric scalar");
+    }
+    double numThreads = mxGetScalar(x);
+    if ( numThreads < 1 || floor(numThreads) != numThreads ) {
+        mexErrMsgIdAndTxt("qpboMemory:badNumThreads", "The number of threads should be a positive integer");
+    }
+    return (int)round(numThreads);
+}
+
+EnergyType getLowerBound(QpboType* g)
+{
+	return 0.5 * g -> ComputeTwiceLowerBound();
+}
+
+void getLabeling(QpboType* g, LabelType* segment)
+{
+	// the search trees are kept for the next update
+	g -> ComputeWeakPersistenciesDynamic();
+
+	int numNodes = g -> GetNodeNum();
+	for(int i = 0; i < numNodes; ++i)
+		segment[i] = g -> GetLabel(i);
+}
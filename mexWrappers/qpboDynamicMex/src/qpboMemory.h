@@ -0,0 +1,59 @@
+#ifndef _QPBO_MEMORY_H_
+#define _QPBO_MEMORY_H_
+
+#include <tmwtypes.h>
+#include <limits>
+#include <cmath>
+#include <vector>
+
+#include "QPBO.h"
+#include "mex.h"
+
+//define types
+typedef double EnergyType;
+#define MATLAB_ENERGY_TYPE  (mxDOUBLE_CLASS)
+
+typedef double EnergyTermType;
+#define MATLAB_ENERGYTERM_TYPE (mxDOUBLE_CLASS)
+
+typedef double LabelType;
+#define MATLAB_LABEL_TYPE  (mxDOUBLE_CLASS)
+
+typedef QPBO<EnergyTermType> QpboType;
+
+typedef void* QpboHandle;
+
+/* pointer types in 64 bits machines */
+#ifdef A64BITS
+#define MATLAB_POINTER_TYPE mxUINT64_CLASS
+#else
+#define MATLAB_POINTER_TYPE mxUINT32_CLASS
+#endif
+
+#ifdef A64BITS
+#define POINTER_CAST    int64_T
+#else
+#define POINTER_CAST    int
+#endif
+
+QpboType* getQpboHandle(const mxArray *x); // extract handle from mxArray
+void getQpboHandles(const mxArray *x, std::vector<QpboType*>& graphs); // extract an array of handles from mxArray
+int getNumThreads(const mxArray *x); // number of threads for the batch mode, 0 stands for default
+
+// lower bound and labeling of the solved energy, do not call MATLAB API and thus can be run on the thread pool;
+// getLabeling computes the weak persistencies, so it is called only when the labels are requested
+EnergyType getLowerBound(QpboType* g);
+void getLabeling(QpboType* g, LabelType* segment);
+
+inline double round(double a)
+{
+	return (int)floor(a + 0.5);
+}
+
+inline int isInteger(double a)
+{
+	return (fabs(a - round(a)) < 1e-6);
+}
+
+
+#endif /* _QPBO_MEMORY_H_ */
@@ -0,0 +1,158 @@
+#include "qpboMemory.h"
+#include "mex.h"
+#include "threadPool.h"
+
+#include <limits>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+// checks the update, called from the MATLAB thread only
+EnergyTermType* readUpdate(const mxArray* updateInPtr, int numNodes, int* numChanges);
+// apply the update and rerun QPBO reusing the search trees, do not call MATLAB API and thus can be run on the thread pool
+void updateGraph(QpboType *g, const EnergyTermType* changes, int numChanges);
+EnergyType resolve(QpboType *g, LabelType* segment);
+
+
+void mexFunction(int nlhs, mxArray *plhs[],
+    int nrhs, const mxArray *prhs[])
+{
+	if ( nrhs < 2 || nrhs > 3 ) {
+		mexErrMsgIdAndTxt("updateUnaryQpboDynamicMex:parameters","Wrong number of input parameter, expected 2 or 3");
+    }
+
+	// set up pointers for input/ output parameters
+	const mxArray* qpboHandleInPtr = prhs[0]; //qpboHandle
+	const mxArray* updateInPtr = prhs[1]; // the update array
+	const mxArray* numThreadsInPtr = (nrhs > 2) ? prhs[2] : NULL; //number of threads
+	mxArray **lowerBoundOutPtr = (nlhs > 0) ? &plhs[0] : NULL; //lower bound
+	mxArray **labelsOutPtr = (nlhs > 1) ? &plhs[1] : NULL; //labeling
+
+	if ( mxGetNumberOfElements( qpboHandleInPtr ) == 1 && !mxIsCell( updateInPtr ) && numThreadsInPtr == NULL ) {
+		 // get QPBO handle
+		QpboType *g = NULL;
+		g = getQpboHandle( qpboHandleInPtr );
+
+		int numNodes = g -> GetNodeNum();
+
+		// get the changes
+		int numChanges = 0;
+		EnergyTermType* changes = readUpdate(updateInPtr, numNodes, &numChanges);
+
+		//start editing graph
+		updateGraph(g, changes, numChanges);
+
+		LabelType* segment = NULL;
+		if( labelsOutPtr != NULL )	{
+			*labelsOutPtr = mxCreateNumericMatrix(numNodes, 1, MATLAB_LABEL_TYPE, mxREAL);
+			segment = (LabelType*)mxGetData(*labelsOutPtr);
+		}
+
+		// the graph is re-solved even if no output is requested, so that the next update starts from valid search trees
+		EnergyType lowerBound = resolve(g, segment);
+
+		if (lowerBoundOutPtr != NULL) {
+			*lowerBoundOutPtr = mxCreateNumericMatrix(1, 1, MATLAB_ENERGY_TYPE, mxREAL);
+			*(EnergyType*)mxGetData(*lowerBoundOutPtr) = lowerBound;
+		}
+		return;
+	}
+
+	// batch mode: several graphs are updated in parallel
+	std::vector<QpboType*> graphs;
+	getQpboHandles( qpboHandleInPtr, graphs );
+	int numGraphs = (int)graphs.size();
+
+	std::vector<QpboType*> sortedGraphs(graphs);
+	std::sort(sortedGraphs.begin(), sortedGraphs.end());
+	if ( std::adjacent_find(sortedGraphs.begin(), sortedGraphs.end()) != sortedGraphs.end() ) {
+		mexErrMsgIdAndTxt("updateUnaryQpboDynamicMex:repeatedHandles","qpboHandle contains the same graph several times");
+	}
+
+	if ( mxIsCell( updateInPtr ) && (int)mxGetNumberOfElements( updateInPtr ) != numGraphs ) {
+		mexErrMsgIdAndTxt("updateUnaryQpboDynamicMex:updateUnaryWrongDimension","cell array updateUnary is not of the same size as qpboHandle");
+	}
+	int numThreads = getNumThreads( numThreadsInPtr );
+
+	std::vector<EnergyTermType*> changes(numGraphs, (EnergyTermType*)NULL);
+	std::vector<int> numChanges(numGraphs, 0);
+	for(int iGraph = 0; iGraph < numGraphs; ++iGraph)
+	{
+		const mxArray* curUpdateInPtr = mxIsCell( updateInPtr ) ? mxGetCell( updateInPtr, iGraph ) : updateInPtr;
+		if ( curUpdateInPtr == NULL ) {
+			mexErrMsgIdAndTxt("updateUnaryQpboDynamicMex:updateUnaryWrongDimension","Some cell of updateUnary is empty");
+		}
+		changes[iGraph] = readUpdate(curUpdateInPtr, graphs[iGraph] -> GetNodeNum(), &numChanges[iGraph]);
+	}
+
+	// outputs are allocated before the parallel part
+	std::vector<EnergyType> lowerBounds(numGraphs, 0);
+	std::vector<LabelType*> segments(numGraphs, (LabelType*)NULL);
+	if( labelsOutPtr != NULL )	{
+		*labelsOutPtr = mxCreateCellMatrix(numGraphs, 1);
+		for(int iGraph = 0; iGraph < numGraphs; ++iGraph)
+		{
+			mxArray* curLabels = mxCreateNumericMatrix(graphs[iGraph] -> GetNodeNum(), 1, MATLAB_LABEL_TYPE, mxREAL);
+			segments[iGraph] = (LabelType*)mxGetData(curLabels);
+			mxSetCell(*labelsOutPtr, iGraph, curLabels);
+		}
+	}
+
+	try {
+		getThreadPool(numThreads) -> parallelFor(numGraphs, [&](int iGraph, int iThread) {
+			updateGraph(graphs[iGraph], changes[iGraph], numChanges[iGraph]);
+			lowerBounds[iGraph] = resolve(graphs[iGraph], segments[iGraph]);
+		});
+	}
+	catch (...) {
+		mexErrMsgTaskException("updateUnaryQpboDynamicMex:threadPool");
+	}
+
+	if (lowerBoundOutPtr != NULL) {
+		*lowerBoundOutPtr = mxCreateNumericMatrix(numGraphs, 1, MATLAB_ENERGY_TYPE, mxREAL);
+		EnergyType* lowerBoundData = (EnergyType*)mxGetData(*lowerBoundOutPtr);
+		for(int iGraph = 0; iGraph < numGraphs; ++iGraph)
+			lowerBoundData[iGraph] = lowerBounds[iGraph];
+	}
+}
+
+EnergyTermType* readUpdate(const mxArray* updateInPtr, int numNodes, int* numChanges)
+{
+	if (mxGetNumberOfDimensions( updateInPtr ) != 2)	{
+			mexErrMsgIdAndTxt("updateUnaryQpboDynamicMex:updateUnaryWrongDimension","updateUnary is not 2-dimensional");
+	}
+	*numChanges = mxGetM( updateInPtr );
+	if (mxGetN( updateInPtr ) != 3){
+		mexErrMsgIdAndTxt("updateUnaryQpboDynamicMex:updateUnaryWrongDimension","updateUnary is not of size #changes x 3");
+	}
+	if (mxGetClassID( updateInPtr ) != MATLAB_ENERGYTERM_TYPE ) {
+		mexErrMsgIdAndTxt("updateUnaryQpboDynamicMex:updateUnaryWrongType", "updateUnary is of wrong type");
+	}
+	EnergyTermType* changes = (EnergyTermType*)mxGetData( updateInPtr );
+
+	for(int i = 0; i < *numChanges; ++i)
+		if(!isInteger(changes[i]) || changes[i] < 1 || changes[i] > numNodes){
+			mexErrMsgIdAndTxt("updateUnaryQpboDynamicMex:updateUnaryWrongNodeId", "updateUnary has one nodeId incorrect");
+		}
+	return changes;
+}
+
+void updateGraph(QpboType *g, const EnergyTermType* changes, int numChanges)
+{
+	for(int i = 0; i < numChanges; ++i)
+	{
+		QpboType::NodeId j = (QpboType::NodeId)round(changes[i] - 1);
+		g -> AddUnaryTerm(j, changes[i + numChanges], changes[i + 2 * numChanges]);
+		g -> MarkNode(j);
+	}
+}
+
+EnergyType resolve(QpboType *g, LabelType* segment)
+{
+	g -> SolveDynamic();
+
+	if( segment != NULL )	{
+		getLabeling(g, segment);
+	}
+	return getLowerBound(g);
+}
@@ -0,0 +1,27 @@
+% 	updateUnaryQpboDynamicMex - a part of qpboDynamicMex:
+%		Matlab interface to Vladimir Kolmogorov's implementation of QPBO algorithm:
+%		http://www.cs.ucl.ac.uk/staff/V.Kolmogorov/software.html
+%
+%	updateUnaryQpboDynamicMex adds the given values to the unary terms and reruns QPBO reusing the search trees.
+%	The weak persistencies are computed only if the labels are requested.
+%
+%	Usage:
+%	[LB] = updateUnaryQpboDynamicMex(qpboHandle, updateUnary);
+%	[LB, labels] = updateUnaryQpboDynamicMex(qpboHandle, updateUnary);
+%	[LB, labels] = updateUnaryQpboDynamicMex(qpboHandles, updateUnary, numThreads);
+%
+%	Inputs:
+%	qpboHandle - a single number given by qpboDynamicMex
+%	updateUnary - of type double, array size [numChanges, 3];  ([p, dDp(0), dDp(1)]); the values added to the unary terms of node #p
+%
+%	Outputs:
+%	LB - of type double, a single number; lower bound found by QPBO
+%	labels - of type double, array size [numNodes, 1] of {0, 1, -1}; weakly persistent labeling found by QPBO; -1 means refusal to label the vertex
+%
+%	Batch mode (several handles, cell array updateUnary or numThreads given):
+%	qpboHandles	- an array of different handles given by qpboDynamicMex; the graphs are updated and solved in parallel
+%	updateUnary	- either a single update applied to all graphs or a cell array with an update for each graph
+%	numThreads	- the number of threads (optional); by default, the environment variable SMR_NUM_THREADS or the number of cores is used
+%	In the batch mode, LB is a vector and labels is a cell array of label vectors.
+%
+%	See also deleteQpboDynamicMex, qpboDynamicMex
@@ -802,6 +802,36 @@ template <typename REAL>
 	}
 }
 
+template <typename REAL>
+	void QPBO<REAL>::MarkNode(NodeId i)
+{
+	user_assert(i >= 0 && i < node_num);
+
+	mark_node(&nodes[0][i]);
+	if (stage) mark_node(&nodes[1][i]);
+}
+
+template <typename REAL>
+	void QPBO<REAL>::SolveDynamic()
+{
+	Node* i;
+
+	// the first stage is skipped by Solve() only if all edges are submodular
+	if (stage == 0 && !all_edges_submodular)
+	{
+		Solve();
+		return;
+	}
+
+	maxflow(true);
+
+	for (i=nodes[0]; i<node_last[0]; i++)
+	{
+		i->label = what_segment(i);
+		if (stage && i->label == what_segment(GetMate0(i))) i->label = -1;
+	}
+}
+
 template <typename REAL>
 	REAL QPBO<REAL>::ComputeTwiceEnergy(int option)
 {
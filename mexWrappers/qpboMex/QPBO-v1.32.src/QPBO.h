@@ -290,6 +290,20 @@ public:
 	                         // The numbers are not necessarily consecutive (i.e. some number may be missed).
 	                         // The maximum possible number is 2*nodeNum-5.
 
+	///////////////////////////////////////////////////////////////
+	//                   Dynamic QPBO                            //
+	///////////////////////////////////////////////////////////////
+
+	// After Solve() the unary terms can be changed by AddUnaryTerm(). Each changed node must be passed to MarkNode().
+	// SolveDynamic() then recomputes the strongly persistent labeling reusing the search trees of the previous maxflow,
+	// as in graph.h of the maxflow library. The energy must not be changed in any other way.
+	void MarkNode(NodeId i);
+	void SolveDynamic();
+
+	// Same as ComputeWeakPersistencies() but keeps the search trees, so SolveDynamic() can be called afterwards.
+	// Can only be called immediately after Solve()/SolveDynamic(). GetRegion()/Stitch() can not be used after it.
+	void ComputeWeakPersistenciesDynamic();
+
 	//////////////////////////////////////////////////////////
 	//                   QPBO extensions                    //
 	//////////////////////////////////////////////////////////
@@ -329,6 +343,7 @@ public:
 			  order_array(NULL),
 			  order_seed(0),
 			  dilation(3),
+			  probe_mask(NULL),
 			  callback_fn(NULL)
 		{
 		}
@@ -350,6 +365,10 @@ public:
 		              // d<0:  one iteration tests all unlabeled nodes (i.e. fixes them to 0 and 1). 
 		              // d>=0: nodes within distance d from successful nodes are tested in the next iteration.
 
+		const char* probe_mask; // if array of size nodeNum() is provided, then only nodes i with probe_mask[i] != 0 are tested.
+		                        // Other nodes can still be fixed or contracted as a result of testing. This allows to probe
+		                        // different parts of the energy on several copies of it (see MergeMappings()).
+
 		bool (*callback_fn)(int unlabeled_num); // if callback_fn!=NULL, then after every testing a node Probe calls callback_fn();
 		                                        // unlabeled_num is the current number of remaining nodes in the energy.
 		                                        // If callback_fn returns true then Probe() terminates.
@@ -797,6 +797,17 @@ template <typename REAL>
 			_i[1] = GetMate0(i);
 			bool is_changed = false;
 
+			if (probe_options.probe_mask && !probe_options.probe_mask[i_index])
+			{
+				// the node is not tested, this counts as an unsuccessful test
+				if (probe_options.dilation >= 0)
+				{
+					i->list_flag &= ~MASK_CURRENT;
+					list.Move(i_index, (i->list_flag & MASK_NEXT) ? 3 : 4);
+				}
+				continue;
+			}
+
 			REAL INFTY0 = DetermineSaturation(i);
 			REAL INFTY1 = DetermineSaturation(_i[1]);
 			REAL INFTY = ((INFTY0 > INFTY1) ? INFTY0 : INFTY1) + 1;
@@ -1107,6 +1118,7 @@ template <typename REAL>
 	int nodeNum0 = GetNodeNum();
 	bool is_enough_memory;
 	user_terminated = false;
+	char* probe_mask1 = NULL;
 
 	memcpy(&probe_options, &options, sizeof(ProbeOptions));
 
@@ -1141,11 +1153,25 @@ template <typename REAL>
 			if (success) break;
 		}
 
+		if (options.probe_mask)
+		{
+			// node j of the current energy is tested if some node of the original energy mapped to it is
+			delete [] probe_mask1;
+			probe_mask1 = new char[GetNodeNum()];
+			memset(probe_mask1, 0, GetNodeNum()*sizeof(char));
+			for (int i=0; i<nodeNum0; i++)
+			{
+				if (options.probe_mask[i]) probe_mask1[mapping[i] / 2] = 1;
+			}
+			probe_options.probe_mask = probe_mask1;
+		}
+
 		int* mapping1 = new int[GetNodeNum()];
 		is_enough_memory = Probe(mapping1);
 		MergeMappings(nodeNum0, mapping, mapping1);
 		delete [] mapping1;
 	}
+	delete [] probe_mask1;
 }
 
 template <typename REAL>
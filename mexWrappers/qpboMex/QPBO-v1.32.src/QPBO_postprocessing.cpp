@@ -119,6 +119,48 @@ template <typename REAL>
 	}
 }
 
+template <typename REAL>
+	void QPBO<REAL>::ComputeWeakPersistenciesDynamic()
+{
+	if (stage == 0) return;
+
+	// ComputeWeakPersistencies() overwrites the fields of the search trees, they are restored afterwards
+	struct TreeInfo
+	{
+		Node*	next;
+		int		TS;
+		int		DIST;
+		Arc*	parent;
+	};
+	int node_num_max = node_shift/sizeof(Node);
+	TreeInfo* tree_info = (TreeInfo*) malloc(2*node_num_max*sizeof(TreeInfo));
+	if (!tree_info) { if (error_function) (*error_function)("Not enough memory!"); exit(1); }
+
+	Node* i;
+	int k;
+	for (i=nodes[0], k=0; i<node_last[1]; i++, k++)
+	{
+		if (i == node_last[0]) { i = nodes[1]; k = node_num_max; }
+		tree_info[k].next = i->next;
+		tree_info[k].TS = i->TS;
+		tree_info[k].DIST = i->DIST;
+		tree_info[k].parent = i->parent;
+	}
+
+	ComputeWeakPersistencies();
+
+	for (i=nodes[0], k=0; i<node_last[1]; i++, k++)
+	{
+		if (i == node_last[0]) { i = nodes[1]; k = node_num_max; }
+		i->next = tree_info[k].next;
+		i->TS = tree_info[k].TS;
+		i->DIST = tree_info[k].DIST;
+		i->parent = tree_info[k].parent;
+	}
+
+	free(tree_info);
+}
+
 template <typename REAL>
 	void QPBO<REAL>::Stitch()
 {
@@ -15,7 +15,14 @@ for iFile = 1 : length(srcFiles)
     allFiles = [allFiles, ' ', srcFiles{iFile}];
 end
 
-cmdLine = ['mex ', allFiles, ' -output qpboMex -largeArrayDims ', '-I', codePath];
+% the batch mode uses std::thread
+threadPoolPath = fullfile('..', 'threadPool');
+mexFlags = [' -I', threadPoolPath, ' '];
+if isunix
+    mexFlags = [mexFlags, ' CXXFLAGS="$CXXFLAGS -std=c++11 -pthread" LDFLAGS="$LDFLAGS -pthread" '];
+end
+
+cmdLine = ['mex ', allFiles, ' -output qpboMex -largeArrayDims ', '-I', codePath, mexFlags];
 eval(cmdLine);
 
 
@@ -2,9 +2,14 @@
 
 #include "QPBO.h"
 #include "mex.h"
+#include "threadPool.h"
 
 #include <limits>
 #include <cmath>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <random>
 
 #define INFTY INT_MAX
 
@@ -18,40 +23,299 @@ typedef int mwSize;
 typedef int mwIndex;
 #endif
 
-typedef QPBO<double> GraphType; 
+typedef QPBO<double> GraphType;
 
-void mexFunction(int nlhs, mxArray *plhs[], 
+struct QpboProblem
+{
+	mwSize numNodes;
+	mwSize numEdges;
+	mwSize numUnaries;	// number of unary terms sharing the pairwise terms, each of size numNodes x 2
+	double* termW;
+	double* edges;
+};
+
+struct QpboOptions
+{
+	bool probe;					// run QPBO-P after QPBO
+	int probeDilation;
+	int probeDirectedConstraints;
+	int probeWeakPersistencies;
+	double probeTimeLimit;		// in seconds
+	int probeNumBlocks;			// > 1: the nodes are split into blocks probed on copies of the graph
+	int improveIter;			// number of QPBO-I rounds
+	std::vector<int> improveOrder;	// nodes to fix in each round (0-based); random permutations if empty
+	double improveTimeLimit;	// in seconds
+	unsigned int improveSeed;
+};
+
+// checks the input and fills options, called from the MATLAB thread only
+void readOptions(const mxArray *oInPtr, QpboOptions& options);
+// checks the input and fills problem, called from the MATLAB thread only
+void readProblem(const mxArray *uInPtr, const mxArray *pInPtr, const QpboOptions& options, QpboProblem& problem);
+// creates the graph with the nodes and the pairwise terms of the problem, the unary terms are not added
+GraphType* createGraph(const QpboProblem& problem);
+// adds the unary terms to the graph and runs QPBO (and QPBO-P, QPBO-I if requested);
+// the blocks of probing are run on pool if it is not NULL and sequentially otherwise
+double solveGraph(GraphType* g, mwSize numNodes, const double* termW, const QpboOptions& options, ThreadPool* pool, double* segment);
+// runs QPBO for the first unary terms of the problem, does not call MATLAB API and thus can be run on the thread pool
+double solveProblem(const QpboProblem& problem, const QpboOptions& options, ThreadPool* pool, double* segment);
+// probes the blocks of nodes of the solved graph on its copies and builds the energy where all the found fixings and equivalences are applied;
+// mapping is in the format of QPBO::Probe()
+GraphType* probeBlocks(GraphType* g, const GraphType::ProbeOptions& probeOptions, int numBlocks, ThreadPool* pool, int* mapping);
+int getNumThreads(const mxArray *tInPtr);
+
+// Probe() has no user data in its callback, so the deadline of the current thread is kept here
+static thread_local std::chrono::steady_clock::time_point probeDeadline;
+static bool probeTimeCallback(int unlabeledNum)
+{
+	return std::chrono::steady_clock::now() >= probeDeadline;
+}
+
+void mexFunction(int nlhs, mxArray *plhs[],
     int nrhs, const mxArray *prhs[])
 {
-	MATLAB_ASSERT( nrhs == 2, "qpboMex: Wrong number of input parameters: expected 2");
+	MATLAB_ASSERT( nrhs >= 2 && nrhs <= 4, "qpboMex: Wrong number of input parameters: expected 2 - 4");
     MATLAB_ASSERT( nlhs <= 2, "qpboMex: Too many output arguments: expected 2 or less");
-	
+
 	//Fix input parameter order:
 	const mxArray *uInPtr = (nrhs >= 1) ? prhs[0] : NULL; //unary
 	const mxArray *pInPtr = (nrhs >= 2) ? prhs[1] : NULL; //pairwise
-	
+
+	// the optional parameters can go in any order
+	const mxArray *tInPtr = NULL; //number of threads
+	const mxArray *oInPtr = NULL; //options
+	for(int iArg = 2; iArg < nrhs; ++iArg)
+		if (mxIsStruct(prhs[iArg]))
+		{
+			MATLAB_ASSERT(oInPtr == NULL, "qpboMex: The options are given twice");
+			oInPtr = prhs[iArg];
+		}
+		else
+		{
+			MATLAB_ASSERT(tInPtr == NULL, "qpboMex: The number of threads is given twice");
+			tInPtr = prhs[iArg];
+		}
+
+	QpboOptions options;
+	readOptions(oInPtr, options);
+
 	//Fix output parameter order:
 	mxArray **cOutPtr = (nlhs >= 1) ? &plhs[0] : NULL; //LB
 	mxArray **lOutPtr = (nlhs >= 2) ? &plhs[1] : NULL; //labels
 
+	if (!mxIsCell(uInPtr))
+	{
+		MATLAB_ASSERT(!mxIsCell(pInPtr), "qpboMex: Pairwise potentials can be a cell array only in the batch mode");
+
+		QpboProblem problem;
+		readProblem(uInPtr, pInPtr, options, problem);
+
+		// start computing
+		if (nlhs == 0){
+			return;
+		}
+
+		if (problem.numUnaries > 1)
+		{
+			// several unary terms with the same pairwise terms: the graph is built once and copied for each of them
+			int numUnaries = (int)problem.numUnaries;
+			int numThreads = getNumThreads(tInPtr);
+
+			*cOutPtr = mxCreateNumericMatrix(numUnaries, 1, mxDOUBLE_CLASS, mxREAL);
+			double* lowerBounds = (double*)mxGetData(*cOutPtr);
+
+			double* segments = NULL;
+			if (lOutPtr != NULL){
+				*lOutPtr = mxCreateNumericMatrix(problem.numNodes, numUnaries, mxDOUBLE_CLASS, mxREAL);
+				segments = (double*)mxGetData(*lOutPtr);
+			}
+
+			GraphType* sharedGraph = createGraph(problem);
+			try {
+				getThreadPool(numThreads) -> parallelFor(numUnaries, [&](int iUnary, int iThread) {
+					// the copy constructor only reads the shared graph
+					GraphType g(*sharedGraph);
+					// parallelFor cannot be nested, so the blocks of probing are run sequentially
+					lowerBounds[iUnary] = solveGraph(&g, problem.numNodes, problem.termW + 2 * problem.numNodes * iUnary, options, NULL,
+						(segments != NULL) ? segments + problem.numNodes * iUnary : NULL);
+				});
+			}
+			catch (...) {
+				delete sharedGraph;
+				mexErrMsgTaskException("qpboMex:threadPool");
+			}
+			delete sharedGraph;
+			return;
+		}
+
+		double* segment = NULL;
+		if (lOutPtr != NULL){
+			*lOutPtr = mxCreateNumericMatrix(problem.numNodes, 1, mxDOUBLE_CLASS, mxREAL);
+			segment = (double*)mxGetData(*lOutPtr);
+		}
+
+		// a single problem uses the threads for probing
+		MATLAB_ASSERT(tInPtr == NULL || mxIsEmpty(tInPtr) || (options.probe && options.probeNumBlocks > 1), "qpboMex: The number of threads can be specified only in the batch mode or for probing in blocks");
+		ThreadPool* pool = (options.probe && options.probeNumBlocks > 1) ? getThreadPool(getNumThreads(tInPtr)) : NULL;
+		double lowerBound = 0;
+		try {
+			lowerBound = solveProblem(problem, options, pool, segment);
+		}
+		catch (...) {
+			mexErrMsgTaskException("qpboMex:threadPool");
+		}
+
+		//output lower bound value
+		if (cOutPtr != NULL){
+			*cOutPtr = mxCreateNumericMatrix(1, 1, mxDOUBLE_CLASS, mxREAL);
+			*(double*)mxGetData(*cOutPtr) = lowerBound;
+		}
+		return;
+	}
+
+	// batch mode: independent problems are solved in parallel
+	int numProblems = (int)mxGetNumberOfElements(uInPtr);
+	MATLAB_ASSERT(numProblems >= 1, "qpboMex: The cell array of unary potentials is empty");
+	MATLAB_ASSERT(!mxIsCell(pInPtr) || (int)mxGetNumberOfElements(pInPtr) == numProblems, "qpboMex: The cell arrays of unary and pairwise potentials are of different sizes");
+	int numThreads = getNumThreads(tInPtr);
+
+	std::vector<QpboProblem> problems(numProblems);
+	for(int iProblem = 0; iProblem < numProblems; ++iProblem)
+	{
+		const mxArray *curUInPtr = mxGetCell(uInPtr, iProblem);
+		const mxArray *curPInPtr = mxIsCell(pInPtr) ? mxGetCell(pInPtr, iProblem) : pInPtr;
+		MATLAB_ASSERT(curUInPtr != NULL && curPInPtr != NULL, "qpboMex: Some cell of the batch is empty");
+		readProblem(curUInPtr, curPInPtr, options, problems[iProblem]);
+		MATLAB_ASSERT(problems[iProblem].numUnaries == 1, "qpboMex: Unary potentials in the batch mode should be of size #nodes x 2");
+	}
+
+	if (nlhs == 0){
+		return;
+	}
+
+	// outputs are allocated before the parallel part
+	*cOutPtr = mxCreateNumericMatrix(numProblems, 1, mxDOUBLE_CLASS, mxREAL);
+	double* lowerBounds = (double*)mxGetData(*cOutPtr);
+
+	std::vector<double*> segments(numProblems, (double*)NULL);
+	if (lOutPtr != NULL){
+		*lOutPtr = mxCreateCellMatrix(numProblems, 1);
+		for(int iProblem = 0; iProblem < numProblems; ++iProblem)
+		{
+			mxArray* curLabels = mxCreateNumericMatrix(problems[iProblem].numNodes, 1, mxDOUBLE_CLASS, mxREAL);
+			segments[iProblem] = (double*)mxGetData(curLabels);
+			mxSetCell(*lOutPtr, iProblem, curLabels);
+		}
+	}
+
+	try {
+		getThreadPool(numThreads) -> parallelFor(numProblems, [&](int iProblem, int iThread) {
+			lowerBounds[iProblem] = solveProblem(problems[iProblem], options, NULL, segments[iProblem]);
+		});
+	}
+	catch (...) {
+		mexErrMsgTaskException("qpboMex:threadPool");
+	}
+}
+
+void readOptions(const mxArray *oInPtr, QpboOptions& options)
+{
+	//prepare default options
+	options.probe = false;
+	options.probeDilation = 3;
+	options.probeDirectedConstraints = 2;
+	options.probeWeakPersistencies = 0;
+	options.probeTimeLimit = std::numeric_limits<double>::infinity();
+	options.probeNumBlocks = 1;
+	options.improveIter = 0;
+	options.improveOrder.clear();
+	options.improveTimeLimit = std::numeric_limits<double>::infinity();
+	options.improveSeed = 0;
+
+	if(oInPtr == NULL)
+		return;
+
+	MATLAB_ASSERT(mxIsStruct(oInPtr), "qpboMex: Expected structure array for options");
+	MATLAB_ASSERT(mxGetNumberOfElements(oInPtr) == 1, "qpboMex: Wrong structure type for options: expected a single structure");
+	mxArray *curField = NULL;
+	if((curField = mxGetField(oInPtr, 0, "probe")) != NULL){
+		MATLAB_ASSERT((mxIsDouble(curField) || mxIsLogical(curField)) && mxGetNumberOfElements(curField) == 1, "qpboMex: Wrong structure type for options: expected 1 number for field <<probe>>");
+		options.probe = (mxGetScalar(curField) != 0);
+	}
+	if((curField = mxGetField(oInPtr, 0, "probeDilation")) != NULL){
+		MATLAB_ASSERT(mxIsDouble(curField) && mxGetNumberOfElements(curField) == 1, "qpboMex: Wrong structure type for options: expected 1 number for field <<probeDilation>>");
+		options.probeDilation = (int)mxGetScalar(curField);
+		MATLAB_ASSERT(options.probeDilation >= -1, "qpboMex: Wrong value for options.probeDilation: expected value is >= -1");
+	}
+	if((curField = mxGetField(oInPtr, 0, "probeDirectedConstraints")) != NULL){
+		MATLAB_ASSERT(mxIsDouble(curField) && mxGetNumberOfElements(curField) == 1, "qpboMex: Wrong structure type for options: expected 1 number for field <<probeDirectedConstraints>>");
+		options.probeDirectedConstraints = (int)mxGetScalar(curField);
+		MATLAB_ASSERT(options.probeDirectedConstraints >= 0 && options.probeDirectedConstraints <= 2, "qpboMex: Wrong value for options.probeDirectedConstraints: expected value is 0, 1, or 2");
+	}
+	if((curField = mxGetField(oInPtr, 0, "probeWeakPersistencies")) != NULL){
+		MATLAB_ASSERT((mxIsDouble(curField) || mxIsLogical(curField)) && mxGetNumberOfElements(curField) == 1, "qpboMex: Wrong structure type for options: expected 1 number for field <<probeWeakPersistencies>>");
+		options.probeWeakPersistencies = (mxGetScalar(curField) != 0) ? 1 : 0;
+	}
+	if((curField = mxGetField(oInPtr, 0, "probeTimeLimit")) != NULL){
+		MATLAB_ASSERT(mxIsDouble(curField) && mxGetNumberOfElements(curField) == 1, "qpboMex: Wrong structure type for options: expected 1 number for field <<probeTimeLimit>>");
+		options.probeTimeLimit = mxGetScalar(curField);
+		MATLAB_ASSERT(options.probeTimeLimit >= 0, "qpboMex: Wrong value for options.probeTimeLimit: expected value is >= 0");
+	}
+	if((curField = mxGetField(oInPtr, 0, "probeNumBlocks")) != NULL){
+		MATLAB_ASSERT(mxIsDouble(curField) && mxGetNumberOfElements(curField) == 1, "qpboMex: Wrong structure type for options: expected 1 number for field <<probeNumBlocks>>");
+		options.probeNumBlocks = (int)mxGetScalar(curField);
+		MATLAB_ASSERT(options.probeNumBlocks >= 1, "qpboMex: Wrong value for options.probeNumBlocks: expected value is >= 1");
+	}
+	if((curField = mxGetField(oInPtr, 0, "improveIter")) != NULL){
+		MATLAB_ASSERT(mxIsDouble(curField) && mxGetNumberOfElements(curField) == 1, "qpboMex: Wrong structure type for options: expected 1 number for field <<improveIter>>");
+		options.improveIter = (int)mxGetScalar(curField);
+		MATLAB_ASSERT(options.improveIter >= 0, "qpboMex: Wrong value for options.improveIter: expected value is >= 0");
+	}
+	if((curField = mxGetField(oInPtr, 0, "improveOrder")) != NULL){
+		MATLAB_ASSERT(mxIsDouble(curField) && !mxIsSparse(curField), "qpboMex: Wrong structure type for options: expected DOUBLE for field <<improveOrder>>");
+		mwSize orderLength = mxGetNumberOfElements(curField);
+		double* order = (double*)mxGetData(curField);
+		options.improveOrder.resize(orderLength);
+		for(mwSize i = 0; i < orderLength; ++i)
+		{
+			MATLAB_ASSERT(order[i] >= 1 && floor(order[i]) == order[i], "qpboMex: Wrong value for options.improveOrder: expected node indices");
+			options.improveOrder[i] = (int)order[i] - 1;
+		}
+	}
+	if((curField = mxGetField(oInPtr, 0, "improveTimeLimit")) != NULL){
+		MATLAB_ASSERT(mxIsDouble(curField) && mxGetNumberOfElements(curField) == 1, "qpboMex: Wrong structure type for options: expected 1 number for field <<improveTimeLimit>>");
+		options.improveTimeLimit = mxGetScalar(curField);
+		MATLAB_ASSERT(options.improveTimeLimit >= 0, "qpboMex: Wrong value for options.improveTimeLimit: expected value is >= 0");
+	}
+	if((curField = mxGetField(oInPtr, 0, "improveSeed")) != NULL){
+		MATLAB_ASSERT(mxIsDouble(curField) && mxGetNumberOfElements(curField) == 1, "qpboMex: Wrong structure type for options: expected 1 number for field <<improveSeed>>");
+		MATLAB_ASSERT(mxGetScalar(curField) >= 0, "qpboMex: Wrong value for options.improveSeed: expected value is >= 0");
+		options.improveSeed = (unsigned int)mxGetScalar(curField);
+	}
+}
+
+void readProblem(const mxArray *uInPtr, const mxArray *pInPtr, const QpboOptions& options, QpboProblem& problem)
+{
 	 //node number
 	mwSize numNodes;
-    
+
 	// get unary potentials
-	MATLAB_ASSERT(mxGetNumberOfDimensions(uInPtr) == 2, "qpboMex: The unary paramater is not 2-dimensional");
+	MATLAB_ASSERT(mxGetNumberOfDimensions(uInPtr) == 2 || mxGetNumberOfDimensions(uInPtr) == 3, "qpboMex: The unary paramater is not 2- or 3-dimensional");
 	MATLAB_ASSERT(mxGetClassID(uInPtr) == mxDOUBLE_CLASS, "qpboMex: Unary potentials are of wrong type");
 	MATLAB_ASSERT(mxGetPi(uInPtr) == NULL, "qpboMex: Unary potentials should not be complex");
-	
+
 	numNodes = mxGetM(uInPtr);
-	
+
 	MATLAB_ASSERT(numNodes >= 1, "qpboMex: The number of nodes is not positive");
-	MATLAB_ASSERT(mxGetN(uInPtr) == 2, "qpboMex: The edge paramater is not of size #nodes x 2");
-	
+	MATLAB_ASSERT(mxGetDimensions(uInPtr)[1] == 2, "qpboMex: The unary paramater is not of size #nodes x 2 or #nodes x 2 x #problems");
+	mwSize numUnaries = (mxGetNumberOfDimensions(uInPtr) == 3) ? mxGetDimensions(uInPtr)[2] : 1;
+	MATLAB_ASSERT(numUnaries >= 1, "qpboMex: The number of unary terms is not positive");
+
 	double* termW = (double*)mxGetData(uInPtr);
 
 	//get pairwise potentials
 	MATLAB_ASSERT(mxGetNumberOfDimensions(pInPtr) == 2, "qpboMex: The edge paramater is not 2-dimensional");
-	
+
 	mwSize numEdges = mxGetM(pInPtr);
 
 	MATLAB_ASSERT( mxGetN(pInPtr) == 6, "qpboMex: The edge paramater is not of size #edges x 6");
@@ -66,29 +330,44 @@ void mexFunction(int nlhs, mxArray *plhs[],
 		MATLAB_ASSERT(isInteger(edges[i + numEdges]), "qpboMex: error in pairwise terms array");
 	}
 
+	// the warning is issued here because solveProblem can be run outside of the MATLAB thread
+	for(mwSize i = 0; i < numEdges; i++)
+		if(edges[i] == edges[numEdges + i]){
+			mexWarnMsgIdAndTxt("qpboMex:pairwisePotentials", "Some edge has invalid vertex numbers and therefore it is ignored");
+			break;
+		}
 
+	for(size_t i = 0; i < options.improveOrder.size(); i++)
+		MATLAB_ASSERT(options.improveOrder[i] < (int)numNodes, "qpboMex: Wrong value for options.improveOrder: node index exceeds the number of nodes");
 
-	// start computing
-	if (nlhs == 0){
-		return;
-	}
+	problem.numNodes = numNodes;
+	problem.numEdges = numEdges;
+	problem.numUnaries = numUnaries;
+	problem.termW = termW;
+	problem.edges = edges;
+}
+
+double solveProblem(const QpboProblem& problem, const QpboOptions& options, ThreadPool* pool, double* segment)
+{
+	GraphType *g = createGraph(problem);
+	double lowerBound = solveGraph(g, problem.numNodes, problem.termW, options, pool, segment);
+	delete g;
+	return lowerBound;
+}
+
+GraphType* createGraph(const QpboProblem& problem)
+{
+	mwSize numNodes = problem.numNodes;
+	mwSize numEdges = problem.numEdges;
+	double* edges = problem.edges;
 
 	//prepare graph
 	GraphType *g = new GraphType(numNodes, numEdges);
-	
-	//add unary potentials
 	g -> AddNode(numNodes);
-	for(mwSize i = 0; i < numNodes; i++)
-	{
-		g -> AddUnaryTerm((GraphType::NodeId) i, termW[i], termW[numNodes + i]); 
-	}
-	
-	//add pairwise terms
+
+	//add pairwise terms, loops are ignored
 	for(mwSize i = 0; i < numEdges; i++)
-		if(edges[i] < 1 || edges[i] > numNodes || edges[numEdges + i] < 1 || edges[numEdges + i] > numNodes || edges[i] == edges[numEdges + i] || !isInteger(edges[i]) || !isInteger(edges[numEdges + i])){
-			mexWarnMsgIdAndTxt("qpboMex:pairwisePotentials", "Some edge has invalid vertex numbers and therefore it is ignored");
-		}
-		else
+		if(edges[i] != edges[numEdges + i])
 		{
 			g -> AddPairwiseTerm((GraphType::NodeId) (edges[i] - 1), (GraphType::NodeId) (edges[numEdges + i] - 1), edges[2 * numEdges + i], edges[3 * numEdges + i], edges[4 * numEdges + i], edges[5 * numEdges + i]);
 		}
@@ -96,25 +375,262 @@ void mexFunction(int nlhs, mxArray *plhs[],
 	//Merge edges
 	g -> MergeParallelEdges();
 
+	return g;
+}
+
+double solveGraph(GraphType* g, mwSize numNodes, const double* termW, const QpboOptions& options, ThreadPool* pool, double* segment)
+{
+	//add unary potentials
+	for(mwSize i = 0; i < numNodes; i++)
+	{
+		g -> AddUnaryTerm((GraphType::NodeId) i, termW[i], termW[numNodes + i]);
+	}
+
 	//Solve
 	g -> Solve();
 	g -> ComputeWeakPersistencies();
 
-	//output lower bound value
-	if (cOutPtr != NULL){
-		*cOutPtr = mxCreateNumericMatrix(1, 1, mxDOUBLE_CLASS, mxREAL);
-		*(double*)mxGetData(*cOutPtr) = 0.5 * (g -> ComputeTwiceLowerBound());
+	// Probe() adds constants to the energy, so the lower bound is computed before it
+	double lowerBound = 0.5 * (g -> ComputeTwiceLowerBound());
+
+	if (segment == NULL)
+		return lowerBound;
+
+	// node i of the original energy corresponds to node mapping[i] / 2 of the current energy,
+	// its label is (y[mapping[i] / 2] + mapping[i]) % 2 where y is the labeling of the current energy
+	std::vector<int> mapping(numNodes);
+	for(mwSize i = 0; i < numNodes; i++)
+		mapping[i] = 2 * (int)i;
+	GraphType* probedGraph = NULL;
+
+	//Probe
+	if (options.probe){
+		GraphType::ProbeOptions probeOptions;
+		probeOptions.dilation = options.probeDilation;
+		probeOptions.directed_constraints = options.probeDirectedConstraints;
+		probeOptions.weak_persistencies = options.probeWeakPersistencies;
+		if (options.probeTimeLimit < std::numeric_limits<double>::infinity()){
+			probeDeadline = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(options.probeTimeLimit));
+			probeOptions.callback_fn = probeTimeCallback;
+		}
+		if (options.probeNumBlocks > 1 && numNodes > 1){
+			// g is kept unchanged, the probed energy is a new graph
+			g = probeBlocks(g, probeOptions, std::min(options.probeNumBlocks, (int)numNodes), pool, &mapping[0]);
+			probedGraph = g;
+		}
+		else{
+			g -> Probe(&mapping[0], probeOptions);
+			// when stopped by the callback, Probe() returns the reduced energy without solving it
+			g -> Solve();
+		}
+		g -> ComputeWeakPersistencies();
+	}
+
+	//Improve
+	if (options.improveIter > 0){
+		int numCurNodes = g -> GetNodeNum();
+
+		// QPBO-I starts from the persistent labels, the unlabeled nodes are set to 0
+		for(int i = 0; i < numCurNodes; i++)
+			g -> SetLabel(i, (g -> GetLabel(i) >= 0) ? g -> GetLabel(i) : 0);
+
+		// the order is given for the original nodes
+		std::vector<int> order;
+		if (!options.improveOrder.empty()){
+			std::vector<char> isInOrder(numCurNodes, 0);
+			for(size_t i = 0; i < options.improveOrder.size(); i++)
+			{
+				int curNode = mapping[options.improveOrder[i]] / 2;
+				if (!isInOrder[curNode]){
+					isInOrder[curNode] = 1;
+					order.push_back(curNode);
+				}
+			}
+		}
+		else{
+			order.resize(numCurNodes);
+			for(int i = 0; i < numCurNodes; i++)
+				order[i] = i;
+		}
+		std::mt19937 randomGenerator(options.improveSeed);
+
+		std::chrono::steady_clock::time_point improveStart = std::chrono::steady_clock::now();
+		for(int iIter = 0; iIter < options.improveIter; iIter++)
+		{
+			if (std::chrono::duration<double>(std::chrono::steady_clock::now() - improveStart).count() >= options.improveTimeLimit)
+				break;
+
+			// Improve() without arguments uses rand() which is not reproducible on the thread pool
+			if (options.improveOrder.empty())
+				std::shuffle(order.begin(), order.end(), randomGenerator);
+
+			bool success = g -> Improve((int)order.size(), &order[0]);
+
+			// with a fixed order the next rounds would do the same
+			if (!success && !options.improveOrder.empty())
+				break;
+		}
 	}
 
 	//output labeling
-	if (lOutPtr != NULL){
-		*lOutPtr = mxCreateNumericMatrix(numNodes, 1, mxDOUBLE_CLASS, mxREAL);
-		double* segment = (double*)mxGetData(*lOutPtr);
-		for(mwSize i = 0; i < numNodes; i++)
-			segment[i] = g -> GetLabel(i);
+	for(mwSize i = 0; i < numNodes; i++)
+	{
+		int curNode = mapping[i] / 2;
+		int curLabel = g -> GetLabel(curNode);
+		// node 0 of the probed energy always has label 0
+		if (options.probe && curNode == 0 && curLabel < 0)
+			curLabel = 0;
+		segment[i] = (curLabel >= 0) ? (curLabel + mapping[i]) % 2 : -1;
 	}
-    
-    delete g;
+
+	delete probedGraph;
+	return lowerBound;
+}
+
+// label(i) = label(root) XOR parity, the paths are compressed
+static int findClass(std::vector<int>& parent, std::vector<char>& parity, int i, int& iParity)
+{
+	int root = i;
+	iParity = 0;
+	while (parent[root] != root)
+	{
+		iParity ^= parity[root];
+		root = parent[root];
+	}
+	int curParity = iParity;
+	while (parent[i] != root)
+	{
+		int next = parent[i];
+		int nextParity = curParity ^ parity[i];
+		parent[i] = root;
+		parity[i] = (char)curParity;
+		i = next;
+		curParity = nextParity;
+	}
+	return root;
+}
+
+// adds the constraint label(i) XOR label(j) = d, a contradicting constraint is ignored;
+// the node with the largest index (the constant 0) always stays the root of its class
+static void joinClasses(std::vector<int>& parent, std::vector<char>& parity, int i, int j, int d)
+{
+	int iParity, jParity;
+	int iRoot = findClass(parent, parity, i, iParity);
+	int jRoot = findClass(parent, parity, j, jParity);
+	if (iRoot == jRoot)
+		return;
+	if (iRoot > jRoot)
+		std::swap(iRoot, jRoot);
+	parent[iRoot] = jRoot;
+	parity[iRoot] = (char)(iParity ^ jParity ^ d);
+}
+
+GraphType* probeBlocks(GraphType* g, const GraphType::ProbeOptions& probeOptions, int numBlocks, ThreadPool* pool, int* mapping)
+{
+	int numNodes = g -> GetNodeNum();
+
+	// the blocks are the ranges of consecutive nodes, e.g. bands of rows for grids;
+	// with weak persistencies the fixings found in different blocks could be incompatible, so they are not used
+	std::chrono::steady_clock::time_point deadline = probeDeadline;
+	std::vector< std::vector<int> > blockMappings(numBlocks, std::vector<int>(numNodes));
+	auto probeBlock = [&](int iBlock, int iThread) {
+		std::vector<char> mask(numNodes, 0);
+		std::fill(mask.begin() + (long long)numNodes * iBlock / numBlocks, mask.begin() + (long long)numNodes * (iBlock + 1) / numBlocks, 1);
+
+		GraphType::ProbeOptions blockOptions = probeOptions;
+		blockOptions.weak_persistencies = 0;
+		blockOptions.probe_mask = &mask[0];
+		probeDeadline = deadline;
+
+		// the copy constructor only reads g
+		GraphType copy(*g);
+		copy.Probe(&blockMappings[iBlock][0], blockOptions);
+	};
+	if (pool != NULL)
+		pool -> parallelFor(numBlocks, probeBlock);
+	else
+		for(int iBlock = 0; iBlock < numBlocks; ++iBlock)
+			probeBlock(iBlock, 0);
+
+	// merge the results of the blocks: every fixing and equivalence holds for all minima of the energy;
+	// element numNodes is the constant 0
+	std::vector<int> parent(numNodes + 1);
+	std::vector<char> parity(numNodes + 1, 0);
+	for(int i = 0; i <= numNodes; ++i)
+		parent[i] = i;
+	std::vector<int> firstNode(numNodes, -1);
+	for(int iBlock = 0; iBlock < numBlocks; ++iBlock)
+	{
+		const std::vector<int>& blockMapping = blockMappings[iBlock];
+		std::fill(firstNode.begin(), firstNode.end(), -1);
+		for(int i = 0; i < numNodes; ++i)
+		{
+			int j = blockMapping[i] / 2;
+			if (j == 0)
+				joinClasses(parent, parity, i, numNodes, blockMapping[i] % 2);
+			else if (firstNode[j] < 0)
+				firstNode[j] = i;
+			else
+				joinClasses(parent, parity, i, firstNode[j], (blockMapping[i] + blockMapping[firstNode[j]]) % 2);
+		}
+	}
+
+	// node 0 of the new energy is the constant 0, the other classes get new nodes
+	std::vector<int> classNode(numNodes + 1, -1);
+	classNode[numNodes] = 0;
+	int numNewNodes = 1;
+	for(int i = 0; i < numNodes; ++i)
+	{
+		int iParity;
+		int root = findClass(parent, parity, i, iParity);
+		if (classNode[root] < 0)
+			classNode[root] = numNewNodes++;
+		mapping[i] = 2 * classNode[root] + iParity;
+	}
+
+	// the terms of g are expressed via the new nodes, the energy changes only by a constant
+	GraphType* probed = new GraphType(numNewNodes, g -> GetMaxEdgeNum());
+	probed -> AddNode(numNewNodes);
+	probed -> AddUnaryTerm(0, 0, 1);
+	for(int i = 0; i < numNodes; ++i)
+	{
+		double E[2];
+		g -> GetTwiceUnaryTerm(i, E[0], E[1]);
+		int x = mapping[i] % 2;
+		if (mapping[i] >= 2)
+			probed -> AddUnaryTerm(mapping[i] / 2, E[x], E[1 - x]);
+	}
+	for(GraphType::EdgeId e = g -> GetNextEdgeId(-1); e >= 0; e = g -> GetNextEdgeId(e))
+	{
+		GraphType::NodeId i, j;
+		double E[2][2];
+		g -> GetTwicePairwiseTerm(e, i, j, E[0][0], E[0][1], E[1][0], E[1][1]);
+		int iNew = mapping[i] / 2, iX = mapping[i] % 2;
+		int jNew = mapping[j] / 2, jX = mapping[j] % 2;
+		if (iNew == 0 && jNew == 0)
+			continue;
+		if (iNew == 0)
+			probed -> AddUnaryTerm(jNew, E[iX][jX], E[iX][1 - jX]);
+		else if (jNew == 0)
+			probed -> AddUnaryTerm(iNew, E[iX][jX], E[1 - iX][jX]);
+		else if (iNew == jNew)
+			probed -> AddUnaryTerm(iNew, E[iX][jX], E[1 - iX][1 - jX]);
+		else
+			probed -> AddPairwiseTerm(iNew, jNew, E[iX][jX], E[iX][1 - jX], E[1 - iX][jX], E[1 - iX][1 - jX]);
+	}
+	probed -> MergeParallelEdges();
+	probed -> Solve();
+	return probed;
+}
+
+int getNumThreads(const mxArray *tInPtr)
+{
+	if (tInPtr == NULL || mxIsEmpty(tInPtr))
+		return 0;
+	MATLAB_ASSERT(mxIsNumeric(tInPtr) && mxGetNumberOfElements(tInPtr) == 1, "qpboMex: The number of threads should be a numeric scalar");
+	double numThreads = mxGetScalar(tInPtr);
+	MATLAB_ASSERT(numThreads >= 1 && floor(numThreads) == numThreads, "qpboMex: The number of threads should be a positive integer");
+	return (int)round(numThreads);
 }
 
 
@@ -10,14 +10,46 @@
 % Usage:
 % [LB] = qpboMex(unaryTerms, pairwiseTerms);
 % [LB, labels] = qpboMex(unaryTerms, pairwiseTerms);
+% [LB, labels] = qpboMex(unaryTerms, pairwiseTerms, options);
+% [LB, labels] = qpboMex(unaryTerms, pairwiseTerms, options, numThreads);
+% [LB, labels] = qpboMex(unaryTermsShared, pairwiseTerms, numThreads);
+% [LB, labels] = qpboMex(unaryTermsBatch, pairwiseTerms, numThreads);
+% [LB, labels] = qpboMex(unaryTermsBatch, pairwiseTerms, options, numThreads);
 % 	
 % Inputs:
 % unaryTerms - of type double, array size [numNodes, 2]; the cost of assigning 0, 1 to the corresponding unary term ([Dp(0), Dp(1)])
 % pairwiseTerms - of type double, array size [numEdges, 6]; each line corresponds to an edge [p, q, Vpq(0,0), Vpq(0, 1), Vpq(1,0), Vpq(1,1)];
 % 				p and q - indecies of vertecies from 1,...,numNodes, p != q;
+% options - structure (optional) with the following fields (all optional):
+% 	probe - run QPBO-P (probing) after QPBO to label more nodes (default: false)
+% 	probeDilation - dilation parameter of probing, -1 means no dilation (default: 3)
+% 	probeDirectedConstraints - 0, 1 or 2, the way to add directed constraints when probing (default: 2)
+% 	probeWeakPersistencies - use weak persistencies when probing (default: false)
+% 	probeTimeLimit - time budget for probing in seconds (default: Inf)
+% 	probeNumBlocks - if > 1, the nodes are split into this number of blocks of consecutive indices (e.g. bands of rows of a grid),
+% 		the blocks are probed in parallel on copies of the graph and the found fixings and equivalences are merged (default: 1)
+% 		The nodes are tested only within their block, so a few fewer nodes can get labeled than with the sequential probing.
+% 		probeWeakPersistencies is ignored in this case. In the shared and batch modes the blocks are probed sequentially.
+% 	improveIter - the number of QPBO-I (improve) rounds; if positive, all nodes get labels (default: 0)
+% 	improveOrder - indices of the nodes fixed in each round, in the order of fixing (default: random permutation of all nodes)
+% 	improveTimeLimit - time budget for the improve rounds in seconds (default: Inf)
+% 	improveSeed - seed of the random permutations (default: 0)
 % 
 % Outputs:
 % LB - of type double, a single number; lower bound found by QPBO
 % labels - of type double, array size [numNodes, 1] of {0, 1, -1}; labeling found by QPBO; -1 means refusal to label the vertex
+% 	LB is always the lower bound of QPBO. Probing keeps labels persistent, improve rounds make the labeling complete but not necessarily optimal.
+% 
+% Shared pairwise terms:
+% unaryTermsShared - of type double, array size [numNodes, 2, numProblems]; the problems differ only in the unary terms
+% The graph with pairwise terms is built once and copied for each problem, the problems are solved in parallel.
+% LB is a vector of length numProblems and labels is an array of size [numNodes, numProblems].
+% 
+% Batch mode:
+% unaryTermsBatch - cell array of numProblems unaryTerms matrices; the problems are solved in parallel
+% pairwiseTerms - either a single matrix shared by all problems or a cell array of the same size as unaryTermsBatch
+% options - a single structure used for all problems
+% numThreads - the number of threads (optional, used by probeNumBlocks for a single problem); by default, the environment variable SMR_NUM_THREADS or the number of cores is used
+% In the batch mode, LB is a vector of length numProblems and labels is a cell array of numProblems label vectors.
 % 
 % Anton Osokin, firstname.lastname@gmail.com, 24.09.2014 
@@ -0,0 +1,305 @@
+#ifndef __THREADPOOL_H__
+#define __THREADPOOL_H__
+
+// threadPool.h - persistent work-stealing thread pool used by the batched modes of the mex-functions
+//
+// The pool is created by the first call of getThreadPool() and stays alive between the calls of the mex-function.
+// The worker threads are stopped and joined by deleteThreadPool() which is registered with mexAtExit,
+// i.e. it is called when the mex-file is cleared or MATLAB exits.
+//
+// Size of the pool (the calling thread is counted as one of the threads):
+//   1) numThreads argument of getThreadPool(), if positive;
+//   2) otherwise the size of the existing pool;
+//   3) otherwise the environment variable SMR_NUM_THREADS, if set;
+//   4) otherwise the number of hardware threads.
+// Requesting a different size recreates the pool.
+//
+// ThreadPool::parallelFor(numTasks, func) calls func(iTask, iThread) for every iTask in [0, numTasks).
+// The tasks are split into chunks which are distributed over per-thread queues;
+// a thread that runs out of work steals chunks from the queues of the other threads.
+// The calling thread takes part in the computation and parallelFor returns when all the tasks are finished.
+// iThread is in [0, getNumThreads()) and can be used to select per-thread scratch memory.
+// If a task throws, the remaining chunks of the batch are skipped and the first exception is rethrown by parallelFor
+// on the calling thread; the mex-functions convert it to a MATLAB error with mexErrMsgTaskException().
+//
+// IMPORTANT:
+// 1. The tasks must not call any functions of MATLAB API (mx*, mex*), in particular mexErrMsgTxt, mexPrintf and mxMalloc.
+//    All the inputs have to be checked and all the outputs have to be allocated by the calling thread.
+// 2. parallelFor can be called only from the MATLAB thread and must not be nested.
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <deque>
+#include <vector>
+#include <exception>
+#include <new>
+#include <cstdlib>
+#include <cstdio>
+
+#include "mex.h"
+
+class ThreadPool
+{
+public:
+	explicit ThreadPool(int numThreads);
+	~ThreadPool();
+
+	int getNumThreads() const { return m_numThreads; }
+
+	// Calls func(iTask, iThread) for iTask = 0, ..., numTasks - 1. Chunks contain at least grainSize consecutive tasks.
+	template <class Func> void parallelFor(int numTasks, const Func& func, int grainSize = 1);
+
+private:
+	struct Batch
+	{
+		void (*run)(const void* func, int iBegin, int iEnd, int iThread);
+		const void* func;
+		std::atomic<int> numChunksLeft;
+		std::atomic<bool> isFailed;
+		std::mutex exceptionLock;
+		std::exception_ptr exception; // the first exception thrown by the tasks
+	};
+
+	struct Chunk
+	{
+		Batch*	batch;
+		int		iBegin;
+		int		iEnd;
+	};
+
+	struct WorkQueue
+	{
+		std::mutex			lock;
+		std::deque<Chunk>	chunks;
+	};
+
+	int							m_numThreads;
+	std::vector<std::thread>	m_workers;
+	WorkQueue*					m_queues; // one queue per thread, the last one belongs to the calling thread
+
+	std::mutex					m_sleepLock;
+	std::condition_variable		m_wakeUp;
+	std::atomic<int>			m_numChunksQueued; // upper bound on the number of chunks in all queues
+	bool						m_stop;
+
+	ThreadPool(const ThreadPool&);
+	ThreadPool& operator=(const ThreadPool&);
+
+	void workerLoop(int iThread);
+	bool popChunk(int iThread, Chunk& chunk); // takes a chunk from the own queue or steals one from the others
+	void runChunk(const Chunk& chunk, int iThread);
+
+	template <class Func> static void runRange(const void* func, int iBegin, int iEnd, int iThread)
+	{
+		const Func& f = *(const Func*)func;
+		for (int iTask = iBegin; iTask < iEnd; ++iTask)
+			f(iTask, iThread);
+	}
+};
+
+inline ThreadPool::ThreadPool(int numThreads)
+	: m_numThreads( (numThreads >= 1) ? numThreads : 1 ),
+	  m_queues(NULL),
+	  m_numChunksQueued(0),
+	  m_stop(false)
+{
+	m_queues = new WorkQueue[m_numThreads];
+	m_workers.reserve(m_numThreads - 1);
+	for (int iThread = 0; iThread < m_numThreads - 1; ++iThread)
+		m_workers.push_back( std::thread(&ThreadPool::workerLoop, this, iThread) );
+}
+
+inline ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> guard(m_sleepLock);
+		m_stop = true;
+	}
+	m_wakeUp.notify_all();
+	for (size_t iThread = 0; iThread < m_workers.size(); ++iThread)
+		m_workers[iThread].join();
+	delete [] m_queues;
+}
+
+template <class Func> void ThreadPool::parallelFor(int numTasks, const Func& func, int grainSize)
+{
+	if (numTasks <= 0)
+		return;
+
+	int callerThread = m_numThreads - 1;
+	if (m_numThreads == 1 || numTasks == 1) {
+		runRange<Func>(&func, 0, numTasks, callerThread);
+		return;
+	}
+
+	// several chunks per thread to leave something to steal
+	int chunkSize = numTasks / (4 * m_numThreads);
+	if (chunkSize < grainSize) chunkSize = grainSize;
+	if (chunkSize < 1) chunkSize = 1;
+	int numChunks = (numTasks + chunkSize - 1) / chunkSize;
+
+	Batch batch;
+	batch.run = &ThreadPool::runRange<Func>;
+	batch.func = &func;
+	batch.numChunksLeft.store(numChunks);
+	batch.isFailed.store(false);
+
+	m_numChunksQueued.fetch_add(numChunks);
+	for (int iChunk = 0; iChunk < numChunks; ++iChunk) {
+		Chunk chunk;
+		chunk.batch = &batch;
+		chunk.iBegin = iChunk * chunkSize;
+		chunk.iEnd = (chunk.iBegin + chunkSize < numTasks) ? chunk.iBegin + chunkSize : numTasks;
+
+		WorkQueue& queue = m_queues[iChunk % m_numThreads];
+		std::lock_guard<std::mutex> guard(queue.lock);
+		queue.chunks.push_back(chunk);
+	}
+	{
+		std::lock_guard<std::mutex> guard(m_sleepLock);
+	}
+	m_wakeUp.notify_all();
+
+	// the calling thread works as well until the whole batch is finished
+	Chunk chunk;
+	while (batch.numChunksLeft.load() > 0) {
+		if (popChunk(callerThread, chunk))
+			runChunk(chunk, callerThread);
+		else
+			std::this_thread::yield();
+	}
+
+	if (batch.isFailed.load())
+		std::rethrow_exception(batch.exception);
+}
+
+inline void ThreadPool::workerLoop(int iThread)
+{
+	Chunk chunk;
+	for (;;) {
+		if (popChunk(iThread, chunk)) {
+			runChunk(chunk, iThread);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> guard(m_sleepLock);
+		while (!m_stop && m_numChunksQueued.load() <= 0)
+			m_wakeUp.wait(guard);
+		if (m_stop)
+			return;
+	}
+}
+
+inline bool ThreadPool::popChunk(int iThread, Chunk& chunk)
+{
+	{
+		WorkQueue& queue = m_queues[iThread];
+		std::lock_guard<std::mutex> guard(queue.lock);
+		if (!queue.chunks.empty()) {
+			chunk = queue.chunks.back();
+			queue.chunks.pop_back();
+			m_numChunksQueued.fetch_sub(1);
+			return true;
+		}
+	}
+	for (int iShift = 1; iShift < m_numThreads; ++iShift) {
+		WorkQueue& queue = m_queues[(iThread + iShift) % m_numThreads];
+		std::lock_guard<std::mutex> guard(queue.lock);
+		if (!queue.chunks.empty()) {
+			chunk = queue.chunks.front();
+			queue.chunks.pop_front();
+			m_numChunksQueued.fetch_sub(1);
+			return true;
+		}
+	}
+	return false;
+}
+
+inline void ThreadPool::runChunk(const Chunk& chunk, int iThread)
+{
+	Batch* batch = chunk.batch;
+	if (!batch->isFailed.load()) {
+		// an exception must not leave the worker thread (std::terminate) and the chunk has to be counted anyway
+		try {
+			batch->run(batch->func, chunk.iBegin, chunk.iEnd, iThread);
+		}
+		catch (...) {
+			std::lock_guard<std::mutex> guard(batch->exceptionLock);
+			if (!batch->isFailed.load()) {
+				batch->exception = std::current_exception();
+				batch->isFailed.store(true);
+			}
+		}
+	}
+	batch->numChunksLeft.fetch_sub(1); // batch can be destroyed by the calling thread right after this line
+}
+
+/* the pool shared by all calls of the mex-function */
+inline ThreadPool*& threadPoolStorage()
+{
+	static ThreadPool* pool = NULL;
+	return pool;
+}
+
+inline void deleteThreadPool(void)
+{
+	ThreadPool*& pool = threadPoolStorage();
+	delete pool;
+	pool = NULL;
+}
+
+inline int getDefaultNumThreads()
+{
+	const char* envValue = getenv("SMR_NUM_THREADS");
+	if (envValue != NULL) {
+		int numThreads = atoi(envValue);
+		if (numThreads >= 1)
+			return numThreads;
+	}
+	int numThreads = (int)std::thread::hardware_concurrency();
+	return (numThreads >= 1) ? numThreads : 1;
+}
+
+/* converts the exception rethrown by parallelFor to a MATLAB error, to be called from a catch (...) block of the MATLAB thread */
+inline void mexErrMsgTaskException(const char* errorId)
+{
+	char message[256];
+	try {
+		throw;
+	}
+	catch (const std::bad_alloc&) {
+		snprintf(message, sizeof(message), "Out of memory in a worker thread");
+	}
+	catch (const std::exception& e) {
+		snprintf(message, sizeof(message), "Exception in a worker thread: %s", e.what());
+	}
+	catch (...) {
+		snprintf(message, sizeof(message), "Unknown exception in a worker thread");
+	}
+	mexErrMsgIdAndTxt(errorId, "%s", message);
+}
+
+inline ThreadPool* getThreadPool(int numThreads = 0)
+{
+	static bool isAtExitRegistered = false;
+	ThreadPool*& pool = threadPoolStorage();
+
+	if (numThreads <= 0)
+		numThreads = (pool != NULL) ? pool->getNumThreads() : getDefaultNumThreads();
+
+	if (pool != NULL && pool->getNumThreads() != numThreads)
+		deleteThreadPool();
+
+	if (pool == NULL) {
+		pool = new ThreadPool(numThreads);
+		if (!isAtExitRegistered) {
+			mexAtExit(deleteThreadPool);
+			isAtExitRegistered = true;
+		}
+	}
+	return pool;
+}
+
+#endif
@@ -0,0 +1,34 @@
+function build_trwsDynamicMex
+% build_trwsDynamicMex builds package trwsDynamicMex
+
+mexFlags = ' -largeArrayDims ';
+if ~isempty(strfind(mexext, '64'))
+    mexFlags = [mexFlags, ' -DA64BITS '];
+end
+% the TRW-S code is shared with trwsMex_time
+codePath = fullfile('..', 'trwsMex_time', 'src');
+threadPoolPath = fullfile('..', 'threadPool');
+
+mexFlags = [mexFlags, ' -I', codePath, ' -I', threadPoolPath, ' -Isrc '];
+% the wavefront mode uses std::thread
+if isunix
+    mexFlags = [mexFlags, ' CXXFLAGS="$CXXFLAGS -std=c++11 -pthread" LDFLAGS="$LDFLAGS -pthread" '];
+end
+
+trwsFiles = [' ', fullfile(codePath, 'trwsProblem.cpp'), ...
+             ' ', fullfile(codePath, 'ordering.cpp'), ...
+             ' ', fullfile(codePath, 'MRFEnergy.cpp'), ...
+             ' ', fullfile(codePath, 'treeProbabilities.cpp'), ...
+             ' ', fullfile(codePath, 'minimize.cpp'), ' '];
+
+mexcmd = ['mex src/trwsDynamicMex.cpp src/trwsMemory.cpp ', trwsFiles, ' -output trwsDynamicMex', mexFlags];
+eval(mexcmd);
+
+mexcmd = ['mex src/runTrwsDynamicMex.cpp src/trwsMemory.cpp ', trwsFiles, ' -output runTrwsDynamicMex', mexFlags];
+eval(mexcmd);
+
+mexcmd = ['mex src/updateUnaryTrwsDynamicMex.cpp src/trwsMemory.cpp ', trwsFiles, ' -output updateUnaryTrwsDynamicMex', mexFlags];
+eval(mexcmd);
+
+mexcmd = ['mex src/deleteTrwsDynamicMex.cpp src/trwsMemory.cpp ', trwsFiles, ' -output deleteTrwsDynamicMex', mexFlags];
+eval(mexcmd);
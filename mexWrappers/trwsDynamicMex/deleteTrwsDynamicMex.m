@@ -0,0 +1,12 @@
+% 	deleteTrwsDynamicMex - a part of trwsDynamicMex:
+%		Matlab interface to Vladimir Kolmogorov's implementation of TRW-S algorithm
+%
+% 	deleteTrwsDynamicMex function frees the memory given a pointer
+%
+% 	Usage:
+% 	deleteTrwsDynamicMex( trwsHandle );
+%
+% 	Inputs:
+% 	trwsHandle - a single number given by trwsDynamicMex
+%
+%     See also trwsDynamicMex, runTrwsDynamicMex, updateUnaryTrwsDynamicMex
@@ -0,0 +1,37 @@
+% example of usage of package trwsDynamicMex
+
+% this example runs trwsDynamicMex on a simple binary energy of 5 variables
+% y1 - y2 + y1 * y5 - 10 * y1 * y3 - y3 * y4 + y3 * y5
+% and then adds 5 * y2 to the energy
+
+dataCost = [0 0 0 0 0; 1 -1 0 0 0];
+
+neighbors = sparse([1; 1; 3; 3], [5; 3; 4; 5], [1; -10; -1; 1], 5, 5);
+
+metric = [0 0; 0 1];
+
+options.maxIter = 100;
+[labels, energy, LB, trwsHandle] = trwsDynamicMex(dataCost, neighbors, metric, options);
+
+if ~isequal(energy, -11)
+    warning('Wrong value of energy!')
+end
+if ~isequal(labels, [2; 2; 2; 2; 1])
+    warning('Wrong value of labels!')
+end
+
+% [p, dU(1, p), dU(2, p)] - the update of the unary terms
+unaryUpdate = [2, 0, 5];
+updateUnaryTrwsDynamicMex(trwsHandle, unaryUpdate);
+
+% TRW-S continues from the messages of the first run
+[labels, energy, LB] = runTrwsDynamicMex(trwsHandle, 10);
+
+if ~isequal(energy, -10)
+    warning('Wrong value of energy!')
+end
+if ~isequal(labels, [2; 1; 2; 2; 1])
+    warning('Wrong value of labels!')
+end
+
+deleteTrwsDynamicMex( trwsHandle );
@@ -0,0 +1,23 @@
+% 	runTrwsDynamicMex - a part of trwsDynamicMex:
+%		Matlab interface to Vladimir Kolmogorov's implementation of TRW-S algorithm
+%
+%	runTrwsDynamicMex runs more iterations of TRW-S (or BP) starting from the messages kept in the handle
+%	and returns the best labeling and the lower bound of these iterations.
+%
+%	Usage:
+%	S = runTrwsDynamicMex(trwsHandle, numIter);
+%	[S, E, LB] = runTrwsDynamicMex(trwsHandle, numIter);
+%	[S, E, LB, lbPlot, energyPlot, timePlot] = runTrwsDynamicMex(trwsHandle, numIter);
+%	[S, E, LB, lbPlot, energyPlot, timePlot, minMarginals] = runTrwsDynamicMex(trwsHandle, numIter);
+%
+%	Inputs:
+%	trwsHandle - a single number given by trwsDynamicMex
+%	numIter - the number of iterations (double), default: 0; numIter = 0 only returns the results of the previous run,
+%		which do not reflect the updates made by updateUnaryTrwsDynamicMex after it
+%
+%	Outputs:
+%	S, E, LB, lbPlot, energyPlot, timePlot - the same as in trwsMex_time, the plots cover the iterations of this run only
+%	minMarginals - the same as in trwsMex_time, computed at the last iteration of this run only if requested;
+%		numIter = 0 returns the min-marginals of the previous run if they were requested there and [] otherwise
+%
+%	See also trwsDynamicMex, updateUnaryTrwsDynamicMex, deleteTrwsDynamicMex
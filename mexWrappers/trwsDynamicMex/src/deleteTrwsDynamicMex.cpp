@@ -0,0 +1,16 @@
+#include "trwsMemory.h"
+#include "mex.h"
+
+void mexFunction(int nlhs, mxArray *plhs[],
+    int nrhs, const mxArray *prhs[])
+{
+	if ( nrhs != 1 ) {
+		mexErrMsgIdAndTxt("deleteTrwsDynamicMex:inputArguments","Wrong number of input arguments, expected 1");
+	}
+
+	// get TRW-S handle
+	TrwsEnergy* energy = getTrwsHandle(prhs[0]);
+
+	//free memory
+	deleteTrwsEnergy(energy);
+}
@@ -0,0 +1,85 @@
+#include "trwsMemory.h"
+#include "mex.h"
+#include "threadPool.h"
+
+#include <cmath>
+
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
+{
+	if ( nrhs < 1 || nrhs > 2 ) {
+		mexErrMsgIdAndTxt("runTrwsDynamicMex:parameters", "Wrong number of input arguments, expected 1 or 2");
+	}
+	if ( nlhs > 7 ) {
+		mexErrMsgIdAndTxt("runTrwsDynamicMex:parameters", "Too many output arguments, expected 1 - 7");
+	}
+
+	// set up pointers for input/ output parameters
+	const mxArray *trwsHandleInPtr = prhs[0]; //trwsHandle
+	const mxArray *numIterInPtr = (nrhs > 1) ? prhs[1] : NULL; //number of iterations
+	mxArray **sOutPtr = (nlhs > 0) ? &plhs[0] : NULL; //solution
+	mxArray **eOutPtr = (nlhs > 1) ? &plhs[1] : NULL; //energy
+	mxArray **lbOutPtr = (nlhs > 2) ? &plhs[2] : NULL; //lowerbound
+	mxArray **lbPlotOutPtr = (nlhs > 3) ? &plhs[3] : NULL; //lowerbound plot
+	mxArray **energyPlotOutPtr = (nlhs > 4) ? &plhs[4] : NULL; //energy plot
+	mxArray **timePlotOutPtr = (nlhs > 5) ? &plhs[5] : NULL; //time plot
+	mxArray **minMarginalsOutPtr = (nlhs > 6) ? &plhs[6] : NULL; //min-marginals
+
+	TrwsEnergy* energy = getTrwsHandle(trwsHandleInPtr);
+
+	int numIter = 0;
+	if ( numIterInPtr != NULL ) {
+		if ( !mxIsNumeric(numIterInPtr) || mxGetNumberOfElements(numIterInPtr) != 1 ) {
+			mexErrMsgIdAndTxt("runTrwsDynamicMex:badNumIter", "The number of iterations should be a numeric scalar");
+		}
+		double numIterValue = mxGetScalar(numIterInPtr);
+		if ( numIterValue < 0 || floor(numIterValue) != numIterValue ) {
+			mexErrMsgIdAndTxt("runTrwsDynamicMex:badNumIter", "The number of iterations should be a non-negative integer");
+		}
+		numIter = (int)numIterValue;
+	}
+
+	// zero iterations return the results of the previous run
+	if ( numIter > 0 ) {
+		energy->options.computeMinMarginals = (minMarginalsOutPtr != NULL);
+		try {
+			runTrwsEnergy(energy, numIter, getProblemThreadPool(energy->options));
+		}
+		catch (...) {
+			mexErrMsgTaskException("runTrwsDynamicMex:threadPool");
+		}
+	}
+
+	const TrwsResult& result = energy->result;
+
+	//output the best solution
+	if(sOutPtr != NULL)
+		*sOutPtr = createColumn(result.segment);
+
+	//output the best energy value
+	if(eOutPtr != NULL)	{
+		*eOutPtr = mxCreateNumericMatrix(1, 1, mxDOUBLE_CLASS, mxREAL);
+		*(double*)mxGetData(*eOutPtr) = result.energy;
+	}
+
+	//output the best lower bound
+	if(lbOutPtr != NULL)	{
+		*lbOutPtr = mxCreateNumericMatrix(1, 1, mxDOUBLE_CLASS, mxREAL);
+		*(double*)mxGetData(*lbOutPtr) = result.lowerBound;
+	}
+
+	//output lower bound plot
+	if(lbPlotOutPtr != NULL)
+		*lbPlotOutPtr = createColumn(result.lbPlot);
+
+	//output energy plot
+	if(energyPlotOutPtr != NULL)
+		*energyPlotOutPtr = createColumn(result.energyPlot);
+
+	//output time plot
+	if(timePlotOutPtr != NULL)
+		*timePlotOutPtr = createColumn(result.timePlot);
+
+	//output min-marginals
+	if(minMarginalsOutPtr != NULL)
+		*minMarginalsOutPtr = createMatrix(result.minMarginals, energy->numLabels);
+}
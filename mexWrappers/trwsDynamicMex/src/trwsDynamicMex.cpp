@@ -0,0 +1,66 @@
+#include "trwsMemory.h"
+#include "mex.h"
+#include "threadPool.h"
+
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
+{
+	MATLAB_ASSERT(nrhs >= 2 , "Not enough input arguments, expected 2 - 4" );
+	MATLAB_ASSERT(nrhs <= 4, "Too many input arguments, expected 2 - 4");
+
+	MATLAB_ASSERT(nlhs <= 4, "Too many output arguments, expected 1 - 4");
+
+	//Fix input parameter order:
+	const mxArray *uInPtr = (nrhs > 0) ? prhs[0] : NULL; //unary
+	const mxArray *pInPtr = (nrhs > 1) ? prhs[1] : NULL; //pairwise
+	const mxArray *mInPtr = (nrhs > 2) ? prhs[2] : NULL; //label matrix
+	const mxArray *oInPtr = (nrhs > 3) ? prhs[3] : NULL; //options
+
+	//Fix output parameter order:
+	mxArray **sOutPtr = (nlhs > 0) ? &plhs[0] : NULL; //solution
+	mxArray **eOutPtr = (nlhs > 1) ? &plhs[1] : NULL; //energy
+	mxArray **lbOutPtr = (nlhs > 2) ? &plhs[2] : NULL; //lowerbound
+	mxArray **trwsHandleOutPtr = (nlhs > 3) ? &plhs[3] : NULL; //trwsHandle
+
+	MATLAB_ASSERT(!mxIsCell(uInPtr) && (!mxIsCell(pInPtr) || isGridPairwise(pInPtr)), "Cell arrays of the batch mode are not supported by trwsDynamicMex");
+
+	//get options structure
+	TrwsOptions options;
+	readOptions(oInPtr, options);
+	// the admissible labels depend on the unary terms that can be updated
+	MATLAB_ASSERT(!options.pruneLabels, "options.pruneLabels is not supported by trwsDynamicMex");
+
+	TrwsProblem problem;
+	readProblem(uInPtr, pInPtr, mInPtr, options, problem);
+
+	// the first options.maxIter iterations start from zero messages
+	TrwsEnergy* energy = createTrwsEnergy(problem, options);
+	try {
+		runTrwsEnergy(energy, options.m_iterMax, getProblemThreadPool(options));
+	}
+	catch (...) {
+		deleteTrwsEnergy(energy);
+		mexErrMsgTaskException("trwsDynamicMex:threadPool");
+	}
+
+	//output the best solution
+	if(sOutPtr != NULL)
+		*sOutPtr = createColumn(energy->result.segment);
+
+	//output the best energy value
+	if(eOutPtr != NULL)	{
+		*eOutPtr = mxCreateNumericMatrix(1, 1, mxDOUBLE_CLASS, mxREAL);
+		*(double*)mxGetData(*eOutPtr) = energy->result.energy;
+	}
+
+	//output the best lower bound
+	if(lbOutPtr != NULL)	{
+		*lbOutPtr = mxCreateNumericMatrix(1, 1, mxDOUBLE_CLASS, mxREAL);
+		*(double*)mxGetData(*lbOutPtr) = energy->result.lowerBound;
+	}
+
+	// the energy is kept only if the handle is requested
+	if(trwsHandleOutPtr != NULL)
+		*trwsHandleOutPtr = createTrwsHandle(energy);
+	else
+		deleteTrwsEnergy(energy);
+}
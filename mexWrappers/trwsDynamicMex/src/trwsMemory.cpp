@@ -0,0 +1,165 @@
+#include "trwsMemory.h"
+
+template <class T> void runEnergy(TrwsEnergy* energy, ThreadPool* threadPool)
+{
+	minimizeEnergy((MRFEnergy<T>*)energy->mrf, (typename MRFEnergy<T>::NodeId*)energy->nodes, energy->numNodes, energy->numLabels, energy->options, threadPool, energy->result);
+}
+
+template <class T> void addUnary(TrwsEnergy* energy, mwSize node, const double* values)
+{
+	vector<typename T::REAL> D(energy->numLabels);
+	getValues(values, false, 0, energy->numLabels, &D[0]);
+
+	MRFEnergy<T>* mrf = (MRFEnergy<T>*)energy->mrf;
+	typename MRFEnergy<T>::NodeId* nodes = (typename MRFEnergy<T>::NodeId*)energy->nodes;
+	mrf->AddNodeData(nodes[node], typename T::NodeData(&D[0]));
+}
+
+template <class T> void deleteEnergy(TrwsEnergy* energy)
+{
+	delete [] (typename MRFEnergy<T>::NodeId*)energy->nodes;
+	delete (MRFEnergy<T>*)energy->mrf;
+	delete [] (typename T::REAL*)energy->labelMatrix;
+}
+
+TrwsEnergy* getTrwsHandle(const mxArray *x)
+{
+	TrwsHandle th = 0;
+	TrwsEnergy* energy = 0;
+
+	if ( mxGetClassID(x) != MATLAB_POINTER_TYPE ) {
+		mexErrMsgIdAndTxt("trwsMemory:handleWrongType", "TRW-S handle argument is not of proper type");
+	}
+	if ( mxGetNumberOfElements(x) != 1 ) {
+		mexErrMsgIdAndTxt("trwsMemory:handleWrongSize", "Too many TRW-S handles");
+	}
+
+	th = (TrwsHandle*)mxGetData(x);
+	energy = (TrwsEnergy*)(*(POINTER_CAST*)th);
+	if ( energy == NULL ) {
+		mexErrMsgIdAndTxt("trwsMemory:badHandle", "TRW-S handle is not valid");
+	}
+	return energy;
+}
+
+mxArray* createTrwsHandle(TrwsEnergy* energy)
+{
+	mxArray* x = mxCreateNumericMatrix(1, 1, MATLAB_POINTER_TYPE, mxREAL);
+	*(TrwsHandle*)mxGetData(x) = (TrwsHandle)energy;
+	return x;
+}
+
+TrwsEnergy* createTrwsEnergy(const TrwsProblem& problem, const TrwsOptions& options)
+{
+	TrwsEnergy* energy = new TrwsEnergy;
+	energy->numNodes = problem.numNodes;
+	energy->numLabels = problem.numLabels;
+	energy->options = options;
+	energy->verbosityLevel = verbosityLevel;
+	energy->labelMatrix = NULL;
+
+	bool isSingle = isSinglePrecision(problem, options);
+	if ( options.pairwiseType == 1 ) {
+		energy->type = TRWS_TRUNCATED_LINEAR;
+		energy->nodes = new MRFEnergy<TypeTruncatedLinear>::NodeId[problem.numNodes];
+		energy->mrf = createTruncatedEnergy<TypeTruncatedLinear>(problem, options, (MRFEnergy<TypeTruncatedLinear>::NodeId*)energy->nodes);
+	} else if ( options.pairwiseType == 2 ) {
+		energy->type = TRWS_TRUNCATED_QUADRATIC;
+		energy->nodes = new MRFEnergy<TypeTruncatedQuadratic>::NodeId[problem.numNodes];
+		energy->mrf = createTruncatedEnergy<TypeTruncatedQuadratic>(problem, options, (MRFEnergy<TypeTruncatedQuadratic>::NodeId*)energy->nodes);
+	} else if ( options.pairwiseType == 3 ) {
+		energy->type = TRWS_TRUNCATED_LINEAR_2D;
+		energy->nodes = new MRFEnergy<TypeTruncatedLinear2D>::NodeId[problem.numNodes];
+		energy->mrf = createTruncatedEnergy<TypeTruncatedLinear2D>(problem, options, (MRFEnergy<TypeTruncatedLinear2D>::NodeId*)energy->nodes);
+	} else if ( options.pairwiseType == 4 ) {
+		energy->type = TRWS_TRUNCATED_QUADRATIC_2D;
+		energy->nodes = new MRFEnergy<TypeTruncatedQuadratic2D>::NodeId[problem.numNodes];
+		energy->mrf = createTruncatedEnergy<TypeTruncatedQuadratic2D>(problem, options, (MRFEnergy<TypeTruncatedQuadratic2D>::NodeId*)energy->nodes);
+	} else if ( problem.labelMatrix != NULL && options.sharedLabelMatrix ) {
+		if (isSingle) {
+			energy->type = TRWS_WEIGHTED_GENERAL_FLOAT;
+			energy->nodes = new MRFEnergy<TypeWeightedGeneralFloat>::NodeId[problem.numNodes];
+			energy->labelMatrix = new TypeWeightedGeneralFloat::REAL[problem.numLabels * problem.numLabels];
+			energy->mrf = createWeightedGeneralEnergy<TypeWeightedGeneralFloat>(problem, options, (MRFEnergy<TypeWeightedGeneralFloat>::NodeId*)energy->nodes, (TypeWeightedGeneralFloat::REAL*)energy->labelMatrix);
+		} else {
+			energy->type = TRWS_WEIGHTED_GENERAL;
+			energy->nodes = new MRFEnergy<TypeWeightedGeneral>::NodeId[problem.numNodes];
+			energy->labelMatrix = new TypeWeightedGeneral::REAL[problem.numLabels * problem.numLabels];
+			energy->mrf = createWeightedGeneralEnergy<TypeWeightedGeneral>(problem, options, (MRFEnergy<TypeWeightedGeneral>::NodeId*)energy->nodes, (TypeWeightedGeneral::REAL*)energy->labelMatrix);
+		}
+	} else if ( problem.labelMatrix != NULL ) {
+		if (isSingle) {
+			energy->type = TRWS_GENERAL_FLOAT;
+			energy->nodes = new MRFEnergy<TypeGeneralFloat>::NodeId[problem.numNodes];
+			energy->mrf = createGeneralEnergy<TypeGeneralFloat>(problem, options, (MRFEnergy<TypeGeneralFloat>::NodeId*)energy->nodes);
+		} else {
+			energy->type = TRWS_GENERAL;
+			energy->nodes = new MRFEnergy<TypeGeneral>::NodeId[problem.numNodes];
+			energy->mrf = createGeneralEnergy<TypeGeneral>(problem, options, (MRFEnergy<TypeGeneral>::NodeId*)energy->nodes);
+		}
+	} else {
+		if (isSingle) {
+			energy->type = TRWS_POTTS_FLOAT;
+			energy->nodes = new MRFEnergy<TypePottsFloat>::NodeId[problem.numNodes];
+			energy->mrf = createPottsEnergy<TypePottsFloat>(problem, options, (MRFEnergy<TypePottsFloat>::NodeId*)energy->nodes);
+		} else {
+			energy->type = TRWS_POTTS;
+			energy->nodes = new MRFEnergy<TypePotts>::NodeId[problem.numNodes];
+			energy->mrf = createPottsEnergy<TypePotts>(problem, options, (MRFEnergy<TypePotts>::NodeId*)energy->nodes);
+		}
+	}
+	return energy;
+}
+
+void runTrwsEnergy(TrwsEnergy* energy, int numIter, ThreadPool* threadPool)
+{
+	// the handle can be used by another MEX-file, which has its own copy of the global variable
+	verbosityLevel = energy->verbosityLevel;
+	energy->options.m_iterMax = numIter;
+
+	switch (energy->type) {
+		case TRWS_POTTS: runEnergy<TypePotts>(energy, threadPool); break;
+		case TRWS_POTTS_FLOAT: runEnergy<TypePottsFloat>(energy, threadPool); break;
+		case TRWS_GENERAL: runEnergy<TypeGeneral>(energy, threadPool); break;
+		case TRWS_GENERAL_FLOAT: runEnergy<TypeGeneralFloat>(energy, threadPool); break;
+		case TRWS_WEIGHTED_GENERAL: runEnergy<TypeWeightedGeneral>(energy, threadPool); break;
+		case TRWS_WEIGHTED_GENERAL_FLOAT: runEnergy<TypeWeightedGeneralFloat>(energy, threadPool); break;
+		case TRWS_TRUNCATED_LINEAR: runEnergy<TypeTruncatedLinear>(energy, threadPool); break;
+		case TRWS_TRUNCATED_QUADRATIC: runEnergy<TypeTruncatedQuadratic>(energy, threadPool); break;
+		case TRWS_TRUNCATED_LINEAR_2D: runEnergy<TypeTruncatedLinear2D>(energy, threadPool); break;
+		case TRWS_TRUNCATED_QUADRATIC_2D: runEnergy<TypeTruncatedQuadratic2D>(energy, threadPool); break;
+	}
+}
+
+void addUnaryTrwsEnergy(TrwsEnergy* energy, mwSize node, const double* values)
+{
+	switch (energy->type) {
+		case TRWS_POTTS: addUnary<TypePotts>(energy, node, values); break;
+		case TRWS_POTTS_FLOAT: addUnary<TypePottsFloat>(energy, node, values); break;
+		case TRWS_GENERAL: addUnary<TypeGeneral>(energy, node, values); break;
+		case TRWS_GENERAL_FLOAT: addUnary<TypeGeneralFloat>(energy, node, values); break;
+		case TRWS_WEIGHTED_GENERAL: addUnary<TypeWeightedGeneral>(energy, node, values); break;
+		case TRWS_WEIGHTED_GENERAL_FLOAT: addUnary<TypeWeightedGeneralFloat>(energy, node, values); break;
+		case TRWS_TRUNCATED_LINEAR: addUnary<TypeTruncatedLinear>(energy, node, values); break;
+		case TRWS_TRUNCATED_QUADRATIC: addUnary<TypeTruncatedQuadratic>(energy, node, values); break;
+		case TRWS_TRUNCATED_LINEAR_2D: addUnary<TypeTruncatedLinear2D>(energy, node, values); break;
+		case TRWS_TRUNCATED_QUADRATIC_2D: addUnary<TypeTruncatedQuadratic2D>(energy, node, values); break;
+	}
+}
+
+void deleteTrwsEnergy(TrwsEnergy* energy)
+{
+	switch (energy->type) {
+		case TRWS_POTTS: deleteEnergy<TypePotts>(energy); break;
+		case TRWS_POTTS_FLOAT: deleteEnergy<TypePottsFloat>(energy); break;
+		case TRWS_GENERAL: deleteEnergy<TypeGeneral>(energy); break;
+		case TRWS_GENERAL_FLOAT: deleteEnergy<TypeGeneralFloat>(energy); break;
+		case TRWS_WEIGHTED_GENERAL: deleteEnergy<TypeWeightedGeneral>(energy); break;
+		case TRWS_WEIGHTED_GENERAL_FLOAT: deleteEnergy<TypeWeightedGeneralFloat>(energy); break;
+		case TRWS_TRUNCATED_LINEAR: deleteEnergy<TypeTruncatedLinear>(energy); break;
+		case TRWS_TRUNCATED_QUADRATIC: deleteEnergy<TypeTruncatedQuadratic>(energy); break;
+		case TRWS_TRUNCATED_LINEAR_2D: deleteEnergy<TypeTruncatedLinear2D>(energy); break;
+		case TRWS_TRUNCATED_QUADRATIC_2D: deleteEnergy<TypeTruncatedQuadratic2D>(energy); break;
+	}
+	delete energy;
+}
@@ -0,0 +1,67 @@
+#ifndef _TRWS_MEMORY_H_
+#define _TRWS_MEMORY_H_
+
+#include <tmwtypes.h>
+
+#include "trwsProblem.h"
+#include "mex.h"
+
+typedef void* TrwsHandle;
+
+/* pointer types in 64 bits machines */
+#ifdef A64BITS
+#define MATLAB_POINTER_TYPE mxUINT64_CLASS
+#else
+#define MATLAB_POINTER_TYPE mxUINT32_CLASS
+#endif
+
+#ifdef A64BITS
+#define POINTER_CAST    int64_T
+#else
+#define POINTER_CAST    int
+#endif
+
+// MRFEnergy instance of the energy, chosen by the label matrix, options.pairwiseType and the precision
+enum TrwsEnergyType
+{
+	TRWS_POTTS,
+	TRWS_POTTS_FLOAT,
+	TRWS_GENERAL,
+	TRWS_GENERAL_FLOAT,
+	TRWS_WEIGHTED_GENERAL,
+	TRWS_WEIGHTED_GENERAL_FLOAT,
+	TRWS_TRUNCATED_LINEAR,
+	TRWS_TRUNCATED_QUADRATIC,
+	TRWS_TRUNCATED_LINEAR_2D,
+	TRWS_TRUNCATED_QUADRATIC_2D
+};
+
+// The energy and its messages are kept between the calls. The handle is created by one MEX-file and used by the others,
+// so TrwsEnergy has no virtual functions: each MEX-file casts mrf and nodes according to type.
+struct TrwsEnergy
+{
+	TrwsEnergyType type;
+	void* mrf; // MRFEnergy<T>*
+	void* nodes; // array of numNodes MRFEnergy<T>::NodeId
+	void* labelMatrix; // array of numLabels * numLabels T::REAL shared by the edges of the weighted general types, NULL otherwise
+	mwSize numNodes;
+	mwSize numLabels;
+	TrwsOptions options; // options given at creation, options.m_iterMax is the number of iterations of the last run
+	int verbosityLevel;
+	TrwsResult result; // results of the last run
+};
+
+TrwsEnergy* getTrwsHandle(const mxArray *x); // extract handle from mxArray
+mxArray* createTrwsHandle(TrwsEnergy* energy);
+
+// the functions below do not call MATLAB API when verbosityLevel == 0
+// construct the energy of problem, the messages are zero
+TrwsEnergy* createTrwsEnergy(const TrwsProblem& problem, const TrwsOptions& options);
+// run numIter iterations starting from the current messages, the results are saved to energy->result;
+// the passes are parallel if threadPool is not NULL
+void runTrwsEnergy(TrwsEnergy* energy, int numIter, ThreadPool* threadPool);
+// add values (numLabels numbers) to the unary terms of node, the messages are kept
+void addUnaryTrwsEnergy(TrwsEnergy* energy, mwSize node, const double* values);
+void deleteTrwsEnergy(TrwsEnergy* energy);
+
+#endif /* _TRWS_MEMORY_H_ */
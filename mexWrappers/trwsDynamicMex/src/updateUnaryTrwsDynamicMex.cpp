@@ -0,0 +1,49 @@
+#include "trwsMemory.h"
+#include "mex.h"
+
+#include <cmath>
+
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
+{
+	if ( nrhs != 2 ) {
+		mexErrMsgIdAndTxt("updateUnaryTrwsDynamicMex:parameters", "Wrong number of input arguments, expected 2");
+	}
+	if ( nlhs > 0 ) {
+		mexErrMsgIdAndTxt("updateUnaryTrwsDynamicMex:parameters", "Too many output arguments, expected 0");
+	}
+
+	// set up pointers for input parameters
+	const mxArray *trwsHandleInPtr = prhs[0]; //trwsHandle
+	const mxArray *updateInPtr = prhs[1]; // the update array
+
+	TrwsEnergy* energy = getTrwsHandle(trwsHandleInPtr);
+	mwSize numNodes = energy->numNodes;
+	mwSize numLabels = energy->numLabels;
+
+	// get the changes
+	if (mxGetNumberOfDimensions( updateInPtr ) != 2)	{
+		mexErrMsgIdAndTxt("updateUnaryTrwsDynamicMex:updateUnaryWrongDimension", "updateUnary is not 2-dimensional");
+	}
+	mwSize numChanges = mxGetM( updateInPtr );
+	if (mxGetN( updateInPtr ) != numLabels + 1){
+		mexErrMsgIdAndTxt("updateUnaryTrwsDynamicMex:updateUnaryWrongDimension", "updateUnary is not of size #changes x (numLabels + 1)");
+	}
+	if (mxGetClassID( updateInPtr ) != mxDOUBLE_CLASS) {
+		mexErrMsgIdAndTxt("updateUnaryTrwsDynamicMex:updateUnaryWrongType", "updateUnary is of wrong type");
+	}
+	const double* changes = (const double*)mxGetData( updateInPtr );
+
+	for(mwSize i = 0; i < numChanges; ++i)
+		if(floor(changes[i]) != changes[i] || changes[i] < 1 || changes[i] > numNodes){
+			mexErrMsgIdAndTxt("updateUnaryTrwsDynamicMex:updateUnaryWrongNodeId", "updateUnary has one nodeId incorrect");
+		}
+
+	// the messages are kept, so the next run of runTrwsDynamicMex starts from them
+	vector<double> values(numLabels);
+	for(mwSize i = 0; i < numChanges; ++i)
+	{
+		for(mwSize k = 0; k < numLabels; ++k)
+			values[k] = changes[i + (k + 1) * numChanges];
+		addUnaryTrwsEnergy(energy, (mwSize)changes[i] - 1, &values[0]);
+	}
+}
@@ -0,0 +1,28 @@
+% trwsDynamicMex - a version of trwsMex_time that keeps the energy and the messages of TRW-S (or BP) in memory:
+% runTrwsDynamicMex continues the message passing from the previous messages, updateUnaryTrwsDynamicMex changes
+% the unary terms without resetting the messages (warm restart).
+% http://pub.ist.ac.at/~vnk/papers/TRW-S.html
+%
+% Usage:
+%   S = trwsDynamicMex(U, P, M, options)
+%   [S, E, LB] = trwsDynamicMex(U, P, M, options)
+%   [S, E, LB, trwsHandle] = trwsDynamicMex(U, P, M, options)
+%
+% 	if trwsHandle is not requested all memory is cleaned up, otherwise function deleteTrwsDynamicMex needs to be called
+%
+% INPUT:
+% 	U, P, M, options	- the same as in trwsMex_time, options.maxIter iterations are run starting from the zero messages;
+% 				the options are kept in the handle and used by runTrwsDynamicMex; options.pairwiseType and the grid mode
+% 				(P = {vertCost, horCost}) are supported,
+% 				the batch mode is not
+%
+% OUTPUT:
+% 	S		- labeling that has energy E, vector numNodes * 1 of type double (indices are in [1,...,numLabels])
+%   E       - energy of labeling S
+% 	LB		- maximum value of lower bound of type double (only for TRW-S method)
+% 	trwsHandle - a single number, for direct usage in runTrwsDynamicMex, updateUnaryTrwsDynamicMex and deleteTrwsDynamicMex only
+%
+% 	To build the code in Matlab choose reasonable compiler and run build_trwsDynamicMex.m
+% 	Run example_trwsDynamicMex.m to test the code
+%
+%   See also runTrwsDynamicMex, updateUnaryTrwsDynamicMex, deleteTrwsDynamicMex, trwsMex_time
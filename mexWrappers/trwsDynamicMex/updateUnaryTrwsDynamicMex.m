@@ -0,0 +1,15 @@
+% 	updateUnaryTrwsDynamicMex - a part of trwsDynamicMex:
+%		Matlab interface to Vladimir Kolmogorov's implementation of TRW-S algorithm
+%
+%	updateUnaryTrwsDynamicMex adds the given values to the unary terms. The messages are kept,
+%	so the next call of runTrwsDynamicMex continues from them, which is usually much faster than starting from scratch
+%	when the update is small.
+%
+%	Usage:
+%	updateUnaryTrwsDynamicMex(trwsHandle, updateUnary);
+%
+%	Inputs:
+%	trwsHandle - a single number given by trwsDynamicMex
+%	updateUnary - of type double, array size [numChanges, numLabels + 1]; ([p, dU(1, p), ..., dU(numLabels, p)]); the values added to the unary terms of node #p
+%
+%	See also trwsDynamicMex, runTrwsDynamicMex, deleteTrwsDynamicMex
@@ -3,4 +3,12 @@ function build_trwsMex_time
 %
 % Anton Osokin (firstname.lastname@gmail.com), 24.09.2014
 
-mex src/trwsMex_time.cpp src/ordering.cpp src/MRFEnergy.cpp src/treeProbabilities.cpp src/minimize.cpp -output trwsMex_time -largeArrayDims
+% the batch mode uses std::thread
+threadPoolPath = fullfile('..', 'threadPool');
+mexFlags = [' -I', threadPoolPath, ' '];
+if isunix
+    mexFlags = [mexFlags, ' CXXFLAGS="$CXXFLAGS -std=c++11 -pthread" LDFLAGS="$LDFLAGS -pthread" '];
+end
+
+mexCmd = ['mex src/trwsMex_time.cpp src/trwsProblem.cpp src/ordering.cpp src/MRFEnergy.cpp src/treeProbabilities.cpp src/minimize.cpp -output trwsMex_time -largeArrayDims', mexFlags];
+eval(mexCmd);
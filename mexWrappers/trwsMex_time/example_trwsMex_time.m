@@ -25,3 +25,14 @@ end
 if ~isequal(labels, [2; 2; 2; 2; 1])
     warning('Wrong value of labels!')
 end
+
+% the same energy with the nodes and the edges copied into one array; the old storage is freed right after the copy,
+% so the memory of the energy is doubled only while copying
+options.contiguousStorage = true;
+[labels, energy] = trwsMex_time(dataCost, neighbors, metric, options);
+if ~isequal(energy, -11)
+    warning('Wrong value of energy with the contiguous storage!')
+end
+if ~isequal(labels, [2; 2; 2; 2; 1])
+    warning('Wrong value of labels with the contiguous storage!')
+end
@@ -20,6 +20,7 @@ template <class T> MRFEnergy<T>::MRFEnergy(GlobalSize Kglobal, ErrorFunction err
 	  m_Kglobal(Kglobal),
 	  m_vectorMaxSizeInBytes(0),
 	  m_isEnergyConstructionCompleted(false),
+	  m_isStorageContiguous(false),
 	  m_buf(NULL)
 {
 }
@@ -77,6 +78,10 @@ template <class T> typename MRFEnergy<T>::NodeId MRFEnergy<T>::AddNode(LocalSize
 
 template <class T> void MRFEnergy<T>::AddNodeData(NodeId i, NodeData data)
 {
+	if (m_isEnergyConstructionCompleted)
+	{
+		i = m_nodes[i->m_ordering];
+	}
 	i->m_D.Add(m_Kglobal, i->m_K, data);
 }
 
@@ -96,6 +101,7 @@ template <class T> void MRFEnergy<T>::AddEdge(NodeId i, NodeId j, EdgeData data)
 	}
 	int MRFedgeSize = sizeof(MRFEdge) - sizeof(Edge) + actualEdgeSize;
 	e = (MRFEdge*) Malloc(MRFedgeSize);
+	e->m_sizeInBytes = MRFedgeSize;
 
 	e->m_message.Initialize(m_Kglobal, i->m_K, j->m_K, data, &i->m_D, &j->m_D);
 
@@ -129,6 +135,7 @@ template <class T> void MRFEnergy<T>::ZeroMessages()
 			e->m_message.GetMessagePtr()->SetZero(m_Kglobal, i->m_K);
 		}
 	}
+	m_rbpMessages.clear();
 }
 
 template <class T> void MRFEnergy<T>::AddRandomMessages(unsigned int random_seed, REAL min_value, REAL max_value)
@@ -157,10 +164,20 @@ template <class T> void MRFEnergy<T>::AddRandomMessages(unsigned int random_seed
 			}
 		}
 	}
+	m_rbpMessages.clear();
 }
 
 /////////////////////////////////////////////////////////////////////////////////
 
+template <class T> int MRFEnergy<T>::GetBufSizeInBytes()
+{
+	int size = m_vectorMaxSizeInBytes + 
+		( m_vectorMaxSizeInBytes > Edge::GetBufSizeInBytes(m_vectorMaxSizeInBytes) ?
+		  m_vectorMaxSizeInBytes : Edge::GetBufSizeInBytes(m_vectorMaxSizeInBytes) );
+	// the buffers of the threads are stored one after another in m_threadBuf, the edge buffers can end with an odd number of ints
+	return (size + 7) & ~7;
+}
+
 template <class T> void MRFEnergy<T>::CompleteGraphConstruction()
 {
 	Node* i;
@@ -181,9 +198,7 @@ template <class T> void MRFEnergy<T>::CompleteGraphConstruction()
 		m_errorFn("CompleteGraphConstruction(): fatal error");
 	}
 
-	m_buf = (char *) Malloc(m_vectorMaxSizeInBytes + 
-		( m_vectorMaxSizeInBytes > Edge::GetBufSizeInBytes(m_vectorMaxSizeInBytes) ?
-		  m_vectorMaxSizeInBytes : Edge::GetBufSizeInBytes(m_vectorMaxSizeInBytes) ) );
+	m_buf = (char *) Malloc(GetBufSizeInBytes());
 
 	// set forward and backward edges properly
 #ifdef _DEBUG
@@ -252,10 +267,150 @@ template <class T> void MRFEnergy<T>::CompleteGraphConstruction()
 
 	m_isEnergyConstructionCompleted = true;
 
+	SetEdgeRanges();
+
 	// ZeroMessages();
 
     if ( verbosityLevel == 2 )
         printf("done\n");
 }
 
+template <class T> void MRFEnergy<T>::SetEdgeRanges()
+{
+	Node* i;
+	MRFEdge* e;
+	int forwardNum = 0, backwardNum = 0;
+
+	m_nodes.resize(m_nodeNum);
+	m_forwardEdges.resize(m_edgeNum);
+	m_backwardEdges.resize(m_edgeNum);
+	m_forwardFirst.resize(m_nodeNum + 1);
+	m_backwardFirst.resize(m_nodeNum + 1);
+	for (i=m_nodeFirst; i; i=i->m_next)
+	{
+		m_nodes[i->m_ordering] = i;
+		m_forwardFirst[i->m_ordering] = forwardNum;
+		for (e=i->m_firstForward; e; e=e->m_nextForward)
+		{
+			m_forwardEdges[forwardNum ++] = e;
+		}
+		m_backwardFirst[i->m_ordering] = backwardNum;
+		for (e=i->m_firstBackward; e; e=e->m_nextBackward)
+		{
+			m_backwardEdges[backwardNum ++] = e;
+		}
+	}
+	m_forwardFirst[m_nodeNum] = forwardNum;
+	m_backwardFirst[m_nodeNum] = backwardNum;
+
+	// the messages of residual BP are indexed by the edges
+	m_rbpMessages.clear();
+}
+
+// sizes of the nodes and the edges in the contiguous storage are rounded up to keep the doubles and the pointers aligned
+static inline size_t AlignSizeInBytes(size_t size)
+{
+	return (size + 7) & ~(size_t)7;
+}
+
+template <class T> void MRFEnergy<T>::SetContiguousStorage(NodeId* nodeIds, int nodeIdNum)
+{
+	Node* i;
+	MRFEdge* e;
+	MRFEdge* eNext;
+
+	if (!m_isEnergyConstructionCompleted)
+	{
+		CompleteGraphConstruction();
+	}
+	if (m_isStorageContiguous || m_nodeNum == 0)
+	{
+		return;
+	}
+
+	size_t size = 0;
+	for (i=m_nodeFirst; i; i=i->m_next)
+	{
+		size += AlignSizeInBytes(sizeof(Node) - sizeof(Vector) + Vector::GetSizeInBytes(m_Kglobal, i->m_K));
+		for (e=i->m_firstForward; e; e=e->m_nextForward)
+		{
+			size += AlignSizeInBytes(e->m_sizeInBytes);
+		}
+	}
+	// the copies go into a new list of the malloc blocks, the old list is freed at the end
+	MallocBlock* mallocBlockOld = m_mallocBlockFirst;
+	m_mallocBlockFirst = NULL;
+	char* ptr = Malloc(size);
+
+	// copy the nodes and the forward edges, the lists of the forward edges keep their order.
+	// The old forward lists are not needed any more: m_nextForward of the old edge is set to its copy
+	vector<Node*> nodes(m_nodeNum);
+	Node* iPrev = NULL;
+	for (i=m_nodeFirst; i; i=i->m_next)
+	{
+		int nodeSize = sizeof(Node) - sizeof(Vector) + Vector::GetSizeInBytes(m_Kglobal, i->m_K);
+		Node* iNew = (Node*) ptr;
+		memcpy(iNew, i, nodeSize);
+		ptr += AlignSizeInBytes(nodeSize);
+		nodes[i->m_ordering] = iNew;
+
+		iNew->m_prev = iPrev;
+		iNew->m_next = NULL;
+		if (iPrev)
+		{
+			iPrev->m_next = iNew;
+		}
+		iPrev = iNew;
+
+		MRFEdge** eLast = &iNew->m_firstForward;
+		for (e=i->m_firstForward; e; e=eNext)
+		{
+			MRFEdge* eNew = (MRFEdge*) ptr;
+			memcpy(eNew, e, e->m_sizeInBytes);
+			ptr += AlignSizeInBytes(e->m_sizeInBytes);
+
+			eNew->m_tail = iNew;
+			*eLast = eNew;
+			eLast = &eNew->m_nextForward;
+
+			eNext = e->m_nextForward;
+			e->m_nextForward = eNew;
+		}
+		*eLast = NULL;
+	}
+
+	// set the heads and the backward lists in the old order
+	for (i=m_nodeFirst; i; i=i->m_next)
+	{
+		Node* iNew = nodes[i->m_ordering];
+		MRFEdge** eLast = &iNew->m_firstBackward;
+		for (e=i->m_firstBackward; e; e=e->m_nextBackward)
+		{
+			MRFEdge* eNew = e->m_nextForward;
+			eNew->m_head = iNew;
+			*eLast = eNew;
+			eLast = &eNew->m_nextBackward;
+		}
+		*eLast = NULL;
+	}
+
+	for (int k=0; k<nodeIdNum; k++)
+	{
+		nodeIds[k] = nodes[nodeIds[k]->m_ordering];
+	}
+	m_nodeFirst = nodes[0];
+	m_nodeLast = nodes[m_nodeNum - 1];
+	m_buf = (char *) Malloc(GetBufSizeInBytes());
+	m_isStorageContiguous = true;
+
+	while (mallocBlockOld)
+	{
+		MallocBlock* next = mallocBlockOld->m_next;
+		delete [] (char*) mallocBlockOld;
+		mallocBlockOld = next;
+	}
+
+	SetEdgeRanges();
+}
+
 #include "instances.inc"
@@ -16,14 +16,16 @@ vnk@microsoft.com
 
 extern int verbosityLevel; // AOSOKIN
 
+class ThreadPool; // threadPool.h, used for the parallel passes
+
 // After MRFEnergy is allocated, there are two phases:
 // 1. Energy construction. Only AddNode(), AddNodeData() and AddEdge() may be called.
 // 
-// Any call ZeroMessages(), SetAutomaticOrdering(), Minimize_TRW_S() or Minimize_BP()
+// Any call ZeroMessages(), SetAutomaticOrdering(), Minimize_TRW_S(), Minimize_BP() or Minimize_RBP()
 // completes graph construction; MRFEnergy goes to the second phase:
-// 2. Only functions AddNodeData(), ZeroMessages(), Minimize_TRW_S(), Minimize_BP()
+// 2. Only functions AddNodeData(), ZeroMessages(), Minimize_TRW_S(), Minimize_BP(), Minimize_RBP()
 // or GetSolution() may be called. (The last function can be called only after
-// Minimize_TRW_S() or Minimize_BP()).
+// Minimize_TRW_S(), Minimize_BP() or Minimize_RBP()).
 
 // for measuring time
 #include <vector>
@@ -100,6 +102,16 @@ public:
 	// Cannot be called after energy construction is completed.
 	void SetAutomaticOrdering();
 
+	// Moves the nodes and the edges (unary terms, edge parameters and messages) into one array
+	// in the order of the nodes, each node followed by its forward edges. The passes of Minimize_TRW_S()
+	// and Minimize_BP() then read the memory sequentially instead of following pointers across
+	// the malloc blocks. The old nodes and edges are freed, so the NodeIds returned by AddNode()
+	// become invalid: the nodeIdNum NodeIds in nodeIds[] (if not NULL) are replaced by the new ones.
+	// Vector and Edge of the type must not contain pointers to themselves.
+	//
+	// Completes energy construction (if not completed yet), so SetAutomaticOrdering() must be called before.
+	void SetContiguousStorage(NodeId* nodeIds = NULL, int nodeIdNum = 0);
+
 	// The structure below specifies (1) stopping criteria and 
 	// (2) how often to compute solution and print its energy.
 	struct Options
@@ -111,11 +123,14 @@ public:
 			m_iterMax = 1000000;
 			m_printIter = 5;     // After 10 iterations start printing the lower bound
 			m_printMinIter = 10; // and the energy every 5 iterations.
+			m_energyIter = 1;    // compute the energy every iteration
+			m_threadPool = NULL; // sequential passes
 		}
 
 		// stopping criterion
 		REAL		m_eps; // stop if the increase in the lower bound during one iteration is less or equal than m_eps.
 						   // Used only if m_eps >= 0, and only for TRW-S algorithm.
+						   // For Minimize_RBP() the messages whose change is less or equal than m_eps are not updated.
 		int			m_iterMax; // maximum number of iterations
 
 		// Option for printing lower bound and the energy.
@@ -123,20 +138,51 @@ public:
 		// (it is comparable to the cost of one iteration).
 		int		m_printIter; // print lower bound and energy every m_printIter iterations
 		int		m_printMinIter; // do not print lower bound and energy before m_printMinIter iterations
+
+		// Option for the energy plot: the solution and its energy are computed every m_energyIter iterations,
+		// at the last iteration and whenever they are printed; if m_energyIter < 1 only in the two latter cases.
+		// ePlot is NaN at the other iterations.
+		int		m_energyIter;
+
+		// Parallel passes. Node i depends only on the nodes connected to it by backward (forward) edges
+		// during the forward (backward) pass, so the nodes are split into wavefronts: a node belongs to
+		// the wavefront next to the last wavefront of its predecessors. The nodes of a wavefront are not
+		// connected to each other and are processed in parallel, e.g. for a 4-connected grid in the raster
+		// (or automatic) ordering the wavefronts are the anti-diagonals.
+		// The messages, the lower bound and the energy are exactly the same as with the sequential passes.
+		// Must not be used if the calling thread is a worker of m_threadPool.
+		ThreadPool*	m_threadPool;
 	};
 
 	// Returns number of iterations. Sets lowerBound and energy.
+	// lowerBound and energy are accumulated in double even if REAL is float.
 	// If the user provides array min_marginals, then the code
 	// sets this array accordingly. (The size of the array depends on the type
 	// used. Normally, it's (# nodes)*(# labels). Exception: for TypeBinaryFast it's (# nodes).
-	int Minimize_TRW_S(Options& options, REAL& lowerBound, REAL& energy, REAL* min_marginals = NULL);
+	int Minimize_TRW_S(Options& options, double& lowerBound, double& energy, REAL* min_marginals = NULL);
 
 	// Returns number of iterations. Sets energy.
-	int Minimize_BP(Options& options, REAL& energy, REAL* min_marginals = NULL);
+	int Minimize_BP(Options& options, double& energy, REAL* min_marginals = NULL);
+
+	// Residual belief propagation: instead of the passes over the nodes the messages are updated in the order
+	// of their change (residual). The new values of all messages and their residuals are kept; when message i->j
+	// is written, only the messages j->k, k != i, are computed again. The messages are kept in a bucket queue
+	// by the exponent of the residual; every round pops 1/64 of the messages from the top buckets, writes them
+	// and computes the affected messages in parallel on options.m_threadPool, so the result does not depend
+	// on the number of threads. The new values double the memory of the messages.
+	// One iteration is as many message updates as there are messages.
+	// Stops after options.m_iterMax iterations or when no message has residual greater than max(options.m_eps, 0).
+	// Every call starts by computing all messages once; the messages are kept between the calls (and reset by ZeroMessages()).
+	// Returns number of iterations. Sets energy.
+	int Minimize_RBP(Options& options, double& energy, REAL* min_marginals = NULL);
 
 	// Returns an integer in [0,Ki). Can be called only after Minimize().
 	Label GetSolution(NodeId i);
 
+	// Returns the position of node i in the passes. The min-marginals of the nodes are stored in this order,
+	// e.g. if all nodes have K labels then the min-marginals of node i start at min_marginals[GetOrdering(i)*K].
+	int GetOrdering(NodeId i);
+
 
 
 
@@ -174,14 +220,61 @@ private:
 	int				m_vectorMaxSizeInBytes;
 
 	bool			m_isEnergyConstructionCompleted;
+	bool			m_isStorageContiguous;
 
 	char*			m_buf; // buffer of size m_vectorMaxSizeInBytes 
 					       //              + max(m_vectorMaxSizeInBytes, Edge::GetBufSizeInBytes(m_vectorMaxSizeInBytes))
 
 	void CompleteGraphConstruction(); // nodes and edges cannot be added after calling this function
+	void SetEdgeRanges(); // sets m_nodes and the edge ranges, called whenever the lists of nodes and edges change
 	void SetMonotonicTrees();
 
-	REAL ComputeSolutionAndEnergy(); // sets Node::m_solution, returns value of the energy
+	double ComputeSolutionAndEnergy(ThreadPool* threadPool = NULL); // sets Node::m_solution, returns value of the energy
+
+	// the passes go over the arrays below instead of the lists
+	vector<Node*>	m_nodes; // node with m_ordering == k is m_nodes[k]
+	vector<MRFEdge*> m_forwardEdges; // forward edges of node i are m_forwardEdges[m_forwardFirst[i->m_ordering]], ..., m_forwardEdges[m_forwardFirst[i->m_ordering+1]-1]
+	vector<int>		m_forwardFirst;  // in the order of i->m_firstForward
+	vector<MRFEdge*> m_backwardEdges; // the same for the backward edges
+	vector<int>		m_backwardFirst;
+
+	// parallel passes (see Options::m_threadPool)
+	vector<Node*>	m_wavefrontNodes[2]; // nodes sorted by wavefronts for the forward [0] and the backward [1] pass
+	vector<int>		m_wavefrontFirst[2]; // wavefront w consists of m_wavefrontNodes[d][m_wavefrontFirst[d][w]], ..., m_wavefrontNodes[d][m_wavefrontFirst[d][w+1]-1]
+	vector<char>	m_threadBuf; // a copy of m_buf for every thread
+	vector<REAL>	m_nodeValues; // the terms of the lower bound or of the energy computed by the nodes
+	vector<int>		m_nodeValueFirst; // position of the first term of node i in m_nodeValues is m_nodeValueFirst[i->m_ordering]
+
+	int GetBufSizeInBytes();
+	void SetWavefronts(ThreadPool* threadPool);
+	void SetMinMarginalsFirst(vector<int>& min_marginals_first);
+	char* GetThreadBuf(ThreadPool* threadPool, int iThread);
+	// calls func(i, iThread) for all nodes i in the order of the forward (isForward == true) or the backward pass
+	template <class Func> void ForEachNode(ThreadPool* threadPool, bool isForward, const Func& func);
+	// the steps of the passes at node i; for the TRW-S backward step lowerBoundTerms receive vMin of the node and of its backward edges
+	void UpdateForwardMessages(Node* i, Vector* Di, void* buf, bool isTRWS);
+	void UpdateBackwardMessages(Node* i, Vector* Di, void* buf, bool isTRWS, REAL* lowerBoundTerms);
+
+	// residual BP (see Minimize_RBP()) keeps both messages of every edge: message m < m_edgeNum goes from the tail
+	// to the head of m_forwardEdges[m], message m >= m_edgeNum from the head to the tail of m_backwardEdges[m-m_edgeNum],
+	// so the messages from the same node are consecutive. Message m is stored at &m_rbpMessages[m_rbpMessageFirst[m]].
+	// The edges keep only their parameters and are used as the scratch memory of the updates.
+	vector<char>	m_rbpMessages; // empty if the messages have to be taken from the edges
+	vector<size_t>	m_rbpMessageFirst;
+	vector<int>		m_rbpSource; // m_ordering of the node sending message m
+	vector<int>		m_rbpReverse; // message in the opposite direction along the same edge
+
+	void SetResidualMessages(); // copies the messages of the edges to m_rbpMessages, the messages to the heads are zero
+	Vector* GetResidualMessage(int m) { return (Vector*) &m_rbpMessages[m_rbpMessageFirst[m]]; }
+	MRFEdge* GetResidualEdge(int m) { return (m < m_edgeNum) ? m_forwardEdges[m] : m_backwardEdges[m - m_edgeNum]; }
+	// calls func(k, iThread) for k = 0, ..., taskNum-1, in parallel if threadPool is not NULL
+	template <class Func> void ForEachTask(ThreadPool* threadPool, int taskNum, const Func& func);
+	// sets Di to the unary term of node i plus all the messages to i
+	void AddResidualMessages(Node* i, Vector* Di);
+	// computes the new values of the messages m = messages[0], ..., messages[messageNum-1] from node i into
+	// candidates + m_rbpMessageFirst[m] and their largest changes into residuals[m], does not change the messages;
+	// Di is set by AddResidualMessages()
+	void UpdateResidualMessages(Node* i, const int* messages, int messageNum, Vector* Di, void* buf, char* candidates, double* residuals);
 
 
 
@@ -211,6 +304,8 @@ private:
 		REAL		m_gammaForward; // = rho_{ij} / rho_{i} where i=m_tail, j=m_head
 		REAL		m_gammaBackward; // = rho_{ij} / rho_{j} where i=m_tail, j=m_head
 
+		size_t		m_sizeInBytes; // size of the struct including the variable part of m_message (size_t keeps m_message aligned)
+
 		Edge		m_message; // must be the last member in the struct since its size is not fixed.
 					           // Stores edge information and either forward or backward message.
 					           // Most of the time it's the backward message; it gets replaced
@@ -227,17 +322,20 @@ private:
 		char*			m_current; // first element of available memory in this block
 		char*			m_last; // first element outside of allocated memory for this block
 	};
-	char* Malloc(int bytesNum); 
+	char* Malloc(size_t bytesNum); 
 };
 
 
 
 
-template <class T> inline char* MRFEnergy<T>::Malloc(int bytesNum)
+template <class T> inline char* MRFEnergy<T>::Malloc(size_t bytesNum)
 {
+	// keep the doubles and the pointers aligned, the sizes of the float vectors are multiples of 4 only
+	bytesNum = (bytesNum + 7) & ~(size_t)7;
+
 	if (!m_mallocBlockFirst || m_mallocBlockFirst->m_current+bytesNum > m_mallocBlockFirst->m_last)
 	{
-		int size = (bytesNum > MallocBlock::minBlockSizeInBytes) ? bytesNum : MallocBlock::minBlockSizeInBytes;
+		size_t size = (bytesNum > MallocBlock::minBlockSizeInBytes) ? bytesNum : MallocBlock::minBlockSizeInBytes;
 		MallocBlock* b = (MallocBlock*) new char[sizeof(MallocBlock) + size];
 		if (!b) m_errorFn("Not enough memory");
 		b->m_current = (char*) b + sizeof(MallocBlock);
@@ -254,7 +352,12 @@ template <class T> inline char* MRFEnergy<T>::Malloc(int bytesNum)
 
 template <class T> inline typename T::Label MRFEnergy<T>::GetSolution(NodeId i)
 {
-	return i->m_solution;
+	return m_nodes[i->m_ordering]->m_solution;
+}
+
+template <class T> inline int MRFEnergy<T>::GetOrdering(NodeId i)
+{
+	return i->m_ordering;
 }
 
 #include "instances.h"
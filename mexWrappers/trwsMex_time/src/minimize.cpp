@@ -5,16 +5,16 @@
 #include <stdlib.h>
 #include <assert.h>
 #include "MRFEnergy.h"
+#include "threadPool.h"
 #include <limits>
+#include <chrono>
+#include <math.h>
+#include <algorithm>
 
-template <class T> int MRFEnergy<T>::Minimize_TRW_S(Options& options, REAL& lowerBound, REAL& energy, REAL* min_marginals)
+template <class T> int MRFEnergy<T>::Minimize_TRW_S(Options& options, double& lowerBound, double& energy, REAL* min_marginals)
 {
-	Node* i;
-	Node* j;
-	MRFEdge* e;
-	REAL vMin;
 	int iter;
-	REAL lowerBoundPrev;
+	double lowerBoundPrev = 0;
 
 	if (!m_isEnergyConstructionCompleted)
 	{
@@ -25,18 +25,24 @@ template <class T> int MRFEnergy<T>::Minimize_TRW_S(Options& options, REAL& lowe
         printf("TRW_S algorithm\n");
 
 	SetMonotonicTrees();
+	SetWavefronts(options.m_threadPool);
+	m_rbpMessages.clear(); // the passes change the messages of the edges
 
-	Vector* Di = (Vector*) m_buf;
-	void* buf = (void*) (m_buf + m_vectorMaxSizeInBytes);
+	// position of the min-marginals of node i in min_marginals
+	vector<int> min_marginals_first;
+	if (min_marginals)
+	{
+		SetMinMarginalsFirst(min_marginals_first);
+	}
 
 	iter = 0;
 	bool lastIter = false;
 
 	//init time measurements: Anton
-	timePlot.resize(options.m_iterMax, -1);
-	lbPlot.resize(options.m_iterMax, -1);
-	ePlot.resize(options.m_iterMax, -1);
-	clock_t tStart = clock();
+	timePlot.assign(options.m_iterMax, -1);
+	lbPlot.assign(options.m_iterMax, -1);
+	ePlot.assign(options.m_iterMax, -1);
+	std::chrono::steady_clock::time_point tStart = std::chrono::steady_clock::now();
 
 	// main loop
 	for (iter=1; ; iter++)
@@ -46,81 +52,37 @@ template <class T> int MRFEnergy<T>::Minimize_TRW_S(Options& options, REAL& lowe
 		////////////////////////////////////////////////
 		//                forward pass                //
 		////////////////////////////////////////////////
-		REAL* min_marginals_ptr = min_marginals;
-
-		for (i=m_nodeFirst; i; i=i->m_next)
+		ForEachNode(options.m_threadPool, true, [&](Node* i, int iThread)
 		{
-			Di->Copy(m_Kglobal, i->m_K, &i->m_D);
-			for (e=i->m_firstForward; e; e=e->m_nextForward)
-			{
-				Di->Add(m_Kglobal, i->m_K, e->m_message.GetMessagePtr());
-			}
-			for (e=i->m_firstBackward; e; e=e->m_nextBackward)
-			{
-				Di->Add(m_Kglobal, i->m_K, e->m_message.GetMessagePtr());
-			}
-
-			// normalize Di, update lower bound
-			// vMin = Di->ComputeAndSubtractMin(m_Kglobal, i->m_K); // do not compute lower bound
-			// lowerBound += vMin;                                  // during the forward pass
-
-			// pass messages from i to nodes with higher m_ordering
-			for (e=i->m_firstForward; e; e=e->m_nextForward)
-			{
-				assert(e->m_tail == i);
-				j = e->m_head;
-
-				vMin = e->m_message.UpdateMessage(m_Kglobal, i->m_K, j->m_K, Di, e->m_gammaForward, 0, buf);
-
-				// lowerBound += vMin; // do not compute lower bound during the forward pass
-			}
-
-			if (lastIter && min_marginals)
-			{
-				min_marginals_ptr += Di->GetArraySize(m_Kglobal, i->m_K);
-			}
-		}
+			char* threadBuf = GetThreadBuf(options.m_threadPool, iThread);
+			// the lower bound is not computed during the forward pass
+			UpdateForwardMessages(i, (Vector*) threadBuf, (void*) (threadBuf + m_vectorMaxSizeInBytes), true);
+		});
 
 		////////////////////////////////////////////////
 		//               backward pass                //
 		////////////////////////////////////////////////
-		lowerBound = 0;
-
-		for (i=m_nodeLast; i; i=i->m_prev)
+		ForEachNode(options.m_threadPool, false, [&](Node* i, int iThread)
 		{
-			Di->Copy(m_Kglobal, i->m_K, &i->m_D);
-			for (e=i->m_firstBackward; e; e=e->m_nextBackward)
-			{
-				Di->Add(m_Kglobal, i->m_K, e->m_message.GetMessagePtr());
-			}
-			for (e=i->m_firstForward; e; e=e->m_nextForward)
-			{
-				Di->Add(m_Kglobal, i->m_K, e->m_message.GetMessagePtr());
-			}
-
-			// normalize Di, update lower bound
-			vMin = Di->ComputeAndSubtractMin(m_Kglobal, i->m_K);
-			lowerBound += vMin;
-
-			// pass messages from i to nodes with smaller m_ordering
-			for (e=i->m_firstBackward; e; e=e->m_nextBackward)
-			{
-				assert(e->m_head == i);
-				j = e->m_tail;
-
-				vMin = e->m_message.UpdateMessage(m_Kglobal, i->m_K, j->m_K, Di, e->m_gammaBackward, 1, buf);
-
-				lowerBound += vMin;
-			}
+			char* threadBuf = GetThreadBuf(options.m_threadPool, iThread);
+			Vector* Di = (Vector*) threadBuf;
+			UpdateBackwardMessages(i, Di, (void*) (threadBuf + m_vectorMaxSizeInBytes), true, &m_nodeValues[m_nodeValueFirst[i->m_ordering]]);
 
 			if (lastIter && min_marginals)
 			{
-				min_marginals_ptr -= Di->GetArraySize(m_Kglobal, i->m_K);
+				REAL* min_marginals_ptr = min_marginals + min_marginals_first[i->m_ordering];
 				for (int k=0; k<Di->GetArraySize(m_Kglobal, i->m_K); k++) 
 				{
 					min_marginals_ptr[k] = Di->GetArrayValue(m_Kglobal, i->m_K, k);
 				}
 			}
+		});
+
+		// the terms are summed in the order of the sequential backward pass
+		lowerBound = 0;
+		for (size_t k=0; k<m_nodeValues.size(); k++)
+		{
+			lowerBound += m_nodeValues[k];
 		}
 
 		////////////////////////////////////////////////
@@ -130,15 +92,22 @@ template <class T> int MRFEnergy<T>::Minimize_TRW_S(Options& options, REAL& lowe
 		
 
 		//update time measurements: Anton
-		timePlot[iter - 1] = (double)(clock() - tStart) / CLOCKS_PER_SEC;
+		timePlot[iter - 1] = std::chrono::duration<double>(std::chrono::steady_clock::now() - tStart).count();
 		lbPlot[iter - 1] = lowerBound;
-		ePlot[iter - 1] = ComputeSolutionAndEnergy();
-
 
 		// print lower bound and energy, if necessary
-		if (  	lastIter || ( iter>=options.m_printMinIter && 
-			(options.m_printIter<1 || iter%options.m_printIter==0) )
-		)
+		bool printIter = lastIter || ( iter>=options.m_printMinIter && 
+			(options.m_printIter<1 || iter%options.m_printIter==0) );
+		if (printIter || (options.m_energyIter>=1 && iter%options.m_energyIter==0))
+		{
+			ePlot[iter - 1] = ComputeSolutionAndEnergy(options.m_threadPool);
+		}
+		else
+		{
+			ePlot[iter - 1] = std::numeric_limits<double>::quiet_NaN();
+		}
+
+		if (printIter)
 		{
 			//energy = ComputeSolutionAndEnergy();
 			energy = ePlot[iter - 1]; // Anton
@@ -166,12 +135,8 @@ template <class T> int MRFEnergy<T>::Minimize_TRW_S(Options& options, REAL& lowe
 	return iter;
 }
 
-template <class T> int MRFEnergy<T>::Minimize_BP(Options& options, REAL& energy, REAL* min_marginals)
+template <class T> int MRFEnergy<T>::Minimize_BP(Options& options, double& energy, REAL* min_marginals)
 {
-	Node* i;
-	Node* j;
-	MRFEdge* e;
-	REAL vMin;
 	int iter;
 
 	if (!m_isEnergyConstructionCompleted)
@@ -182,17 +147,24 @@ template <class T> int MRFEnergy<T>::Minimize_BP(Options& options, REAL& energy,
     if (verbosityLevel >= 1)
         printf("BP algorithm\n");
 
-	Vector* Di = (Vector*) m_buf;
-	void* buf = (void*) (m_buf + m_vectorMaxSizeInBytes);
+	SetWavefronts(options.m_threadPool);
+	m_rbpMessages.clear(); // the passes change the messages of the edges
+
+	// position of the min-marginals of node i in min_marginals
+	vector<int> min_marginals_first;
+	if (min_marginals)
+	{
+		SetMinMarginalsFirst(min_marginals_first);
+	}
 
 	iter = 0;
 	bool lastIter = false;
 
 	//init time measurements: Anton
-	timePlot.resize(options.m_iterMax, -1);
-	lbPlot.resize(options.m_iterMax, -1);
-	ePlot.resize(options.m_iterMax, -1);
-	clock_t tStart = clock();
+	timePlot.assign(options.m_iterMax, -1);
+	lbPlot.assign(options.m_iterMax, -1);
+	ePlot.assign(options.m_iterMax, -1);
+	std::chrono::steady_clock::time_point tStart = std::chrono::steady_clock::now();
 
 
 	// main loop
@@ -203,72 +175,280 @@ template <class T> int MRFEnergy<T>::Minimize_BP(Options& options, REAL& energy,
 		////////////////////////////////////////////////
 		//                forward pass                //
 		////////////////////////////////////////////////
-		REAL* min_marginals_ptr = min_marginals;
+		ForEachNode(options.m_threadPool, true, [&](Node* i, int iThread)
+		{
+			char* threadBuf = GetThreadBuf(options.m_threadPool, iThread);
+			UpdateForwardMessages(i, (Vector*) threadBuf, (void*) (threadBuf + m_vectorMaxSizeInBytes), false);
+		});
 
-		for (i=m_nodeFirst; i; i=i->m_next)
+		////////////////////////////////////////////////
+		//               backward pass                //
+		////////////////////////////////////////////////
+		ForEachNode(options.m_threadPool, false, [&](Node* i, int iThread)
 		{
-			Di->Copy(m_Kglobal, i->m_K, &i->m_D);
-			for (e=i->m_firstForward; e; e=e->m_nextForward)
-			{
-				Di->Add(m_Kglobal, i->m_K, e->m_message.GetMessagePtr());
-			}
-			for (e=i->m_firstBackward; e; e=e->m_nextBackward)
+			char* threadBuf = GetThreadBuf(options.m_threadPool, iThread);
+			Vector* Di = (Vector*) threadBuf;
+			UpdateBackwardMessages(i, Di, (void*) (threadBuf + m_vectorMaxSizeInBytes), false, NULL);
+
+			if (lastIter && min_marginals)
 			{
-				Di->Add(m_Kglobal, i->m_K, e->m_message.GetMessagePtr());
+				REAL* min_marginals_ptr = min_marginals + min_marginals_first[i->m_ordering];
+				for (int k=0; k<Di->GetArraySize(m_Kglobal, i->m_K); k++) 
+				{
+					min_marginals_ptr[k] = Di->GetArrayValue(m_Kglobal, i->m_K, k);
+				}
 			}
+		});
 
-			// pass messages from i to nodes with higher m_ordering
-			for (e=i->m_firstForward; e; e=e->m_nextForward)
-			{
-				assert(i == e->m_tail);
-				j = e->m_head;
+		////////////////////////////////////////////////
+		//          check stopping criterion          //
+		////////////////////////////////////////////////
 
-				const REAL gamma = 1;
+		//update time measurements: Anton
+		timePlot[iter - 1] = std::chrono::duration<double>(std::chrono::steady_clock::now() - tStart).count();
+		lbPlot[iter - 1] = std::numeric_limits<double>::signaling_NaN();
 
-				e->m_message.UpdateMessage(m_Kglobal, i->m_K, j->m_K, Di, gamma, 0, buf);
-			}
+		// print energy, if necessary
+		bool printIter = lastIter || 
+			( iter>=options.m_printMinIter && 
+			(options.m_printIter<1 || iter%options.m_printIter==0) );
+		if (printIter || (options.m_energyIter>=1 && iter%options.m_energyIter==0))
+		{
+			ePlot[iter - 1] = ComputeSolutionAndEnergy(options.m_threadPool);
+		}
+		else
+		{
+			ePlot[iter - 1] = std::numeric_limits<double>::quiet_NaN();
+		}
 
-			if (lastIter && min_marginals)
-			{
-				min_marginals_ptr += Di->GetArraySize(m_Kglobal, i->m_K);
-			}
+		if (printIter)
+		{
+			//energy = ComputeSolutionAndEnergy();
+			energy = ePlot[iter - 1]; //Anton
+            if( (verbosityLevel == 2) || (lastIter && (verbosityLevel == 1)) )
+                printf("iter %d: energy = %f\n", iter, energy);
 		}
 
-		////////////////////////////////////////////////
-		//               backward pass                //
-		////////////////////////////////////////////////
+		// if finishFlag==true terminate
+		if (lastIter) break;
+	}
+
+	return iter;
+}
+
+// residual r > 0 goes to bucket 1 + (exponent of r) + RBP_BUCKET_OFFSET clipped to [0, RBP_BUCKET_NUM-2],
+// the messages which have not been updated yet are in the last bucket
+static const int RBP_BUCKET_NUM = 64;
+static const int RBP_BUCKET_OFFSET = 31;
+
+static inline int GetResidualBucket(double r)
+{
+	if (r == std::numeric_limits<double>::infinity())
+	{
+		return RBP_BUCKET_NUM - 1;
+	}
+	int exponent;
+	frexp(r, &exponent);
+	int b = exponent + RBP_BUCKET_OFFSET;
+	return (b < 0) ? 0 : ((b > RBP_BUCKET_NUM - 2) ? RBP_BUCKET_NUM - 2 : b);
+}
+
+template <class T> int MRFEnergy<T>::Minimize_RBP(Options& options, double& energy, REAL* min_marginals)
+{
+	int iter;
+	int k, m;
+
+	if (!m_isEnergyConstructionCompleted)
+	{
+		CompleteGraphConstruction();
+	}
+
+    if (verbosityLevel >= 1)
+        printf("Residual BP algorithm\n");
+
+	SetWavefronts(options.m_threadPool);
+	if (m_rbpMessages.empty())
+	{
+		SetResidualMessages();
+	}
 
-		for (i=m_nodeLast; i; i=i->m_prev)
+	// position of the min-marginals of node i in min_marginals
+	vector<int> min_marginals_first;
+	if (min_marginals)
+	{
+		SetMinMarginalsFirst(min_marginals_first);
+	}
+
+	// The new values of all messages (the candidates) and their changes (the residuals) are kept: after a round
+	// only the messages from the nodes receiving the updated messages are computed again.
+	// Bucket queue of the messages, messageBucket[m] is the bucket of message m or -1 if m is not in the queue;
+	// the buckets are stacks and can contain stale entries which are skipped
+	const int messageNum = 2 * m_edgeNum;
+	const double eps = (options.m_eps > 0) ? options.m_eps : 0;
+	const int batchSize = messageNum / 64 + 1;
+	vector<char> candidates(m_rbpMessages.size());
+	vector<double> residuals(messageNum);
+	vector< vector<int> > buckets(RBP_BUCKET_NUM);
+	vector<signed char> messageBucket(messageNum, (signed char) -1);
+
+	// the messages of a round, the messages to compute again and the tasks computing them
+	vector<int> batch;
+	vector<int> affected;
+	vector<char> isAffected(messageNum, 0);
+	vector<int> taskFirst;
+
+	// the vector of node i (see AddResidualMessages()) is computed once per round at &nodeVectors[nodeVectorFirst[i]]
+	vector<size_t> nodeVectorFirst(m_nodeNum + 1, 0);
+	for (k=0; k<m_nodeNum; k++)
+	{
+		nodeVectorFirst[k + 1] = nodeVectorFirst[k] + ((Vector::GetSizeInBytes(m_Kglobal, m_nodes[k]->m_K) + 7) & ~(size_t)7);
+	}
+	vector<char> nodeVectors(nodeVectorFirst[m_nodeNum] + 1);
+	vector<int> nodeVectorRound(m_nodeNum, -1);
+	int round = 0;
+
+	// computes the candidates of the messages (sorted) and puts them into the queue; the messages from one node
+	// in one direction are computed by one task, the messages to the heads and to the tails are computed separately
+	// since both messages of an edge use the edge as scratch memory
+	auto updateCandidates = [&](const vector<int>& messages)
+	{
+		round ++;
+		taskFirst.clear();
+		int backwardTaskFirst = 0;
+		for (k=0; k<(int)messages.size(); k++)
 		{
-			Di->Copy(m_Kglobal, i->m_K, &i->m_D);
-			for (e=i->m_firstBackward; e; e=e->m_nextBackward)
+			if (k == 0 || m_rbpSource[messages[k]] != m_rbpSource[messages[k - 1]] || (messages[k - 1] < m_edgeNum) != (messages[k] < m_edgeNum))
 			{
-				Di->Add(m_Kglobal, i->m_K, e->m_message.GetMessagePtr());
+				if (messages[k] < m_edgeNum) backwardTaskFirst ++;
+				taskFirst.push_back(k);
 			}
-			for (e=i->m_firstForward; e; e=e->m_nextForward)
+		}
+		taskFirst.push_back((int)messages.size());
+
+		for (int d=0; d<2; d++)
+		{
+			const int dirTaskFirst = (d == 0) ? 0 : backwardTaskFirst;
+			const int dirTaskNum = (d == 0) ? backwardTaskFirst : (int)taskFirst.size() - 1 - backwardTaskFirst;
+			ForEachTask(options.m_threadPool, dirTaskNum, [&](int t, int iThread)
 			{
-				Di->Add(m_Kglobal, i->m_K, e->m_message.GetMessagePtr());
-			}
+				const int first = taskFirst[dirTaskFirst + t], last = taskFirst[dirTaskFirst + t + 1];
+				const int source = m_rbpSource[messages[first]];
+				Vector* Di = (Vector*) &nodeVectors[nodeVectorFirst[source]];
+				if (nodeVectorRound[source] != round)
+				{
+					nodeVectorRound[source] = round;
+					AddResidualMessages(m_nodes[source], Di);
+				}
+				UpdateResidualMessages(m_nodes[source], &messages[first], last - first, Di,
+					(void*) GetThreadBuf(options.m_threadPool, iThread), &candidates[0], &residuals[0]);
+			});
+		}
 
-			// pass messages from i to nodes with smaller m_ordering
-			for (e=i->m_firstBackward; e; e=e->m_nextBackward)
+		for (k=0; k<(int)messages.size(); k++)
+		{
+			m = messages[k];
+			const int b = (residuals[m] > eps) ? GetResidualBucket(residuals[m]) : -1;
+			if (messageBucket[m] != b)
 			{
-				assert(i == e->m_head);
-				j = e->m_tail;
+				messageBucket[m] = (signed char) b;
+				if (b >= 0) buckets[b].push_back(m);
+			}
+		}
+	};
 
-				const REAL gamma = 1;
+	batch.resize(messageNum);
+	for (m=0; m<messageNum; m++)
+	{
+		batch[m] = m;
+	}
+	updateCandidates(batch);
 
-				vMin = e->m_message.UpdateMessage(m_Kglobal, i->m_K, j->m_K, Di, gamma, 1, buf);
+	iter = 0;
+	bool lastIter = false;
+
+	//init time measurements: Anton
+	timePlot.assign(options.m_iterMax, -1);
+	lbPlot.assign(options.m_iterMax, -1);
+	ePlot.assign(options.m_iterMax, -1);
+	std::chrono::steady_clock::time_point tStart = std::chrono::steady_clock::now();
+
+
+	// main loop
+	for (iter=1; ; iter++)
+	{
+		if (iter >= options.m_iterMax) lastIter = true;
+
+		for (int updateNum=0; updateNum<messageNum; updateNum+=(int)batch.size())
+		{
+			////////////////////////////////////////////////
+			//       take the largest residuals           //
+			////////////////////////////////////////////////
+			batch.clear();
+			for (int b=RBP_BUCKET_NUM-1; b>=0 && (int)batch.size()<batchSize; b--)
+			{
+				vector<int>& bucket = buckets[b];
+				while (!bucket.empty() && (int)batch.size()<batchSize)
+				{
+					m = bucket.back();
+					bucket.pop_back();
+					if (messageBucket[m] == b)
+					{
+						messageBucket[m] = -1;
+						batch.push_back(m);
+					}
+				}
+			}
+			if (batch.empty())
+			{
+				// converged
+				lastIter = true;
+				break;
 			}
 
-			if (lastIter && min_marginals)
+			////////////////////////////////////////////////
+			//           write the candidates             //
+			////////////////////////////////////////////////
+			ForEachTask(options.m_threadPool, (int)batch.size(), [&](int kt, int iThread)
 			{
-				min_marginals_ptr -= Di->GetArraySize(m_Kglobal, i->m_K);
-				for (int k=0; k<Di->GetArraySize(m_Kglobal, i->m_K); k++) 
+				const int mt = batch[kt];
+				Node* j = m_nodes[m_rbpSource[m_rbpReverse[mt]]];
+				GetResidualMessage(mt)->Copy(m_Kglobal, j->m_K, (Vector*) &candidates[m_rbpMessageFirst[mt]]);
+				residuals[mt] = 0;
+			});
+
+			////////////////////////////////////////////////
+			//  compute the messages from the heads again //
+			////////////////////////////////////////////////
+			affected.clear();
+			for (k=0; k<(int)batch.size(); k++)
+			{
+				const int reverse = m_rbpReverse[batch[k]];
+				const int j = m_rbpSource[reverse];
+
+				for (m=m_forwardFirst[j]; m<m_forwardFirst[j + 1]; m++)
 				{
-					min_marginals_ptr[k] = Di->GetArrayValue(m_Kglobal, i->m_K, k);
+					if (m != reverse && !isAffected[m])
+					{
+						isAffected[m] = 1;
+						affected.push_back(m);
+					}
+				}
+				for (m=m_edgeNum+m_backwardFirst[j]; m<m_edgeNum+m_backwardFirst[j + 1]; m++)
+				{
+					if (m != reverse && !isAffected[m])
+					{
+						isAffected[m] = 1;
+						affected.push_back(m);
+					}
 				}
 			}
+			for (k=0; k<(int)affected.size(); k++)
+			{
+				isAffected[affected[k]] = 0;
+			}
+			// sorted to keep the memory access sequential
+			std::sort(affected.begin(), affected.end());
+			updateCandidates(affected);
 		}
 
 		////////////////////////////////////////////////
@@ -276,49 +456,152 @@ template <class T> int MRFEnergy<T>::Minimize_BP(Options& options, REAL& energy,
 		////////////////////////////////////////////////
 
 		//update time measurements: Anton
-		timePlot[iter - 1] = (double)(clock() - tStart) / CLOCKS_PER_SEC;
+		timePlot[iter - 1] = std::chrono::duration<double>(std::chrono::steady_clock::now() - tStart).count();
 		lbPlot[iter - 1] = std::numeric_limits<double>::signaling_NaN();
-		ePlot[iter - 1] = ComputeSolutionAndEnergy();
 
 		// print energy, if necessary
-		if ( lastIter || 
+		bool printIter = lastIter || 
 			( iter>=options.m_printMinIter && 
-			(options.m_printIter<1 || iter%options.m_printIter==0) )
-		)
+			(options.m_printIter<1 || iter%options.m_printIter==0) );
+		if (printIter || (options.m_energyIter>=1 && iter%options.m_energyIter==0))
 		{
-			//energy = ComputeSolutionAndEnergy();
-			energy = ePlot[iter - 1]; //Anton
+			// ComputeSolutionAndEnergy() takes the messages to the tails from the edges
+			ForEachTask(options.m_threadPool, m_edgeNum, [&](int ke, int iThread)
+			{
+				MRFEdge* e = m_forwardEdges[ke];
+				e->m_message.GetMessagePtr()->Copy(m_Kglobal, e->m_tail->m_K, GetResidualMessage(m_rbpReverse[ke]));
+			});
+			ePlot[iter - 1] = ComputeSolutionAndEnergy(options.m_threadPool);
+		}
+		else
+		{
+			ePlot[iter - 1] = std::numeric_limits<double>::quiet_NaN();
+		}
+
+		if (printIter)
+		{
+			energy = ePlot[iter - 1];
             if( (verbosityLevel == 2) || (lastIter && (verbosityLevel == 1)) )
                 printf("iter %d: energy = %f\n", iter, energy);
 		}
 
-		// if finishFlag==true terminate
 		if (lastIter) break;
 	}
 
+	if (min_marginals)
+	{
+		ForEachNode(options.m_threadPool, true, [&](Node* i, int iThread)
+		{
+			Vector* Di = (Vector*) GetThreadBuf(options.m_threadPool, iThread);
+			AddResidualMessages(i, Di);
+
+			REAL* min_marginals_ptr = min_marginals + min_marginals_first[i->m_ordering];
+			for (int kk=0; kk<Di->GetArraySize(m_Kglobal, i->m_K); kk++)
+			{
+				min_marginals_ptr[kk] = Di->GetArrayValue(m_Kglobal, i->m_K, kk);
+			}
+		});
+	}
+
 	return iter;
 }
 
-template <class T> typename T::REAL MRFEnergy<T>::ComputeSolutionAndEnergy()
+template <class T> void MRFEnergy<T>::UpdateForwardMessages(Node* i, Vector* Di, void* buf, bool isTRWS)
 {
-	Node* i;
 	Node* j;
 	MRFEdge* e;
-	REAL E = 0;
+	int k;
+	const int forwardFirst = m_forwardFirst[i->m_ordering], forwardLast = m_forwardFirst[i->m_ordering + 1];
+	const int backwardFirst = m_backwardFirst[i->m_ordering], backwardLast = m_backwardFirst[i->m_ordering + 1];
 
-	Vector* DiBackward = (Vector*) m_buf; // cost of backward edges plus Di at the node
-	Vector* Di = (Vector*) (m_buf + m_vectorMaxSizeInBytes); // all edges plus Di at the node
+	Di->Copy(m_Kglobal, i->m_K, &i->m_D);
+	for (k=forwardFirst; k<forwardLast; k++)
+	{
+		Di->Add(m_Kglobal, i->m_K, m_forwardEdges[k]->m_message.GetMessagePtr());
+	}
+	for (k=backwardFirst; k<backwardLast; k++)
+	{
+		Di->Add(m_Kglobal, i->m_K, m_backwardEdges[k]->m_message.GetMessagePtr());
+	}
 
-	for (i=m_nodeFirst; i; i=i->m_next)
+	// pass messages from i to nodes with higher m_ordering
+	for (k=forwardFirst; k<forwardLast; k++)
 	{
+		e = m_forwardEdges[k];
+		assert(e->m_tail == i);
+		j = e->m_head;
+
+		const REAL gamma = isTRWS ? e->m_gammaForward : 1;
+
+		e->m_message.UpdateMessage(m_Kglobal, i->m_K, j->m_K, Di, gamma, 0, buf);
+	}
+}
+
+template <class T> void MRFEnergy<T>::UpdateBackwardMessages(Node* i, Vector* Di, void* buf, bool isTRWS, REAL* lowerBoundTerms)
+{
+	Node* j;
+	MRFEdge* e;
+	REAL vMin;
+	int k;
+	const int forwardFirst = m_forwardFirst[i->m_ordering], forwardLast = m_forwardFirst[i->m_ordering + 1];
+	const int backwardFirst = m_backwardFirst[i->m_ordering], backwardLast = m_backwardFirst[i->m_ordering + 1];
+
+	Di->Copy(m_Kglobal, i->m_K, &i->m_D);
+	for (k=backwardFirst; k<backwardLast; k++)
+	{
+		Di->Add(m_Kglobal, i->m_K, m_backwardEdges[k]->m_message.GetMessagePtr());
+	}
+	for (k=forwardFirst; k<forwardLast; k++)
+	{
+		Di->Add(m_Kglobal, i->m_K, m_forwardEdges[k]->m_message.GetMessagePtr());
+	}
+
+	// normalize Di, update lower bound
+	if (isTRWS)
+	{
+		vMin = Di->ComputeAndSubtractMin(m_Kglobal, i->m_K);
+		*lowerBoundTerms ++ = vMin;
+	}
+
+	// pass messages from i to nodes with smaller m_ordering
+	for (k=backwardFirst; k<backwardLast; k++)
+	{
+		e = m_backwardEdges[k];
+		assert(e->m_head == i);
+		j = e->m_tail;
+
+		const REAL gamma = isTRWS ? e->m_gammaBackward : 1;
+
+		vMin = e->m_message.UpdateMessage(m_Kglobal, i->m_K, j->m_K, Di, gamma, 1, buf);
+
+		if (isTRWS)
+		{
+			*lowerBoundTerms ++ = vMin;
+		}
+	}
+}
+
+template <class T> double MRFEnergy<T>::ComputeSolutionAndEnergy(ThreadPool* threadPool)
+{
+	ForEachNode(threadPool, true, [&](Node* i, int iThread)
+	{
+		Node* j;
+		MRFEdge* e;
+		int k;
+		char* threadBuf = GetThreadBuf(threadPool, iThread);
+
+		Vector* DiBackward = (Vector*) threadBuf; // cost of backward edges plus Di at the node
+		Vector* Di = (Vector*) (threadBuf + m_vectorMaxSizeInBytes); // all edges plus Di at the node
+
 		// Set Ebackward[ki] to be the sum of V(ki,j->m_solution) for backward edges (i,j).
 		// Set Di[ki] to be the value of the energy corresponding to
 		// part of the graph considered so far, assuming that nodes u
 		// in this subgraph are fixed to u->m_solution
 
 		DiBackward->Copy(m_Kglobal, i->m_K, &i->m_D);
-		for (e=i->m_firstBackward; e; e=e->m_nextBackward)
+		for (k=m_backwardFirst[i->m_ordering]; k<m_backwardFirst[i->m_ordering + 1]; k++)
 		{
+			e = m_backwardEdges[k];
 			assert(i == e->m_head);
 			j = e->m_tail;
 
@@ -328,19 +611,228 @@ template <class T> typename T::REAL MRFEnergy<T>::ComputeSolutionAndEnergy()
 		// add forward edges
 		Di->Copy(m_Kglobal, i->m_K, DiBackward);
 
-		for (e=i->m_firstForward; e; e=e->m_nextForward)
+		for (k=m_forwardFirst[i->m_ordering]; k<m_forwardFirst[i->m_ordering + 1]; k++)
 		{
-			Di->Add(m_Kglobal, i->m_K, e->m_message.GetMessagePtr());
+			Di->Add(m_Kglobal, i->m_K, m_forwardEdges[k]->m_message.GetMessagePtr());
 		}
 
 		Di->ComputeMin(m_Kglobal, i->m_K, i->m_solution);
 
-		// update energy
-		E += DiBackward->GetValue(m_Kglobal, i->m_K, i->m_solution);
+		// energy of the node, the first slot of the node in m_nodeValues is free at this point
+		m_nodeValues[m_nodeValueFirst[i->m_ordering]] = DiBackward->GetValue(m_Kglobal, i->m_K, i->m_solution);
+	});
+
+	// update energy in the order of the nodes
+	double E = 0;
+	for (Node* i=m_nodeFirst; i; i=i->m_next)
+	{
+		E += m_nodeValues[m_nodeValueFirst[i->m_ordering]];
 	}
 
 	return E;
 }
 
+template <class T> void MRFEnergy<T>::SetWavefronts(ThreadPool* threadPool)
+{
+	Node* i;
+	MRFEdge* e;
+	int d;
+
+	// the backward pass at node i gives 1 + (number of backward edges) terms of the lower bound
+	m_nodeValueFirst.resize(m_nodeNum);
+	int valueNum = 0;
+	for (i=m_nodeLast; i; i=i->m_prev)
+	{
+		m_nodeValueFirst[i->m_ordering] = valueNum ++;
+		for (e=i->m_firstBackward; e; e=e->m_nextBackward)
+		{
+			valueNum ++;
+		}
+	}
+	m_nodeValues.assign(valueNum, 0);
+
+	if (!threadPool)
+	{
+		return;
+	}
+
+	m_threadBuf.resize((size_t)threadPool->getNumThreads() * GetBufSizeInBytes());
+
+	vector<int> wavefront(m_nodeNum);
+	for (d=0; d<2; d++)
+	{
+		// d == 0: node i depends on the tails of its backward edges, d == 1: on the heads of its forward edges
+		int wavefrontNum = 0;
+		for (i=(d==0)?m_nodeFirst:m_nodeLast; i; i=(d==0)?i->m_next:i->m_prev)
+		{
+			int w = 0;
+			for (e=(d==0)?i->m_firstBackward:i->m_firstForward; e; e=(d==0)?e->m_nextBackward:e->m_nextForward)
+			{
+				Node* j = (d==0) ? e->m_tail : e->m_head;
+				if (w <= wavefront[j->m_ordering]) w = wavefront[j->m_ordering] + 1;
+			}
+			wavefront[i->m_ordering] = w;
+			if (wavefrontNum <= w) wavefrontNum = w + 1;
+		}
+
+		// counting sort, the nodes of a wavefront stay in the order of the pass
+		vector<int>& first = m_wavefrontFirst[d];
+		first.assign(wavefrontNum + 1, 0);
+		for (i=m_nodeFirst; i; i=i->m_next)
+		{
+			first[wavefront[i->m_ordering] + 1] ++;
+		}
+		for (int w=0; w<wavefrontNum; w++)
+		{
+			first[w + 1] += first[w];
+		}
+		vector<int> position(first.begin(), first.end() - 1);
+		m_wavefrontNodes[d].resize(m_nodeNum);
+		for (i=(d==0)?m_nodeFirst:m_nodeLast; i; i=(d==0)?i->m_next:i->m_prev)
+		{
+			m_wavefrontNodes[d][position[wavefront[i->m_ordering]] ++] = i;
+		}
+	}
+}
+
+template <class T> void MRFEnergy<T>::SetMinMarginalsFirst(vector<int>& min_marginals_first)
+{
+	min_marginals_first.resize(m_nodeNum);
+	int k = 0;
+	for (Node* i=m_nodeFirst; i; i=i->m_next)
+	{
+		min_marginals_first[i->m_ordering] = k;
+		k += i->m_D.GetArraySize(m_Kglobal, i->m_K);
+	}
+}
+
+template <class T> void MRFEnergy<T>::SetResidualMessages()
+{
+	int k;
+
+	// the backward edges are the forward edges in a different order
+	vector< std::pair<MRFEdge*, int> > forwardIndex(m_edgeNum);
+	for (k=0; k<m_edgeNum; k++)
+	{
+		forwardIndex[k] = std::make_pair(m_forwardEdges[k], k);
+	}
+	std::sort(forwardIndex.begin(), forwardIndex.end());
+	m_rbpReverse.resize(2 * m_edgeNum);
+	for (k=0; k<m_edgeNum; k++)
+	{
+		int f = std::lower_bound(forwardIndex.begin(), forwardIndex.end(), std::make_pair(m_backwardEdges[k], -1))->second;
+		m_rbpReverse[f] = m_edgeNum + k;
+		m_rbpReverse[m_edgeNum + k] = f;
+	}
+
+	m_rbpSource.resize(2 * m_edgeNum);
+	m_rbpMessageFirst.resize(2 * m_edgeNum + 1);
+	size_t size = 0;
+	for (k=0; k<2*m_edgeNum; k++)
+	{
+		MRFEdge* e = GetResidualEdge(k);
+		m_rbpSource[k] = (k < m_edgeNum) ? e->m_tail->m_ordering : e->m_head->m_ordering;
+		m_rbpMessageFirst[k] = size;
+		size += (Vector::GetSizeInBytes(m_Kglobal, (k < m_edgeNum) ? e->m_head->m_K : e->m_tail->m_K) + 7) & ~(size_t)7;
+	}
+	m_rbpMessageFirst[2 * m_edgeNum] = size;
+	m_rbpMessages.resize(size + 1); // not empty even without edges
+
+	// between the calls of the minimization the edges keep the messages to the tails
+	for (k=0; k<m_edgeNum; k++)
+	{
+		MRFEdge* e = m_forwardEdges[k];
+		GetResidualMessage(k)->SetZero(m_Kglobal, e->m_head->m_K);
+		GetResidualMessage(m_rbpReverse[k])->Copy(m_Kglobal, e->m_tail->m_K, e->m_message.GetMessagePtr());
+	}
+}
+
+template <class T> void MRFEnergy<T>::AddResidualMessages(Node* i, Vector* Di)
+{
+	int m;
+
+	// the messages to i are reverse to the messages from i
+	Di->Copy(m_Kglobal, i->m_K, &i->m_D);
+	for (m=m_forwardFirst[i->m_ordering]; m<m_forwardFirst[i->m_ordering + 1]; m++)
+	{
+		Di->Add(m_Kglobal, i->m_K, GetResidualMessage(m_rbpReverse[m]));
+	}
+	for (m=m_edgeNum+m_backwardFirst[i->m_ordering]; m<m_edgeNum+m_backwardFirst[i->m_ordering + 1]; m++)
+	{
+		Di->Add(m_Kglobal, i->m_K, GetResidualMessage(m_rbpReverse[m]));
+	}
+}
+
+template <class T> void MRFEnergy<T>::UpdateResidualMessages(Node* i, const int* messages, int messageNum, Vector* Di, void* buf, char* candidates, double* residuals)
+{
+	int k, kk;
+
+	for (k=0; k<messageNum; k++)
+	{
+		const int m = messages[k];
+		const int dir = (m < m_edgeNum) ? 0 : 1;
+		MRFEdge* e = GetResidualEdge(m);
+		Node* j = (dir == 0) ? e->m_head : e->m_tail;
+
+		// UpdateMessage() replaces the message from j to i in the edge by the message from i to j
+		Vector* M = e->m_message.GetMessagePtr();
+		M->Copy(m_Kglobal, i->m_K, GetResidualMessage(m_rbpReverse[m]));
+		e->m_message.UpdateMessage(m_Kglobal, i->m_K, j->m_K, Di, 1, dir, buf);
+		((Vector*) (candidates + m_rbpMessageFirst[m]))->Copy(m_Kglobal, j->m_K, M);
+
+		// both messages are normalized to have zero minimum
+		Vector* oldMessage = GetResidualMessage(m);
+		double residual = 0;
+		for (kk=0; kk<M->GetArraySize(m_Kglobal, j->m_K); kk++)
+		{
+			double diff = fabs((double)M->GetArrayValue(m_Kglobal, j->m_K, kk) - (double)oldMessage->GetArrayValue(m_Kglobal, j->m_K, kk));
+			if (residual < diff) residual = diff;
+		}
+		residuals[m] = residual;
+	}
+}
+
+template <class T> template <class Func> void MRFEnergy<T>::ForEachTask(ThreadPool* threadPool, int taskNum, const Func& func)
+{
+	if (!threadPool)
+	{
+		for (int k=0; k<taskNum; k++)
+		{
+			func(k, 0);
+		}
+		return;
+	}
+	threadPool->parallelFor(taskNum, func, 16);
+}
+
+template <class T> char* MRFEnergy<T>::GetThreadBuf(ThreadPool* threadPool, int iThread)
+{
+	return threadPool ? &m_threadBuf[(size_t)iThread * GetBufSizeInBytes()] : m_buf;
+}
+
+template <class T> template <class Func> void MRFEnergy<T>::ForEachNode(ThreadPool* threadPool, bool isForward, const Func& func)
+{
+	if (!threadPool)
+	{
+		for (int k=0; k<m_nodeNum; k++)
+		{
+			func(m_nodes[isForward ? k : m_nodeNum - 1 - k], 0);
+		}
+		return;
+	}
+
+	// the wavefronts are processed one after another, the nodes of a wavefront in parallel
+	const vector<Node*>& nodes = m_wavefrontNodes[isForward ? 0 : 1];
+	const vector<int>& first = m_wavefrontFirst[isForward ? 0 : 1];
+	for (size_t w=0; w+1<first.size(); w++)
+	{
+		int wavefrontStart = first[w];
+		threadPool->parallelFor(first[w + 1] - wavefrontStart, [&](int k, int iThread)
+		{
+			func(nodes[wavefrontStart + k], iThread);
+		}, 16);
+	}
+}
+
 #include "instances.inc"
 
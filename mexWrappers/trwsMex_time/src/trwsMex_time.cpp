@@ -1,396 +1,258 @@
-#include <cstdlib>
-#include <stdio.h>
-#include <limits>
-#include <time.h>
-#include <vector>
-using std::vector;
+#include "trwsProblem.h"
 
-#include "MRFEnergy.h"
-#include "mex.h"
-
-#define MATLAB_ASSERT(expr,msg) if (!(expr)) {mexErrMsgIdAndTxt( "trwsMex_time:error", msg);}
-
-#if !defined(MX_API_VER) || MX_API_VER < 0x07030000
-typedef int mwSize;
-typedef int mwIndex;
-#endif
-
-int verbosityLevel; // AOSOKIN
+// run TRW-S or BP, do not call MATLAB API when verbosityLevel == 0 and thus can be run on the thread pool;
+// the passes are parallel if threadPool is not NULL, in this case the function must be called from the MATLAB thread
+void solveProblem(const TrwsProblem& problem, const TrwsOptions& options, ThreadPool* threadPool, TrwsResult& result);
+template <class T> void solveGeneral(const TrwsProblem& problem, const TrwsOptions& options, ThreadPool* threadPool, TrwsResult& result);
+template <class T> void solveWeightedGeneral(const TrwsProblem& problem, const TrwsOptions& options, ThreadPool* threadPool, TrwsResult& result);
+template <class T> void solvePotts(const TrwsProblem& problem, const TrwsOptions& options, ThreadPool* threadPool, TrwsResult& result);
+template <class T> void solveTruncated(const TrwsProblem& problem, const TrwsOptions& options, ThreadPool* threadPool, TrwsResult& result);
+template <class T> void solvePruned(const TrwsProblem& problem, const TrwsOptions& options, ThreadPool* threadPool, TrwsResult& result);
 
 void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
 {
 	MATLAB_ASSERT(nrhs >= 2 , "Not enough input arguments, expected 2 - 4" ); \
-	MATLAB_ASSERT(nrhs <= 4, "Too many input arguments, expected 2 - 4"); 	
+	MATLAB_ASSERT(nrhs <= 4, "Too many input arguments, expected 2 - 4");
+
+	MATLAB_ASSERT(nlhs <= 7, "Too many output arguments, expected 1 - 7");
 
-	MATLAB_ASSERT(nlhs <= 6, "Too many output arguments, expected 1 - 6");
-	
 	//Fix input parameter order:
 	const mxArray *uInPtr = (nrhs > 0) ? prhs[0] : NULL; //unary
 	const mxArray *pInPtr = (nrhs > 1) ? prhs[1] : NULL; //pairwise
 	const mxArray *mInPtr = (nrhs > 2) ? prhs[2] : NULL; //label matrix
 	const mxArray *oInPtr = (nrhs > 3) ? prhs[3] : NULL; //options
-	
+
 	//Fix output parameter order:
 	mxArray **eOutPtr = (nlhs > 1) ? &plhs[1] : NULL; //energy
 	mxArray **sOutPtr = (nlhs > 0) ? &plhs[0] : NULL; //solution
 	mxArray **lbOutPtr = (nlhs > 2) ? &plhs[2] : NULL; //lowerbound
-	mxArray **timePlotOutPtr = (nlhs > 5) ? &plhs[5] : NULL; //time plot 
-	mxArray **lbPlotOutPtr = (nlhs > 3) ? &plhs[3] : NULL; //lowerbound plot 
-	mxArray **energyPlotOutPtr = (nlhs > 4) ? &plhs[4] : NULL; //energy plot 
-
-	//prepare default options
-	double m_eps = 1e-2; 
-	int m_iterMax = 100;
-	int m_printIter = 5;     
-	int m_printMinIter = 10;
-	verbosityLevel = 0; // global variable
-	int method = 0;
-	
+	mxArray **timePlotOutPtr = (nlhs > 5) ? &plhs[5] : NULL; //time plot
+	mxArray **lbPlotOutPtr = (nlhs > 3) ? &plhs[3] : NULL; //lowerbound plot
+	mxArray **energyPlotOutPtr = (nlhs > 4) ? &plhs[4] : NULL; //energy plot
+	mxArray **minMarginalsOutPtr = (nlhs > 6) ? &plhs[6] : NULL; //min-marginals
+
 	//get options structure
-	if(oInPtr != NULL){
-		MATLAB_ASSERT(mxIsStruct(oInPtr), "Expected structure array for constraints");
-		MATLAB_ASSERT(mxGetNumberOfElements(oInPtr) == 1, "Wrong structure type for options: wrong number of fields");
-		mxArray *curField = NULL;
-		if((curField = mxGetField(oInPtr, 0, "method")) != NULL){
-			MATLAB_ASSERT(mxGetClassID(curField) == mxCHAR_CLASS, "Wrong structure type for options: expected STRING for field <<method>>");
-		
-			mwSize buflen = mxGetN(curField)*sizeof(mxChar)+1;
-			char *buf = (char*)mxMalloc(buflen);
-			if(!mxGetString(curField, buf, buflen)){
-				if(!strcmp(buf, "trw-s")) method = 0;
-				if(!strcmp(buf, "bp")) method = 1;
-			}
-			mxFree(buf);
-		}
-		if((curField = mxGetField(oInPtr, 0, "maxIter")) != NULL){
-			MATLAB_ASSERT(mxGetClassID(curField) == mxDOUBLE_CLASS, "Wrong structure type for options: expected DOUBLE for field <<maxIter>>");
-			MATLAB_ASSERT(mxGetNumberOfElements(curField) == 1, "Wrong structure type for options: expected 1 number for field <<maxIter>>");
-			m_iterMax = (int)(*(double*)mxGetData(curField));
-			MATLAB_ASSERT(m_iterMax >= 1, "Wrong value for options.maxIter: expected value is >= 1");
-		}
-		if((curField = mxGetField(oInPtr, 0, "verbosity")) != NULL){
-			MATLAB_ASSERT(mxGetClassID(curField) == mxDOUBLE_CLASS, "Wrong structure type for options: expected DOUBLE for field <<verbosity>>");
-			MATLAB_ASSERT(mxGetNumberOfElements(curField) == 1, "Wrong structure type for options: expected 1 number for field <<verbosity>>");
-			verbosityLevel = (int)(*(double*)mxGetData(curField));
-			MATLAB_ASSERT(verbosityLevel == 0 || verbosityLevel == 1 || verbosityLevel == 2, "Wrong value for options.verbosity: expected value is 0, 1, or 2");
-		}
-		if((curField = mxGetField(oInPtr, 0, "funcEps")) != NULL){
-			MATLAB_ASSERT(mxGetClassID(curField) == mxDOUBLE_CLASS, "Wrong structure type for options: expected DOUBLE for field <<funcEps>>");
-			MATLAB_ASSERT(mxGetNumberOfElements(curField) == 1, "Wrong structure type for options: expected 1 number for field <<funcEps>>");
-			m_eps = *(double*)mxGetData(curField);
-		}
-		if((curField = mxGetField(oInPtr, 0, "printMinIter")) != NULL){
-			MATLAB_ASSERT(mxGetClassID(curField) == mxDOUBLE_CLASS, "Wrong structure type for options: expected DOUBLE for field <<printMinIter>>");
-			MATLAB_ASSERT(mxGetNumberOfElements(curField) == 1, "Wrong structure type for options: expected 1 number for field <<printMinIter>>");
-			m_printMinIter = (int)(*(double*)mxGetData(curField));
-			MATLAB_ASSERT(m_printMinIter >= 0, "Wrong value for options.printMinIter: expected value is >= 0");
-		}
-		if((curField = mxGetField(oInPtr, 0, "printIter")) != NULL){
-			MATLAB_ASSERT(mxGetClassID(curField) == mxDOUBLE_CLASS, "Wrong structure type for options: expected DOUBLE for field <<printIter>>");
-			MATLAB_ASSERT(mxGetNumberOfElements(curField) == 1, "Wrong structure type for options: expected 1 number for field <<printIter>>");
-			m_printIter = (int)(*(double*)mxGetData(curField));
-			MATLAB_ASSERT(m_printIter >= 1, "Wrong value for options.printIter: expected value is >= 1");
-		}
-	}	
-
-	// get unary potentials
-	MATLAB_ASSERT(mxGetNumberOfDimensions(uInPtr) == 2, "Unary term array is not 2-dimensional");
-	MATLAB_ASSERT(mxGetPi(uInPtr) == NULL, "Unary potentials should not be complex");
-	
-	mwSize numNodes = mxGetN(uInPtr);
-	mwSize numLabels = mxGetM(uInPtr);
-
-	MATLAB_ASSERT(numNodes >= 1, "The number of nodes is not positive");
-	MATLAB_ASSERT(numLabels >= 1, "The number of labels is not positive");
-	MATLAB_ASSERT(mxGetClassID(uInPtr) == mxDOUBLE_CLASS, "Expected mxDOUBLE_CLASS for input unary term argument");
-	double* termW = (double*)mxGetData(uInPtr);
-
-	//get label matrix
-	double* labelMatrix = NULL;
-	if(mInPtr != NULL){
-		if(!mxIsEmpty(mInPtr)){
-			MATLAB_ASSERT(mxGetClassID(mInPtr) == mxDOUBLE_CLASS, "Expected mxDOUBLE_CLASS for label matrix");
-			MATLAB_ASSERT(mxGetNumberOfDimensions(mInPtr) == 2, "Label matrix is not 2-dimensional");
-			MATLAB_ASSERT(mxGetPi(mInPtr) == NULL, "Label matrix should not be complex");
-			MATLAB_ASSERT(mxGetN(mInPtr) == numLabels && mxGetM(mInPtr) == numLabels, "Label matrix should be of size NumLabels x NumLabels");
-			
-			labelMatrix = (double*)mxGetData(mInPtr);
-		}
-	}
+	TrwsOptions options;
+	readOptions(oInPtr, options);
+	options.computeMinMarginals = (minMarginalsOutPtr != NULL);
 
-	//get pairwise potentials
-	MATLAB_ASSERT(mxIsSparse(pInPtr), "Expected sparse array for neighbours");
-	MATLAB_ASSERT(mxGetN(pInPtr) == numNodes && mxGetM(pInPtr) == numNodes,
-	              "Neighbours array must be NumNodes x NumNodes in size");
-	MATLAB_ASSERT(mxGetClassID(pInPtr) == mxDOUBLE_CLASS, "Expected mxDOUBLE_CLASS for neighbours array");
-	MATLAB_ASSERT(mxGetPi(pInPtr) == NULL, "Pairwise potentials should not be complex");
-
-	mwIndex colNum = (mwIndex)mxGetN(pInPtr);
-	const mwIndex* ir = mxGetIr(pInPtr);
-	const mwIndex* jc = mxGetJc(pInPtr);
-	double*        pr = mxGetPr(pInPtr);
-
-	//create variables to store answer
-	double lowerBoundMy  = 0;
-	double energyMy = 0;
-	vector<double> segmentMy(numNodes, 0);
-	vector<double> timePlot;
-	vector<double> energyPlot;
-	vector<double> lbPlot;
-
-	//create MRF object for general potentials
-	if ( labelMatrix != NULL ) {
-
-		//prepare default options
-		MRFEnergy<TypeGeneral>::Options options;
-		options.m_eps = m_eps; 
-		options.m_iterMax = m_iterMax;
-		options.m_printIter = m_printIter;     
-		options.m_printMinIter = m_printMinIter;
-
-		MRFEnergy<TypeGeneral>* mrf;
-		MRFEnergy<TypeGeneral>::NodeId* nodes;
-	
-		TypeGeneral::REAL energy, lowerBound;
-		
-		TypeGeneral::REAL *D = new TypeGeneral::REAL[numLabels];
-		TypeGeneral::REAL *P = new TypeGeneral::REAL[numLabels * numLabels];
-		for(int i = 0; i < numLabels * numLabels; ++i)	P[i] = 0;
-
-		mrf = new MRFEnergy<TypeGeneral>(TypeGeneral::GlobalSize());
-		nodes = new MRFEnergy<TypeGeneral>::NodeId[numNodes];
-	
-		// construct energy
-		// add unary terms
-		for(int i = 0; i < numNodes; ++i){
-			nodes[i] = mrf->AddNode(TypeGeneral::LocalSize(numLabels), TypeGeneral::NodeData(termW + i * numLabels));
-		}
+	if (!mxIsCell(uInPtr)) {
+		MATLAB_ASSERT(!mxIsCell(pInPtr) || isGridPairwise(pInPtr), "Cell array of pairwise terms is accepted only in the batch mode");
+
+		TrwsProblem problem;
+		readProblem(uInPtr, pInPtr, mInPtr, options, problem);
 
-		//add pairwise terms
-		for (mwIndex c = 0; c < colNum; ++c) {
-			mwIndex rowStart = jc[c]; 
-			mwIndex rowEnd   = jc[c + 1]; 
-			for (mwIndex ri = rowStart; ri < rowEnd; ++ri)  {
-				mwIndex r = ir[ri];
-				double dw = pr[ri];
-
-				// Add a general term
-				if (r < c) { // pick only upper triangle
-					for(int i = 0; i < numLabels; ++i)
-						for(int j = 0; j < numLabels; ++j)
-							P[j + numLabels * i] = dw * labelMatrix[j + numLabels * i];
-	
-					mrf->AddEdge(nodes[r], nodes[c], TypeGeneral::EdgeData(TypeGeneral::GENERAL, P));
-				}
-			 }
-		 }	
-
-		 /////////////////////// TRW-S algorithm //////////////////////
-		 if (verbosityLevel < 2)
-			options.m_printMinIter = options.m_iterMax + 2;
-
-			clock_t tStart = clock();
-			
-			if(method == 0) //TRW-S
-			{
-				// Function below is optional - it may help if, for example, nodes are added in a random order
-				mrf->SetAutomaticOrdering();
-	
-				mrf->Minimize_TRW_S(options, lowerBound, energy);
-
-				if(verbosityLevel >= 1)
-					printf("TRW-S finished. Time: %f\n", (clock() - tStart) * 1.0 / CLOCKS_PER_SEC);
-			}
-			else
-			{
-				// Function below is optional - it may help if, for example, nodes are added in a random order
-				//mrf->SetAutomaticOrdering();
-
-				mrf->Minimize_BP(options, energy);
-				lowerBound = std::numeric_limits<double>::signaling_NaN();
-
-				if(verbosityLevel >= 1)
-					printf("BP finished. Time: %f\n", (clock() - tStart) * 1.0 / CLOCKS_PER_SEC);
-			}
-
-		// save solution
-		energyMy = energy;
-		lowerBoundMy = lowerBound;
-		for( int i = 0; i < numNodes; ++i) {
-			segmentMy[i] = (double)(mrf -> GetSolution(nodes[i])) + 1;
+		TrwsResult result;
+		try {
+			solveProblem(problem, options, getProblemThreadPool(options), result);
 		}
-		timePlot.reserve(m_iterMax);
-		energyPlot.reserve(m_iterMax);;
-		lbPlot.reserve(m_iterMax);;
-		for(int i = 0; i < m_iterMax; ++i) {
-			double curTime = (double)(mrf -> timePlot[i]);
-			if (curTime < -1e-2) break;
-			
-			timePlot.push_back(curTime);
-			lbPlot.push_back( (double)(mrf -> lbPlot[i]) );
-			energyPlot.push_back( (double)(mrf -> ePlot[i]) );
+		catch (...) {
+			mexErrMsgTaskException("trwsMex_time:threadPool");
 		}
 
-
-		// done
-		delete [] nodes;
-		delete mrf;
-		delete [] D;
-		delete [] P;
-	} else {
-	// Potts MRF
-		//check pairwise terms
-		mwSize numEdges = 0;
-		for (mwIndex c = 0; c < colNum; ++c) {
-			mwIndex rowStart = jc[c]; 
-			mwIndex rowEnd   = jc[c+1]; 
-			for (mwIndex ri = rowStart; ri < rowEnd; ++ri)  {
-				mwIndex r = ir[ri];
-	
-				double dw = pr[ri];
-				if( r < c) numEdges++;
-				if (dw < 0)
-					mexErrMsgTxt("Some Potts edge have negative coefficient!");
-
-			}
+		//output the best energy value
+		if(eOutPtr != NULL)	{
+			*eOutPtr = mxCreateNumericMatrix(1, 1, mxDOUBLE_CLASS, mxREAL);
+			*(double*)mxGetData(*eOutPtr) = (double)result.energy;
 		}
 
-		//prepare default options
-		MRFEnergy<TypePotts>::Options options;
-		options.m_eps = m_eps; 
-		options.m_iterMax = m_iterMax;
-		options.m_printIter = m_printIter;     
-		options.m_printMinIter = m_printMinIter;
-
-		MRFEnergy<TypePotts>* mrf;
-		MRFEnergy<TypePotts>::NodeId* nodes;
-	
-		TypePotts::REAL energy, lowerBound;
-		
-		TypePotts::REAL *D = new TypePotts::REAL[numLabels];
-		
-		mrf = new MRFEnergy<TypePotts>(TypePotts::GlobalSize(numLabels));
-		nodes = new MRFEnergy<TypePotts>::NodeId[numNodes];
-	
-		// construct energy
-		// add unary terms
-		for(int i = 0; i < numNodes; ++i){
-			nodes[i] = mrf->AddNode(TypePotts::LocalSize(), TypePotts::NodeData(termW + i * numLabels));
-		}
+		//output the best solution
+		if(sOutPtr != NULL)
+			*sOutPtr = createColumn(result.segment);
 
-		//add pairwise terms
-		for (mwIndex c = 0; c < colNum; ++c) {
-			mwIndex rowStart = jc[c]; 
-			mwIndex rowEnd   = jc[c + 1]; 
-			for (mwIndex ri = rowStart; ri < rowEnd; ++ri)  {
-				mwIndex r = ir[ri];
-				double dw = pr[ri];
-
-				if (r < c) {
-					if (dw >= 0) {
-						mrf->AddEdge(nodes[r], nodes[c], TypePotts::EdgeData(dw));
-					}
-				}
-			 }
-		 }	
-
-		 /////////////////////// TRW-S algorithm //////////////////////
-		 if (verbosityLevel < 2)
-			options.m_printMinIter = options.m_iterMax + 2;
-
-			clock_t tStart = clock();
-			
-			if(method == 0) //TRW-S
-			{
-				// Function below is optional - it may help if, for example, nodes are added in a random order
-				mrf->SetAutomaticOrdering();
-	
-				mrf->Minimize_TRW_S(options, lowerBound, energy);
-
-				if(verbosityLevel >= 1)
-					printf("TRW-S finished. Time: %f\n", (clock() - tStart) * 1.0 / CLOCKS_PER_SEC);
-			}
-			else
-			{
-				// Function below is optional - it may help if, for example, nodes are added in a random order
-				//mrf->SetAutomaticOrdering();
-
-				mrf->Minimize_BP(options, energy);
-				lowerBound = std::numeric_limits<double>::signaling_NaN();
-
-				if(verbosityLevel >= 1)
-					printf("BP finished. Time: %f\n", (clock() - tStart) * 1.0 / CLOCKS_PER_SEC);
-			}
-
-		// save solution
-		energyMy = energy;
-		lowerBoundMy = lowerBound;
-		for( int i = 0; i < numNodes; ++i) {
-			segmentMy[i] = (double)(mrf -> GetSolution(nodes[i])) + 1;
-		}
-		timePlot.reserve(m_iterMax);
-		energyPlot.reserve(m_iterMax);;
-		lbPlot.reserve(m_iterMax);;
-		for(int i = 0; i < m_iterMax; ++i) {
-			double curTime = (double)(mrf -> timePlot[i]);
-			if (curTime < -1e-2) break;
-			
-			timePlot.push_back(curTime);
-			lbPlot.push_back( (double)(mrf -> lbPlot[i]) );
-			energyPlot.push_back( (double)(mrf -> ePlot[i]) );
+		//output the best lower bound
+		if(lbOutPtr != NULL)	{
+			*lbOutPtr = mxCreateNumericMatrix(1, 1, mxDOUBLE_CLASS, mxREAL);
+			*(double*)mxGetData(*lbOutPtr) = (double)result.lowerBound;
 		}
 
+		//output time plot
+		if(timePlotOutPtr != NULL)
+			*timePlotOutPtr = createColumn(result.timePlot);
 
-		// done
-		delete [] nodes;
-		delete mrf;
-		delete [] D;
+		//output lower bound plot
+		if(lbPlotOutPtr != NULL)
+			*lbPlotOutPtr = createColumn(result.lbPlot);
+
+		//output energy plot
+		if(energyPlotOutPtr != NULL)
+			*energyPlotOutPtr = createColumn(result.energyPlot);
+
+		//output min-marginals
+		if(minMarginalsOutPtr != NULL)
+			*minMarginalsOutPtr = createMatrix(result.minMarginals, problem.numLabels);
+		return;
 	}
 
-	//output the best energy value
-	if(eOutPtr != NULL)	{
-		*eOutPtr = mxCreateNumericMatrix(1, 1, mxDOUBLE_CLASS, mxREAL);
-		*(double*)mxGetData(*eOutPtr) = (double)energyMy;
+	// batch mode: independent problems are solved in parallel
+	mwSize numProblems = mxGetNumberOfElements(uInPtr);
+	MATLAB_ASSERT(numProblems >= 1, "Cell array of unary terms is empty");
+	// {vertCost, horCost} of the grid mode is shared by all the problems
+	bool isPairwiseShared = !mxIsCell(pInPtr) || isGridPairwise(pInPtr);
+	MATLAB_ASSERT(isPairwiseShared || mxGetNumberOfElements(pInPtr) == numProblems, "Cell arrays of unary and pairwise terms are of different sizes");
+	MATLAB_ASSERT(mInPtr == NULL || !mxIsCell(mInPtr) || mxGetNumberOfElements(mInPtr) == numProblems, "Cell arrays of unary terms and label matrices are of different sizes");
+
+	// printf goes to mexPrintf which can not be called from the worker threads
+	verbosityLevel = 0;
+	options.m_printMinIter = options.m_iterMax + 2;
+
+	vector<TrwsProblem> problems(numProblems);
+	for(mwSize iProblem = 0; iProblem < numProblems; ++iProblem) {
+		const mxArray *curUInPtr = mxGetCell(uInPtr, iProblem);
+		const mxArray *curPInPtr = isPairwiseShared ? pInPtr : mxGetCell(pInPtr, iProblem);
+		const mxArray *curMInPtr = (mInPtr != NULL && mxIsCell(mInPtr)) ? mxGetCell(mInPtr, iProblem) : mInPtr;
+		MATLAB_ASSERT(curUInPtr != NULL && curPInPtr != NULL, "Some cell of the batch is empty");
+		readProblem(curUInPtr, curPInPtr, curMInPtr, options, problems[iProblem]);
 	}
 
-	//output the best solution
-	if(sOutPtr != NULL)	{
-		*sOutPtr = mxCreateNumericMatrix(numNodes, 1, mxDOUBLE_CLASS, mxREAL);
-		double* segment = (double*)mxGetData(*sOutPtr);
-		for(int i = 0; i < numNodes; ++i)
-			segment[i] = segmentMy[i];
+	vector<TrwsResult> results(numProblems);
+	try {
+		getThreadPool(options.numThreads) -> parallelFor((int)numProblems, [&](int iProblem, int iThread) {
+			solveProblem(problems[iProblem], options, NULL, results[iProblem]);
+		});
+	}
+	catch (...) {
+		mexErrMsgTaskException("trwsMex_time:threadPool");
 	}
 
-	//output the best lower bound
+	if(eOutPtr != NULL)	{
+		*eOutPtr = mxCreateNumericMatrix(numProblems, 1, mxDOUBLE_CLASS, mxREAL);
+		double* energy = (double*)mxGetData(*eOutPtr);
+		for(mwSize iProblem = 0; iProblem < numProblems; ++iProblem)
+			energy[iProblem] = results[iProblem].energy;
+	}
 	if(lbOutPtr != NULL)	{
-		*lbOutPtr = mxCreateNumericMatrix(1, 1, mxDOUBLE_CLASS, mxREAL);
-		*(double*)mxGetData(*lbOutPtr) = (double)lowerBoundMy;
+		*lbOutPtr = mxCreateNumericMatrix(numProblems, 1, mxDOUBLE_CLASS, mxREAL);
+		double* lowerBound = (double*)mxGetData(*lbOutPtr);
+		for(mwSize iProblem = 0; iProblem < numProblems; ++iProblem)
+			lowerBound[iProblem] = results[iProblem].lowerBound;
+	}
+	if(sOutPtr != NULL)	{
+		*sOutPtr = mxCreateCellMatrix(numProblems, 1);
+		for(mwSize iProblem = 0; iProblem < numProblems; ++iProblem)
+			mxSetCell(*sOutPtr, iProblem, createColumn(results[iProblem].segment));
 	}
-
-	//output time plot
 	if(timePlotOutPtr != NULL)	{
-		*timePlotOutPtr = mxCreateNumericMatrix(timePlot.size(), 1, mxDOUBLE_CLASS, mxREAL);
-		double* time = (double*)mxGetData(*timePlotOutPtr);
-		for(int i = 0; i < timePlot.size(); ++i)
-			time[i] = timePlot[i];
+		*timePlotOutPtr = mxCreateCellMatrix(numProblems, 1);
+		for(mwSize iProblem = 0; iProblem < numProblems; ++iProblem)
+			mxSetCell(*timePlotOutPtr, iProblem, createColumn(results[iProblem].timePlot));
 	}
-
-	//output lower bound plot
 	if(lbPlotOutPtr != NULL)	{
-		*lbPlotOutPtr = mxCreateNumericMatrix(lbPlot.size(), 1, mxDOUBLE_CLASS, mxREAL);
-		double* lb = (double*)mxGetData(*lbPlotOutPtr);
-		for(int i = 0; i < lbPlot.size(); ++i)
-			lb[i] = lbPlot[i];
+		*lbPlotOutPtr = mxCreateCellMatrix(numProblems, 1);
+		for(mwSize iProblem = 0; iProblem < numProblems; ++iProblem)
+			mxSetCell(*lbPlotOutPtr, iProblem, createColumn(results[iProblem].lbPlot));
 	}
-
-	//output energy plot
 	if(energyPlotOutPtr != NULL)	{
-		*energyPlotOutPtr = mxCreateNumericMatrix(energyPlot.size(), 1, mxDOUBLE_CLASS, mxREAL);
-		double* curE = (double*)mxGetData(*energyPlotOutPtr);
-		for(int i = 0; i < energyPlot.size(); ++i)
-			curE[i] = energyPlot[i];
+		*energyPlotOutPtr = mxCreateCellMatrix(numProblems, 1);
+		for(mwSize iProblem = 0; iProblem < numProblems; ++iProblem)
+			mxSetCell(*energyPlotOutPtr, iProblem, createColumn(results[iProblem].energyPlot));
+	}
+	if(minMarginalsOutPtr != NULL)	{
+		*minMarginalsOutPtr = mxCreateCellMatrix(numProblems, 1);
+		for(mwSize iProblem = 0; iProblem < numProblems; ++iProblem)
+			mxSetCell(*minMarginalsOutPtr, iProblem, createMatrix(results[iProblem].minMarginals, problems[iProblem].numLabels));
+	}
+}
+
+void solveProblem(const TrwsProblem& problem, const TrwsOptions& options, ThreadPool* threadPool, TrwsResult& result)
+{
+	bool isSingle = isSinglePrecision(problem, options);
+
+	// the truncated types are double only
+	if ( options.pairwiseType == 1 ) {
+		solveTruncated<TypeTruncatedLinear>(problem, options, threadPool, result);
+	} else if ( options.pairwiseType == 2 ) {
+		solveTruncated<TypeTruncatedQuadratic>(problem, options, threadPool, result);
+	} else if ( options.pairwiseType == 3 ) {
+		solveTruncated<TypeTruncatedLinear2D>(problem, options, threadPool, result);
+	} else if ( options.pairwiseType == 4 ) {
+		solveTruncated<TypeTruncatedQuadratic2D>(problem, options, threadPool, result);
+	} else if ( options.pruneLabels ) {
+		if (isSingle)
+			solvePruned<TypeGeneralFloat>(problem, options, threadPool, result);
+		else
+			solvePruned<TypeGeneral>(problem, options, threadPool, result);
+	} else if ( problem.labelMatrix != NULL && options.sharedLabelMatrix ) {
+		if (isSingle)
+			solveWeightedGeneral<TypeWeightedGeneralFloat>(problem, options, threadPool, result);
+		else
+			solveWeightedGeneral<TypeWeightedGeneral>(problem, options, threadPool, result);
+	} else if ( problem.labelMatrix != NULL ) {
+		if (isSingle)
+			solveGeneral<TypeGeneralFloat>(problem, options, threadPool, result);
+		else
+			solveGeneral<TypeGeneral>(problem, options, threadPool, result);
+	} else {
+		if (isSingle)
+			solvePotts<TypePottsFloat>(problem, options, threadPool, result);
+		else
+			solvePotts<TypePotts>(problem, options, threadPool, result);
 	}
+}
+
+template <class T> void solveGeneral(const TrwsProblem& problem, const TrwsOptions& options, ThreadPool* threadPool, TrwsResult& result)
+{
+	typename MRFEnergy<T>::NodeId* nodes = new typename MRFEnergy<T>::NodeId[problem.numNodes];
+	MRFEnergy<T>* mrf = createGeneralEnergy<T>(problem, options, nodes);
+
+	minimizeEnergy(mrf, nodes, problem.numNodes, problem.numLabels, options, threadPool, result);
+
+	// done
+	delete [] nodes;
+	delete mrf;
+}
+
+template <class T> void solveWeightedGeneral(const TrwsProblem& problem, const TrwsOptions& options, ThreadPool* threadPool, TrwsResult& result)
+{
+	typename MRFEnergy<T>::NodeId* nodes = new typename MRFEnergy<T>::NodeId[problem.numNodes];
+	typename T::REAL* labelMatrix = new typename T::REAL[problem.numLabels * problem.numLabels];
+	MRFEnergy<T>* mrf = createWeightedGeneralEnergy<T>(problem, options, nodes, labelMatrix);
 
+	minimizeEnergy(mrf, nodes, problem.numNodes, problem.numLabels, options, threadPool, result);
 
+	// done
+	delete [] nodes;
+	delete mrf;
+	delete [] labelMatrix;
 }
 
+template <class T> void solvePotts(const TrwsProblem& problem, const TrwsOptions& options, ThreadPool* threadPool, TrwsResult& result)
+{
+	typename MRFEnergy<T>::NodeId* nodes = new typename MRFEnergy<T>::NodeId[problem.numNodes];
+	MRFEnergy<T>* mrf = createPottsEnergy<T>(problem, options, nodes);
+
+	minimizeEnergy(mrf, nodes, problem.numNodes, problem.numLabels, options, threadPool, result);
+
+	// done
+	delete [] nodes;
+	delete mrf;
+}
+
+template <class T> void solveTruncated(const TrwsProblem& problem, const TrwsOptions& options, ThreadPool* threadPool, TrwsResult& result)
+{
+	typename MRFEnergy<T>::NodeId* nodes = new typename MRFEnergy<T>::NodeId[problem.numNodes];
+	MRFEnergy<T>* mrf = createTruncatedEnergy<T>(problem, options, nodes);
+
+	minimizeEnergy(mrf, nodes, problem.numNodes, problem.numLabels, options, threadPool, result);
+
+	// done
+	delete [] nodes;
+	delete mrf;
+}
+
+template <class T> void solvePruned(const TrwsProblem& problem, const TrwsOptions& options, ThreadPool* threadPool, TrwsResult& result)
+{
+	TrwsLabelSets labelSets;
+	pruneLabels(problem, labelSets);
+	if(verbosityLevel >= 1)
+		printf("Label pruning: %d of %d labels left\n", (int)labelSets.labels.size(), (int)(problem.numNodes * problem.numLabels));
+
+	typename MRFEnergy<T>::NodeId* nodes = new typename MRFEnergy<T>::NodeId[problem.numNodes];
+	MRFEnergy<T>* mrf = createPrunedEnergy<T>(problem, options, labelSets, nodes);
+
+	minimizeEnergy(mrf, nodes, problem.numNodes, problem.numLabels, options, threadPool, result, &labelSets);
+
+	// done
+	delete [] nodes;
+	delete mrf;
+}
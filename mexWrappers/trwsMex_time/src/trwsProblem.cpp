@@ -0,0 +1,461 @@
+#include "trwsProblem.h"
+
+#include <algorithm>
+
+int verbosityLevel; // AOSOKIN
+
+void readOptions(const mxArray *oInPtr, TrwsOptions& options)
+{
+	//prepare default options
+	options.m_eps = 1e-2;
+	options.m_iterMax = 100;
+	options.m_printIter = 5;
+	options.m_printMinIter = 10;
+	options.energyIter = 1;
+	options.method = 0;
+	options.numThreads = 0;
+	options.wavefront = false;
+	options.precision = 0;
+	options.contiguousStorage = false;
+	options.sharedLabelMatrix = true;
+	options.pairwiseType = 0;
+	options.numLabelsX = 1;
+	options.computeMinMarginals = false;
+	options.pruneLabels = false;
+	verbosityLevel = 0; // global variable
+
+	if(oInPtr == NULL)
+		return;
+
+	MATLAB_ASSERT(mxIsStruct(oInPtr), "Expected structure array for constraints");
+	MATLAB_ASSERT(mxGetNumberOfElements(oInPtr) == 1, "Wrong structure type for options: wrong number of fields");
+	mxArray *curField = NULL;
+	if((curField = mxGetField(oInPtr, 0, "method")) != NULL){
+		MATLAB_ASSERT(mxGetClassID(curField) == mxCHAR_CLASS, "Wrong structure type for options: expected STRING for field <<method>>");
+
+		mwSize buflen = mxGetN(curField)*sizeof(mxChar)+1;
+		char *buf = (char*)mxMalloc(buflen);
+		if(!mxGetString(curField, buf, buflen)){
+			if(!strcmp(buf, "trw-s")) options.method = 0;
+			if(!strcmp(buf, "bp")) options.method = 1;
+			if(!strcmp(buf, "rbp")) options.method = 2;
+		}
+		mxFree(buf);
+	}
+	if((curField = mxGetField(oInPtr, 0, "maxIter")) != NULL){
+		MATLAB_ASSERT(mxGetClassID(curField) == mxDOUBLE_CLASS, "Wrong structure type for options: expected DOUBLE for field <<maxIter>>");
+		MATLAB_ASSERT(mxGetNumberOfElements(curField) == 1, "Wrong structure type for options: expected 1 number for field <<maxIter>>");
+		options.m_iterMax = (int)(*(double*)mxGetData(curField));
+		MATLAB_ASSERT(options.m_iterMax >= 1, "Wrong value for options.maxIter: expected value is >= 1");
+	}
+	if((curField = mxGetField(oInPtr, 0, "verbosity")) != NULL){
+		MATLAB_ASSERT(mxGetClassID(curField) == mxDOUBLE_CLASS, "Wrong structure type for options: expected DOUBLE for field <<verbosity>>");
+		MATLAB_ASSERT(mxGetNumberOfElements(curField) == 1, "Wrong structure type for options: expected 1 number for field <<verbosity>>");
+		verbosityLevel = (int)(*(double*)mxGetData(curField));
+		MATLAB_ASSERT(verbosityLevel == 0 || verbosityLevel == 1 || verbosityLevel == 2, "Wrong value for options.verbosity: expected value is 0, 1, or 2");
+	}
+	if((curField = mxGetField(oInPtr, 0, "funcEps")) != NULL){
+		MATLAB_ASSERT(mxGetClassID(curField) == mxDOUBLE_CLASS, "Wrong structure type for options: expected DOUBLE for field <<funcEps>>");
+		MATLAB_ASSERT(mxGetNumberOfElements(curField) == 1, "Wrong structure type for options: expected 1 number for field <<funcEps>>");
+		options.m_eps = *(double*)mxGetData(curField);
+	}
+	if((curField = mxGetField(oInPtr, 0, "printMinIter")) != NULL){
+		MATLAB_ASSERT(mxGetClassID(curField) == mxDOUBLE_CLASS, "Wrong structure type for options: expected DOUBLE for field <<printMinIter>>");
+		MATLAB_ASSERT(mxGetNumberOfElements(curField) == 1, "Wrong structure type for options: expected 1 number for field <<printMinIter>>");
+		options.m_printMinIter = (int)(*(double*)mxGetData(curField));
+		MATLAB_ASSERT(options.m_printMinIter >= 0, "Wrong value for options.printMinIter: expected value is >= 0");
+	}
+	if((curField = mxGetField(oInPtr, 0, "printIter")) != NULL){
+		MATLAB_ASSERT(mxGetClassID(curField) == mxDOUBLE_CLASS, "Wrong structure type for options: expected DOUBLE for field <<printIter>>");
+		MATLAB_ASSERT(mxGetNumberOfElements(curField) == 1, "Wrong structure type for options: expected 1 number for field <<printIter>>");
+		options.m_printIter = (int)(*(double*)mxGetData(curField));
+		MATLAB_ASSERT(options.m_printIter >= 1, "Wrong value for options.printIter: expected value is >= 1");
+	}
+	if((curField = mxGetField(oInPtr, 0, "energyIter")) != NULL){
+		MATLAB_ASSERT(mxGetClassID(curField) == mxDOUBLE_CLASS, "Wrong structure type for options: expected DOUBLE for field <<energyIter>>");
+		MATLAB_ASSERT(mxGetNumberOfElements(curField) == 1, "Wrong structure type for options: expected 1 number for field <<energyIter>>");
+		options.energyIter = (int)(*(double*)mxGetData(curField));
+		MATLAB_ASSERT(options.energyIter >= 0, "Wrong value for options.energyIter: expected value is >= 0");
+	}
+	if((curField = mxGetField(oInPtr, 0, "numThreads")) != NULL){
+		MATLAB_ASSERT(mxGetClassID(curField) == mxDOUBLE_CLASS, "Wrong structure type for options: expected DOUBLE for field <<numThreads>>");
+		MATLAB_ASSERT(mxGetNumberOfElements(curField) == 1, "Wrong structure type for options: expected 1 number for field <<numThreads>>");
+		options.numThreads = (int)(*(double*)mxGetData(curField));
+		MATLAB_ASSERT(options.numThreads >= 0, "Wrong value for options.numThreads: expected value is >= 0");
+	}
+	if((curField = mxGetField(oInPtr, 0, "wavefront")) != NULL){
+		MATLAB_ASSERT(mxGetClassID(curField) == mxDOUBLE_CLASS || mxGetClassID(curField) == mxLOGICAL_CLASS, "Wrong structure type for options: expected DOUBLE or LOGICAL for field <<wavefront>>");
+		MATLAB_ASSERT(mxGetNumberOfElements(curField) == 1, "Wrong structure type for options: expected 1 number for field <<wavefront>>");
+		options.wavefront = (mxGetScalar(curField) != 0);
+	}
+	if((curField = mxGetField(oInPtr, 0, "precision")) != NULL){
+		MATLAB_ASSERT(mxGetClassID(curField) == mxCHAR_CLASS, "Wrong structure type for options: expected STRING for field <<precision>>");
+
+		mwSize buflen = mxGetN(curField)*sizeof(mxChar)+1;
+		char *buf = (char*)mxMalloc(buflen);
+		options.precision = -1;
+		if(!mxGetString(curField, buf, buflen)){
+			if(!strcmp(buf, "auto")) options.precision = 0;
+			if(!strcmp(buf, "double")) options.precision = 1;
+			if(!strcmp(buf, "single")) options.precision = 2;
+		}
+		mxFree(buf);
+		MATLAB_ASSERT(options.precision >= 0, "Wrong value for options.precision: expected 'auto', 'double' or 'single'");
+	}
+	if((curField = mxGetField(oInPtr, 0, "contiguousStorage")) != NULL){
+		MATLAB_ASSERT(mxGetClassID(curField) == mxDOUBLE_CLASS || mxGetClassID(curField) == mxLOGICAL_CLASS, "Wrong structure type for options: expected DOUBLE or LOGICAL for field <<contiguousStorage>>");
+		MATLAB_ASSERT(mxGetNumberOfElements(curField) == 1, "Wrong structure type for options: expected 1 number for field <<contiguousStorage>>");
+		options.contiguousStorage = (mxGetScalar(curField) != 0);
+	}
+	if((curField = mxGetField(oInPtr, 0, "sharedLabelMatrix")) != NULL){
+		MATLAB_ASSERT(mxGetClassID(curField) == mxDOUBLE_CLASS || mxGetClassID(curField) == mxLOGICAL_CLASS, "Wrong structure type for options: expected DOUBLE or LOGICAL for field <<sharedLabelMatrix>>");
+		MATLAB_ASSERT(mxGetNumberOfElements(curField) == 1, "Wrong structure type for options: expected 1 number for field <<sharedLabelMatrix>>");
+		options.sharedLabelMatrix = (mxGetScalar(curField) != 0);
+	}
+	if((curField = mxGetField(oInPtr, 0, "pairwiseType")) != NULL){
+		MATLAB_ASSERT(mxGetClassID(curField) == mxCHAR_CLASS, "Wrong structure type for options: expected STRING for field <<pairwiseType>>");
+
+		mwSize buflen = mxGetN(curField)*sizeof(mxChar)+1;
+		char *buf = (char*)mxMalloc(buflen);
+		options.pairwiseType = -1;
+		if(!mxGetString(curField, buf, buflen)){
+			if(!strcmp(buf, "auto")) options.pairwiseType = 0;
+			if(!strcmp(buf, "truncLinear")) options.pairwiseType = 1;
+			if(!strcmp(buf, "truncQuadratic")) options.pairwiseType = 2;
+			if(!strcmp(buf, "truncLinear2D")) options.pairwiseType = 3;
+			if(!strcmp(buf, "truncQuadratic2D")) options.pairwiseType = 4;
+		}
+		mxFree(buf);
+		MATLAB_ASSERT(options.pairwiseType >= 0, "Wrong value for options.pairwiseType: expected 'auto', 'truncLinear', 'truncQuadratic', 'truncLinear2D' or 'truncQuadratic2D'");
+	}
+	if((curField = mxGetField(oInPtr, 0, "numLabelsX")) != NULL){
+		MATLAB_ASSERT(mxGetClassID(curField) == mxDOUBLE_CLASS, "Wrong structure type for options: expected DOUBLE for field <<numLabelsX>>");
+		MATLAB_ASSERT(mxGetNumberOfElements(curField) == 1, "Wrong structure type for options: expected 1 number for field <<numLabelsX>>");
+		options.numLabelsX = (int)(*(double*)mxGetData(curField));
+		MATLAB_ASSERT(options.numLabelsX >= 1, "Wrong value for options.numLabelsX: expected value is >= 1");
+	}
+	if((curField = mxGetField(oInPtr, 0, "pruneLabels")) != NULL){
+		MATLAB_ASSERT(mxGetClassID(curField) == mxDOUBLE_CLASS || mxGetClassID(curField) == mxLOGICAL_CLASS, "Wrong structure type for options: expected DOUBLE or LOGICAL for field <<pruneLabels>>");
+		MATLAB_ASSERT(mxGetNumberOfElements(curField) == 1, "Wrong structure type for options: expected 1 number for field <<pruneLabels>>");
+		options.pruneLabels = (mxGetScalar(curField) != 0);
+	}
+}
+
+// the Potts and the truncated edges
+static void checkNonNegative(const double* costs, mwSize numCosts, const TrwsOptions& options)
+{
+	for (mwSize i = 0; i < numCosts; ++i) {
+		if (costs[i] < 0)
+			mexErrMsgTxt(options.pairwiseType == 0 ? "Some Potts edge have negative coefficient!" : "Some truncated edge have negative coefficient!");
+	}
+}
+
+bool isGridPairwise(const mxArray *pInPtr)
+{
+	// {vertCost, horCost}, the cells of the batch mode contain sparse matrices or such cell arrays
+	return mxIsCell(pInPtr) && mxGetNumberOfElements(pInPtr) == 2
+		&& mxGetCell(pInPtr, 0) != NULL && !mxIsCell(mxGetCell(pInPtr, 0)) && !mxIsSparse(mxGetCell(pInPtr, 0))
+		&& mxGetCell(pInPtr, 1) != NULL && !mxIsCell(mxGetCell(pInPtr, 1)) && !mxIsSparse(mxGetCell(pInPtr, 1));
+}
+
+void readProblem(const mxArray *uInPtr, const mxArray *pInPtr, const mxArray *mInPtr, const TrwsOptions& options, TrwsProblem& problem)
+{
+	bool isGrid = isGridPairwise(pInPtr);
+
+	// get unary potentials, numLabels x height x width in the grid mode
+	MATLAB_ASSERT(mxGetNumberOfDimensions(uInPtr) == 2 || (isGrid && mxGetNumberOfDimensions(uInPtr) == 3), "Unary term array is not 2-dimensional");
+	MATLAB_ASSERT(mxGetPi(uInPtr) == NULL, "Unary potentials should not be complex");
+
+	mwSize numLabels = mxGetM(uInPtr);
+	mwSize numNodes = (numLabels > 0) ? mxGetNumberOfElements(uInPtr) / numLabels : 0;
+
+	MATLAB_ASSERT(numNodes >= 1, "The number of nodes is not positive");
+	MATLAB_ASSERT(numLabels >= 1, "The number of labels is not positive");
+	MATLAB_ASSERT(mxGetClassID(uInPtr) == mxDOUBLE_CLASS || mxGetClassID(uInPtr) == mxSINGLE_CLASS, "Expected mxDOUBLE_CLASS or mxSINGLE_CLASS for input unary term argument");
+	const void* termW = mxGetData(uInPtr);
+
+	//get label matrix
+	const void* labelMatrix = NULL;
+	if(mInPtr != NULL && options.pairwiseType == 0){
+		if(!mxIsEmpty(mInPtr)){
+			MATLAB_ASSERT(mxGetClassID(mInPtr) == mxDOUBLE_CLASS || mxGetClassID(mInPtr) == mxSINGLE_CLASS, "Expected mxDOUBLE_CLASS or mxSINGLE_CLASS for label matrix");
+			MATLAB_ASSERT(mxGetNumberOfDimensions(mInPtr) == 2, "Label matrix is not 2-dimensional");
+			MATLAB_ASSERT(mxGetPi(mInPtr) == NULL, "Label matrix should not be complex");
+			MATLAB_ASSERT(mxGetN(mInPtr) == numLabels && mxGetM(mInPtr) == numLabels, "Label matrix should be of size NumLabels x NumLabels");
+
+			labelMatrix = mxGetData(mInPtr);
+		}
+	}
+
+	//get pairwise potentials
+	mwIndex colNum = 0;
+	const mwIndex* ir = NULL;
+	const mwIndex* jc = NULL;
+	double*        pr = NULL;
+	mwSize gridHeight = 0;
+	mwSize gridWidth = 0;
+	const double* vertCost = NULL;
+	const double* horCost = NULL;
+	if (isGrid) {
+		const mxArray *vertInPtr = mxGetCell(pInPtr, 0);
+		const mxArray *horInPtr = mxGetCell(pInPtr, 1);
+		MATLAB_ASSERT(mxGetClassID(vertInPtr) == mxDOUBLE_CLASS && mxGetClassID(horInPtr) == mxDOUBLE_CLASS, "Expected mxDOUBLE_CLASS for vertCost and horCost");
+		MATLAB_ASSERT(mxGetPi(vertInPtr) == NULL && mxGetPi(horInPtr) == NULL, "Pairwise potentials should not be complex");
+		MATLAB_ASSERT(mxGetNumberOfDimensions(vertInPtr) == 2 && mxGetNumberOfDimensions(horInPtr) == 2, "vertCost and horCost should be matrices");
+
+		gridHeight = mxGetM(horInPtr);
+		gridWidth = mxGetN(vertInPtr);
+		MATLAB_ASSERT(gridHeight >= 1 && gridWidth >= 1, "The grid is empty");
+		MATLAB_ASSERT(mxGetM(vertInPtr) + 1 == gridHeight && mxGetN(horInPtr) + 1 == gridWidth, "vertCost should be (height - 1) x width and horCost should be height x (width - 1)");
+		MATLAB_ASSERT(gridHeight * gridWidth == numNodes, "The number of nodes should be height * width");
+		if (mxGetNumberOfDimensions(uInPtr) == 3) {
+			const mwSize* dims = mxGetDimensions(uInPtr);
+			MATLAB_ASSERT(dims[1] == gridHeight && dims[2] == gridWidth, "Unary term array should be NumLabels x height x width");
+		}
+
+		vertCost = mxGetPr(vertInPtr);
+		horCost = mxGetPr(horInPtr);
+		if (labelMatrix == NULL) {
+			checkNonNegative(vertCost, mxGetNumberOfElements(vertInPtr), options);
+			checkNonNegative(horCost, mxGetNumberOfElements(horInPtr), options);
+		}
+	} else {
+		MATLAB_ASSERT(mxIsSparse(pInPtr), "Expected sparse array for neighbours");
+		MATLAB_ASSERT(mxGetN(pInPtr) == numNodes && mxGetM(pInPtr) == numNodes,
+		              "Neighbours array must be NumNodes x NumNodes in size");
+		MATLAB_ASSERT(mxGetClassID(pInPtr) == mxDOUBLE_CLASS, "Expected mxDOUBLE_CLASS for neighbours array");
+		MATLAB_ASSERT(mxGetPi(pInPtr) == NULL, "Pairwise potentials should not be complex");
+
+		colNum = (mwIndex)mxGetN(pInPtr);
+		ir = mxGetIr(pInPtr);
+		jc = mxGetJc(pInPtr);
+		pr = mxGetPr(pInPtr);
+		if (labelMatrix == NULL)
+			checkNonNegative(pr, jc[colNum], options);
+	}
+
+	//get truncation, M is a scalar or a sparse matrix for the truncated types
+	problem.truncation = std::numeric_limits<double>::infinity();
+	problem.truncationIr = NULL;
+	problem.truncationJc = NULL;
+	problem.truncationPr = NULL;
+	if (options.pairwiseType != 0) {
+		if (options.pairwiseType == 3 || options.pairwiseType == 4)
+			MATLAB_ASSERT(numLabels % options.numLabelsX == 0, "The number of labels is not divisible by options.numLabelsX");
+
+		if(mInPtr != NULL && !mxIsEmpty(mInPtr)){
+			MATLAB_ASSERT(mxGetClassID(mInPtr) == mxDOUBLE_CLASS, "Expected mxDOUBLE_CLASS for truncation");
+			MATLAB_ASSERT(mxGetPi(mInPtr) == NULL, "Truncation should not be complex");
+			const double* truncation = mxGetPr(mInPtr);
+			mwSize numTruncations = 1;
+			if (mxIsSparse(mInPtr)) {
+				MATLAB_ASSERT(mxGetN(mInPtr) == numNodes && mxGetM(mInPtr) == numNodes, "Truncation matrix must be NumNodes x NumNodes in size");
+				problem.truncationIr = mxGetIr(mInPtr);
+				problem.truncationJc = mxGetJc(mInPtr);
+				problem.truncationPr = truncation;
+				numTruncations = problem.truncationJc[numNodes];
+			} else {
+				MATLAB_ASSERT(mxGetNumberOfElements(mInPtr) == 1, "Truncation should be a scalar or a sparse NumNodes x NumNodes matrix");
+				problem.truncation = truncation[0];
+			}
+			for (mwSize i = 0; i < numTruncations; ++i)
+				MATLAB_ASSERT(truncation[i] >= 0, "Some edge have negative truncation!");
+		}
+	}
+
+	problem.numNodes = numNodes;
+	problem.numLabels = numLabels;
+	problem.termW = termW;
+	problem.isTermWSingle = (mxGetClassID(uInPtr) == mxSINGLE_CLASS);
+	problem.labelMatrix = labelMatrix;
+	problem.isLabelMatrixSingle = (labelMatrix != NULL && mxGetClassID(mInPtr) == mxSINGLE_CLASS);
+	problem.colNum = colNum;
+	problem.ir = ir;
+	problem.jc = jc;
+	problem.pr = pr;
+	problem.gridHeight = gridHeight;
+	problem.gridWidth = gridWidth;
+	problem.vertCost = vertCost;
+	problem.horCost = horCost;
+}
+
+bool isSinglePrecision(const TrwsProblem& problem, const TrwsOptions& options)
+{
+	// single precision halves the memory traffic of the messages, the energy and the lower bound are accumulated in double anyway
+	return (options.precision == 2) || (options.precision == 0 && problem.isTermWSingle);
+}
+
+ThreadPool* getProblemThreadPool(const TrwsOptions& options)
+{
+	return (options.wavefront || options.method == 2) ? getThreadPool(options.numThreads) : NULL;
+}
+
+double getTruncation(const TrwsProblem& problem, mwIndex r, mwIndex c)
+{
+	if (problem.truncationJc == NULL)
+		return problem.truncation;
+
+	// the rows of a column of the sparse matrix are sorted
+	const mwIndex* rowFirst = problem.truncationIr + problem.truncationJc[c];
+	const mwIndex* rowLast = problem.truncationIr + problem.truncationJc[c + 1];
+	const mwIndex* row = std::lower_bound(rowFirst, rowLast, r);
+	if (row == rowLast || *row != r)
+		return 0;
+	return problem.truncationPr[row - problem.truncationIr];
+}
+
+void pruneLabels(const TrwsProblem& problem, TrwsLabelSets& labelSets)
+{
+	mwSize numNodes = problem.numNodes;
+	int numLabels = (int)problem.numLabels;
+
+	vector<double> U(numNodes * numLabels);
+	getValues(problem.termW, problem.isTermWSingle, 0, numNodes * numLabels, &U[0]);
+	vector<double> M;
+	if (problem.labelMatrix != NULL) {
+		M.resize(numLabels * numLabels);
+		getValues(problem.labelMatrix, problem.isLabelMatrixSingle, 0, numLabels * numLabels, &M[0]);
+	}
+
+	// the neighbors of the nodes, V_ij(ki, kj) = weight * M(ki, kj) if isFirst (i < j), weight * M(kj, ki) otherwise
+	struct Neighbor
+	{
+		mwIndex node;
+		double weight;
+		bool isFirst;
+	};
+	vector<mwIndex> neighborFirst(numNodes + 1, 0);
+	forEachEdge(problem, [&](mwIndex r, mwIndex c, double dw) {
+		++neighborFirst[r + 1];
+		++neighborFirst[c + 1];
+	});
+	for (mwIndex i = 0; i < numNodes; ++i)
+		neighborFirst[i + 1] += neighborFirst[i];
+	vector<Neighbor> neighbors(neighborFirst[numNodes]);
+	vector<mwIndex> neighborLast(neighborFirst.begin(), neighborFirst.end() - 1);
+	forEachEdge(problem, [&](mwIndex r, mwIndex c, double dw) {
+		Neighbor toC = {c, dw, true};
+		Neighbor toR = {r, dw, false};
+		neighbors[neighborLast[r]++] = toC;
+		neighbors[neighborLast[c]++] = toR;
+	});
+
+	// max_l (M(b, l) - M(a, l)) and min_l (M(b, l) - M(a, l)) over all labels l at [b + numLabels * a],
+	// the same for M(l, b) - M(l, a) at [b + numLabels * a + numLabels * numLabels]
+	vector<double> maxDiff, minDiff;
+	if (!M.empty()) {
+		maxDiff.assign(2 * numLabels * numLabels, -std::numeric_limits<double>::infinity());
+		minDiff.assign(2 * numLabels * numLabels, std::numeric_limits<double>::infinity());
+		for (int a = 0; a < numLabels; ++a)
+			for (int b = 0; b < numLabels; ++b)
+				for (int l = 0; l < numLabels; ++l) {
+					double diff = M[b + numLabels * l] - M[a + numLabels * l];
+					maxDiff[b + numLabels * a] = std::max(maxDiff[b + numLabels * a], diff);
+					minDiff[b + numLabels * a] = std::min(minDiff[b + numLabels * a], diff);
+					diff = M[l + numLabels * b] - M[l + numLabels * a];
+					maxDiff[b + numLabels * a + numLabels * numLabels] = std::max(maxDiff[b + numLabels * a + numLabels * numLabels], diff);
+					minDiff[b + numLabels * a + numLabels * numLabels] = std::min(minDiff[b + numLabels * a + numLabels * numLabels], diff);
+				}
+	}
+
+	// admissible[k + numLabels * i], the minimum of the unary terms of every node is always admissible
+	vector<char> admissible(numNodes * numLabels, 1);
+	vector<int> numAdmissible(numNodes, numLabels);
+	vector<int> best(numNodes);
+	for (mwIndex i = 0; i < numNodes; ++i)
+		best[i] = (int)(std::min_element(&U[numLabels * i], &U[numLabels * (i + 1)]) - &U[numLabels * i]);
+
+	// Label a of node i is dominated by label b if changing x_i from a to b decreases the energy whatever the neighbors take:
+	//   U_i(a) - U_i(b) > \sum_j max_{l admissible at j} (V_ij(b, l) - V_ij(a, l)).
+	// Then no minimum of the energy has x_i = a, so the labels can be removed at all the nodes at once and the sums
+	// over the remaining labels of the neighbors stay valid. b is the minimum of U_i; the nodes are checked again
+	// while the sets of their neighbors shrink, a few sweeps are enough in practice.
+	const int maxSweeps = 8;
+	vector<char> isDirty(numNodes, 1);
+	bool isChanged = true;
+	for (int iSweep = 0; iSweep < maxSweeps && isChanged; ++iSweep) {
+		isChanged = false;
+		for (mwIndex i = 0; i < numNodes; ++i) {
+			if (!isDirty[i])
+				continue;
+			isDirty[i] = 0;
+
+			int b = best[i];
+			bool isPruned = false;
+			for (int a = 0; a < numLabels; ++a) {
+				if (a == b || !admissible[a + numLabels * i])
+					continue;
+
+				double bound = 0;
+				for (mwIndex n = neighborFirst[i]; n < neighborFirst[i + 1]; ++n) {
+					const Neighbor& nb = neighbors[n];
+					const char* admissibleJ = &admissible[numLabels * nb.node];
+					if (M.empty()) {
+						// Potts: l = a gives w, l = b gives -w, other labels give 0
+						if (admissibleJ[a])
+							bound += nb.weight;
+						else if (numAdmissible[nb.node] == 1 && admissibleJ[b])
+							bound -= nb.weight;
+					} else if (numAdmissible[nb.node] == numLabels) {
+						mwIndex table = b + numLabels * a + (nb.isFirst ? 0 : numLabels * numLabels);
+						bound += (nb.weight >= 0) ? nb.weight * maxDiff[table] : nb.weight * minDiff[table];
+					} else {
+						// V(b, l) - V(a, l) = w * (M(b, l) - M(a, l)) or w * (M(l, b) - M(l, a))
+						mwIndex stepK = nb.isFirst ? 1 : numLabels;
+						mwIndex stepL = nb.isFirst ? numLabels : 1;
+						double maxDiff = -std::numeric_limits<double>::infinity();
+						for (int l = 0; l < numLabels; ++l) {
+							if (admissibleJ[l]) {
+								double diff = nb.weight * (M[b * stepK + l * stepL] - M[a * stepK + l * stepL]);
+								if (diff > maxDiff)
+									maxDiff = diff;
+							}
+						}
+						bound += maxDiff;
+					}
+				}
+
+				if (U[a + numLabels * i] - U[b + numLabels * i] > bound) {
+					admissible[a + numLabels * i] = 0;
+					--numAdmissible[i];
+					isPruned = true;
+				}
+			}
+
+			if (isPruned) {
+				for (mwIndex n = neighborFirst[i]; n < neighborFirst[i + 1]; ++n)
+					isDirty[neighbors[n].node] = 1;
+				isChanged = true;
+			}
+		}
+	}
+
+	labelSets.first.resize(numNodes + 1);
+	labelSets.labels.clear();
+	for (mwIndex i = 0; i < numNodes; ++i) {
+		labelSets.first[i] = (int)labelSets.labels.size();
+		for (int k = 0; k < numLabels; ++k)
+			if (admissible[k + numLabels * i])
+				labelSets.labels.push_back(k);
+	}
+	labelSets.first[numNodes] = (int)labelSets.labels.size();
+}
+
+mxArray* createColumn(const vector<double>& values)
+{
+	mxArray* column = mxCreateNumericMatrix(values.size(), 1, mxDOUBLE_CLASS, mxREAL);
+	double* data = (double*)mxGetData(column);
+	for(size_t i = 0; i < values.size(); ++i)
+		data[i] = values[i];
+	return column;
+}
+
+mxArray* createMatrix(const vector<double>& values, mwSize numRows)
+{
+	mwSize numCols = (numRows > 0) ? values.size() / numRows : 0;
+	mxArray* matrix = mxCreateNumericMatrix(numRows, numCols, mxDOUBLE_CLASS, mxREAL);
+	double* data = (double*)mxGetData(matrix);
+	for(size_t i = 0; i < values.size(); ++i)
+		data[i] = values[i];
+	return matrix;
+}
@@ -0,0 +1,533 @@
+#ifndef __TRWSPROBLEM_H__
+#define __TRWSPROBLEM_H__
+
+#include <cstdlib>
+#include <stdio.h>
+#include <string.h>
+#include <limits>
+#include <chrono>
+#include <vector>
+using std::vector;
+
+#include "MRFEnergy.h"
+#include "mex.h"
+#include "threadPool.h"
+
+#define MATLAB_ASSERT(expr,msg) if (!(expr)) {mexErrMsgIdAndTxt( "trwsMex_time:error", msg);}
+
+#if !defined(MX_API_VER) || MX_API_VER < 0x07030000
+typedef int mwSize;
+typedef int mwIndex;
+#endif
+
+// Inputs, options and outputs of trwsMex_time, shared with the package trwsDynamicMex
+
+struct TrwsOptions
+{
+	double m_eps;
+	int m_iterMax;
+	int m_printIter;
+	int m_printMinIter;
+	int energyIter; // the energy plot is computed every energyIter iterations, 0 - only at the last iteration
+	int method; // 0 - TRW-S, 1 - BP, 2 - residual BP
+	int numThreads; // used in the batch mode and by the wavefront mode, 0 - default
+	bool wavefront; // a single problem is solved with the parallel passes over the wavefronts of nodes
+	int precision; // REAL of the solver: 0 - same as the unary terms, 1 - double, 2 - single
+	bool contiguousStorage; // nodes and edges are moved into one array in the order of the passes
+	bool sharedLabelMatrix; // the label matrix is stored once and scaled by the edge weights (TypeWeightedGeneral),
+	                        // otherwise every edge stores its own matrix (TypeGeneral)
+	int pairwiseType; // 0 - Potts or general (given by the label matrix), 1 - truncated linear, 2 - truncated quadratic,
+	                  // 3 - truncated linear 2D, 4 - truncated quadratic 2D
+	int numLabelsX; // the labels of the 2D types form a grid of numLabelsX x (numLabels / numLabelsX) labels
+	bool pruneLabels; // the dominated labels are removed and the energy is built over the rest (TypeGeneral), pairwiseType 0 only
+	bool computeMinMarginals; // set when the min-marginals are requested as an output
+};
+
+struct TrwsProblem
+{
+	mwSize numNodes;
+	mwSize numLabels;
+	const void* termW; // double or single
+	bool isTermWSingle;
+	const void* labelMatrix; // NULL for Potts, double or single
+	bool isLabelMatrixSingle;
+	// truncated types: V_ij(ki, kj) = P(i, j) * min(distance(ki, kj), T(i, j))
+	double truncation; // T(i, j) of all edges if truncationJc == NULL
+	const mwIndex* truncationIr; // sparse matrix of T(i, j), a missing entry means zero
+	const mwIndex* truncationJc;
+	const double*  truncationPr;
+
+	mwIndex colNum;
+	const mwIndex* ir;
+	const mwIndex* jc;
+	double*        pr;
+
+	// grid mode: node (y, x) is y + gridHeight * x, the sparse matrix is not used
+	mwSize gridHeight; // 0 if the edges are given by the sparse matrix
+	mwSize gridWidth;
+	const double* vertCost; // (gridHeight - 1) x gridWidth, edge (y, x) - (y + 1, x)
+	const double* horCost; // gridHeight x (gridWidth - 1), edge (y, x) - (y, x + 1)
+};
+
+struct TrwsResult
+{
+	double energy;
+	double lowerBound;
+	vector<double> segment;
+	vector<double> timePlot;
+	vector<double> energyPlot;
+	vector<double> lbPlot;
+	vector<double> minMarginals; // numLabels x numNodes, min-marginals of the last iteration if options.computeMinMarginals
+};
+
+// admissible labels of the nodes after pruneLabels: node i keeps labels[first[i]], ..., labels[first[i + 1] - 1] (0-based, sorted)
+struct TrwsLabelSets
+{
+	vector<int> first; // numNodes + 1 elements
+	vector<int> labels;
+};
+
+// parse inputs, called from the MATLAB thread only
+void readOptions(const mxArray *oInPtr, TrwsOptions& options);
+void readProblem(const mxArray *uInPtr, const mxArray *pInPtr, const mxArray *mInPtr, const TrwsOptions& options, TrwsProblem& problem);
+// P is {vertCost, horCost} of the grid mode
+bool isGridPairwise(const mxArray *pInPtr);
+// REAL of the solver chosen by options.precision
+bool isSinglePrecision(const TrwsProblem& problem, const TrwsOptions& options);
+// the thread pool of a single problem: used by the wavefront passes and by residual BP, NULL otherwise
+ThreadPool* getProblemThreadPool(const TrwsOptions& options);
+// T(r, c) of the truncated types
+double getTruncation(const TrwsProblem& problem, mwIndex r, mwIndex c);
+// remove the labels that are not taken by any minimum of the energy, pairwiseType 0 only, does not call MATLAB API
+void pruneLabels(const TrwsProblem& problem, TrwsLabelSets& labelSets);
+// convert results to MATLAB format
+mxArray* createColumn(const vector<double>& values);
+mxArray* createMatrix(const vector<double>& values, mwSize numRows);
+
+// The functions below do not call MATLAB API and thus can be run on the thread pool.
+// values[i] = data[first + i], i < num, data is double or single
+template <class REAL> void getValues(const void* data, bool isSingle, mwSize first, mwSize num, REAL* values);
+// construct the energy with the labelMatrix (T is TypeGeneral or TypeGeneralFloat) or the Potts energy (TypePotts or TypePottsFloat),
+// nodes is an array of problem.numNodes elements (moved with the contiguous storage); the ordering and the storage are set according to options, so the energy
+// is ready for minimizeEnergy
+template <class T> MRFEnergy<T>* createGeneralEnergy(const TrwsProblem& problem, const TrwsOptions& options, typename MRFEnergy<T>::NodeId* nodes);
+template <class T> MRFEnergy<T>* createPottsEnergy(const TrwsProblem& problem, const TrwsOptions& options, typename MRFEnergy<T>::NodeId* nodes);
+// T is TypeWeightedGeneral or TypeWeightedGeneralFloat, labelMatrix is an array of numLabels * numLabels elements filled by the function,
+// it is used by the energy and must be deleted after it
+template <class T> MRFEnergy<T>* createWeightedGeneralEnergy(const TrwsProblem& problem, const TrwsOptions& options, typename MRFEnergy<T>::NodeId* nodes, typename T::REAL* labelMatrix);
+// T is TypeGeneral or TypeGeneralFloat, node i has the labels of labelSets (see pruneLabels), the edges with a node
+// of a single label are added to the unary terms of the other node
+template <class T> MRFEnergy<T>* createPrunedEnergy(const TrwsProblem& problem, const TrwsOptions& options, const TrwsLabelSets& labelSets, typename MRFEnergy<T>::NodeId* nodes);
+// T is TypeTruncatedLinear, TypeTruncatedQuadratic, TypeTruncatedLinear2D or TypeTruncatedQuadratic2D
+template <class T> MRFEnergy<T>* createTruncatedEnergy(const TrwsProblem& problem, const TrwsOptions& options, typename MRFEnergy<T>::NodeId* nodes);
+// call addEdge(r, c, dw) for the edges r < c of the sparse matrix or of the grid, zero costs of the grid are skipped
+template <class F> void forEachEdge(const TrwsProblem& problem, F addEdge);
+// run trwsOptions.m_iterMax iterations of TRW-S or BP starting from the current messages of mrf, printing is controlled by verbosityLevel;
+// the passes are parallel if threadPool is not NULL, in this case the function must be called from the MATLAB thread;
+// if labelSets is not NULL the labels of the nodes of mrf are the admissible ones, the solution and the min-marginals
+// are mapped back to numLabels labels (the min-marginals of the removed labels are Inf)
+template <class T> void minimizeEnergy(MRFEnergy<T>* mrf, typename MRFEnergy<T>::NodeId* nodes, mwSize numNodes, mwSize numLabels, const TrwsOptions& trwsOptions, ThreadPool* threadPool, TrwsResult& result, const TrwsLabelSets* labelSets = NULL);
+
+template <class F> void forEachEdge(const TrwsProblem& problem, F addEdge)
+{
+	if (problem.gridHeight == 0) {
+		for (mwIndex c = 0; c < problem.colNum; ++c) {
+			mwIndex rowStart = problem.jc[c];
+			mwIndex rowEnd   = problem.jc[c + 1];
+			for (mwIndex ri = rowStart; ri < rowEnd; ++ri)  {
+				mwIndex r = problem.ir[ri];
+				if (r < c) // pick only upper triangle
+					addEdge(r, c, problem.pr[ri]);
+			 }
+		 }
+		return;
+	}
+
+	// the same order as for the sparse matrix of the grid: by the second node, then by the first one
+	mwSize height = problem.gridHeight;
+	for (mwIndex c = 0; c < problem.numNodes; ++c) {
+		mwIndex y = c % height;
+		mwIndex x = c / height;
+		if (x > 0 && problem.horCost[y + height * (x - 1)] != 0)
+			addEdge(c - height, c, problem.horCost[y + height * (x - 1)]);
+		if (y > 0 && problem.vertCost[(y - 1) + (height - 1) * x] != 0)
+			addEdge(c - 1, c, problem.vertCost[(y - 1) + (height - 1) * x]);
+	}
+}
+
+template <class T> void setOrderingAndStorage(MRFEnergy<T>* mrf, const TrwsProblem& problem, const TrwsOptions& options, typename MRFEnergy<T>::NodeId* nodes)
+{
+	// the nodes of a grid are added in the raster order, so its rows and columns are the monotonic chains already
+	if(options.method == 0 && problem.gridHeight == 0) //TRW-S
+	{
+		// Function below is optional - it may help if, for example, nodes are added in a random order
+		mrf->SetAutomaticOrdering();
+	}
+	if (options.contiguousStorage)
+		mrf->SetContiguousStorage(nodes, (int)problem.numNodes);
+}
+
+template <class T> MRFEnergy<T>* createGeneralEnergy(const TrwsProblem& problem, const TrwsOptions& options, typename MRFEnergy<T>::NodeId* nodes)
+{
+	mwSize numNodes = problem.numNodes;
+	mwSize numLabels = problem.numLabels;
+
+	//create MRF object for general potentials
+	MRFEnergy<T>* mrf;
+
+	typename T::REAL *D = new typename T::REAL[numLabels];
+	double *M = new double[numLabels * numLabels];
+	typename T::REAL *P = new typename T::REAL[numLabels * numLabels];
+	for(int i = 0; i < numLabels * numLabels; ++i)	P[i] = 0;
+	getValues(problem.labelMatrix, problem.isLabelMatrixSingle, 0, numLabels * numLabels, M);
+
+	mrf = new MRFEnergy<T>(typename T::GlobalSize());
+
+	// construct energy
+	// add unary terms
+	for(int i = 0; i < numNodes; ++i){
+		getValues(problem.termW, problem.isTermWSingle, i * numLabels, numLabels, D);
+		nodes[i] = mrf->AddNode(typename T::LocalSize(numLabels), typename T::NodeData(D));
+	}
+
+	//add pairwise terms
+	forEachEdge(problem, [&](mwIndex r, mwIndex c, double dw) {
+		// Add a general term
+		for(int i = 0; i < numLabels; ++i)
+			for(int j = 0; j < numLabels; ++j)
+				P[j + numLabels * i] = (typename T::REAL)(dw * M[j + numLabels * i]);
+
+		mrf->AddEdge(nodes[r], nodes[c], typename T::EdgeData(T::GENERAL, P));
+	});
+
+	setOrderingAndStorage(mrf, problem, options, nodes);
+
+	delete [] P;
+	delete [] M;
+	delete [] D;
+	return mrf;
+}
+
+template <class T> MRFEnergy<T>* createPottsEnergy(const TrwsProblem& problem, const TrwsOptions& options, typename MRFEnergy<T>::NodeId* nodes)
+{
+	mwSize numNodes = problem.numNodes;
+	mwSize numLabels = problem.numLabels;
+
+	// Potts MRF
+	MRFEnergy<T>* mrf;
+
+	typename T::REAL *D = new typename T::REAL[numLabels];
+
+	mrf = new MRFEnergy<T>(typename T::GlobalSize(numLabels));
+
+	// construct energy
+	// add unary terms
+	for(int i = 0; i < numNodes; ++i){
+		getValues(problem.termW, problem.isTermWSingle, i * numLabels, numLabels, D);
+		nodes[i] = mrf->AddNode(typename T::LocalSize(), typename T::NodeData(D));
+	}
+
+	//add pairwise terms
+	forEachEdge(problem, [&](mwIndex r, mwIndex c, double dw) {
+		if (dw >= 0) {
+			mrf->AddEdge(nodes[r], nodes[c], typename T::EdgeData((typename T::REAL)dw));
+		}
+	});
+
+	setOrderingAndStorage(mrf, problem, options, nodes);
+
+	delete [] D;
+	return mrf;
+}
+
+template <class T> MRFEnergy<T>* createWeightedGeneralEnergy(const TrwsProblem& problem, const TrwsOptions& options, typename MRFEnergy<T>::NodeId* nodes, typename T::REAL* labelMatrix)
+{
+	mwSize numNodes = problem.numNodes;
+	mwSize numLabels = problem.numLabels;
+
+	// general MRF with one label matrix scaled by the edge weights
+	MRFEnergy<T>* mrf;
+
+	typename T::REAL *D = new typename T::REAL[numLabels];
+	getValues(problem.labelMatrix, problem.isLabelMatrixSingle, 0, numLabels * numLabels, labelMatrix);
+
+	mrf = new MRFEnergy<T>(typename T::GlobalSize((int)numLabels, labelMatrix));
+
+	// construct energy
+	// add unary terms
+	for(int i = 0; i < numNodes; ++i){
+		getValues(problem.termW, problem.isTermWSingle, i * numLabels, numLabels, D);
+		nodes[i] = mrf->AddNode(typename T::LocalSize(), typename T::NodeData(D));
+	}
+
+	//add pairwise terms
+	forEachEdge(problem, [&](mwIndex r, mwIndex c, double dw) {
+		mrf->AddEdge(nodes[r], nodes[c], typename T::EdgeData((typename T::REAL)dw));
+	});
+
+	setOrderingAndStorage(mrf, problem, options, nodes);
+
+	delete [] D;
+	return mrf;
+}
+
+template <class T> MRFEnergy<T>* createPrunedEnergy(const TrwsProblem& problem, const TrwsOptions& options, const TrwsLabelSets& labelSets, typename MRFEnergy<T>::NodeId* nodes)
+{
+	mwSize numNodes = problem.numNodes;
+	mwSize numLabels = problem.numLabels;
+	const int* first = &labelSets.first[0];
+	const int* labels = &labelSets.labels[0];
+
+	// general MRF over the admissible labels, the Potts terms are written as matrices
+	MRFEnergy<T>* mrf;
+
+	vector<double> M;
+	if (problem.labelMatrix != NULL) {
+		M.resize(numLabels * numLabels);
+		getValues(problem.labelMatrix, problem.isLabelMatrixSingle, 0, numLabels * numLabels, &M[0]);
+	}
+	// V_rc(kr, kc) of the admissible labels
+	auto pairwise = [&](double dw, int lr, int lc) -> double {
+		return M.empty() ? ((lr == lc) ? 0 : dw) : dw * M[lr + numLabels * lc];
+	};
+
+	// unary terms of the admissible labels, the edges with a node of a single label are added to them
+	vector<double> unary(labelSets.labels.size());
+	double *U = new double[numLabels];
+	for(int i = 0; i < numNodes; ++i){
+		getValues(problem.termW, problem.isTermWSingle, i * numLabels, numLabels, U);
+		for(int k = first[i]; k < first[i + 1]; ++k)
+			unary[k] = U[labels[k]];
+	}
+	delete [] U;
+
+	forEachEdge(problem, [&](mwIndex r, mwIndex c, double dw) {
+		if (first[c + 1] - first[c] == 1) {
+			for(int kr = first[r]; kr < first[r + 1]; ++kr)
+				unary[kr] += pairwise(dw, labels[kr], labels[first[c]]);
+		} else if (first[r + 1] - first[r] == 1) {
+			for(int kc = first[c]; kc < first[c + 1]; ++kc)
+				unary[kc] += pairwise(dw, labels[first[r]], labels[kc]);
+		}
+	});
+
+	mrf = new MRFEnergy<T>(typename T::GlobalSize());
+
+	// construct energy
+	// add unary terms
+	typename T::REAL *D = new typename T::REAL[numLabels];
+	for(int i = 0; i < numNodes; ++i){
+		for(int k = first[i]; k < first[i + 1]; ++k)
+			D[k - first[i]] = (typename T::REAL)unary[k];
+		nodes[i] = mrf->AddNode(typename T::LocalSize(first[i + 1] - first[i]), typename T::NodeData(D));
+	}
+
+	//add pairwise terms
+	typename T::REAL *P = new typename T::REAL[numLabels * numLabels];
+	forEachEdge(problem, [&](mwIndex r, mwIndex c, double dw) {
+		int numLabelsR = first[r + 1] - first[r];
+		int numLabelsC = first[c + 1] - first[c];
+		if (numLabelsR == 1 || numLabelsC == 1)
+			return;
+
+		for(int kc = 0; kc < numLabelsC; ++kc)
+			for(int kr = 0; kr < numLabelsR; ++kr)
+				P[kr + numLabelsR * kc] = (typename T::REAL)pairwise(dw, labels[first[r] + kr], labels[first[c] + kc]);
+
+		mrf->AddEdge(nodes[r], nodes[c], typename T::EdgeData(T::GENERAL, P));
+	});
+
+	setOrderingAndStorage(mrf, problem, options, nodes);
+
+	delete [] P;
+	delete [] D;
+	return mrf;
+}
+
+// the label space and the edge terms of the truncated types, the 2D types use the same weight for both label dimensions
+template <class T> struct TruncatedTerms;
+
+template <> struct TruncatedTerms<TypeTruncatedLinear>
+{
+	static TypeTruncatedLinear::GlobalSize globalSize(mwSize numLabels, int numLabelsX) { return TypeTruncatedLinear::GlobalSize((int)numLabels); }
+	static TypeTruncatedLinear::EdgeData edgeData(double alpha, double lambda) { return TypeTruncatedLinear::EdgeData(alpha, lambda); }
+};
+
+template <> struct TruncatedTerms<TypeTruncatedQuadratic>
+{
+	static TypeTruncatedQuadratic::GlobalSize globalSize(mwSize numLabels, int numLabelsX) { return TypeTruncatedQuadratic::GlobalSize((int)numLabels); }
+	static TypeTruncatedQuadratic::EdgeData edgeData(double alpha, double lambda) { return TypeTruncatedQuadratic::EdgeData(alpha, lambda); }
+};
+
+template <> struct TruncatedTerms<TypeTruncatedLinear2D>
+{
+	static TypeTruncatedLinear2D::GlobalSize globalSize(mwSize numLabels, int numLabelsX) { return TypeTruncatedLinear2D::GlobalSize(numLabelsX, (int)numLabels / numLabelsX); }
+	static TypeTruncatedLinear2D::EdgeData edgeData(double alpha, double lambda) { return TypeTruncatedLinear2D::EdgeData(alpha, alpha, lambda); }
+};
+
+template <> struct TruncatedTerms<TypeTruncatedQuadratic2D>
+{
+	static TypeTruncatedQuadratic2D::GlobalSize globalSize(mwSize numLabels, int numLabelsX) { return TypeTruncatedQuadratic2D::GlobalSize(numLabelsX, (int)numLabels / numLabelsX); }
+	static TypeTruncatedQuadratic2D::EdgeData edgeData(double alpha, double lambda) { return TypeTruncatedQuadratic2D::EdgeData(alpha, alpha, lambda); }
+};
+
+template <class T> MRFEnergy<T>* createTruncatedEnergy(const TrwsProblem& problem, const TrwsOptions& options, typename MRFEnergy<T>::NodeId* nodes)
+{
+	mwSize numNodes = problem.numNodes;
+	mwSize numLabels = problem.numLabels;
+
+	// truncated MRF, the messages are computed by the distance transforms in O(numLabels)
+	MRFEnergy<T>* mrf;
+
+	typename T::REAL *D = new typename T::REAL[numLabels];
+
+	mrf = new MRFEnergy<T>(TruncatedTerms<T>::globalSize(numLabels, options.numLabelsX));
+
+	// construct energy
+	// add unary terms
+	for(int i = 0; i < numNodes; ++i){
+		getValues(problem.termW, problem.isTermWSingle, i * numLabels, numLabels, D);
+		nodes[i] = mrf->AddNode(typename T::LocalSize(), typename T::NodeData(D));
+	}
+
+	//add pairwise terms
+	forEachEdge(problem, [&](mwIndex r, mwIndex c, double dw) {
+		// lambda = dw * T, the infinite truncation of the zero edge gives zero
+		double lambda = (dw == 0) ? 0 : dw * getTruncation(problem, r, c);
+		mrf->AddEdge(nodes[r], nodes[c], TruncatedTerms<T>::edgeData(dw, lambda));
+	});
+
+	setOrderingAndStorage(mrf, problem, options, nodes);
+
+	delete [] D;
+	return mrf;
+}
+
+// index of the label in [0, numLabels), the labels of the 2D types are stored by columns of the numLabelsX x (numLabels / numLabelsX) grid
+inline double getLabelIndex(int k, int numLabelsX)
+{
+	return (double)k;
+}
+
+inline double getLabelIndex(TypeTruncatedLinear2D::Label k, int numLabelsX)
+{
+	return (double)(k.m_kx + numLabelsX * k.m_ky);
+}
+
+inline double getLabelIndex(TypeTruncatedQuadratic2D::Label k, int numLabelsX)
+{
+	return (double)(k.m_kx + numLabelsX * k.m_ky);
+}
+
+template <class REAL> void getValues(const void* data, bool isSingle, mwSize first, mwSize num, REAL* values)
+{
+	if (isSingle) {
+		const float* singleData = (const float*)data + first;
+		for(mwSize i = 0; i < num; ++i)
+			values[i] = (REAL)singleData[i];
+	} else {
+		const double* doubleData = (const double*)data + first;
+		for(mwSize i = 0; i < num; ++i)
+			values[i] = (REAL)doubleData[i];
+	}
+}
+
+template <class T> void minimizeEnergy(MRFEnergy<T>* mrf, typename MRFEnergy<T>::NodeId* nodes, mwSize numNodes, mwSize numLabels, const TrwsOptions& trwsOptions, ThreadPool* threadPool, TrwsResult& result, const TrwsLabelSets* labelSets)
+{
+	//prepare default options
+	typename MRFEnergy<T>::Options options;
+	options.m_eps = trwsOptions.m_eps;
+	options.m_iterMax = trwsOptions.m_iterMax;
+	options.m_printIter = trwsOptions.m_printIter;
+	options.m_printMinIter = trwsOptions.m_printMinIter;
+	options.m_energyIter = trwsOptions.energyIter;
+	options.m_threadPool = threadPool;
+
+	double energy, lowerBound;
+
+	// the min-marginals are written in the order of the passes during the last iteration
+	vector<typename T::REAL> minMarginals;
+	if (trwsOptions.computeMinMarginals)
+		minMarginals.resize(labelSets ? labelSets->labels.size() : numNodes * numLabels);
+	typename T::REAL* minMarginalsPtr = trwsOptions.computeMinMarginals ? &minMarginals[0] : NULL;
+
+	 /////////////////////// TRW-S algorithm //////////////////////
+	 if (verbosityLevel < 2)
+		options.m_printMinIter = options.m_iterMax + 2;
+
+		std::chrono::steady_clock::time_point tStart = std::chrono::steady_clock::now();
+
+		if(trwsOptions.method == 0) //TRW-S
+		{
+			mrf->Minimize_TRW_S(options, lowerBound, energy, minMarginalsPtr);
+
+			if(verbosityLevel >= 1)
+				printf("TRW-S finished. Time: %f\n", std::chrono::duration<double>(std::chrono::steady_clock::now() - tStart).count());
+		}
+		else if(trwsOptions.method == 1) //BP
+		{
+			mrf->Minimize_BP(options, energy, minMarginalsPtr);
+			lowerBound = std::numeric_limits<double>::signaling_NaN();
+
+			if(verbosityLevel >= 1)
+				printf("BP finished. Time: %f\n", std::chrono::duration<double>(std::chrono::steady_clock::now() - tStart).count());
+		}
+		else
+		{
+			mrf->Minimize_RBP(options, energy, minMarginalsPtr);
+			lowerBound = std::numeric_limits<double>::signaling_NaN();
+
+			if(verbosityLevel >= 1)
+				printf("Residual BP finished. Time: %f\n", std::chrono::duration<double>(std::chrono::steady_clock::now() - tStart).count());
+		}
+
+	// save solution
+	result.energy = energy;
+	result.lowerBound = lowerBound;
+	result.segment.resize(numNodes);
+	for( int i = 0; i < numNodes; ++i) {
+		double label = getLabelIndex(mrf -> GetSolution(nodes[i]), trwsOptions.numLabelsX);
+		if (labelSets != NULL)
+			label = labelSets->labels[labelSets->first[i] + (int)label];
+		result.segment[i] = label + 1;
+	}
+	result.minMarginals.clear();
+	if (trwsOptions.computeMinMarginals && labelSets != NULL) {
+		// the nodes have different numbers of labels, their min-marginals are stored in the order of the passes
+		vector<size_t> minMarginalsFirst(numNodes + 1, 0);
+		for( int i = 0; i < numNodes; ++i)
+			minMarginalsFirst[mrf -> GetOrdering(nodes[i]) + 1] = labelSets->first[i + 1] - labelSets->first[i];
+		for( int i = 0; i < numNodes; ++i)
+			minMarginalsFirst[i + 1] += minMarginalsFirst[i];
+
+		result.minMarginals.assign(numNodes * numLabels, std::numeric_limits<double>::infinity());
+		for( int i = 0; i < numNodes; ++i) {
+			const typename T::REAL* nodeMinMarginals = &minMarginals[minMarginalsFirst[mrf -> GetOrdering(nodes[i])]];
+			for( int k = labelSets->first[i]; k < labelSets->first[i + 1]; ++k)
+				result.minMarginals[labelSets->labels[k] + numLabels * i] = (double)nodeMinMarginals[k - labelSets->first[i]];
+		}
+	} else if (trwsOptions.computeMinMarginals) {
+		result.minMarginals.resize(numNodes * numLabels);
+		for( int i = 0; i < numNodes; ++i) {
+			const typename T::REAL* nodeMinMarginals = &minMarginals[mrf -> GetOrdering(nodes[i]) * numLabels];
+			for( int k = 0; k < numLabels; ++k)
+				result.minMarginals[k + numLabels * i] = (double)nodeMinMarginals[k];
+		}
+	}
+	result.timePlot.clear();
+	result.energyPlot.clear();
+	result.lbPlot.clear();
+	result.timePlot.reserve(trwsOptions.m_iterMax);
+	result.energyPlot.reserve(trwsOptions.m_iterMax);
+	result.lbPlot.reserve(trwsOptions.m_iterMax);
+	for(int i = 0; i < trwsOptions.m_iterMax; ++i) {
+		double curTime = (double)(mrf -> timePlot[i]);
+		if (curTime < -1e-2) break;
+
+		result.timePlot.push_back(curTime);
+		result.lbPlot.push_back( (double)(mrf -> lbPlot[i]) );
+		result.energyPlot.push_back( (double)(mrf -> ePlot[i]) );
+	}
+}
+
+#endif
@@ -9,6 +9,9 @@ Energy function with general interactions:
 
    Inefficient! If possible, use other type*.h files.
 
+   TypeGeneralFloat stores the parameters and the messages in single precision,
+   the lower bound and the energy are still accumulated in double.
+
 
 Example usage:
 
@@ -114,7 +117,7 @@ void testGeneral()
 template <class T> class MRFEnergy;
 
 
-class TypeGeneral
+template <class R> class TypeGeneralT
 {
 private:
 	struct Vector; // node parameters and messages
@@ -129,7 +132,7 @@ public:
 
 	// types declarations
 	typedef int Label;
-	typedef double REAL;
+	typedef R REAL;
 	struct GlobalSize; // global information about number of labels
 	struct LocalSize; // local information about number of labels (stored at each node)
 	struct NodeData; // argument to MRFEnergy::AddNode()
@@ -188,7 +191,7 @@ public:
 	//////////////////////////////////////////////////////////////////////////////////
 
 private:
-friend class MRFEnergy<TypeGeneral>;
+friend class MRFEnergy<TypeGeneralT<R> >;
 
 	struct Vector
 	{
@@ -258,8 +261,8 @@ friend class MRFEnergy<TypeGeneral>;
 
 		Type		m_type;
 
-		// message
-		Vector*		m_message;
+		// message, stored at (char*)this + m_messageOffset (an offset rather than a pointer, so that edges can be moved with memcpy)
+		int			m_messageOffset;
 	};
 
 	struct EdgePotts : Edge
@@ -278,6 +281,9 @@ friend class MRFEnergy<TypeGeneral>;
 	};
 };
 
+typedef TypeGeneralT<double> TypeGeneral;
+typedef TypeGeneralT<float> TypeGeneralFloat;
+
 
 
 
@@ -286,26 +292,26 @@ friend class MRFEnergy<TypeGeneral>;
 //////////////////////////////////////////////////////////////////////////////////
 
 
-inline TypeGeneral::LocalSize::LocalSize(int K)
+template <class R> inline TypeGeneralT<R>::LocalSize::LocalSize(int K)
 {
 	m_K = K;
 }
 
 ///////////////////// NodeData and EdgeData ///////////////////////
 
-inline TypeGeneral::NodeData::NodeData(REAL* data)
+template <class R> inline TypeGeneralT<R>::NodeData::NodeData(REAL* data)
 {
 	m_data = data;
 }
 
-inline TypeGeneral::EdgeData::EdgeData(Type type, REAL lambdaPotts)
+template <class R> inline TypeGeneralT<R>::EdgeData::EdgeData(Type type, REAL lambdaPotts)
 {
 	assert(type == POTTS);
 	m_type = type;
 	m_lambdaPotts = lambdaPotts;
 }
 
-inline TypeGeneral::EdgeData::EdgeData(Type type, REAL* data)
+template <class R> inline TypeGeneralT<R>::EdgeData::EdgeData(Type type, REAL* data)
 {
 	assert(type == GENERAL);
 	m_type = type;
@@ -314,7 +320,7 @@ inline TypeGeneral::EdgeData::EdgeData(Type type, REAL* data)
 
 ///////////////////// Vector ///////////////////////
 
-inline int TypeGeneral::Vector::GetSizeInBytes(GlobalSize Kglobal, LocalSize K)
+template <class R> inline int TypeGeneralT<R>::Vector::GetSizeInBytes(GlobalSize Kglobal, LocalSize K)
 {
 	if (K.m_K < 1)
 	{
@@ -322,12 +328,12 @@ inline int TypeGeneral::Vector::GetSizeInBytes(GlobalSize Kglobal, LocalSize K)
 	}
 	return K.m_K*sizeof(REAL);
 }
-inline void TypeGeneral::Vector::Initialize(GlobalSize Kglobal, LocalSize K, NodeData data)
+template <class R> inline void TypeGeneralT<R>::Vector::Initialize(GlobalSize Kglobal, LocalSize K, NodeData data)
 {
 	memcpy(m_data, data.m_data, K.m_K*sizeof(REAL));
 }
 
-inline void TypeGeneral::Vector::Add(GlobalSize Kglobal, LocalSize K, NodeData data)
+template <class R> inline void TypeGeneralT<R>::Vector::Add(GlobalSize Kglobal, LocalSize K, NodeData data)
 {
 	for (int k=0; k<K.m_K; k++)
 	{
@@ -335,17 +341,17 @@ inline void TypeGeneral::Vector::Add(GlobalSize Kglobal, LocalSize K, NodeData d
 	}
 }
 
-inline void TypeGeneral::Vector::SetZero(GlobalSize Kglobal, LocalSize K)
+template <class R> inline void TypeGeneralT<R>::Vector::SetZero(GlobalSize Kglobal, LocalSize K)
 {
 	memset(m_data, 0, K.m_K*sizeof(REAL));
 }
 
-inline void TypeGeneral::Vector::Copy(GlobalSize Kglobal, LocalSize K, Vector* V)
+template <class R> inline void TypeGeneralT<R>::Vector::Copy(GlobalSize Kglobal, LocalSize K, Vector* V)
 {
 	memcpy(m_data, V->m_data, K.m_K*sizeof(REAL));
 }
 
-inline void TypeGeneral::Vector::Add(GlobalSize Kglobal, LocalSize K, Vector* V)
+template <class R> inline void TypeGeneralT<R>::Vector::Add(GlobalSize Kglobal, LocalSize K, Vector* V)
 {
 	for (int k=0; k<K.m_K; k++)
 	{
@@ -353,13 +359,13 @@ inline void TypeGeneral::Vector::Add(GlobalSize Kglobal, LocalSize K, Vector* V)
 	}
 }
 
-inline TypeGeneral::REAL TypeGeneral::Vector::GetValue(GlobalSize Kglobal, LocalSize K, Label k)
+template <class R> inline typename TypeGeneralT<R>::REAL TypeGeneralT<R>::Vector::GetValue(GlobalSize Kglobal, LocalSize K, Label k)
 {
 	assert(k>=0 && k<K.m_K);
 	return m_data[k];
 }
 
-inline TypeGeneral::REAL TypeGeneral::Vector::ComputeMin(GlobalSize Kglobal, LocalSize K, Label& kMin)
+template <class R> inline typename TypeGeneralT<R>::REAL TypeGeneralT<R>::Vector::ComputeMin(GlobalSize Kglobal, LocalSize K, Label& kMin)
 {
 	REAL vMin = m_data[0];
 	kMin = 0;
@@ -375,7 +381,7 @@ inline TypeGeneral::REAL TypeGeneral::Vector::ComputeMin(GlobalSize Kglobal, Loc
 	return vMin;
 }
 
-inline TypeGeneral::REAL TypeGeneral::Vector::ComputeAndSubtractMin(GlobalSize Kglobal, LocalSize K)
+template <class R> inline typename TypeGeneralT<R>::REAL TypeGeneralT<R>::Vector::ComputeAndSubtractMin(GlobalSize Kglobal, LocalSize K)
 {
 	REAL vMin = m_data[0];
 	for (int k=1; k<K.m_K; k++)
@@ -393,18 +399,18 @@ inline TypeGeneral::REAL TypeGeneral::Vector::ComputeAndSubtractMin(GlobalSize K
 	return vMin;
 }
 
-inline int TypeGeneral::Vector::GetArraySize(GlobalSize Kglobal, LocalSize K)
+template <class R> inline int TypeGeneralT<R>::Vector::GetArraySize(GlobalSize Kglobal, LocalSize K)
 {
 	return K.m_K;
 }
 
-inline TypeGeneral::REAL TypeGeneral::Vector::GetArrayValue(GlobalSize Kglobal, LocalSize K, int k)
+template <class R> inline typename TypeGeneralT<R>::REAL TypeGeneralT<R>::Vector::GetArrayValue(GlobalSize Kglobal, LocalSize K, int k)
 {
 	assert(k>=0 && k<K.m_K);
 	return m_data[k];
 }
 
-inline void TypeGeneral::Vector::SetArrayValue(GlobalSize Kglobal, LocalSize K, int k, REAL x)
+template <class R> inline void TypeGeneralT<R>::Vector::SetArrayValue(GlobalSize Kglobal, LocalSize K, int k, REAL x)
 {
 	assert(k>=0 && k<K.m_K);
 	m_data[k] = x;
@@ -412,7 +418,7 @@ inline void TypeGeneral::Vector::SetArrayValue(GlobalSize Kglobal, LocalSize K,
 
 ///////////////////// EdgeDataAndMessage implementation /////////////////////////
 
-inline int TypeGeneral::Edge::GetSizeInBytes(GlobalSize Kglobal, LocalSize Ki, LocalSize Kj, EdgeData data)
+template <class R> inline int TypeGeneralT<R>::Edge::GetSizeInBytes(GlobalSize Kglobal, LocalSize Ki, LocalSize Kj, EdgeData data)
 {
 	int messageSizeInBytes = ((Ki.m_K > Kj.m_K) ? Ki.m_K : Kj.m_K)*sizeof(REAL);
 
@@ -431,12 +437,12 @@ inline int TypeGeneral::Edge::GetSizeInBytes(GlobalSize Kglobal, LocalSize Ki, L
 	}
 }
 
-inline int TypeGeneral::Edge::GetBufSizeInBytes(int vectorMaxSizeInBytes)
+template <class R> inline int TypeGeneralT<R>::Edge::GetBufSizeInBytes(int vectorMaxSizeInBytes)
 {
 	return vectorMaxSizeInBytes;
 }
 
-inline void TypeGeneral::Edge::Initialize(GlobalSize Kglobal, LocalSize Ki, LocalSize Kj, EdgeData data, Vector* Di, Vector* Dj)
+template <class R> inline void TypeGeneralT<R>::Edge::Initialize(GlobalSize Kglobal, LocalSize Ki, LocalSize Kj, EdgeData data, Vector* Di, Vector* Dj)
 {
 	m_type = data.m_type;
 
@@ -444,26 +450,26 @@ inline void TypeGeneral::Edge::Initialize(GlobalSize Kglobal, LocalSize Ki, Loca
 	{
 		case POTTS:
 			((EdgePotts*)this)->m_lambdaPotts = data.m_lambdaPotts;
-			m_message = (Vector*)((char*)this + sizeof(EdgePotts));
+			m_messageOffset = sizeof(EdgePotts);
 			break;
 		case GENERAL:
 			((EdgeGeneral*)this)->m_dir = 0;
 			memcpy(((EdgeGeneral*)this)->m_data, data.m_dataGeneral, Ki.m_K*Kj.m_K*sizeof(REAL));
-			m_message = (Vector*)((char*)this + sizeof(EdgeGeneral) - sizeof(REAL) + Ki.m_K*Kj.m_K*sizeof(REAL));
+			m_messageOffset = sizeof(EdgeGeneral) - sizeof(REAL) + Ki.m_K*Kj.m_K*sizeof(REAL);
 			break;
 		default:
 			assert(0);
 	}
 
-	memset(m_message->m_data, 0, ((Ki.m_K > Kj.m_K) ? Ki.m_K : Kj.m_K)*sizeof(REAL));
+	memset(GetMessagePtr()->m_data, 0, ((Ki.m_K > Kj.m_K) ? Ki.m_K : Kj.m_K)*sizeof(REAL));
 }
 
-inline TypeGeneral::Vector* TypeGeneral::Edge::GetMessagePtr()
+template <class R> inline typename TypeGeneralT<R>::Vector* TypeGeneralT<R>::Edge::GetMessagePtr()
 {
-	return m_message;
+	return (Vector*)((char*)this + m_messageOffset);
 }
 
-inline void TypeGeneral::Edge::Swap(GlobalSize Kglobal, LocalSize Ki, LocalSize Kj)
+template <class R> inline void TypeGeneralT<R>::Edge::Swap(GlobalSize Kglobal, LocalSize Ki, LocalSize Kj)
 {
 	if (m_type == GENERAL)
 	{
@@ -471,9 +477,10 @@ inline void TypeGeneral::Edge::Swap(GlobalSize Kglobal, LocalSize Ki, LocalSize
 	}
 }
 
-inline TypeGeneral::REAL TypeGeneral::Edge::UpdateMessage(GlobalSize Kglobal, LocalSize Ksource, LocalSize Kdest, Vector* source, REAL gamma, int dir, void* _buf)
+template <class R> inline typename TypeGeneralT<R>::REAL TypeGeneralT<R>::Edge::UpdateMessage(GlobalSize Kglobal, LocalSize Ksource, LocalSize Kdest, Vector* source, REAL gamma, int dir, void* _buf)
 {
 	Vector* buf = (Vector*) _buf;
+	Vector* message = GetMessagePtr();
 	REAL vMin;
 
 	if (m_type == POTTS)
@@ -482,28 +489,28 @@ inline TypeGeneral::REAL TypeGeneral::Edge::UpdateMessage(GlobalSize Kglobal, Lo
 
 		int k, kMin;
 
-		m_message->m_data[0] = gamma*source->m_data[0] - m_message->m_data[0];
+		message->m_data[0] = gamma*source->m_data[0] - message->m_data[0];
 		kMin = 0;
-		vMin = m_message->m_data[0];
+		vMin = message->m_data[0];
 
 		for (k=1; k<Ksource.m_K; k++)
 		{
-			m_message->m_data[k] = gamma*source->m_data[k] - m_message->m_data[k];
+			message->m_data[k] = gamma*source->m_data[k] - message->m_data[k];
 			kMin = 0;
 			vMin = buf->m_data[0];
-			if (vMin > m_message->m_data[k])
+			if (vMin > message->m_data[k])
 			{
 				kMin = k;
-				vMin = m_message->m_data[k];
+				vMin = message->m_data[k];
 			}
 		}
 
 		for (k=0; k<Ksource.m_K; k++)
 		{
-			m_message->m_data[k] -= vMin;
-			if (m_message->m_data[k] > ((EdgePotts*)this)->m_lambdaPotts)
+			message->m_data[k] -= vMin;
+			if (message->m_data[k] > ((EdgePotts*)this)->m_lambdaPotts)
 			{
-				m_message->m_data[k] = ((EdgePotts*)this)->m_lambdaPotts;
+				message->m_data[k] = ((EdgePotts*)this)->m_lambdaPotts;
 			}
 		}
 	}
@@ -514,7 +521,7 @@ inline TypeGeneral::REAL TypeGeneral::Edge::UpdateMessage(GlobalSize Kglobal, Lo
 
 		for (ksource=0; ksource<Ksource.m_K; ksource++)
 		{
-			buf->m_data[ksource] = gamma*source->m_data[ksource] - m_message->m_data[ksource];
+			buf->m_data[ksource] = gamma*source->m_data[ksource] - message->m_data[ksource];
 		}
 
 		if (dir == ((EdgeGeneral*)this)->m_dir)
@@ -529,7 +536,7 @@ inline TypeGeneral::REAL TypeGeneral::Edge::UpdateMessage(GlobalSize Kglobal, Lo
 						vMin = buf->m_data[ksource] + data[ksource + kdest*Ksource.m_K];
 					}
 				}
-				m_message->m_data[kdest] = vMin;
+				message->m_data[kdest] = vMin;
 			}
 		}
 		else
@@ -544,22 +551,22 @@ inline TypeGeneral::REAL TypeGeneral::Edge::UpdateMessage(GlobalSize Kglobal, Lo
 						vMin = buf->m_data[ksource] + data[kdest + ksource*Kdest.m_K];
 					}
 				}
-				m_message->m_data[kdest] = vMin;
+				message->m_data[kdest] = vMin;
 			}
 		}
 
-		vMin = m_message->m_data[0];
+		vMin = message->m_data[0];
 		for (kdest=1; kdest<Kdest.m_K; kdest++)
 		{
-			if (vMin > m_message->m_data[kdest])
+			if (vMin > message->m_data[kdest])
 			{
-				vMin = m_message->m_data[kdest];
+				vMin = message->m_data[kdest];
 			}
 		}
 
 		for (kdest=0; kdest<Kdest.m_K; kdest++)
 		{
-			m_message->m_data[kdest] -= vMin;
+			message->m_data[kdest] -= vMin;
 		}
 	}
 	else
@@ -570,7 +577,7 @@ inline TypeGeneral::REAL TypeGeneral::Edge::UpdateMessage(GlobalSize Kglobal, Lo
 	return vMin;
 }
 
-inline void TypeGeneral::Edge::AddColumn(GlobalSize Kglobal, LocalSize Ksource, LocalSize Kdest, Label ksource, Vector* dest, int dir)
+template <class R> inline void TypeGeneralT<R>::Edge::AddColumn(GlobalSize Kglobal, LocalSize Ksource, LocalSize Kdest, Label ksource, Vector* dest, int dir)
 {
 	assert(ksource>=0 && ksource<Ksource.m_K);
 
@@ -7,6 +7,9 @@ Energy function with Potts interactions:
    V_ij(ki, kj) = 0 if ki==kj, and lambda_ij otherwise.
    lambda_ij must be non-negative.
 
+   TypePottsFloat stores the parameters and the messages in single precision,
+   the lower bound and the energy are still accumulated in double.
+
 Example usage:
 
 Minimize function E(x,y) = Dx(x) + Dy(y) + lambda*[x != y] where 
@@ -98,12 +101,13 @@ void testPotts()
 
 #include <string.h>
 #include <assert.h>
+#include "typePottsSimd.h"
 
 
 template <class T> class MRFEnergy;
 
 
-class TypePotts
+template <class R> class TypePottsT
 {
 private:
 	struct Vector; // node parameters and messages
@@ -112,7 +116,7 @@ private:
 public:
 	// types declarations
 	typedef int Label;
-	typedef double REAL;
+	typedef R REAL;
 	struct GlobalSize; // global information about number of labels
 	struct LocalSize; // local information about number of labels (stored at each node)
 	struct NodeData; // argument to MRFEnergy::AddNode()
@@ -164,7 +168,7 @@ public:
 	//////////////////////////////////////////////////////////////////////////////////
 
 private:
-friend class MRFEnergy<TypePotts>;
+friend class MRFEnergy<TypePottsT<R> >;
 
 	struct Vector
 	{
@@ -187,7 +191,7 @@ friend class MRFEnergy<TypePotts>;
 
 	private:
 	friend struct Edge;
-		REAL		m_data[1]; // actual size is MRFEnergy::m_Kglobal
+		REAL		m_data[1]; // actual size is MRFEnergy::m_Kglobal padded with zeros to a multiple of POTTS_SIMD_PADDING_BYTES
 	};
 
 	struct Edge
@@ -239,6 +243,9 @@ friend class MRFEnergy<TypePotts>;
 	};
 };
 
+typedef TypePottsT<double> TypePotts;
+typedef TypePottsT<float> TypePottsFloat;
+
 
 
 
@@ -247,39 +254,40 @@ friend class MRFEnergy<TypePotts>;
 //////////////////////////////////////////////////////////////////////////////////
 
 
-inline TypePotts::GlobalSize::GlobalSize(int K)
+template <class R> inline TypePottsT<R>::GlobalSize::GlobalSize(int K)
 {
 	m_K = K;
 }
 
 ///////////////////// NodeData and EdgeData ///////////////////////
 
-inline TypePotts::NodeData::NodeData(REAL* data)
+template <class R> inline TypePottsT<R>::NodeData::NodeData(REAL* data)
 {
 	m_data = data;
 }
 
-inline TypePotts::EdgeData::EdgeData(REAL lambdaPotts)
+template <class R> inline TypePottsT<R>::EdgeData::EdgeData(REAL lambdaPotts)
 {
 	m_lambdaPotts = lambdaPotts;
 }
 
 ///////////////////// Vector ///////////////////////
 
-inline int TypePotts::Vector::GetSizeInBytes(GlobalSize Kglobal, LocalSize K)
+template <class R> inline int TypePottsT<R>::Vector::GetSizeInBytes(GlobalSize Kglobal, LocalSize K)
 {
 	if (Kglobal.m_K < 1)
 	{
 		return -1;
 	}
-	return Kglobal.m_K*sizeof(REAL);
+	return PottsSimdPaddedSize<REAL>(Kglobal.m_K)*sizeof(REAL);
 }
-inline void TypePotts::Vector::Initialize(GlobalSize Kglobal, LocalSize K, NodeData data)
+template <class R> inline void TypePottsT<R>::Vector::Initialize(GlobalSize Kglobal, LocalSize K, NodeData data)
 {
 	memcpy(m_data, data.m_data, Kglobal.m_K*sizeof(REAL));
+	memset(m_data + Kglobal.m_K, 0, (PottsSimdPaddedSize<REAL>(Kglobal.m_K) - Kglobal.m_K)*sizeof(REAL));
 }
 
-inline void TypePotts::Vector::Add(GlobalSize Kglobal, LocalSize K, NodeData data)
+template <class R> inline void TypePottsT<R>::Vector::Add(GlobalSize Kglobal, LocalSize K, NodeData data)
 {
 	for (int k=0; k<Kglobal.m_K; k++)
 	{
@@ -287,76 +295,60 @@ inline void TypePotts::Vector::Add(GlobalSize Kglobal, LocalSize K, NodeData dat
 	}
 }
 
-inline void TypePotts::Vector::SetZero(GlobalSize Kglobal, LocalSize K)
+template <class R> inline void TypePottsT<R>::Vector::SetZero(GlobalSize Kglobal, LocalSize K)
 {
-	memset(m_data, 0, Kglobal.m_K*sizeof(REAL));
+	memset(m_data, 0, PottsSimdPaddedSize<REAL>(Kglobal.m_K)*sizeof(REAL));
 }
 
-inline void TypePotts::Vector::Copy(GlobalSize Kglobal, LocalSize K, Vector* V)
+template <class R> inline void TypePottsT<R>::Vector::Copy(GlobalSize Kglobal, LocalSize K, Vector* V)
 {
-	memcpy(m_data, V->m_data, Kglobal.m_K*sizeof(REAL));
+	memcpy(m_data, V->m_data, PottsSimdPaddedSize<REAL>(Kglobal.m_K)*sizeof(REAL));
 }
 
-inline void TypePotts::Vector::Add(GlobalSize Kglobal, LocalSize K, Vector* V)
+template <class R> inline void TypePottsT<R>::Vector::Add(GlobalSize Kglobal, LocalSize K, Vector* V)
 {
-	for (int k=0; k<Kglobal.m_K; k++)
-	{
-		m_data[k] += V->m_data[k];
-	}
+	PottsSimdAdd(m_data, V->m_data, PottsSimdPaddedSize<REAL>(Kglobal.m_K));
 }
 
-inline TypePotts::REAL TypePotts::Vector::GetValue(GlobalSize Kglobal, LocalSize K, Label k)
+template <class R> inline typename TypePottsT<R>::REAL TypePottsT<R>::Vector::GetValue(GlobalSize Kglobal, LocalSize K, Label k)
 {
 	assert(k>=0 && k<Kglobal.m_K);
 	return m_data[k];
 }
 
-inline TypePotts::REAL TypePotts::Vector::ComputeMin(GlobalSize Kglobal, LocalSize K, Label& kMin)
+template <class R> inline typename TypePottsT<R>::REAL TypePottsT<R>::Vector::ComputeMin(GlobalSize Kglobal, LocalSize K, Label& kMin)
 {
-	REAL vMin = m_data[0];
-	kMin = 0;
-	for (int k=1; k<Kglobal.m_K; k++)
+	REAL vMin = PottsSimdMin(m_data, Kglobal.m_K);
+
+	// the first label with the minimal value
+	for (kMin=0; kMin<Kglobal.m_K-1; kMin++)
 	{
-		if (vMin > m_data[k])
-		{
-			vMin = m_data[k];
-			kMin = k;
-		}
+		if (m_data[kMin] == vMin) break;
 	}
 
 	return vMin;
 }
 
-inline TypePotts::REAL TypePotts::Vector::ComputeAndSubtractMin(GlobalSize Kglobal, LocalSize K)
+template <class R> inline typename TypePottsT<R>::REAL TypePottsT<R>::Vector::ComputeAndSubtractMin(GlobalSize Kglobal, LocalSize K)
 {
-	REAL vMin = m_data[0];
-	for (int k=1; k<Kglobal.m_K; k++)
-	{
-		if (vMin > m_data[k])
-		{
-			vMin = m_data[k];
-		}
-	}
-	for (int k=0; k<Kglobal.m_K; k++)
-	{
-		m_data[k] -= vMin;
-	}
+	REAL vMin = PottsSimdMin(m_data, Kglobal.m_K);
+	PottsSimdSubtract(m_data, vMin, Kglobal.m_K);
 
 	return vMin;
 }
 
-inline int TypePotts::Vector::GetArraySize(GlobalSize Kglobal, LocalSize K)
+template <class R> inline int TypePottsT<R>::Vector::GetArraySize(GlobalSize Kglobal, LocalSize K)
 {
 	return Kglobal.m_K;
 }
 
-inline TypePotts::REAL TypePotts::Vector::GetArrayValue(GlobalSize Kglobal, LocalSize K, int k)
+template <class R> inline typename TypePottsT<R>::REAL TypePottsT<R>::Vector::GetArrayValue(GlobalSize Kglobal, LocalSize K, int k)
 {
 	assert(k>=0 && k<Kglobal.m_K);
 	return m_data[k];
 }
 
-inline void TypePotts::Vector::SetArrayValue(GlobalSize Kglobal, LocalSize K, int k, REAL x)
+template <class R> inline void TypePottsT<R>::Vector::SetArrayValue(GlobalSize Kglobal, LocalSize K, int k, REAL x)
 {
 	assert(k>=0 && k<Kglobal.m_K);
 	m_data[k] = x;
@@ -364,65 +356,49 @@ inline void TypePotts::Vector::SetArrayValue(GlobalSize Kglobal, LocalSize K, in
 
 ///////////////////// EdgeDataAndMessage implementation /////////////////////////
 
-inline int TypePotts::Edge::GetSizeInBytes(GlobalSize Kglobal, LocalSize Ki, LocalSize Kj, EdgeData data)
+template <class R> inline int TypePottsT<R>::Edge::GetSizeInBytes(GlobalSize Kglobal, LocalSize Ki, LocalSize Kj, EdgeData data)
 {
 	if (data.m_lambdaPotts < 0)
 	{
 		return -1;
 	}
-	return sizeof(Edge) - sizeof(Vector) + Kglobal.m_K*sizeof(REAL);
+	return sizeof(Edge) - sizeof(Vector) + PottsSimdPaddedSize<REAL>(Kglobal.m_K)*sizeof(REAL);
 }
 
-inline int TypePotts::Edge::GetBufSizeInBytes(int vectorMaxSizeInBytes)
+template <class R> inline int TypePottsT<R>::Edge::GetBufSizeInBytes(int vectorMaxSizeInBytes)
 {
 	return 0;
 }
 
-inline void TypePotts::Edge::Initialize(GlobalSize Kglobal, LocalSize Ki, LocalSize Kj, EdgeData data, Vector* Di, Vector* Dj)
+template <class R> inline void TypePottsT<R>::Edge::Initialize(GlobalSize Kglobal, LocalSize Ki, LocalSize Kj, EdgeData data, Vector* Di, Vector* Dj)
 {
 	m_lambdaPotts = data.m_lambdaPotts;
-	memset(m_message.m_data, 0, Kglobal.m_K*sizeof(REAL));
+	memset(m_message.m_data, 0, PottsSimdPaddedSize<REAL>(Kglobal.m_K)*sizeof(REAL));
 }
 
-inline TypePotts::Vector* TypePotts::Edge::GetMessagePtr()
+template <class R> inline typename TypePottsT<R>::Vector* TypePottsT<R>::Edge::GetMessagePtr()
 {
 	return &m_message;
 }
 
-inline void TypePotts::Edge::Swap(GlobalSize Kglobal, LocalSize Ki, LocalSize Kj)
+template <class R> inline void TypePottsT<R>::Edge::Swap(GlobalSize Kglobal, LocalSize Ki, LocalSize Kj)
 {
 }
 
-inline TypePotts::REAL TypePotts::Edge::UpdateMessage(GlobalSize Kglobal, LocalSize Ksource, LocalSize Kdest, Vector* source, REAL gamma, int dir, void* buf)
+template <class R> inline typename TypePottsT<R>::REAL TypePottsT<R>::Edge::UpdateMessage(GlobalSize Kglobal, LocalSize Ksource, LocalSize Kdest, Vector* source, REAL gamma, int dir, void* buf)
 {
-	int k;
 	REAL vMin;
 
-	m_message.m_data[0] = gamma*source->m_data[0] - m_message.m_data[0];
-	vMin = m_message.m_data[0];
-
-	for (k=1; k<Kglobal.m_K; k++)
-	{
-		m_message.m_data[k] = gamma*source->m_data[k] - m_message.m_data[k];
-		if (vMin > m_message.m_data[k])
-		{
-			vMin = m_message.m_data[k];
-		}
-	}
+	// m_message[k] = gamma*source[k] - m_message[k], vMin = min_k m_message[k]
+	vMin = PottsSimdDiffMin(m_message.m_data, source->m_data, gamma, Kglobal.m_K);
 
-	for (k=0; k<Kglobal.m_K; k++)
-	{
-		m_message.m_data[k] -= vMin;
-		if (m_message.m_data[k] > m_lambdaPotts)
-		{
-			m_message.m_data[k] = m_lambdaPotts;
-		}
-	}
+	// m_message[k] = min(m_message[k] - vMin, lambda)
+	PottsSimdSubtractTruncate(m_message.m_data, vMin, m_lambdaPotts, Kglobal.m_K);
 
 	return vMin;
 }
 
-inline void TypePotts::Edge::AddColumn(GlobalSize Kglobal, LocalSize Ksource, LocalSize Kdest, Label ksource, Vector* dest, int dir)
+template <class R> inline void TypePottsT<R>::Edge::AddColumn(GlobalSize Kglobal, LocalSize Ksource, LocalSize Kdest, Label ksource, Vector* dest, int dir)
 {
 	assert(ksource>=0 && ksource<Kglobal.m_K);
 
@@ -0,0 +1,434 @@
+/******************************************************************
+typePottsSimd.h
+
+Vectorized loops over labels used by TypePotts (see typePotts.h), for REAL = double and REAL = float.
+The registers and the dispatch are also used by the Viterbi solver of viterbiPottsMex.
+
+The loops are compiled for SSE2, AVX2 and AVX-512; the widest instruction set
+supported by the CPU is selected at run time. The environment variable
+SMR_POTTS_SIMD limits the selection: 0 - scalar loops, 1 - SSE2, 2 - AVX2, 3 - AVX-512.
+
+Vectors of TypePotts are padded with zeros to a multiple of POTTS_SIMD_PADDING_BYTES,
+so that all loads of whole registers stay inside the vectors and PottsSimdAdd() needs no tail.
+The other functions use only the first K values and keep the padding equal to zero.
+
+The functions perform the same floating point operations as the scalar loops in the same
+order for every label, so the results do not depend on the selected instruction set.
+*******************************************************************/
+
+#ifndef __TYPEPOTTSSIMD_H__
+#define __TYPEPOTTSSIMD_H__
+
+#include <stdlib.h>
+#include <limits>
+
+#define POTTS_SIMD_PADDING_BYTES 64 // size of a 512-bit register
+
+#if defined(__GNUC__) && (defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__)))
+	#define POTTS_SIMD_X86
+	#define POTTS_SIMD_TARGET(isa) __attribute__((target(isa)))
+	#include <immintrin.h>
+#elif defined(_MSC_VER) && (defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+	#define POTTS_SIMD_X86
+	#define POTTS_SIMD_TARGET(isa)
+	#include <intrin.h>
+	#include <immintrin.h>
+#endif
+
+enum PottsSimdLevel
+{
+	POTTS_SIMD_SCALAR = 0,
+	POTTS_SIMD_SSE2 = 1,
+	POTTS_SIMD_AVX2 = 2,
+	POTTS_SIMD_AVX512 = 3
+};
+
+// number of values in a vector of K labels including the padding
+template <class REAL> inline int PottsSimdPaddedSize(int K)
+{
+	const int padding = POTTS_SIMD_PADDING_BYTES / sizeof(REAL);
+	return (K + padding - 1) / padding * padding;
+}
+
+inline int DetectPottsSimdLevel()
+{
+	int level = POTTS_SIMD_SCALAR;
+#if defined(POTTS_SIMD_X86) && defined(__GNUC__)
+	__builtin_cpu_init();
+	level = POTTS_SIMD_SSE2;
+	if (__builtin_cpu_supports("avx2")) level = POTTS_SIMD_AVX2;
+	if (__builtin_cpu_supports("avx512f")) level = POTTS_SIMD_AVX512;
+#elif defined(POTTS_SIMD_X86)
+	level = POTTS_SIMD_SSE2;
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] >= 7)
+	{
+		__cpuid(info, 1);
+		bool osxsave = (info[2] & (1 << 27)) != 0;
+		unsigned long long xcr0 = osxsave ? _xgetbv(0) : 0;
+		__cpuidex(info, 7, 0);
+		if ((xcr0 & 0x6) == 0x6 && (info[1] & (1 << 5))) level = POTTS_SIMD_AVX2; // YMM state, AVX2
+		if ((xcr0 & 0xe6) == 0xe6 && (info[1] & (1 << 16))) level = POTTS_SIMD_AVX512; // ZMM state, AVX-512F
+	}
+#endif
+	const char* envValue = getenv("SMR_POTTS_SIMD");
+	if (envValue != NULL)
+	{
+		int maxLevel = atoi(envValue);
+		if (maxLevel >= POTTS_SIMD_SCALAR && maxLevel < level) level = maxLevel;
+	}
+	return level;
+}
+
+inline int GetPottsSimdLevel()
+{
+	static const int level = DetectPottsSimdLevel();
+	return level;
+}
+
+///////////////////// scalar loops ///////////////////////
+
+// x[k] += y[k], k < N
+template <class REAL> inline void PottsAddScalar(REAL* x, const REAL* y, int N)
+{
+	for (int k=0; k<N; k++)
+	{
+		x[k] += y[k];
+	}
+}
+
+// returns min_k x[k], k < K
+template <class REAL> inline REAL PottsMinScalar(const REAL* x, int K)
+{
+	REAL vMin = std::numeric_limits<REAL>::infinity();
+	for (int k=0; k<K; k++)
+	{
+		if (vMin > x[k]) vMin = x[k];
+	}
+	return vMin;
+}
+
+// x[k] -= v, k < K
+template <class REAL> inline void PottsSubtractScalar(REAL* x, REAL v, int K)
+{
+	for (int k=0; k<K; k++)
+	{
+		x[k] -= v;
+	}
+}
+
+// m[k] = gamma*s[k] - m[k], returns min_k m[k], k < K
+template <class REAL> inline REAL PottsDiffMinScalar(REAL* m, const REAL* s, REAL gamma, int K)
+{
+	REAL vMin = std::numeric_limits<REAL>::infinity();
+	for (int k=0; k<K; k++)
+	{
+		m[k] = gamma*s[k] - m[k];
+		if (vMin > m[k]) vMin = m[k];
+	}
+	return vMin;
+}
+
+// m[k] = min(m[k] - v, lambda), k < K
+template <class REAL> inline void PottsSubtractTruncateScalar(REAL* m, REAL v, REAL lambda, int K)
+{
+	for (int k=0; k<K; k++)
+	{
+		m[k] -= v;
+		if (m[k] > lambda) m[k] = lambda;
+	}
+}
+
+#ifdef POTTS_SIMD_X86
+
+///////////////////// registers ///////////////////////
+// Select(n, a, b) takes the first n lanes from a and the others from b.
+// LessMask(a, b) has bit j set if lane j of a is less than lane j of b.
+
+struct PottsSse2Double
+{
+	typedef double REAL;
+	typedef __m128d V;
+	enum { W = 2 };
+	static POTTS_SIMD_TARGET("sse2") V Load(const REAL* x) { return _mm_loadu_pd(x); }
+	static POTTS_SIMD_TARGET("sse2") void Store(REAL* x, V v) { _mm_storeu_pd(x, v); }
+	static POTTS_SIMD_TARGET("sse2") V Set1(REAL a) { return _mm_set1_pd(a); }
+	static POTTS_SIMD_TARGET("sse2") V Add(V a, V b) { return _mm_add_pd(a, b); }
+	static POTTS_SIMD_TARGET("sse2") V Sub(V a, V b) { return _mm_sub_pd(a, b); }
+	static POTTS_SIMD_TARGET("sse2") V Mul(V a, V b) { return _mm_mul_pd(a, b); }
+	static POTTS_SIMD_TARGET("sse2") V Min(V a, V b) { return _mm_min_pd(a, b); }
+	static POTTS_SIMD_TARGET("sse2") V Max(V a, V b) { return _mm_max_pd(a, b); }
+	static POTTS_SIMD_TARGET("sse2") int LessMask(V a, V b) { return _mm_movemask_pd(_mm_cmplt_pd(a, b)); }
+	static POTTS_SIMD_TARGET("sse2") V Select(int n, V a, V b)
+	{
+		__m128d mask = _mm_cmplt_pd(_mm_set_pd(1, 0), _mm_set1_pd(n));
+		return _mm_or_pd(_mm_and_pd(mask, a), _mm_andnot_pd(mask, b));
+	}
+	static POTTS_SIMD_TARGET("sse2") REAL HorizontalMin(V v)
+	{
+		v = _mm_min_pd(v, _mm_unpackhi_pd(v, v));
+		return _mm_cvtsd_f64(v);
+	}
+};
+
+struct PottsSse2Float
+{
+	typedef float REAL;
+	typedef __m128 V;
+	enum { W = 4 };
+	static POTTS_SIMD_TARGET("sse2") V Load(const REAL* x) { return _mm_loadu_ps(x); }
+	static POTTS_SIMD_TARGET("sse2") void Store(REAL* x, V v) { _mm_storeu_ps(x, v); }
+	static POTTS_SIMD_TARGET("sse2") V Set1(REAL a) { return _mm_set1_ps(a); }
+	static POTTS_SIMD_TARGET("sse2") V Add(V a, V b) { return _mm_add_ps(a, b); }
+	static POTTS_SIMD_TARGET("sse2") V Sub(V a, V b) { return _mm_sub_ps(a, b); }
+	static POTTS_SIMD_TARGET("sse2") V Mul(V a, V b) { return _mm_mul_ps(a, b); }
+	static POTTS_SIMD_TARGET("sse2") V Min(V a, V b) { return _mm_min_ps(a, b); }
+	static POTTS_SIMD_TARGET("sse2") V Max(V a, V b) { return _mm_max_ps(a, b); }
+	static POTTS_SIMD_TARGET("sse2") int LessMask(V a, V b) { return _mm_movemask_ps(_mm_cmplt_ps(a, b)); }
+	static POTTS_SIMD_TARGET("sse2") V Select(int n, V a, V b)
+	{
+		__m128 mask = _mm_cmplt_ps(_mm_set_ps(3, 2, 1, 0), _mm_set1_ps((float)n));
+		return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+	}
+	static POTTS_SIMD_TARGET("sse2") REAL HorizontalMin(V v)
+	{
+		v = _mm_min_ps(v, _mm_movehl_ps(v, v));
+		v = _mm_min_ps(v, _mm_shuffle_ps(v, v, 1));
+		return _mm_cvtss_f32(v);
+	}
+};
+
+struct PottsAvx2Double
+{
+	typedef double REAL;
+	typedef __m256d V;
+	enum { W = 4 };
+	static POTTS_SIMD_TARGET("avx2") V Load(const REAL* x) { return _mm256_loadu_pd(x); }
+	static POTTS_SIMD_TARGET("avx2") void Store(REAL* x, V v) { _mm256_storeu_pd(x, v); }
+	static POTTS_SIMD_TARGET("avx2") V Set1(REAL a) { return _mm256_set1_pd(a); }
+	static POTTS_SIMD_TARGET("avx2") V Add(V a, V b) { return _mm256_add_pd(a, b); }
+	static POTTS_SIMD_TARGET("avx2") V Sub(V a, V b) { return _mm256_sub_pd(a, b); }
+	static POTTS_SIMD_TARGET("avx2") V Mul(V a, V b) { return _mm256_mul_pd(a, b); }
+	static POTTS_SIMD_TARGET("avx2") V Min(V a, V b) { return _mm256_min_pd(a, b); }
+	static POTTS_SIMD_TARGET("avx2") V Max(V a, V b) { return _mm256_max_pd(a, b); }
+	static POTTS_SIMD_TARGET("avx2") int LessMask(V a, V b) { return _mm256_movemask_pd(_mm256_cmp_pd(a, b, _CMP_LT_OQ)); }
+	static POTTS_SIMD_TARGET("avx2") V Select(int n, V a, V b)
+	{
+		return _mm256_blendv_pd(b, a, _mm256_cmp_pd(_mm256_set_pd(3, 2, 1, 0), _mm256_set1_pd(n), _CMP_LT_OQ));
+	}
+	static POTTS_SIMD_TARGET("avx2") REAL HorizontalMin(V v)
+	{
+		__m128d w = _mm_min_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+		w = _mm_min_pd(w, _mm_unpackhi_pd(w, w));
+		return _mm_cvtsd_f64(w);
+	}
+};
+
+struct PottsAvx2Float
+{
+	typedef float REAL;
+	typedef __m256 V;
+	enum { W = 8 };
+	static POTTS_SIMD_TARGET("avx2") V Load(const REAL* x) { return _mm256_loadu_ps(x); }
+	static POTTS_SIMD_TARGET("avx2") void Store(REAL* x, V v) { _mm256_storeu_ps(x, v); }
+	static POTTS_SIMD_TARGET("avx2") V Set1(REAL a) { return _mm256_set1_ps(a); }
+	static POTTS_SIMD_TARGET("avx2") V Add(V a, V b) { return _mm256_add_ps(a, b); }
+	static POTTS_SIMD_TARGET("avx2") V Sub(V a, V b) { return _mm256_sub_ps(a, b); }
+	static POTTS_SIMD_TARGET("avx2") V Mul(V a, V b) { return _mm256_mul_ps(a, b); }
+	static POTTS_SIMD_TARGET("avx2") V Min(V a, V b) { return _mm256_min_ps(a, b); }
+	static POTTS_SIMD_TARGET("avx2") V Max(V a, V b) { return _mm256_max_ps(a, b); }
+	static POTTS_SIMD_TARGET("avx2") int LessMask(V a, V b) { return _mm256_movemask_ps(_mm256_cmp_ps(a, b, _CMP_LT_OQ)); }
+	static POTTS_SIMD_TARGET("avx2") V Select(int n, V a, V b)
+	{
+		return _mm256_blendv_ps(b, a, _mm256_cmp_ps(_mm256_set_ps(7, 6, 5, 4, 3, 2, 1, 0), _mm256_set1_ps((float)n), _CMP_LT_OQ));
+	}
+	static POTTS_SIMD_TARGET("avx2") REAL HorizontalMin(V v)
+	{
+		__m128 w = _mm_min_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+		w = _mm_min_ps(w, _mm_movehl_ps(w, w));
+		w = _mm_min_ps(w, _mm_shuffle_ps(w, w, 1));
+		return _mm_cvtss_f32(w);
+	}
+};
+
+struct PottsAvx512Double
+{
+	typedef double REAL;
+	typedef __m512d V;
+	enum { W = 8 };
+	static POTTS_SIMD_TARGET("avx512f") V Load(const REAL* x) { return _mm512_loadu_pd(x); }
+	static POTTS_SIMD_TARGET("avx512f") void Store(REAL* x, V v) { _mm512_storeu_pd(x, v); }
+	static POTTS_SIMD_TARGET("avx512f") V Set1(REAL a) { return _mm512_set1_pd(a); }
+	static POTTS_SIMD_TARGET("avx512f") V Add(V a, V b) { return _mm512_add_pd(a, b); }
+	static POTTS_SIMD_TARGET("avx512f") V Sub(V a, V b) { return _mm512_sub_pd(a, b); }
+	// the zero-masked forms with the full mask compile to the plain instructions; the unmasked intrinsics of GCC pass _mm512_undefined_pd(),
+	// which produces false -Wmaybe-uninitialized warnings
+	static POTTS_SIMD_TARGET("avx512f") V Mul(V a, V b) { return _mm512_maskz_mul_round_pd((__mmask8)0xFF, a, b, _MM_FROUND_CUR_DIRECTION); } // not contracted to FMA
+	static POTTS_SIMD_TARGET("avx512f") V Min(V a, V b) { return _mm512_maskz_min_pd((__mmask8)0xFF, a, b); }
+	static POTTS_SIMD_TARGET("avx512f") V Max(V a, V b) { return _mm512_maskz_max_pd((__mmask8)0xFF, a, b); }
+	static POTTS_SIMD_TARGET("avx512f") int LessMask(V a, V b) { return (int)_mm512_cmp_pd_mask(a, b, _CMP_LT_OQ); }
+	static POTTS_SIMD_TARGET("avx512f") V Select(int n, V a, V b)
+	{
+		return (n >= W) ? a : _mm512_mask_blend_pd((__mmask8)((1u << n) - 1), b, a);
+	}
+	static POTTS_SIMD_TARGET("avx512f") REAL HorizontalMin(V v)
+	{
+		// the halves are reduced through memory, the 512-bit extracts produce the same false warnings as above
+		alignas(64) REAL x[W];
+		_mm512_store_pd(x, v);
+		__m256d u = _mm256_min_pd(_mm256_load_pd(x), _mm256_load_pd(x + 4));
+		__m128d w = _mm_min_pd(_mm256_castpd256_pd128(u), _mm256_extractf128_pd(u, 1));
+		w = _mm_min_pd(w, _mm_unpackhi_pd(w, w));
+		return _mm_cvtsd_f64(w);
+	}
+};
+
+struct PottsAvx512Float
+{
+	typedef float REAL;
+	typedef __m512 V;
+	enum { W = 16 };
+	static POTTS_SIMD_TARGET("avx512f") V Load(const REAL* x) { return _mm512_loadu_ps(x); }
+	static POTTS_SIMD_TARGET("avx512f") void Store(REAL* x, V v) { _mm512_storeu_ps(x, v); }
+	static POTTS_SIMD_TARGET("avx512f") V Set1(REAL a) { return _mm512_set1_ps(a); }
+	static POTTS_SIMD_TARGET("avx512f") V Add(V a, V b) { return _mm512_add_ps(a, b); }
+	static POTTS_SIMD_TARGET("avx512f") V Sub(V a, V b) { return _mm512_sub_ps(a, b); }
+	static POTTS_SIMD_TARGET("avx512f") V Mul(V a, V b) { return _mm512_maskz_mul_round_ps((__mmask16)0xFFFF, a, b, _MM_FROUND_CUR_DIRECTION); } // not contracted to FMA
+	static POTTS_SIMD_TARGET("avx512f") V Min(V a, V b) { return _mm512_maskz_min_ps((__mmask16)0xFFFF, a, b); }
+	static POTTS_SIMD_TARGET("avx512f") V Max(V a, V b) { return _mm512_maskz_max_ps((__mmask16)0xFFFF, a, b); }
+	static POTTS_SIMD_TARGET("avx512f") int LessMask(V a, V b) { return (int)_mm512_cmp_ps_mask(a, b, _CMP_LT_OQ); }
+	static POTTS_SIMD_TARGET("avx512f") V Select(int n, V a, V b)
+	{
+		return (n >= W) ? a : _mm512_mask_blend_ps((__mmask16)((1u << n) - 1), b, a);
+	}
+	static POTTS_SIMD_TARGET("avx512f") REAL HorizontalMin(V v)
+	{
+		alignas(64) REAL x[W];
+		_mm512_store_ps(x, v);
+		__m256 u = _mm256_min_ps(_mm256_load_ps(x), _mm256_load_ps(x + 8));
+		__m128 w = _mm_min_ps(_mm256_castps256_ps128(u), _mm256_extractf128_ps(u, 1));
+		w = _mm_min_ps(w, _mm_movehl_ps(w, w));
+		w = _mm_min_ps(w, _mm_shuffle_ps(w, w, 1));
+		return _mm_cvtss_f32(w);
+	}
+};
+
+template <class REAL> struct PottsSimdRegisters;
+template <> struct PottsSimdRegisters<double> { typedef PottsSse2Double Sse2; typedef PottsAvx2Double Avx2; typedef PottsAvx512Double Avx512; };
+template <> struct PottsSimdRegisters<float>  { typedef PottsSse2Float  Sse2; typedef PottsAvx2Float  Avx2; typedef PottsAvx512Float  Avx512; };
+
+///////////////////// vectorized loops ///////////////////////
+// The same loops are compiled for every instruction set, S is one of the register structs above.
+// The last register of a vector of K values is partially filled: its other lanes are read from the padding,
+// they are replaced by +inf when computing the minimum and are written back unchanged.
+
+#define POTTS_SIMD_LOOPS(ISA, TARGET) \
+template <class S> POTTS_SIMD_TARGET(TARGET) inline void PottsAdd##ISA(typename S::REAL* x, const typename S::REAL* y, int N) \
+{ \
+	for (int k=0; k<N; k+=S::W) \
+	{ \
+		S::Store(x + k, S::Add(S::Load(x + k), S::Load(y + k))); \
+	} \
+} \
+ \
+template <class S> POTTS_SIMD_TARGET(TARGET) inline typename S::REAL PottsMin##ISA(const typename S::REAL* x, int K) \
+{ \
+	typename S::V vInf = S::Set1(std::numeric_limits<typename S::REAL>::infinity()); \
+	typename S::V vMin = vInf; \
+	for (int k=0; k<K; k+=S::W) \
+	{ \
+		vMin = S::Min(vMin, S::Select(K - k, S::Load(x + k), vInf)); \
+	} \
+	return S::HorizontalMin(vMin); \
+} \
+ \
+template <class S> POTTS_SIMD_TARGET(TARGET) inline void PottsSubtract##ISA(typename S::REAL* x, typename S::REAL v, int K) \
+{ \
+	typename S::V vv = S::Set1(v); \
+	for (int k=0; k<K; k+=S::W) \
+	{ \
+		typename S::V old = S::Load(x + k); \
+		S::Store(x + k, S::Select(K - k, S::Sub(old, vv), old)); \
+	} \
+} \
+ \
+template <class S> POTTS_SIMD_TARGET(TARGET) inline typename S::REAL PottsDiffMin##ISA(typename S::REAL* m, const typename S::REAL* s, typename S::REAL gamma, int K) \
+{ \
+	typename S::V vGamma = S::Set1(gamma); \
+	typename S::V vInf = S::Set1(std::numeric_limits<typename S::REAL>::infinity()); \
+	typename S::V vMin = vInf; \
+	for (int k=0; k<K; k+=S::W) \
+	{ \
+		/* no FMA: the product is rounded as in the scalar loop */ \
+		typename S::V old = S::Load(m + k); \
+		typename S::V d = S::Sub(S::Mul(vGamma, S::Load(s + k)), old); \
+		S::Store(m + k, S::Select(K - k, d, old)); \
+		vMin = S::Min(vMin, S::Select(K - k, d, vInf)); \
+	} \
+	return S::HorizontalMin(vMin); \
+} \
+ \
+template <class S> POTTS_SIMD_TARGET(TARGET) inline void PottsSubtractTruncate##ISA(typename S::REAL* m, typename S::REAL v, typename S::REAL lambda, int K) \
+{ \
+	typename S::V vv = S::Set1(v); \
+	typename S::V vLambda = S::Set1(lambda); \
+	for (int k=0; k<K; k+=S::W) \
+	{ \
+		typename S::V old = S::Load(m + k); \
+		S::Store(m + k, S::Select(K - k, S::Min(S::Sub(old, vv), vLambda), old)); \
+	} \
+}
+
+POTTS_SIMD_LOOPS(Sse2, "sse2")
+POTTS_SIMD_LOOPS(Avx2, "avx2")
+POTTS_SIMD_LOOPS(Avx512, "avx512f")
+
+#undef POTTS_SIMD_LOOPS
+
+#endif // POTTS_SIMD_X86
+
+///////////////////// dispatch ///////////////////////
+
+#ifdef POTTS_SIMD_X86
+	#define POTTS_SIMD_DISPATCH(LOOP, ARGS) \
+		switch (GetPottsSimdLevel()) \
+		{ \
+			case POTTS_SIMD_AVX512: return LOOP##Avx512<typename PottsSimdRegisters<REAL>::Avx512> ARGS; \
+			case POTTS_SIMD_AVX2:   return LOOP##Avx2<typename PottsSimdRegisters<REAL>::Avx2> ARGS; \
+			case POTTS_SIMD_SSE2:   return LOOP##Sse2<typename PottsSimdRegisters<REAL>::Sse2> ARGS; \
+			default:                return LOOP##Scalar ARGS; \
+		}
+#else
+	#define POTTS_SIMD_DISPATCH(LOOP, ARGS) return LOOP##Scalar ARGS;
+#endif
+
+// x[k] += y[k], N is a multiple of POTTS_SIMD_PADDING_BYTES / sizeof(REAL)
+template <class REAL> inline void PottsSimdAdd(REAL* x, const REAL* y, int N)
+{
+	POTTS_SIMD_DISPATCH(PottsAdd, (x, y, N))
+}
+
+template <class REAL> inline REAL PottsSimdMin(const REAL* x, int K)
+{
+	POTTS_SIMD_DISPATCH(PottsMin, (x, K))
+}
+
+template <class REAL> inline void PottsSimdSubtract(REAL* x, REAL v, int K)
+{
+	POTTS_SIMD_DISPATCH(PottsSubtract, (x, v, K))
+}
+
+template <class REAL> inline REAL PottsSimdDiffMin(REAL* m, const REAL* s, REAL gamma, int K)
+{
+	POTTS_SIMD_DISPATCH(PottsDiffMin, (m, s, gamma, K))
+}
+
+template <class REAL> inline void PottsSimdSubtractTruncate(REAL* m, REAL v, REAL lambda, int K)
+{
+	POTTS_SIMD_DISPATCH(PottsSubtractTruncate, (m, v, lambda, K))
+}
+
+#undef POTTS_SIMD_DISPATCH
+
+#endif
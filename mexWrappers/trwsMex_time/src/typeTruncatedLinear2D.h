@@ -424,8 +424,8 @@ inline TypeTruncatedLinear2D::REAL TypeTruncatedLinear2D::Edge::UpdateMessage(Gl
 	REAL* sourcePtr;
 	REAL* destPtr;
 
-	m_message.m_data[0] = gamma*source->m_data[0] - m_message.m_data[0];
-	vMin = m_message.m_data[0];
+	// m_data[0] is updated in the loop below, updating it here as well used the message from source instead of the one to source
+	vMin = gamma*source->m_data[0] - m_message.m_data[0];
 
 	sourcePtr = source->m_data;
 	destPtr = m_message.m_data;
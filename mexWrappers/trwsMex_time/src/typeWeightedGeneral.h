@@ -0,0 +1,535 @@
+/******************************************************************
+typeWeightedGeneral.h
+
+Energy function with general interactions sharing one label matrix:
+   E(x)   =   \sum_i D_i(x_i)   +   \sum_ij V_ij(x_i,x_j)
+   where x_i \in {0, 1, ..., K-1},
+   V_ij(ki, kj) = w_ij * V(ki, kj).
+   The K*K matrix V is stored once (in GlobalSize), each edge stores only the weight w_ij,
+   so the memory is O(K*K + numEdges*K) instead of O(numEdges*K*K) of TypeGeneral.
+
+   The matrix is not copied: the array given to GlobalSize must stay valid while the energy is used.
+
+   The min-plus products of the message updates are vectorized with the registers of typePottsSimd.h,
+   the instruction set is selected in the same way (see SMR_POTTS_SIMD). The results do not depend on it
+   and are the same as for TypeGeneral with the matrices w_ij * V(ki, kj) computed in REAL.
+
+   TypeWeightedGeneralFloat stores the parameters and the messages in single precision,
+   the lower bound and the energy are still accumulated in double.
+
+Example usage:
+
+	REAL V[K*K]; // V(ki, kj) = V[ki + K*kj]
+	mrf = new MRFEnergy<TypeWeightedGeneral>(TypeWeightedGeneral::GlobalSize(K, V));
+	nodes[i] = mrf->AddNode(TypeWeightedGeneral::LocalSize(), TypeWeightedGeneral::NodeData(Di));
+	mrf->AddEdge(nodes[i], nodes[j], TypeWeightedGeneral::EdgeData(w_ij));
+
+*******************************************************************/
+
+#ifndef __TYPEWEIGHTEDGENERAL_H__
+#define __TYPEWEIGHTEDGENERAL_H__
+
+#include <string.h>
+#include <assert.h>
+#include "typePottsSimd.h"
+
+
+template <class T> class MRFEnergy;
+
+
+template <class R> class TypeWeightedGeneralT
+{
+private:
+	struct Vector; // node parameters and messages
+	struct Edge; // stores edge information and either forward or backward message
+
+public:
+	// types declarations
+	typedef int Label;
+	typedef R REAL;
+	struct GlobalSize; // global information about number of labels and the shared matrix
+	struct LocalSize; // local information about number of labels (stored at each node)
+	struct NodeData; // argument to MRFEnergy::AddNode()
+	struct EdgeData; // argument to MRFEnergy::AddEdge()
+
+
+	struct GlobalSize
+	{
+		GlobalSize(int K, const REAL* data); // data = pointer to array of size K*K such that V(ki,kj) = data[ki + K*kj]
+
+	private:
+	friend struct Vector;
+	friend struct Edge;
+		int			m_K; // number of labels
+		const REAL*	m_data; // shared matrix, not owned
+	};
+
+	struct LocalSize // number of labels is stored at MRFEnergy::m_Kglobal
+	{
+	};
+
+	struct NodeData
+	{
+		NodeData(REAL* data); // data = pointer to array of size MRFEnergy::m_Kglobal
+
+	private:
+	friend struct Vector;
+	friend struct Edge;
+		REAL*		m_data;
+	};
+
+	struct EdgeData
+	{
+		EdgeData(REAL weight);
+
+	private:
+	friend struct Vector;
+	friend struct Edge;
+		REAL		m_weight;
+	};
+
+
+
+
+
+
+
+	//////////////////////////////////////////////////////////////////////////////////
+	////////////////////////// Visible only to MRFEnergy /////////////////////////////
+	//////////////////////////////////////////////////////////////////////////////////
+
+private:
+friend class MRFEnergy<TypeWeightedGeneralT<R> >;
+
+	struct Vector
+	{
+		static int GetSizeInBytes(GlobalSize Kglobal, LocalSize K); // returns -1 if invalid K's
+		void Initialize(GlobalSize Kglobal, LocalSize K, NodeData data);  // called once when user adds a node
+		void Add(GlobalSize Kglobal, LocalSize K, NodeData data); // called once when user calls MRFEnergy::AddNodeData()
+
+		void SetZero(GlobalSize Kglobal, LocalSize K);                            // set this[k] = 0
+		void Copy(GlobalSize Kglobal, LocalSize K, Vector* V);                    // set this[k] = V[k]
+		void Add(GlobalSize Kglobal, LocalSize K, Vector* V);                     // set this[k] = this[k] + V[k]
+		REAL GetValue(GlobalSize Kglobal, LocalSize K, Label k);                  // return this[k]
+		REAL ComputeMin(GlobalSize Kglobal, LocalSize K, Label& kMin);            // return vMin = min_k { this[k] }, set kMin
+		REAL ComputeAndSubtractMin(GlobalSize Kglobal, LocalSize K);              // same as previous, but additionally set this[k] -= vMin (and kMin is not returned)
+
+		static int GetArraySize(GlobalSize Kglobal, LocalSize K);
+		REAL GetArrayValue(GlobalSize Kglobal, LocalSize K, int k); // note: k is an integer in [0..GetArraySize()-1].
+		void SetArrayValue(GlobalSize Kglobal, LocalSize K, int k, REAL x);
+
+	private:
+	friend struct Edge;
+		REAL		m_data[1]; // actual size is MRFEnergy::m_Kglobal
+	};
+
+	struct Edge
+	{
+		static int GetSizeInBytes(GlobalSize Kglobal, LocalSize Ki, LocalSize Kj, EdgeData data); // returns -1 if invalid data
+		static int GetBufSizeInBytes(int vectorMaxSizeInBytes); // returns size of buffer need for UpdateMessage()
+		void Initialize(GlobalSize Kglobal, LocalSize Ki, LocalSize Kj, EdgeData data, Vector* Di, Vector* Dj); // called once when user adds an edge
+		Vector* GetMessagePtr();
+		void Swap(GlobalSize Kglobal, LocalSize Ki, LocalSize Kj); // if the client calls this function, then the meaning of 'dir'
+								                                               // in distance transform functions is swapped
+
+		// When UpdateMessage() is called, edge contains message from dest to source.
+		// The function must replace it with the message from source to dest.
+		// The update rule is given below assuming that source corresponds to tail (i) and dest corresponds
+		// to head (j) (which is the case if dir==0).
+		//
+		// 1. Compute Di[ki] = gamma*source[ki] - message[ki].  (Note: message = message from j to i).
+		// 2. Compute distance transform: set
+		//       message[kj] = min_{ki} (Di[ki] + V(ki,kj)). (Note: message = message from i to j).
+		// 3. Compute vMin = min_{kj} m_message[kj].
+		// 4. Set m_message[kj] -= vMin.
+		// 5. Return vMin.
+		//
+		// If dir==1 then source corresponds to j, sink corresponds to i. Then the update rule is
+		//
+		// 1. Compute Dj[kj] = gamma*source[kj] - message[kj].  (Note: message = message from i to j).
+		// 2. Compute distance transform: set
+		//       message[ki] = min_{kj} (Dj[kj] + V(ki,kj)). (Note: message = message from j to i).
+		// 3. Compute vMin = min_{ki} m_message[ki].
+		// 4. Set m_message[ki] -= vMin.
+		// 5. Return vMin.
+		//
+		// If Edge::Swap has been called odd number of times, then the meaning of dir is swapped.
+		//
+		// Vector 'source' must not be modified. Function may use 'buf' as a temporary storage.
+		REAL UpdateMessage(GlobalSize Kglobal, LocalSize Ksource, LocalSize Kdest, Vector* source, REAL gamma, int dir, void* buf);
+
+		// If dir==0, then sets dest[kj] += V(ksource,kj).
+		// If dir==1, then sets dest[ki] += V(ki,ksource).
+		// If Swap() has been called odd number of times, then the meaning of dir is swapped.
+		void AddColumn(GlobalSize Kglobal, LocalSize Ksource, LocalSize Kdest, Label ksource, Vector* dest, int dir);
+
+	private:
+		// edge information
+		REAL		m_weight;
+		int			m_dir; // 0 if Swap() was called even number of times, 1 otherwise
+
+		// message
+		Vector		m_message;
+	};
+};
+
+typedef TypeWeightedGeneralT<double> TypeWeightedGeneral;
+typedef TypeWeightedGeneralT<float> TypeWeightedGeneralFloat;
+
+
+
+
+//////////////////////////////////////////////////////////////////////////////////
+////////////////////////////// Min-plus products /////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////
+// V is a K*K matrix stored by columns.
+// WeightedMinPlusColumns: m[k] = min_j (b[j] + w*V[k + K*j]), the inner loop goes over the labels k of a column
+// WeightedMinPlusRows:    m[j] = min_k (b[k] + w*V[k + K*j]), the inner loop is a reduction over a column
+// The product w*V is rounded before the addition (no FMA) in all versions.
+
+template <class REAL> inline void WeightedMinPlusColumnsScalar(REAL* m, const REAL* b, REAL w, const REAL* V, int K)
+{
+	for (int k=0; k<K; k++)
+	{
+		m[k] = b[0] + w*V[k];
+	}
+	for (int j=1; j<K; j++)
+	{
+		for (int k=0; k<K; k++)
+		{
+			REAL v = b[j] + w*V[k + K*j];
+			if (m[k] > v) m[k] = v;
+		}
+	}
+}
+
+template <class REAL> inline void WeightedMinPlusRowsScalar(REAL* m, const REAL* b, REAL w, const REAL* V, int K)
+{
+	for (int j=0; j<K; j++)
+	{
+		REAL vMin = b[0] + w*V[K*j];
+		for (int k=1; k<K; k++)
+		{
+			REAL v = b[k] + w*V[k + K*j];
+			if (vMin > v) vMin = v;
+		}
+		m[j] = vMin;
+	}
+}
+
+#ifdef POTTS_SIMD_X86
+
+// Whole registers are used for the first K - K%W labels, so the arrays need no padding. The remaining labels
+// are computed in all lanes of a register filled with one value: a scalar b + w*v could be contracted to FMA
+// where the instruction set has it.
+#define WEIGHTED_MIN_PLUS_LOOPS(ISA, TARGET) \
+template <class S> POTTS_SIMD_TARGET(TARGET) inline void WeightedMinPlusColumns##ISA(typename S::REAL* m, const typename S::REAL* b, typename S::REAL w, const typename S::REAL* V, int K) \
+{ \
+	typename S::V vw = S::Set1(w); \
+	int k = 0; \
+	for (; k+2*S::W<=K; k+=2*S::W) \
+	{ \
+		/* two registers of the message are kept while going over the columns */ \
+		typename S::V vb = S::Set1(b[0]); \
+		typename S::V acc0 = S::Add(vb, S::Mul(vw, S::Load(V + k))); \
+		typename S::V acc1 = S::Add(vb, S::Mul(vw, S::Load(V + k + S::W))); \
+		for (int j=1; j<K; j++) \
+		{ \
+			vb = S::Set1(b[j]); \
+			acc0 = S::Min(acc0, S::Add(vb, S::Mul(vw, S::Load(V + k + K*j)))); \
+			acc1 = S::Min(acc1, S::Add(vb, S::Mul(vw, S::Load(V + k + S::W + K*j)))); \
+		} \
+		S::Store(m + k, acc0); \
+		S::Store(m + k + S::W, acc1); \
+	} \
+	for (; k+S::W<=K; k+=S::W) \
+	{ \
+		typename S::V acc = S::Add(S::Set1(b[0]), S::Mul(vw, S::Load(V + k))); \
+		for (int j=1; j<K; j++) \
+		{ \
+			acc = S::Min(acc, S::Add(S::Set1(b[j]), S::Mul(vw, S::Load(V + k + K*j)))); \
+		} \
+		S::Store(m + k, acc); \
+	} \
+	for (; k<K; k++) \
+	{ \
+		typename S::V acc = S::Add(S::Set1(b[0]), S::Mul(vw, S::Set1(V[k]))); \
+		for (int j=1; j<K; j++) \
+		{ \
+			acc = S::Min(acc, S::Add(S::Set1(b[j]), S::Mul(vw, S::Set1(V[k + K*j])))); \
+		} \
+		m[k] = S::HorizontalMin(acc); \
+	} \
+} \
+ \
+template <class S> POTTS_SIMD_TARGET(TARGET) inline void WeightedMinPlusRows##ISA(typename S::REAL* m, const typename S::REAL* b, typename S::REAL w, const typename S::REAL* V, int K) \
+{ \
+	typedef typename S::REAL REAL; \
+	typename S::V vw = S::Set1(w); \
+	typename S::V vInf = S::Set1(std::numeric_limits<REAL>::infinity()); \
+	for (int j=0; j<K; j++) \
+	{ \
+		const REAL* column = V + K*j; \
+		typename S::V acc = vInf; \
+		int k = 0; \
+		for (; k+S::W<=K; k+=S::W) \
+		{ \
+			acc = S::Min(acc, S::Add(S::Load(b + k), S::Mul(vw, S::Load(column + k)))); \
+		} \
+		for (; k<K; k++) \
+		{ \
+			acc = S::Min(acc, S::Add(S::Set1(b[k]), S::Mul(vw, S::Set1(column[k])))); \
+		} \
+		m[j] = S::HorizontalMin(acc); \
+	} \
+}
+
+WEIGHTED_MIN_PLUS_LOOPS(Sse2, "sse2")
+WEIGHTED_MIN_PLUS_LOOPS(Avx2, "avx2")
+WEIGHTED_MIN_PLUS_LOOPS(Avx512, "avx512f")
+
+#undef WEIGHTED_MIN_PLUS_LOOPS
+
+#define WEIGHTED_MIN_PLUS_DISPATCH(LOOP, ARGS) \
+	switch (GetPottsSimdLevel()) \
+	{ \
+		case POTTS_SIMD_AVX512: return LOOP##Avx512<typename PottsSimdRegisters<REAL>::Avx512> ARGS; \
+		case POTTS_SIMD_AVX2:   return LOOP##Avx2<typename PottsSimdRegisters<REAL>::Avx2> ARGS; \
+		case POTTS_SIMD_SSE2:   return LOOP##Sse2<typename PottsSimdRegisters<REAL>::Sse2> ARGS; \
+		default:                return LOOP##Scalar ARGS; \
+	}
+#else
+	#define WEIGHTED_MIN_PLUS_DISPATCH(LOOP, ARGS) return LOOP##Scalar ARGS;
+#endif // POTTS_SIMD_X86
+
+template <class REAL> inline void WeightedMinPlusColumns(REAL* m, const REAL* b, REAL w, const REAL* V, int K)
+{
+	WEIGHTED_MIN_PLUS_DISPATCH(WeightedMinPlusColumns, (m, b, w, V, K))
+}
+
+template <class REAL> inline void WeightedMinPlusRows(REAL* m, const REAL* b, REAL w, const REAL* V, int K)
+{
+	WEIGHTED_MIN_PLUS_DISPATCH(WeightedMinPlusRows, (m, b, w, V, K))
+}
+
+#undef WEIGHTED_MIN_PLUS_DISPATCH
+
+
+
+
+//////////////////////////////////////////////////////////////////////////////////
+/////////////////////////////// Implementation ///////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////
+
+
+template <class R> inline TypeWeightedGeneralT<R>::GlobalSize::GlobalSize(int K, const REAL* data)
+{
+	m_K = K;
+	m_data = data;
+}
+
+///////////////////// NodeData and EdgeData ///////////////////////
+
+template <class R> inline TypeWeightedGeneralT<R>::NodeData::NodeData(REAL* data)
+{
+	m_data = data;
+}
+
+template <class R> inline TypeWeightedGeneralT<R>::EdgeData::EdgeData(REAL weight)
+{
+	m_weight = weight;
+}
+
+///////////////////// Vector ///////////////////////
+
+template <class R> inline int TypeWeightedGeneralT<R>::Vector::GetSizeInBytes(GlobalSize Kglobal, LocalSize K)
+{
+	if (Kglobal.m_K < 1 || Kglobal.m_data == NULL)
+	{
+		return -1;
+	}
+	return Kglobal.m_K*sizeof(REAL);
+}
+template <class R> inline void TypeWeightedGeneralT<R>::Vector::Initialize(GlobalSize Kglobal, LocalSize K, NodeData data)
+{
+	memcpy(m_data, data.m_data, Kglobal.m_K*sizeof(REAL));
+}
+
+template <class R> inline void TypeWeightedGeneralT<R>::Vector::Add(GlobalSize Kglobal, LocalSize K, NodeData data)
+{
+	for (int k=0; k<Kglobal.m_K; k++)
+	{
+		m_data[k] += data.m_data[k];
+	}
+}
+
+template <class R> inline void TypeWeightedGeneralT<R>::Vector::SetZero(GlobalSize Kglobal, LocalSize K)
+{
+	memset(m_data, 0, Kglobal.m_K*sizeof(REAL));
+}
+
+template <class R> inline void TypeWeightedGeneralT<R>::Vector::Copy(GlobalSize Kglobal, LocalSize K, Vector* V)
+{
+	memcpy(m_data, V->m_data, Kglobal.m_K*sizeof(REAL));
+}
+
+template <class R> inline void TypeWeightedGeneralT<R>::Vector::Add(GlobalSize Kglobal, LocalSize K, Vector* V)
+{
+	for (int k=0; k<Kglobal.m_K; k++)
+	{
+		m_data[k] += V->m_data[k];
+	}
+}
+
+template <class R> inline typename TypeWeightedGeneralT<R>::REAL TypeWeightedGeneralT<R>::Vector::GetValue(GlobalSize Kglobal, LocalSize K, Label k)
+{
+	assert(k>=0 && k<Kglobal.m_K);
+	return m_data[k];
+}
+
+template <class R> inline typename TypeWeightedGeneralT<R>::REAL TypeWeightedGeneralT<R>::Vector::ComputeMin(GlobalSize Kglobal, LocalSize K, Label& kMin)
+{
+	REAL vMin = m_data[0];
+	kMin = 0;
+	for (int k=1; k<Kglobal.m_K; k++)
+	{
+		if (vMin > m_data[k])
+		{
+			vMin = m_data[k];
+			kMin = k;
+		}
+	}
+
+	return vMin;
+}
+
+template <class R> inline typename TypeWeightedGeneralT<R>::REAL TypeWeightedGeneralT<R>::Vector::ComputeAndSubtractMin(GlobalSize Kglobal, LocalSize K)
+{
+	REAL vMin = m_data[0];
+	for (int k=1; k<Kglobal.m_K; k++)
+	{
+		if (vMin > m_data[k])
+		{
+			vMin = m_data[k];
+		}
+	}
+	for (int k=0; k<Kglobal.m_K; k++)
+	{
+		m_data[k] -= vMin;
+	}
+
+	return vMin;
+}
+
+template <class R> inline int TypeWeightedGeneralT<R>::Vector::GetArraySize(GlobalSize Kglobal, LocalSize K)
+{
+	return Kglobal.m_K;
+}
+
+template <class R> inline typename TypeWeightedGeneralT<R>::REAL TypeWeightedGeneralT<R>::Vector::GetArrayValue(GlobalSize Kglobal, LocalSize K, int k)
+{
+	assert(k>=0 && k<Kglobal.m_K);
+	return m_data[k];
+}
+
+template <class R> inline void TypeWeightedGeneralT<R>::Vector::SetArrayValue(GlobalSize Kglobal, LocalSize K, int k, REAL x)
+{
+	assert(k>=0 && k<Kglobal.m_K);
+	m_data[k] = x;
+}
+
+///////////////////// EdgeDataAndMessage implementation /////////////////////////
+
+template <class R> inline int TypeWeightedGeneralT<R>::Edge::GetSizeInBytes(GlobalSize Kglobal, LocalSize Ki, LocalSize Kj, EdgeData data)
+{
+	return sizeof(Edge) - sizeof(Vector) + Kglobal.m_K*sizeof(REAL);
+}
+
+template <class R> inline int TypeWeightedGeneralT<R>::Edge::GetBufSizeInBytes(int vectorMaxSizeInBytes)
+{
+	return vectorMaxSizeInBytes;
+}
+
+template <class R> inline void TypeWeightedGeneralT<R>::Edge::Initialize(GlobalSize Kglobal, LocalSize Ki, LocalSize Kj, EdgeData data, Vector* Di, Vector* Dj)
+{
+	m_weight = data.m_weight;
+	m_dir = 0;
+	memset(m_message.m_data, 0, Kglobal.m_K*sizeof(REAL));
+}
+
+template <class R> inline typename TypeWeightedGeneralT<R>::Vector* TypeWeightedGeneralT<R>::Edge::GetMessagePtr()
+{
+	return &m_message;
+}
+
+template <class R> inline void TypeWeightedGeneralT<R>::Edge::Swap(GlobalSize Kglobal, LocalSize Ki, LocalSize Kj)
+{
+	m_dir = 1 - m_dir;
+}
+
+template <class R> inline typename TypeWeightedGeneralT<R>::REAL TypeWeightedGeneralT<R>::Edge::UpdateMessage(GlobalSize Kglobal, LocalSize Ksource, LocalSize Kdest, Vector* source, REAL gamma, int dir, void* _buf)
+{
+	Vector* buf = (Vector*) _buf;
+	const int K = Kglobal.m_K;
+	REAL vMin;
+	int k;
+
+	for (k=0; k<K; k++)
+	{
+		buf->m_data[k] = gamma*source->m_data[k] - m_message.m_data[k];
+	}
+
+	if (dir == m_dir)
+	{
+		// source is the first index of V
+		WeightedMinPlusRows(m_message.m_data, buf->m_data, m_weight, Kglobal.m_data, K);
+	}
+	else
+	{
+		WeightedMinPlusColumns(m_message.m_data, buf->m_data, m_weight, Kglobal.m_data, K);
+	}
+
+	vMin = m_message.m_data[0];
+	for (k=1; k<K; k++)
+	{
+		if (vMin > m_message.m_data[k])
+		{
+			vMin = m_message.m_data[k];
+		}
+	}
+
+	for (k=0; k<K; k++)
+	{
+		m_message.m_data[k] -= vMin;
+	}
+
+	return vMin;
+}
+
+template <class R> inline void TypeWeightedGeneralT<R>::Edge::AddColumn(GlobalSize Kglobal, LocalSize Ksource, LocalSize Kdest, Label ksource, Vector* dest, int dir)
+{
+	assert(ksource>=0 && ksource<Kglobal.m_K);
+
+	const int K = Kglobal.m_K;
+	const REAL* data = Kglobal.m_data;
+	int k;
+
+	if (dir == m_dir)
+	{
+		for (k=0; k<K; k++)
+		{
+			dest->m_data[k] += m_weight*data[ksource + k*K];
+		}
+	}
+	else
+	{
+		for (k=0; k<K; k++)
+		{
+			dest->m_data[k] += m_weight*data[k + ksource*K];
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+
+#endif
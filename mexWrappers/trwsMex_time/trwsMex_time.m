@@ -8,30 +8,94 @@
 %   trwsMex_time(U, P)
 %   trwsMex_time(U, P, M)
 %   trwsMex_time(U, P, M, options)
+%   trwsMex_time(U, {vertCost, horCost}, M, options)
 % Output examples:
 %   S = trwsMex_time(U, P, M, options)
 %   [S, E] = trwsMex_time(U, P, M, options)
 %   [S, E, LB] = trwsMex_time(U, P, M, options)
 %   [S, E, LB, lbPlot, energyPlot, timePlot] = trwsMex_time(U, P, M, options)
+%   [S, E, LB, lbPlot, energyPlot, timePlot, minMarginals] = trwsMex_time(U, P, M, options)
+%   [S, E, LB] = trwsMex_time(UBatch, PBatch, MBatch, options)
 % 
 % INPUT:
-% 	U		- unary terms (double[numLabels, numNodes])
+% 	U		- unary terms (double[numLabels, numNodes] or single[numLabels, numNodes])
 % 	P		- matrix of edge coefficients (sparse double[numNodes, numNodes]); only upper triangle is used
-% 	M		- matrix of label dependencies (double[numLabels, numLabels]); if M is not specified, Potts is assumed
+% 				or {vertCost, horCost} of a 4-connected grid, see GRID MODE
+% 	M		- matrix of label dependencies (double[numLabels, numLabels] or single); if M is not specified, Potts is assumed
 % 				if you want to set options without M call: mrfMinimizeMex(U, P, [], options)
+% 				for the truncated types (see options.pairwiseType) M is the truncation T: a double scalar shared by all edges
+% 				or a sparse double[numNodes, numNodes] with T(i, j) of every edge (a missing entry means 0); default: Inf
 %   options	- Stucture that determines method to be used.
 % 				Fields:  
-% 					method		:	method to use (string: 'trw-s' or 'bp') default: 'trw-s'
+% 					method		:	method to use (string: 'trw-s', 'bp' or 'rbp') default: 'trw-s'
+% 									'rbp' - residual BP: the messages are updated in the order of their change
+% 									instead of the passes; runs on numThreads threads (not in the batch mode), the result
+% 									does not depend on the number of threads. One iteration is as many updates as there are messages.
 % 					maxIter		:	maximum number of iterations (double) default: 100
 % 					funcEps		:	If functional change is less than funcEps then stop, TRW-S only (double) default: 1e-2
+% 									for 'rbp' the messages that would change by at most funcEps are not updated
 % 					verbosity	:	verbosity level: 0 - no output; 1 - final output; 2 - full output (double) default: 0
 % 					printMinIter:	After printMinIter iterations start printing the lower bound (double) default: 10
 % 					printIter	:	and print every printIter iterations (double) default: 5
+% 					energyIter	:	compute the labeling and its energy for energyPlot every energyIter iterations (double) default: 1
+% 									0 - only at the last iteration; energyPlot is NaN at the skipped iterations.
+% 									Computing the energy costs about as much as one pass over the edges.
+% 					numThreads	:	number of threads used in the batch mode, in the wavefront mode and by 'rbp' (double) default: 0 - environment variable SMR_NUM_THREADS or the number of cores
+% 					wavefront	:	process the nodes of a single problem in parallel by wavefronts (double or logical) default: 0
+% 									A node depends only on its neighbors that precede it in the pass, so the nodes not connected by
+% 									such chains are independent; for a 4-connected grid the wavefronts are its anti-diagonals.
+% 									The messages, the lower bound and the energy are the same as without the option.
+% 									Ignored in the batch mode.
+% 					precision	:	precision of the messages (string: 'auto', 'double' or 'single') default: 'auto' - single if U is single
+% 									Single precision halves the memory traffic of the message passing, the energy and the lower bound
+% 									are still accumulated in double but are less accurate.
+% 					contiguousStorage:	copy the nodes and the edges into one array in the order of the passes (double or logical) default: 0
+% 									The passes then read the memory sequentially; the old storage is freed after the copy, so the memory
+% 									of the energy is doubled only while it is copied.
+% 					sharedLabelMatrix:	store M once and scale it by P(i, j) in the message updates (double or logical) default: 1
+% 									The edges then need O(numLabels) memory instead of O(numLabels^2); the min-plus products are vectorized.
+% 									0 - every edge stores its own matrix P(i, j) * M as in the original code.
+% 					pairwiseType:	type of the pairwise terms (string) default: 'auto' - Potts if M is empty, general otherwise
+% 									'truncLinear'		:	V_ij(k, l) = P(i, j) * min(|k - l|, T(i, j))
+% 									'truncQuadratic'	:	V_ij(k, l) = P(i, j) * min((k - l)^2, T(i, j))
+% 									'truncLinear2D'		:	V_ij(k, l) = P(i, j) * min(|kx - lx| + |ky - ly|, T(i, j))
+% 									'truncQuadratic2D'	:	V_ij(k, l) = P(i, j) * min((kx - lx)^2 + (ky - ly)^2, T(i, j))
+% 									The messages of the truncated types are computed by distance transforms in O(numLabels)
+% 									and no numLabels x numLabels matrix is stored per edge. P should be non-negative.
+% 									The truncated types are solved in double precision.
+% 					numLabelsX	:	the labels of the 2D types form a numLabelsX x (numLabels / numLabelsX) grid, label k has
+% 									kx = mod(k - 1, numLabelsX), ky = floor((k - 1) / numLabelsX) (double) default: 1
+% 					pruneLabels	:	remove the labels that are not taken by any minimum of the energy (double or logical) default: 0
+% 									Label a of node i is removed if U(a, i) - min U(:, i) exceeds what the neighbors can gain
+% 									from it: the sum over the edges of max_l V_ij(b, l) - V_ij(a, l), b the best unary label.
+% 									The energy is then solved over the remaining labels of every node (per-edge matrices of
+% 									their size, the edges to the nodes with one label become unary terms), so the messages cost
+% 									(# labels left)^2 instead of numLabels^2. The min-marginals of the removed labels are Inf.
+% 									Only for the Potts and the general pairwise terms, not supported by trwsDynamicMex.
 % 
 % OUTPUT: 
 % 	S		- labeling that has energy E, vector numNodes * 1 of type double (indices are in [1,...,numLabels])
 %   E       - energy of labeling S
 % 	LB		- maximum value of lower bound of type double (only for TRW-S method)
-%   lbPlot, energyPlot, timePlot - measures per iteration
+%   lbPlot, energyPlot, timePlot - measures per iteration, timePlot is the wall-clock time in seconds
+%   minMarginals - min-marginals of the last iteration, double[numLabels, numNodes]: the unary terms reparametrized
+%               by the incoming messages, for TRW-S they are normalized so that the minimum of each column is 0.
+%               They are computed only if this output is requested.
+% 
+% BATCH MODE:
+% 	UBatch	- cell array of unary terms of numProblems independent problems, the problems are solved in parallel
+% 	PBatch	- cell array of the corresponding edge coefficients (or a single sparse matrix shared by all problems)
+% 	MBatch	- cell array of label matrices (or a single matrix shared by all problems, or [] for Potts)
+%   S, lbPlot, energyPlot, timePlot, minMarginals are then numProblems x 1 cell arrays, E and LB are numProblems x 1 vectors.
+%   Verbosity is ignored in the batch mode.
+% 
+% GRID MODE:
+% 	P = {vertCost, horCost} as returned by separateVertHorCosts: vertCost is double[H - 1, W] with the coefficients of
+% 	the edges (y, x) - (y + 1, x), horCost is double[H, W - 1] with the coefficients of the edges (y, x) - (y, x + 1).
+% 	Node (y, x) has index y + H * (x - 1), U is double[numLabels, H * W] or double[numLabels, H, W] (or single).
+% 	The edges are built directly from the two arrays and the nodes are taken in the raster order instead of the automatic
+% 	ordering of TRW-S (its rows and columns are the monotonic chains), so no sparse matrix is needed.
+% 	Zero coefficients mean no edge as in the sparse matrix. In the batch mode PBatch can be one {vertCost, horCost}
+% 	shared by all problems or a cell array of them.
 % 
 % Anton Osokin (firstname.lastname@gmail.com),  24.09.2014
@@ -3,4 +3,31 @@ function build_viterbiPottsMex
 %
 % Anton Osokin (firstname.lastname@gmail.com),  22.05.2013
 
-mex viterbiPottsMex.cpp -output viterbiPottsMex -largeArrayDims
+% the batch mode uses std::thread
+threadPoolPath = fullfile('..', 'threadPool');
+% the vector registers of the chain solver are shared with trwsMex_time
+simdPath = fullfile('..', 'trwsMex_time', 'src');
+mexFlags = [' -I', threadPoolPath, ' -I', simdPath, ' '];
+% the handles of viterbiGridDynamicMex are pointers
+if ~isempty(strfind(mexext, '64'))
+    mexFlags = [mexFlags, ' -DA64BITS '];
+end
+if isunix
+    mexFlags = [mexFlags, ' CXXFLAGS="$CXXFLAGS -std=c++11 -pthread" LDFLAGS="$LDFLAGS -pthread" '];
+end
+
+mexCmd = ['mex viterbiPottsMex.cpp viterbiPotts.cpp -output viterbiPottsMex -largeArrayDims', mexFlags];
+eval(mexCmd);
+
+mexCmd = ['mex viterbiGridPottsMex.cpp viterbiPotts.cpp -output viterbiGridPottsMex -largeArrayDims', mexFlags];
+eval(mexCmd);
+
+dynamicFiles = ' viterbiPotts.cpp viterbiGridMemory.cpp ';
+mexCmd = ['mex viterbiGridDynamicMex.cpp', dynamicFiles, '-output viterbiGridDynamicMex -largeArrayDims', mexFlags];
+eval(mexCmd);
+
+mexCmd = ['mex updateUnaryViterbiGridDynamicMex.cpp', dynamicFiles, '-output updateUnaryViterbiGridDynamicMex -largeArrayDims', mexFlags];
+eval(mexCmd);
+
+mexCmd = ['mex deleteViterbiGridDynamicMex.cpp', dynamicFiles, '-output deleteViterbiGridDynamicMex -largeArrayDims', mexFlags];
+eval(mexCmd);
@@ -0,0 +1,14 @@
+#include "viterbiGridMemory.h"
+#include "mex.h"
+
+void mexFunction(int nlhs, mxArray *plhs[],
+    int nrhs, const mxArray *prhs[])
+{
+	MATLAB_ASSERT( nrhs == 1, "deleteViterbiGridDynamicMex:inputArguments", "Wrong number of input arguments, expected 1");
+
+	// get Viterbi handle
+	ViterbiGridEnergy* energy = getViterbiGridHandle(prhs[0]);
+
+	//free memory
+	deleteViterbiGridEnergy(energy);
+}
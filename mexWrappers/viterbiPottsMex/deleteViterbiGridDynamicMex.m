@@ -0,0 +1,8 @@
+% deleteViterbiGridDynamicMex frees the memory of the chains created by viterbiGridDynamicMex
+% 
+% deleteViterbiGridDynamicMex( viterbiHandle );
+% 
+% INPUT
+%     viterbiHandle -   a single number given by viterbiGridDynamicMex
+% 
+%     See also viterbiGridDynamicMex, updateUnaryViterbiGridDynamicMex
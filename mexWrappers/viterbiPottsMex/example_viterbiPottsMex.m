@@ -14,3 +14,51 @@ end
 if ~isequal(labels, [3; 3; 3; 3])
     warning('Wrong value of labels!')
 end
+
+% the min-marginals: the smallest energy of every node at every label, their minimum is the energy
+[~, ~, minMarginals] = viterbiPottsMex(unary, costs);
+if ~isequal(min(minMarginals, [], 2), -7 * ones(4, 1))
+    warning('Wrong value of minMarginals!')
+end
+
+% negative Potts costs make many labelings equally good, the ties should be broken as in the sequential scan
+% at every vectorization level (see SMR_POTTS_SIMD in trwsMex_time/src/typePottsSimd.h, 0 is the scalar path)
+unaryTie = [1 1 0; 2 1 0; 1 0 0; 2 2 0];
+costsTie = [-2; -1; -1];
+[energyTie, labelsTie] = viterbiPottsMex(unaryTie, costsTie);
+
+% correct answer: energyTie = -3; labelsTie = [2; 3; 2; 3];
+if ~isequal(energyTie, -3)
+    warning('Wrong value of energy with the negative costs!')
+end
+if ~isequal(labelsTie, [2; 3; 2; 3])
+    warning('Wrong value of labels with the negative costs!')
+end
+
+% all the rows of a 2 x 4 grid in one call: the chain above and the same chain with the unary terms shifted by 10
+unaryGrid = zeros(3, 2 * 4);
+unaryGrid(:, 1 : 2 : end) = unary';
+unaryGrid(:, 2 : 2 : end) = unary' + 10;
+[energyRows, labelsGrid] = viterbiGridPottsMex(unaryGrid, [costs'; costs'], 'hor');
+
+% correct answer: energyRows = [-7; 33]; labelsGrid = 3 * ones(2, 4);
+if ~isequal(energyRows, [-7; 33])
+    warning('Wrong value of energyRows!')
+end
+if ~isequal(labelsGrid, 3 * ones(2, 4))
+    warning('Wrong value of labelsGrid!')
+end
+
+% the same rows kept between the calls: the unary terms of the last node of the first row become [0 1 10],
+% only this row is solved again
+[~, ~, viterbiHandle] = viterbiGridDynamicMex(unaryGrid, [costs'; costs'], 'hor');
+[energyRows, labelsGrid] = updateUnaryViterbiGridDynamicMex(viterbiHandle, [7, 0, 1, 20]);
+deleteViterbiGridDynamicMex(viterbiHandle);
+
+% correct answer: energyRows = [1; 33]; labelsGrid = [1 1 1 1; 3 3 3 3];
+if ~isequal(energyRows, [1; 33])
+    warning('Wrong value of energyRows after the update!')
+end
+if ~isequal(labelsGrid, [1 1 1 1; 3 3 3 3])
+    warning('Wrong value of labelsGrid after the update!')
+end
@@ -0,0 +1,57 @@
+#include "viterbiGridMemory.h"
+
+#include <cmath>
+#include <algorithm>
+
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
+{
+	MATLAB_ASSERT( nrhs == 2 || nrhs == 3, "updateUnaryViterbiGridDynamicMex:inputParameters", "Wrong number of input arguments, expected 2 or 3");
+	MATLAB_ASSERT( nlhs <= 2, "updateUnaryViterbiGridDynamicMex:outputParameters", "Too many output arguments, expected 0 - 2");
+
+	// set up pointers for input/ output parameters
+	const mxArray *handleInPtr = prhs[0]; //viterbiHandle
+	const mxArray *updateInPtr = prhs[1]; // the update array
+	const mxArray* numThreadsInPtr = (nrhs > 2) ? prhs[2] : NULL; //number of threads
+
+	mxArray **energyOutPtr = (nlhs > 0) ? &plhs[0] : NULL; //energies of the chains
+	mxArray **labelsOutPtr = (nlhs > 1) ? &plhs[1] : NULL; //labeling
+
+	ViterbiGridEnergy* energy = getViterbiGridHandle(handleInPtr);
+	mwSize numNodes = energy->height * energy->width;
+	int numLabels = energy->numLabels;
+
+	// get the changes
+	MATLAB_ASSERT( mxGetNumberOfDimensions( updateInPtr ) == 2, "updateUnaryViterbiGridDynamicMex:updateUnaryWrongDimension", "updateUnary is not 2-dimensional");
+	mwSize numChanges = mxGetM( updateInPtr );
+	MATLAB_ASSERT( numChanges == 0 || mxGetN( updateInPtr ) == (mwSize)numLabels + 1, "updateUnaryViterbiGridDynamicMex:updateUnaryWrongDimension", "updateUnary is not of size #changes x (numLabels + 1)");
+	MATLAB_ASSERT( mxGetClassID( updateInPtr ) == mxDOUBLE_CLASS, "updateUnaryViterbiGridDynamicMex:updateUnaryWrongType", "updateUnary is of wrong type");
+	const double* changes = (const double*)mxGetData( updateInPtr );
+
+	for(mwSize i = 0; i < numChanges; ++i)
+		MATLAB_ASSERT( floor(changes[i]) == changes[i] && changes[i] >= 1 && changes[i] <= (double)numNodes, "updateUnaryViterbiGridDynamicMex:updateUnaryWrongNodeId", "updateUnary has one nodeId incorrect");
+
+	int numThreads = 0;
+	if (numThreadsInPtr != NULL && !mxIsEmpty(numThreadsInPtr)) {
+		MATLAB_ASSERT( mxIsNumeric(numThreadsInPtr) && mxGetNumberOfElements(numThreadsInPtr) == 1, "updateUnaryViterbiGridDynamicMex:numThreadsWrongType", "numThreads should be a numeric scalar");
+		double numThreadsValue = mxGetScalar(numThreadsInPtr);
+		MATLAB_ASSERT( numThreadsValue >= 1 && floor(numThreadsValue) == numThreadsValue, "updateUnaryViterbiGridDynamicMex:numThreadsWrongValue", "numThreads should be a positive integer");
+		numThreads = (int)numThreadsValue;
+	}
+
+	// the chains without changes keep their energies and labels
+	try {
+		addUnaryViterbiGridEnergy(energy, changes, numChanges, getThreadPool(numThreads));
+	}
+	catch (...) {
+		mexErrMsgTaskException("updateUnaryViterbiGridDynamicMex:threadPool");
+	}
+
+	if (energyOutPtr != NULL) {
+		*energyOutPtr = mxCreateNumericMatrix(energy->energy.size(), 1, mxDOUBLE_CLASS, mxREAL);
+		std::copy(energy->energy.begin(), energy->energy.end(), (double*)mxGetData(*energyOutPtr));
+	}
+	if (labelsOutPtr != NULL) {
+		*labelsOutPtr = mxCreateNumericMatrix(energy->height, energy->width, mxDOUBLE_CLASS, mxREAL);
+		std::copy(energy->labels.begin(), energy->labels.end(), (double*)mxGetData(*labelsOutPtr));
+	}
+}
@@ -0,0 +1,20 @@
+% updateUnaryViterbiGridDynamicMex adds the given values to the unary terms of the chains created by viterbiGridDynamicMex
+% and solves the chains again. Only the chains with changed nodes are processed, and in them only the messages between
+% the first and the last changed node (and the ones outdated by the previous updates) are recomputed, so small updates
+% are much faster than viterbiGridPottsMex.
+% 
+% [energy, labels] = updateUnaryViterbiGridDynamicMex(viterbiHandle, updateUnary)
+% [energy, labels] = updateUnaryViterbiGridDynamicMex(viterbiHandle, updateUnary, numThreads)
+% 
+% INPUT
+%     viterbiHandle -   a single number given by viterbiGridDynamicMex
+%     updateUnary   -   of type double, array size [numChanges, K + 1]; ([p, dU(1, p), ..., dU(K, p)]); the values added to the unary terms of node #p
+%     numThreads    -   the number of threads (optional); by default, the environment variable SMR_NUM_THREADS or the number of cores is used
+% 
+% OUTPUT
+%     energy    -   energies of all the chains after the update, numChains x 1 vector
+%     labels    -   the best labelings of all the chains after the update, H x W double matrix
+% 
+% The energies are computed from the stored messages and can differ from the ones of viterbiGridPottsMex by rounding errors.
+% 
+%     See also viterbiGridDynamicMex, deleteViterbiGridDynamicMex
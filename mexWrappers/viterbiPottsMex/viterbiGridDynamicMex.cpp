@@ -0,0 +1,77 @@
+#include "viterbiGridMemory.h"
+
+#include <cmath>
+#include <algorithm>
+
+void mexFunction(int nlhs, mxArray *plhs[],
+    int nrhs, const mxArray *prhs[])
+{
+	MATLAB_ASSERT( nrhs == 3 || nrhs == 4, "viterbiGridDynamicMex:inputParameters", "Wrong number of input arguments, expected 3 or 4");
+	MATLAB_ASSERT( nlhs <= 3, "viterbiGridDynamicMex:outputParameters", "Too many output arguments, expected 0 - 3");
+
+	// set up pointers for input/ output parameters
+	const mxArray* unaryInPtr = prhs[0]; //unary terms
+	const mxArray* costsInPtr = prhs[1]; //pairwise terms of the direction
+	const mxArray* directionInPtr = prhs[2]; //direction
+	const mxArray* numThreadsInPtr = (nrhs > 3) ? prhs[3] : NULL; //number of threads
+
+	mxArray **energyOutPtr = (nlhs > 0) ? &plhs[0] : NULL; //energies of the chains
+	mxArray **labelsOutPtr = (nlhs > 1) ? &plhs[1] : NULL; //labeling
+	mxArray **handleOutPtr = (nlhs > 2) ? &plhs[2] : NULL; //viterbiHandle
+
+	// get direction
+	MATLAB_ASSERT( mxIsChar(directionInPtr), "viterbiGridDynamicMex:directionWrongType", "direction should be a string");
+	int direction = -1;
+	char buf[16];
+	if ( !mxGetString(directionInPtr, buf, sizeof(buf)) )
+		direction = getGridDirection(buf);
+	MATLAB_ASSERT( direction >= 0, "viterbiGridDynamicMex:directionWrongValue", "direction should be 'vert', 'hor', 'mainDiag' or 'secondDiag'");
+
+	// get pairwise potentials, the size of the grid follows from their size
+	MATLAB_ASSERT( mxGetClassID(costsInPtr) == mxDOUBLE_CLASS, "viterbiGridDynamicMex:pairwisePotentialsWrongType", "costs is of wrong type, expected double");
+	MATLAB_ASSERT( mxGetNumberOfDimensions(costsInPtr) == 2, "viterbiGridDynamicMex:pairwisePotentialsWrongDimensionality", "costs is not 2-dimensional");
+	MATLAB_ASSERT( mxGetPi(costsInPtr) == NULL, "viterbiGridDynamicMex:pairwisePotentialsComplex",  "Pairwise potentials should not be complex");
+	mwSize height = mxGetM(costsInPtr) + ((direction == HORIZONTAL) ? 0 : 1);
+	mwSize width = mxGetN(costsInPtr) + ((direction == VERTICAL) ? 0 : 1);
+	const double* costs = (const double*)mxGetData(costsInPtr);
+
+	// get unary potentials
+	MATLAB_ASSERT( mxGetClassID(unaryInPtr) == mxDOUBLE_CLASS, "viterbiGridDynamicMex:unaryPotentialsWrongType", "unary is of wrong type, expected double");
+	MATLAB_ASSERT( mxGetPi(unaryInPtr) == NULL, "viterbiGridDynamicMex:unaryPotentialsComplex",  "Unary potentials should not be complex");
+	int numLabels = (int)mxGetM(unaryInPtr);
+	MATLAB_ASSERT( numLabels >= 1, "viterbiGridDynamicMex:unaryPotentialsWrongNumLabels", "The number of labels is not positive");
+	MATLAB_ASSERT( mxGetNumberOfElements(unaryInPtr) == numLabels * height * width, "viterbiGridDynamicMex:unaryPotentialsWrongSize", "unary should be numLabels x (height * width), the size of the grid is given by costs");
+	const double* dataCost = (const double*)mxGetData(unaryInPtr);
+
+	int numThreads = 0;
+	if (numThreadsInPtr != NULL && !mxIsEmpty(numThreadsInPtr)) {
+		MATLAB_ASSERT( mxIsNumeric(numThreadsInPtr) && mxGetNumberOfElements(numThreadsInPtr) == 1, "viterbiGridDynamicMex:numThreadsWrongType", "numThreads should be a numeric scalar");
+		double numThreadsValue = mxGetScalar(numThreadsInPtr);
+		MATLAB_ASSERT( numThreadsValue >= 1 && floor(numThreadsValue) == numThreadsValue, "viterbiGridDynamicMex:numThreadsWrongValue", "numThreads should be a positive integer");
+		numThreads = (int)numThreadsValue;
+	}
+
+	// the chains and their messages are kept only if the handle is requested
+	ViterbiGridEnergy* energy = NULL;
+	try {
+		energy = createViterbiGridEnergy(direction, height, width, numLabels, dataCost, costs, getThreadPool(numThreads));
+	}
+	catch (...) {
+		mexErrMsgTaskException("viterbiGridDynamicMex:threadPool");
+	}
+	int numChains = (int)energy->problems.size();
+
+	if (energyOutPtr != NULL) {
+		*energyOutPtr = mxCreateNumericMatrix(numChains, 1, mxDOUBLE_CLASS, mxREAL);
+		std::copy(energy->energy.begin(), energy->energy.end(), (double*)mxGetData(*energyOutPtr));
+	}
+	if (labelsOutPtr != NULL) {
+		*labelsOutPtr = mxCreateNumericMatrix(height, width, mxDOUBLE_CLASS, mxREAL);
+		std::copy(energy->labels.begin(), energy->labels.end(), (double*)mxGetData(*labelsOutPtr));
+	}
+
+	if (handleOutPtr != NULL)
+		*handleOutPtr = createViterbiGridHandle(energy);
+	else
+		deleteViterbiGridEnergy(energy);
+}
@@ -0,0 +1,20 @@
+% viterbiGridDynamicMex solves all the chains of one direction of a grid as viterbiGridPottsMex and keeps their messages
+% for the updates of the unary terms by updateUnaryViterbiGridDynamicMex
+% 
+% [energy, labels] = viterbiGridDynamicMex(unary, costs, direction)
+% [energy, labels, viterbiHandle] = viterbiGridDynamicMex(unary, costs, direction)
+% [energy, labels, viterbiHandle] = viterbiGridDynamicMex(unary, costs, direction, numThreads)
+% 
+% if viterbiHandle is not requested all memory is cleaned up, otherwise function deleteViterbiGridDynamicMex needs to be called
+% 
+% INPUT
+%     unary, costs, direction, numThreads   -   see viterbiGridPottsMex
+% 
+% OUTPUT
+%     energy    -   energies of the chains, numChains x 1 vector (the order of viterbiGridPottsMex)
+%     labels    -   the best labelings of the chains, H x W double matrix, the same as of viterbiGridPottsMex
+%     viterbiHandle -   a single number, for direct usage in updateUnaryViterbiGridDynamicMex and deleteViterbiGridDynamicMex only
+% 
+% For every chain the forward and the backward messages are stored (2 x K x H x W numbers per grid direction).
+% 
+%     See also updateUnaryViterbiGridDynamicMex, deleteViterbiGridDynamicMex, viterbiGridPottsMex
@@ -0,0 +1,101 @@
+#include "viterbiGridMemory.h"
+
+#include <algorithm>
+#include <climits>
+
+ViterbiGridEnergy* getViterbiGridHandle(const mxArray *x)
+{
+	ViterbiGridHandle vh = 0;
+	ViterbiGridEnergy* energy = 0;
+
+	if ( mxGetClassID(x) != MATLAB_POINTER_TYPE ) {
+		mexErrMsgIdAndTxt("viterbiGridMemory:handleWrongType", "Viterbi handle argument is not of proper type");
+	}
+	if ( mxGetNumberOfElements(x) != 1 ) {
+		mexErrMsgIdAndTxt("viterbiGridMemory:handleWrongSize", "Too many Viterbi handles");
+	}
+
+	vh = (ViterbiGridHandle*)mxGetData(x);
+	energy = (ViterbiGridEnergy*)(*(POINTER_CAST*)vh);
+	if ( energy == NULL ) {
+		mexErrMsgIdAndTxt("viterbiGridMemory:badHandle", "Viterbi handle is not valid");
+	}
+	return energy;
+}
+
+mxArray* createViterbiGridHandle(ViterbiGridEnergy* energy)
+{
+	mxArray* x = mxCreateNumericMatrix(1, 1, MATLAB_POINTER_TYPE, mxREAL);
+	*(ViterbiGridHandle*)mxGetData(x) = (ViterbiGridHandle)energy;
+	return x;
+}
+
+ViterbiGridEnergy* createViterbiGridEnergy(int direction, mwSize height, mwSize width, int numLabels, const double* dataCost, const double* costs, ThreadPool* pool)
+{
+	ViterbiGridEnergy* energy = new ViterbiGridEnergy;
+	energy->direction = direction;
+	energy->height = height;
+	energy->width = width;
+	energy->numLabels = numLabels;
+
+	mwSize numNodes = height * width;
+	mwSize numCosts = (height - ((direction == HORIZONTAL) ? 0 : 1)) * (width - ((direction == VERTICAL) ? 0 : 1));
+	energy->dataCost.assign(dataCost, dataCost + (size_t)numLabels * numNodes);
+	energy->costs.assign(costs, costs + numCosts);
+	getGridChains(direction, height, width, numLabels, energy->dataCost.empty() ? NULL : &energy->dataCost[0],
+		energy->costs.empty() ? NULL : &energy->costs[0], energy->problems, energy->chainFirst, energy->segmentStride);
+	int numChains = (int)energy->problems.size();
+
+	energy->nodeChain.resize(numNodes);
+	energy->nodePosition.resize(numNodes);
+	for (int iChain = 0; iChain < numChains; ++iChain)
+		for (int iNode = 0; iNode < energy->problems[iChain].numNodes; ++iNode) {
+			ptrdiff_t node = energy->chainFirst[iChain] + iNode * energy->segmentStride;
+			energy->nodeChain[node] = iChain;
+			energy->nodePosition[node] = iNode;
+		}
+
+	energy->caches.resize(numChains);
+	energy->energy.resize(numChains);
+	energy->labels.resize(numNodes);
+	vector<ChainWorkspace> workspaces( pool -> getNumThreads() );
+	pool -> parallelFor(numChains, [&](int iChain, int iThread) {
+		energy->energy[iChain] = solveChainCached(energy->problems[iChain], energy->caches[iChain], workspaces[iThread],
+			&energy->labels[energy->chainFirst[iChain]], energy->segmentStride);
+	});
+	return energy;
+}
+
+void addUnaryViterbiGridEnergy(ViterbiGridEnergy* energy, const double* changes, mwSize numChanges, ThreadPool* pool)
+{
+	int numLabels = energy->numLabels;
+	int numChains = (int)energy->problems.size();
+
+	// the changed part of every chain
+	vector<int> firstChanged(numChains, INT_MAX);
+	vector<int> lastChanged(numChains, -1);
+	vector<int> changedChains;
+	for (mwIndex i = 0; i < numChanges; ++i) {
+		mwIndex node = (mwIndex)changes[i] - 1;
+		for (int k = 0; k < numLabels; ++k)
+			energy->dataCost[k + (size_t)numLabels * node] += changes[i + (k + 1) * numChanges];
+
+		int iChain = energy->nodeChain[node];
+		if (lastChanged[iChain] < 0)
+			changedChains.push_back(iChain);
+		firstChanged[iChain] = std::min(firstChanged[iChain], energy->nodePosition[node]);
+		lastChanged[iChain] = std::max(lastChanged[iChain], energy->nodePosition[node]);
+	}
+
+	vector<ChainWorkspace> workspaces( pool -> getNumThreads() );
+	pool -> parallelFor((int)changedChains.size(), [&](int iChanged, int iThread) {
+		int iChain = changedChains[iChanged];
+		energy->energy[iChain] = updateChainCached(energy->problems[iChain], energy->caches[iChain], firstChanged[iChain], lastChanged[iChain],
+			workspaces[iThread], &energy->labels[energy->chainFirst[iChain]], energy->segmentStride);
+	});
+}
+
+void deleteViterbiGridEnergy(ViterbiGridEnergy* energy)
+{
+	delete energy;
+}
@@ -0,0 +1,56 @@
+#ifndef __VITERBIGRIDMEMORY_H__
+#define __VITERBIGRIDMEMORY_H__
+
+#include <tmwtypes.h>
+
+#include "viterbiPotts.h"
+#include "threadPool.h"
+#include "mex.h"
+
+typedef void* ViterbiGridHandle;
+
+/* pointer types in 64 bits machines */
+#ifdef A64BITS
+#define MATLAB_POINTER_TYPE mxUINT64_CLASS
+#else
+#define MATLAB_POINTER_TYPE mxUINT32_CLASS
+#endif
+
+#ifdef A64BITS
+#define POINTER_CAST    int64_T
+#else
+#define POINTER_CAST    int
+#endif
+
+// The chains of one grid direction with their messages kept between the calls of viterbiGridDynamicMex and updateUnaryViterbiGridDynamicMex.
+// The unary terms and the costs are copied, the chain problems point to the copies.
+struct ViterbiGridEnergy
+{
+	int direction;
+	mwSize height;
+	mwSize width;
+	int numLabels;
+	vector<double> dataCost; // numLabels x (height * width), the current unary terms
+	vector<double> costs;
+	vector<ChainProblem> problems;
+	vector<ptrdiff_t> chainFirst;
+	ptrdiff_t segmentStride;
+	vector<int> nodeChain; // the chain of every node and the position of the node in it
+	vector<int> nodePosition;
+	vector<ChainCache> caches;
+	vector<double> energy; // the energies of the chains and the labeling of the grid after the last call
+	vector<double> labels;
+};
+
+ViterbiGridEnergy* getViterbiGridHandle(const mxArray *x); // extract handle from mxArray
+mxArray* createViterbiGridHandle(ViterbiGridEnergy* energy);
+
+// the functions below do not call MATLAB API, the chains are solved on pool
+// copies the problem and solves all the chains
+ViterbiGridEnergy* createViterbiGridEnergy(int direction, mwSize height, mwSize width, int numLabels, const double* dataCost, const double* costs, ThreadPool* pool);
+// adds the changes (numChanges x (numLabels + 1) array [p, dU(1, p), ..., dU(numLabels, p)], p is 1-based and valid) to the unary terms,
+// only the chains with the changed nodes are solved again and only their outdated messages are recomputed
+void addUnaryViterbiGridEnergy(ViterbiGridEnergy* energy, const double* changes, mwSize numChanges, ThreadPool* pool);
+void deleteViterbiGridEnergy(ViterbiGridEnergy* energy);
+
+#endif
@@ -0,0 +1,97 @@
+#include "viterbiPotts.h"
+#include "threadPool.h"
+
+#include <cmath>
+
+void mexFunction(int nlhs, mxArray *plhs[],
+    int nrhs, const mxArray *prhs[])
+{
+	MATLAB_ASSERT( nrhs == 3 || nrhs == 4, "viterbiGridPottsMex:inputParameters", "Wrong number of input arguments, expected 3 or 4");
+	MATLAB_ASSERT( nlhs <= 3, "viterbiGridPottsMex:outputParameters", "Too many output arguments, expected 0 - 3");
+
+	// set up pointers for input/ output parameters
+	const mxArray* unaryInPtr = prhs[0]; //unary terms
+	const mxArray* costsInPtr = prhs[1]; //pairwise terms of the direction
+	const mxArray* directionInPtr = prhs[2]; //direction
+	const mxArray* numThreadsInPtr = (nrhs > 3) ? prhs[3] : NULL; //number of threads
+
+	mxArray **energyOutPtr = (nlhs > 0) ? &plhs[0] : NULL; //energies of the chains
+	mxArray **labelsOutPtr = (nlhs > 1) ? &plhs[1] : NULL; //labeling
+	mxArray **minMarginalsOutPtr = (nlhs > 2) ? &plhs[2] : NULL; //min-marginals
+
+	// get direction
+	MATLAB_ASSERT( mxIsChar(directionInPtr), "viterbiGridPottsMex:directionWrongType", "direction should be a string");
+	int direction = -1;
+	char buf[16];
+	if ( !mxGetString(directionInPtr, buf, sizeof(buf)) )
+		direction = getGridDirection(buf);
+	MATLAB_ASSERT( direction >= 0, "viterbiGridPottsMex:directionWrongValue", "direction should be 'vert', 'hor', 'mainDiag' or 'secondDiag'");
+
+	// get pairwise potentials, the size of the grid follows from their size
+	MATLAB_ASSERT( mxGetClassID(costsInPtr) == mxDOUBLE_CLASS, "viterbiGridPottsMex:pairwisePotentialsWrongType", "costs is of wrong type, expected double");
+	MATLAB_ASSERT( mxGetNumberOfDimensions(costsInPtr) == 2, "viterbiGridPottsMex:pairwisePotentialsWrongDimensionality", "costs is not 2-dimensional");
+	MATLAB_ASSERT( mxGetPi(costsInPtr) == NULL, "viterbiGridPottsMex:pairwisePotentialsComplex",  "Pairwise potentials should not be complex");
+	mwSize height = mxGetM(costsInPtr) + ((direction == HORIZONTAL) ? 0 : 1);
+	mwSize width = mxGetN(costsInPtr) + ((direction == VERTICAL) ? 0 : 1);
+	const double* costs = (const double*)mxGetData(costsInPtr);
+
+	// get unary potentials
+	MATLAB_ASSERT( mxGetClassID(unaryInPtr) == mxDOUBLE_CLASS, "viterbiGridPottsMex:unaryPotentialsWrongType", "unary is of wrong type, expected double");
+	MATLAB_ASSERT( mxGetPi(unaryInPtr) == NULL, "viterbiGridPottsMex:unaryPotentialsComplex",  "Unary potentials should not be complex");
+	int numLabels = (int)mxGetM(unaryInPtr);
+	MATLAB_ASSERT( numLabels >= 1, "viterbiGridPottsMex:unaryPotentialsWrongNumLabels", "The number of labels is not positive");
+	MATLAB_ASSERT( mxGetNumberOfElements(unaryInPtr) == numLabels * height * width, "viterbiGridPottsMex:unaryPotentialsWrongSize", "unary should be numLabels x (height * width), the size of the grid is given by costs");
+	const double* dataCost = (const double*)mxGetData(unaryInPtr);
+
+	int numThreads = 0;
+	if (numThreadsInPtr != NULL && !mxIsEmpty(numThreadsInPtr)) {
+		MATLAB_ASSERT( mxIsNumeric(numThreadsInPtr) && mxGetNumberOfElements(numThreadsInPtr) == 1, "viterbiGridPottsMex:numThreadsWrongType", "numThreads should be a numeric scalar");
+		double numThreadsValue = mxGetScalar(numThreadsInPtr);
+		MATLAB_ASSERT( numThreadsValue >= 1 && floor(numThreadsValue) == numThreadsValue, "viterbiGridPottsMex:numThreadsWrongValue", "numThreads should be a positive integer");
+		numThreads = (int)numThreadsValue;
+	}
+
+	vector<ChainProblem> problems;
+	vector<ptrdiff_t> chainFirst; // the first node of each chain
+	ptrdiff_t segmentStride = 0;
+	getGridChains(direction, height, width, numLabels, dataCost, costs, problems, chainFirst, segmentStride);
+	int numChains = (int)problems.size();
+
+	// outputs are allocated before the parallel part
+	mxArray* energyArray = mxCreateNumericMatrix(numChains, 1, mxDOUBLE_CLASS, mxREAL);
+	double* energy = (double*)mxGetData( energyArray );
+	if (energyOutPtr != NULL)
+		*energyOutPtr = energyArray;
+
+	double* segment = NULL;
+	if ( labelsOutPtr != NULL ){
+		*labelsOutPtr = mxCreateNumericMatrix(height, width, mxDOUBLE_CLASS, mxREAL);
+		segment = (double*)mxGetData( *labelsOutPtr );
+	}
+
+	// the min-marginals have the layout of the unary terms
+	double* minMarginals = NULL;
+	if ( minMarginalsOutPtr != NULL ){
+		*minMarginalsOutPtr = mxCreateNumericMatrix(numLabels, height * width, mxDOUBLE_CLASS, mxREAL);
+		minMarginals = (double*)mxGetData( *minMarginalsOutPtr );
+	}
+
+	ThreadPool* pool = getThreadPool(numThreads);
+	vector<ChainWorkspace> workspaces( pool -> getNumThreads() );
+	try {
+		pool -> parallelFor(numChains, [&](int iChain, int iThread) {
+			double* curSegment = (segment != NULL) ? segment + chainFirst[iChain] : NULL;
+			if (minMarginals != NULL)
+				energy[iChain] = solveChainMinMarginals(problems[iChain], workspaces[iThread], curSegment, segmentStride,
+					minMarginals + numLabels * chainFirst[iChain], numLabels * segmentStride, 1);
+			else
+				energy[iChain] = solveChain(problems[iChain], workspaces[iThread], curSegment, segmentStride);
+		});
+	}
+	catch (...) {
+		mexErrMsgTaskException("viterbiGridPottsMex:threadPool");
+	}
+
+	if (energyOutPtr == NULL)
+		mxDestroyArray(energyArray);
+}
@@ -0,0 +1,29 @@
+% viterbiGridPottsMex runs Viterbi algorithm on all the chains of one direction of a grid in one call
+% 
+% [energy, labels] = viterbiGridPottsMex(unary, costs, direction)
+% [energy, labels, minMarginals] = viterbiGridPottsMex(unary, costs, direction)
+% [energy, labels, minMarginals] = viterbiGridPottsMex(unary, costs, direction, numThreads)
+% 
+% INPUT
+%     unary     -   unary potentials, K x (H * W) double matrix, where K - number of labels,
+%               H x W - size of the grid, unary(k, i) is the potential for node i to be of label k;
+%               node i = y + H * (x - 1) is in row y and column x (the layout of dataCost in the DD-TRW oracles)
+%     costs     -   Potts coefficients of the edges of the direction:
+%               'vert'      :   (H - 1) x W, costs(y, x) is the edge (y, x) - (y + 1, x)
+%               'hor'       :   H x (W - 1), costs(y, x) is the edge (y, x) - (y, x + 1)
+%               'mainDiag'  :   (H - 1) x (W - 1), costs(y, x) is the edge (y, x) - (y + 1, x + 1)
+%               'secondDiag':   (H - 1) x (W - 1), costs(y, x) is the edge (y + 1, x) - (y, x + 1)
+%     direction -   'vert', 'hor', 'mainDiag' or 'secondDiag'
+%     numThreads    -   the number of threads (optional); by default, the environment variable SMR_NUM_THREADS or the number of cores is used
+% 
+% OUTPUT
+%     energy    -   energies of the chains, numChains x 1 vector;
+%               the columns for 'vert', the rows for 'hor', the diagonals for 'mainDiag' and 'secondDiag'
+%               (first the ones starting in the first column from top to bottom, then the ones starting in the first row
+%               for 'mainDiag' or in the last row for 'secondDiag' from left to right)
+%     labels    -   the best labelings of the chains, H x W double matrix
+%     minMarginals  -   K x (H * W) double matrix (the layout of unary), minMarginals(k, i) is the smallest energy of the labelings
+%               of the chain of node i with node i of label k; computed by a forward and a backward pass only if requested (about twice the cost)
+% 
+% The chains are solved in parallel, the result is the same as of viterbiPottsMex applied to every chain.
+% viterbiGridDynamicMex keeps the chains between the calls for the incremental updates of the unary terms.
@@ -0,0 +1,469 @@
+#include "viterbiPotts.h"
+#include "typePottsSimd.h"
+
+#include <algorithm>
+#include <limits>
+#include <string.h>
+
+// The forward pass keeps only two rows of the costs. For the Potts terms the best path to label k of the next node
+// either stays at k or jumps from the best label of the current node (from the second best one if k is the best),
+// so one byte per label and the two best labels of every node are enough to recover the labeling.
+
+///////////////////// scalar loops ///////////////////////
+
+// the smallest and the second smallest of x[k], k < K (the second equals the first if it is taken twice)
+inline void ViterbiMinTwoScalar(const double* x, int K, double& minValue, double& secondValue)
+{
+	minValue = std::numeric_limits<double>::infinity();
+	secondValue = std::numeric_limits<double>::infinity();
+	for (int k = 0; k < K; ++k) {
+		secondValue = std::min(secondValue, std::max(minValue, x[k]));
+		minValue = std::min(minValue, x[k]);
+	}
+}
+
+// cur[k] = min(prev[k], jump) + unary[k], jumped[k] = (jump <= prev[k]), k < K
+inline void ViterbiStepScalar(const double* prev, const double* unary, double jump, int K, double* cur, unsigned char* jumped)
+{
+	for (int k = 0; k < K; ++k) {
+		jumped[k] = !(prev[k] < jump);
+		cur[k] = std::min(prev[k], jump) + unary[k];
+	}
+}
+
+///////////////////// vectorized loops ///////////////////////
+// The rows are padded, the lanes after K are replaced by +inf in the minimum, their costs and flags are garbage.
+
+#ifdef POTTS_SIMD_X86
+
+#define VITERBI_SIMD_LOOPS(ISA, TARGET) \
+template <class S> POTTS_SIMD_TARGET(TARGET) inline void ViterbiMinTwo##ISA(const double* x, int K, double& minValue, double& secondValue) \
+{ \
+	typename S::V vInf = S::Set1(std::numeric_limits<double>::infinity()); \
+	typename S::V vMin = vInf; \
+	typename S::V vSecond = vInf; \
+	for (int k = 0; k < K; k += S::W) { \
+		typename S::V v = S::Select(K - k, S::Load(x + k), vInf); \
+		vSecond = S::Min(vSecond, S::Max(vMin, v)); \
+		vMin = S::Min(vMin, v); \
+	} \
+	/* the two smallest values are among the two smallest of every lane */ \
+	double lanes[2 * S::W]; \
+	S::Store(lanes, vMin); \
+	S::Store(lanes + S::W, vSecond); \
+	ViterbiMinTwoScalar(lanes, 2 * S::W, minValue, secondValue); \
+} \
+ \
+template <class S> POTTS_SIMD_TARGET(TARGET) inline void ViterbiStep##ISA(const double* prev, const double* unary, double jump, int K, double* cur, unsigned char* jumped) \
+{ \
+	typename S::V vJump = S::Set1(jump); \
+	for (int k = 0; k < K; k += S::W) { \
+		typename S::V stay = S::Load(prev + k); \
+		int mask = ~S::LessMask(stay, vJump); \
+		S::Store(cur + k, S::Add(S::Min(stay, vJump), S::Load(unary + k))); \
+		for (int j = 0; j < S::W; ++j) \
+			jumped[k + j] = (unsigned char)((mask >> j) & 1); \
+	} \
+}
+
+VITERBI_SIMD_LOOPS(Sse2, "sse2")
+VITERBI_SIMD_LOOPS(Avx2, "avx2")
+VITERBI_SIMD_LOOPS(Avx512, "avx512f")
+
+#undef VITERBI_SIMD_LOOPS
+
+	#define VITERBI_SIMD_DISPATCH(LOOP, ARGS) \
+		switch (GetPottsSimdLevel()) \
+		{ \
+			case POTTS_SIMD_AVX512: return LOOP##Avx512<PottsAvx512Double> ARGS; \
+			case POTTS_SIMD_AVX2:   return LOOP##Avx2<PottsAvx2Double> ARGS; \
+			case POTTS_SIMD_SSE2:   return LOOP##Sse2<PottsSse2Double> ARGS; \
+			default:                return LOOP##Scalar ARGS; \
+		}
+#else
+	#define VITERBI_SIMD_DISPATCH(LOOP, ARGS) return LOOP##Scalar ARGS;
+#endif
+
+inline void ViterbiSimdMinTwo(const double* x, int K, double& minValue, double& secondValue)
+{
+	VITERBI_SIMD_DISPATCH(ViterbiMinTwo, (x, K, minValue, secondValue))
+}
+
+inline void ViterbiSimdStep(const double* prev, const double* unary, double jump, int K, double* cur, unsigned char* jumped)
+{
+	VITERBI_SIMD_DISPATCH(ViterbiStep, (prev, unary, jump, K, cur, jumped))
+}
+
+#undef VITERBI_SIMD_DISPATCH
+
+// the two smallest costs and their labels; ties are broken as in the sequential scan with the strict comparisons:
+// the labels 0 and 1 are visited first (label 1 before label 0 if x[0] >= x[1]), then 2, ..., K - 1, the first visited label wins
+inline void ViterbiMinTwoPoints(const double* x, int K, double& minValue, double& secondValue, int& minPoint, int& secondMinPoint)
+{
+	ViterbiSimdMinTwo(x, K, minValue, secondValue);
+	int firstPoint = (K > 1 && !(x[0] < x[1])) ? 1 : 0;
+	minPoint = firstPoint;
+	if (x[minPoint] != minValue) {
+		minPoint = 2;
+		while (minPoint < K - 1 && x[minPoint] != minValue)
+			++minPoint;
+	}
+	secondMinPoint = minPoint;
+	if (K < 2)
+		return;
+	if (minPoint != firstPoint && x[firstPoint] == secondValue) {
+		secondMinPoint = firstPoint;
+	} else if (minPoint != 1 - firstPoint && x[1 - firstPoint] == secondValue) {
+		secondMinPoint = 1 - firstPoint;
+	} else {
+		for(int k = 2; k < K; ++k)
+			if (k != minPoint && x[k] == secondValue) {
+				secondMinPoint = k;
+				break;
+			}
+	}
+}
+
+double solveChain(const ChainProblem& problem, ChainWorkspace& workspace, double* segment, ptrdiff_t segmentStride)
+{
+	int numNodes = problem.numNodes;
+	int numLabels = problem.numLabels;
+	const double* dataCost = problem.dataCost;
+	ptrdiff_t nodeStride = problem.nodeStride;
+	ptrdiff_t labelStride = problem.labelStride;
+	const double* pairwiseCost = problem.pairwiseCost;
+	ptrdiff_t pairwiseStride = problem.pairwiseStride;
+
+	// the vector loops read and write whole registers, the flags of the last edge are followed by the padding too
+	int paddedSize = PottsSimdPaddedSize<double>(numLabels);
+	workspace.cost.resize(3 * paddedSize);
+	workspace.jumped.resize((size_t)(numNodes - 1) * numLabels + paddedSize);
+	workspace.jumpFrom.resize(2 * numNodes);
+	double* prevCost = &workspace.cost[0];
+	double* curCost = prevCost + paddedSize;
+	double* unary = curCost + paddedSize;
+	unsigned char* jumped = &workspace.jumped[0];
+	int* jumpFrom = &workspace.jumpFrom[0];
+
+	// put the first line
+	for(int iLabel = 0; iLabel < numLabels; ++iLabel)
+		prevCost[iLabel] = dataCost[labelStride * iLabel];
+
+	for(int iNode = 1; iNode < numNodes; ++iNode) {
+		for(int iLabel = 0; iLabel < numLabels; ++iLabel)
+			unary[iLabel] = dataCost[iNode * nodeStride + labelStride * iLabel];
+
+		double minValue, secondValue;
+		int minPoint, secondMinPoint;
+		ViterbiMinTwoPoints(prevCost, numLabels, minValue, secondValue, minPoint, secondMinPoint);
+
+		// stay at the label or jump from the best label, the best label itself jumps from the second one
+		double pairwise = pairwiseCost[(iNode - 1) * pairwiseStride];
+		unsigned char* curJumped = jumped + (size_t)(iNode - 1) * numLabels;
+		ViterbiSimdStep(prevCost, unary, minValue + pairwise, numLabels, curCost, curJumped);
+
+		double jump = secondValue + pairwise;
+		curJumped[minPoint] = !(prevCost[minPoint] < jump);
+		curCost[minPoint] = std::min(prevCost[minPoint], jump) + unary[minPoint];
+
+		jumpFrom[2 * (iNode - 1)] = minPoint;
+		jumpFrom[2 * (iNode - 1) + 1] = secondMinPoint;
+		std::swap(prevCost, curCost);
+	}
+
+	// find best energy
+	int minPoint = 0;
+	double energy = prevCost[minPoint];
+	for(int iLabel = 1; iLabel < numLabels; ++iLabel)
+		if(prevCost[iLabel] < energy ){
+			minPoint = iLabel;
+			energy = prevCost[minPoint];
+		}
+
+	//output minimum cut
+	if ( segment != NULL ){
+		segment[ (numNodes - 1) * segmentStride ] = minPoint + 1;
+		for(int iNode = numNodes - 2; iNode >= 0; --iNode) {
+			if (jumped[(size_t)iNode * numLabels + minPoint])
+				minPoint = (minPoint != jumpFrom[2 * iNode]) ? jumpFrom[2 * iNode] : jumpFrom[2 * iNode + 1];
+			segment[ iNode * segmentStride ] = minPoint + 1;
+		}
+	}
+
+	return energy;
+}
+
+///////////////////// cached messages ///////////////////////
+
+// row iNode of the messages from the row of the previous node of the pass (prev == NULL for the first node) and the unary terms;
+// the best label itself can only be reached from the second best one
+inline void ViterbiPassRow(const double* prev, const double* prevMin, const int* prevMinPoint, double pairwise, const double* unary, int K,
+	double* cur, double* curMin, int* curMinPoint, unsigned char* jumped)
+{
+	if (prev == NULL) {
+		for (int k = 0; k < K; ++k)
+			cur[k] = unary[k];
+	} else {
+		ViterbiSimdStep(prev, unary, prevMin[0] + pairwise, K, cur, jumped);
+		cur[prevMinPoint[0]] = std::min(prev[prevMinPoint[0]], prevMin[1] + pairwise) + unary[prevMinPoint[0]];
+	}
+	ViterbiMinTwoPoints(cur, K, curMin[0], curMin[1], curMinPoint[0], curMinPoint[1]);
+}
+
+// the label of a node given the label of its neighbor in the pass that computed the row (stay is the value of the row at label,
+// rowMin and rowMinPoint are its two smallest values and their labels): the rule of the backtracking of solveChain
+inline int ViterbiFollow(double stay, const double* rowMin, const int* rowMinPoint, double pairwise, int label)
+{
+	double jump = ((label != rowMinPoint[0]) ? rowMin[0] : rowMin[1]) + pairwise;
+	if (stay < jump)
+		return label;
+	return (label != rowMinPoint[0]) ? rowMinPoint[0] : rowMinPoint[1];
+}
+
+static void forwardRows(const ChainProblem& problem, ChainCache& cache, int first, int last, ChainWorkspace& workspace)
+{
+	int numLabels = problem.numLabels;
+	size_t paddedSize = PottsSimdPaddedSize<double>(numLabels);
+	double* unary = &workspace.cost[2 * paddedSize];
+	for (int iNode = first; iNode <= last; ++iNode) {
+		for(int iLabel = 0; iLabel < numLabels; ++iLabel)
+			unary[iLabel] = problem.dataCost[iNode * problem.nodeStride + problem.labelStride * iLabel];
+		bool isFirst = (iNode == 0);
+		ViterbiPassRow(isFirst ? NULL : &cache.forward[(iNode - 1) * paddedSize], isFirst ? NULL : &cache.forwardMin[2 * (iNode - 1)],
+			isFirst ? NULL : &cache.forwardMinPoint[2 * (iNode - 1)], isFirst ? 0.0 : problem.pairwiseCost[(iNode - 1) * problem.pairwiseStride],
+			unary, numLabels, &cache.forward[iNode * paddedSize], &cache.forwardMin[2 * iNode], &cache.forwardMinPoint[2 * iNode], &workspace.jumped[0]);
+	}
+}
+
+static void backwardRows(const ChainProblem& problem, ChainCache& cache, int first, int last, ChainWorkspace& workspace)
+{
+	int numLabels = problem.numLabels;
+	size_t paddedSize = PottsSimdPaddedSize<double>(numLabels);
+	double* unary = &workspace.cost[2 * paddedSize];
+	for (int iNode = last; iNode >= first; --iNode) {
+		for(int iLabel = 0; iLabel < numLabels; ++iLabel)
+			unary[iLabel] = problem.dataCost[iNode * problem.nodeStride + problem.labelStride * iLabel];
+		bool isLast = (iNode == problem.numNodes - 1);
+		ViterbiPassRow(isLast ? NULL : &cache.backward[(iNode + 1) * paddedSize], isLast ? NULL : &cache.backwardMin[2 * (iNode + 1)],
+			isLast ? NULL : &cache.backwardMinPoint[2 * (iNode + 1)], isLast ? 0.0 : problem.pairwiseCost[iNode * problem.pairwiseStride],
+			unary, numLabels, &cache.backward[iNode * paddedSize], &cache.backwardMin[2 * iNode], &cache.backwardMinPoint[2 * iNode], &workspace.jumped[0]);
+	}
+}
+
+// the forward messages are up to date up to split, the backward ones from split on (or split is the last node):
+// the best label of split is found from both of them, the other labels follow the messages to the left and to the right
+static double decodeChain(const ChainProblem& problem, ChainCache& cache, int split, ChainWorkspace& workspace, double* segment, ptrdiff_t segmentStride)
+{
+	int numNodes = problem.numNodes;
+	int numLabels = problem.numLabels;
+	size_t paddedSize = PottsSimdPaddedSize<double>(numLabels);
+
+	// the last node needs only the forward messages, the energy is then computed exactly as by solveChain
+	double* belief = &cache.forward[split * paddedSize];
+	if (split != numNodes - 1) {
+		belief = &workspace.cost[paddedSize];
+		const double* backward = &cache.backward[split * paddedSize];
+		for(int iLabel = 0; iLabel < numLabels; ++iLabel)
+			belief[iLabel] = cache.forward[split * paddedSize + iLabel] + backward[iLabel]
+				- problem.dataCost[split * problem.nodeStride + problem.labelStride * iLabel];
+	}
+
+	int minPoint = 0;
+	double energy = belief[minPoint];
+	for(int iLabel = 1; iLabel < numLabels; ++iLabel)
+		if(belief[iLabel] < energy ){
+			minPoint = iLabel;
+			energy = belief[minPoint];
+		}
+
+	if ( segment != NULL ){
+		segment[ split * segmentStride ] = minPoint + 1;
+		int label = minPoint;
+		for(int iNode = split - 1; iNode >= 0; --iNode) {
+			label = ViterbiFollow(cache.forward[iNode * paddedSize + label], &cache.forwardMin[2 * iNode], &cache.forwardMinPoint[2 * iNode],
+				problem.pairwiseCost[iNode * problem.pairwiseStride], label);
+			segment[ iNode * segmentStride ] = label + 1;
+		}
+		label = minPoint;
+		for(int iNode = split + 1; iNode < numNodes; ++iNode) {
+			label = ViterbiFollow(cache.backward[iNode * paddedSize + label], &cache.backwardMin[2 * iNode], &cache.backwardMinPoint[2 * iNode],
+				problem.pairwiseCost[(iNode - 1) * problem.pairwiseStride], label);
+			segment[ iNode * segmentStride ] = label + 1;
+		}
+	}
+	return energy;
+}
+
+double solveChainCached(const ChainProblem& problem, ChainCache& cache, ChainWorkspace& workspace, double* segment, ptrdiff_t segmentStride)
+{
+	int numNodes = problem.numNodes;
+	size_t paddedSize = PottsSimdPaddedSize<double>(problem.numLabels);
+	workspace.cost.resize(3 * paddedSize);
+	workspace.jumped.resize(paddedSize);
+
+	cache.forward.assign(numNodes * paddedSize, 0.0);
+	cache.backward.assign(numNodes * paddedSize, 0.0);
+	cache.forwardMin.resize(2 * numNodes);
+	cache.backwardMin.resize(2 * numNodes);
+	cache.forwardMinPoint.resize(2 * numNodes);
+	cache.backwardMinPoint.resize(2 * numNodes);
+
+	forwardRows(problem, cache, 0, numNodes - 1, workspace);
+	backwardRows(problem, cache, 0, numNodes - 1, workspace);
+	cache.forwardEnd = numNodes;
+	cache.backwardBegin = 0;
+
+	return decodeChain(problem, cache, numNodes - 1, workspace, segment, segmentStride);
+}
+
+double updateChainCached(const ChainProblem& problem, ChainCache& cache, int firstChanged, int lastChanged, ChainWorkspace& workspace, double* segment, ptrdiff_t segmentStride)
+{
+	int numNodes = problem.numNodes;
+	size_t paddedSize = PottsSimdPaddedSize<double>(problem.numLabels);
+	workspace.cost.resize(3 * paddedSize);
+	workspace.jumped.resize(paddedSize);
+
+	cache.forwardEnd = std::min(cache.forwardEnd, firstChanged);
+	cache.backwardBegin = std::max(cache.backwardBegin, lastChanged + 1);
+
+	// the forward messages are extended to the first up to date backward row, it is the changed part
+	// when the messages were up to date before the call and the gap left by the previous calls otherwise
+	int split = std::min(cache.backwardBegin, numNodes - 1);
+	if (cache.forwardEnd <= split) {
+		forwardRows(problem, cache, cache.forwardEnd, split, workspace);
+		cache.forwardEnd = split + 1;
+	}
+	return decodeChain(problem, cache, cache.forwardEnd - 1, workspace, segment, segmentStride);
+}
+
+double solveChainMinMarginals(const ChainProblem& problem, ChainWorkspace& workspace, double* segment, ptrdiff_t segmentStride,
+	double* minMarginals, ptrdiff_t marginalNodeStride, ptrdiff_t marginalLabelStride)
+{
+	int numNodes = problem.numNodes;
+	int numLabels = problem.numLabels;
+	size_t paddedSize = PottsSimdPaddedSize<double>(numLabels);
+	workspace.cost.resize(3 * paddedSize);
+	workspace.jumped.resize(paddedSize);
+	workspace.minValues.resize(2 * numNodes);
+	workspace.minPoints.resize(2 * numNodes);
+	double* prev = &workspace.cost[0];
+	double* cur = prev + paddedSize;
+	double* unary = cur + paddedSize;
+	double* minValues = &workspace.minValues[0];
+	int* minPoints = &workspace.minPoints[0];
+
+	// the forward messages are written to minMarginals, only the two best labels of every node are kept for the backtracking
+	for(int iNode = 0; iNode < numNodes; ++iNode) {
+		for(int iLabel = 0; iLabel < numLabels; ++iLabel)
+			unary[iLabel] = problem.dataCost[iNode * problem.nodeStride + problem.labelStride * iLabel];
+		bool isFirst = (iNode == 0);
+		ViterbiPassRow(isFirst ? NULL : prev, isFirst ? NULL : minValues + 2 * (iNode - 1), isFirst ? NULL : minPoints + 2 * (iNode - 1),
+			isFirst ? 0.0 : problem.pairwiseCost[(iNode - 1) * problem.pairwiseStride], unary, numLabels, cur, minValues + 2 * iNode, minPoints + 2 * iNode, &workspace.jumped[0]);
+		for(int iLabel = 0; iLabel < numLabels; ++iLabel)
+			minMarginals[iNode * marginalNodeStride + iLabel * marginalLabelStride] = cur[iLabel];
+		std::swap(prev, cur);
+	}
+
+	int minPoint = 0;
+	double energy = prev[minPoint];
+	for(int iLabel = 1; iLabel < numLabels; ++iLabel)
+		if(prev[iLabel] < energy ){
+			minPoint = iLabel;
+			energy = prev[minPoint];
+		}
+
+	if ( segment != NULL ){
+		segment[ (numNodes - 1) * segmentStride ] = minPoint + 1;
+		int label = minPoint;
+		for(int iNode = numNodes - 2; iNode >= 0; --iNode) {
+			label = ViterbiFollow(minMarginals[iNode * marginalNodeStride + label * marginalLabelStride], minValues + 2 * iNode, minPoints + 2 * iNode,
+				problem.pairwiseCost[iNode * problem.pairwiseStride], label);
+			segment[ iNode * segmentStride ] = label + 1;
+		}
+	}
+
+	// the backward pass keeps only the row of the next node, the message from it is added to the forward one
+	double* next = prev;
+	for(int iLabel = 0; iLabel < numLabels; ++iLabel)
+		next[iLabel] = problem.dataCost[(numNodes - 1) * problem.nodeStride + problem.labelStride * iLabel];
+	for(int iNode = numNodes - 2; iNode >= 0; --iNode) {
+		double minValue, secondValue;
+		int nextMinPoint, nextSecondMinPoint;
+		ViterbiMinTwoPoints(next, numLabels, minValue, secondValue, nextMinPoint, nextSecondMinPoint);
+
+		// the message is min(next[k], jump) except for the best label of the next node, it is fixed afterwards
+		double pairwise = problem.pairwiseCost[iNode * problem.pairwiseStride];
+		double jump = minValue + pairwise;
+		const double* dataCost = problem.dataCost + iNode * problem.nodeStride;
+		double* marginals = minMarginals + iNode * marginalNodeStride;
+		double bestForward = marginals[nextMinPoint * marginalLabelStride];
+		for(int iLabel = 0; iLabel < numLabels; ++iLabel) {
+			double message = std::min(next[iLabel], jump);
+			cur[iLabel] = message + dataCost[problem.labelStride * iLabel];
+			marginals[iLabel * marginalLabelStride] += message;
+		}
+		double message = std::min(next[nextMinPoint], secondValue + pairwise);
+		cur[nextMinPoint] = message + dataCost[problem.labelStride * nextMinPoint];
+		marginals[nextMinPoint * marginalLabelStride] = bestForward + message;
+		std::swap(next, cur);
+	}
+	return energy;
+}
+
+///////////////////// grid chains ///////////////////////
+
+int getGridDirection(const char* name)
+{
+	if ( !strcmp(name, "vert") ) return VERTICAL;
+	if ( !strcmp(name, "hor") ) return HORIZONTAL;
+	if ( !strcmp(name, "mainDiag") ) return MAIN_DIAGONAL;
+	if ( !strcmp(name, "secondDiag") ) return SECOND_DIAGONAL;
+	return -1;
+}
+
+void getGridChains(int direction, mwSize height, mwSize width, int numLabels, const double* dataCost, const double* costs,
+	vector<ChainProblem>& problems, vector<ptrdiff_t>& chainFirst, ptrdiff_t& segmentStride)
+{
+	ptrdiff_t numLabelsStride = numLabels;
+	problems.clear();
+	chainFirst.clear();
+	if (direction == VERTICAL) {
+		for (mwIndex x = 0; x < width; ++x) {
+			ChainProblem problem = {(int)height, numLabels, dataCost + numLabelsStride * height * x, numLabelsStride, 1, costs + (height - 1) * x, 1};
+			problems.push_back(problem);
+			chainFirst.push_back(height * x);
+		}
+		segmentStride = 1;
+	} else if (direction == HORIZONTAL) {
+		for (mwIndex y = 0; y < height; ++y) {
+			ChainProblem problem = {(int)width, numLabels, dataCost + numLabelsStride * y, numLabelsStride * (ptrdiff_t)height, 1, costs + y, (ptrdiff_t)height};
+			problems.push_back(problem);
+			chainFirst.push_back(y);
+		}
+		segmentStride = height;
+	} else if (direction == MAIN_DIAGONAL) {
+		// edge (y, x) - (y + 1, x + 1) has cost costs[y + (height - 1) * x]
+		for (mwIndex start = 0; start < height + width - 1; ++start) {
+			mwIndex y = (start < height) ? start : 0;
+			mwIndex x = (start < height) ? 0 : start - height + 1;
+			mwSize numNodes = std::min<mwSize>(height - y, width - x);
+			ChainProblem problem = {(int)numNodes, numLabels, dataCost + numLabelsStride * (y + height * x), numLabelsStride * ((ptrdiff_t)height + 1), 1,
+				(numNodes > 1) ? costs + y + (height - 1) * x : NULL, (ptrdiff_t)height};
+			problems.push_back(problem);
+			chainFirst.push_back(y + height * x);
+		}
+		segmentStride = height + 1;
+	} else {
+		// edge (y, x) - (y - 1, x + 1) has cost costs[y - 1 + (height - 1) * x]
+		for (mwIndex start = 0; start < height + width - 1; ++start) {
+			mwIndex y = (start < height) ? start : height - 1;
+			mwIndex x = (start < height) ? 0 : start - height + 1;
+			mwSize numNodes = std::min<mwSize>(y + 1, width - x);
+			ChainProblem problem = {(int)numNodes, numLabels, dataCost + numLabelsStride * (y + height * x), numLabelsStride * ((ptrdiff_t)height - 1), 1,
+				(numNodes > 1) ? costs + (y - 1) + (height - 1) * x : NULL, (ptrdiff_t)height - 2};
+			problems.push_back(problem);
+			chainFirst.push_back(y + height * x);
+		}
+		segmentStride = (ptrdiff_t)height - 1;
+	}
+}
@@ -0,0 +1,79 @@
+#ifndef __VITERBIPOTTS_H__
+#define __VITERBIPOTTS_H__
+
+#include "mex.h"
+
+#include <cstddef>
+#include <vector>
+using std::vector;
+
+#define MATLAB_ASSERT(expr,errorId,msg) if (!(expr)) {mexErrMsgIdAndTxt(errorId,msg);}
+
+// Chain solver shared by viterbiPottsMex, viterbiGridPottsMex and viterbiGridDynamicMex
+
+// a chain with the Potts pairwise terms: the unary term of node i and label k is dataCost[i * nodeStride + k * labelStride],
+// the cost of the edge (i, i + 1) is pairwiseCost[i * pairwiseStride]
+struct ChainProblem
+{
+	int numNodes;
+	int numLabels;
+	const double* dataCost;
+	ptrdiff_t nodeStride;
+	ptrdiff_t labelStride;
+	const double* pairwiseCost;
+	ptrdiff_t pairwiseStride;
+};
+
+// buffers reused by the consecutive chains processed by one thread
+struct ChainWorkspace
+{
+	vector<double> cost; // costs of the previous and the current node and the unary terms of the current node, padded for the vector loads
+	vector<unsigned char> jumped; // jumped[k + numLabels * i] = 1 if the best path to label k of node i + 1 comes from another label
+	vector<int> jumpFrom; // the best and the second best label of node i: a jump to label k comes from the best one unless it is k
+	vector<double> minValues; // the two smallest forward costs of every node and their labels (solveChainMinMarginals)
+	vector<int> minPoints;
+};
+
+// runs Viterbi with the loops over the labels vectorized (see typePottsSimd.h), writes the label (1-based) of node i to segment[i * segmentStride] if segment is not NULL;
+// does not call MATLAB API and thus can be run on the thread pool
+double solveChain(const ChainProblem& problem, ChainWorkspace& workspace, double* segment, ptrdiff_t segmentStride = 1);
+
+// solves the chain as solveChain and writes the min-marginals (the smallest energy of the labelings with node i at label k)
+// to minMarginals[i * marginalNodeStride + k * marginalLabelStride]: a forward and a backward pass, about twice the cost of solveChain
+double solveChainMinMarginals(const ChainProblem& problem, ChainWorkspace& workspace, double* segment, ptrdiff_t segmentStride,
+	double* minMarginals, ptrdiff_t marginalNodeStride, ptrdiff_t marginalLabelStride);
+
+// Messages of a chain kept between the calls for the incremental updates, the rows are padded for the vector loops:
+// forward[i] is the cost of the best labeling of nodes 0..i given the label of node i, backward[i] the same for nodes i..numNodes - 1,
+// both include the unary term of node i. A change of the unary term of node p outdates forward[i], i >= p, and backward[i], i <= p.
+struct ChainCache
+{
+	vector<double> forward;
+	vector<double> backward;
+	vector<double> forwardMin; // the two smallest values of every row and their labels
+	vector<double> backwardMin;
+	vector<int> forwardMinPoint;
+	vector<int> backwardMinPoint;
+	int forwardEnd; // forward[i] is up to date for i < forwardEnd
+	int backwardBegin; // backward[i] is up to date for i >= backwardBegin
+};
+
+// solves the chain as solveChain and fills all the messages of cache
+double solveChainCached(const ChainProblem& problem, ChainCache& cache, ChainWorkspace& workspace, double* segment, ptrdiff_t segmentStride = 1);
+// the unary terms of nodes firstChanged..lastChanged have changed since the last call: only the outdated messages between
+// the up to date forward and backward ones are recomputed; the labeling is written as by solveChain
+double updateChainCached(const ChainProblem& problem, ChainCache& cache, int firstChanged, int lastChanged, ChainWorkspace& workspace, double* segment, ptrdiff_t segmentStride = 1);
+
+// the chains of a grid direction, node (y, x) is y + height * x
+enum GridDirection { VERTICAL, HORIZONTAL, MAIN_DIAGONAL, SECOND_DIAGONAL };
+
+// 'vert', 'hor', 'mainDiag' or 'secondDiag', -1 for other strings
+int getGridDirection(const char* name);
+
+// the chains start at the first column (top to bottom), the diagonals then continue with the first row ('\')
+// or the last row ('/') from left to right; node i of chain c is chainFirst[c] + i * segmentStride;
+// dataCost is numLabels x (height * width), costs is the matrix of the edges of the direction (see viterbiGridPottsMex.m)
+void getGridChains(int direction, mwSize height, mwSize width, int numLabels, const double* dataCost, const double* costs,
+	vector<ChainProblem>& problems, vector<ptrdiff_t>& chainFirst, ptrdiff_t& segmentStride);
+
+#endif
@@ -1,25 +1,128 @@
-#include "mex.h"
-#define MATLAB_ASSERT(expr,errorId,msg) if (!(expr)) {mexErrMsgIdAndTxt(errorId,msg);}
+#include "viterbiPotts.h"
+#include "threadPool.h"
 
-#include <vector>
-using std::vector;
+#include <cmath>
 
-void mexFunction(int nlhs, mxArray *plhs[], 
+// checks the input and fills problem, called from the MATLAB thread only
+void readProblem(const mxArray* unaryInPtr, const mxArray* pairwiseInPtr, ChainProblem& problem);
+
+void mexFunction(int nlhs, mxArray *plhs[],
     int nrhs, const mxArray *prhs[])
 {
-	MATLAB_ASSERT( nrhs == 2, "viterbiPottsMex:inputParameters", "Wrong number of input input arguments, expected 2");
-	MATLAB_ASSERT( nlhs <= 2, "viterbiPottsMex:outputParameters", "Too many output arguments, expected 0 - 2");
+	MATLAB_ASSERT( nrhs == 2 || nrhs == 3, "viterbiPottsMex:inputParameters", "Wrong number of input input arguments, expected 2 or 3");
+	MATLAB_ASSERT( nlhs <= 3, "viterbiPottsMex:outputParameters", "Too many output arguments, expected 0 - 3");
 
 	// set up pointers for input/ output parameters
 	const mxArray* unaryInPtr = prhs[0]; //unary terms
 	const mxArray* pairwiseInPtr = prhs[1]; //pairwise terms
-	
+	const mxArray* numThreadsInPtr = (nrhs > 2) ? prhs[2] : NULL; //number of threads
+
 	mxArray **energyOutPtr = (nlhs > 0) ? &plhs[0] : NULL; //energy
 	mxArray **labelsOutPtr = (nlhs > 1) ? &plhs[1] : NULL; //labeling
-	
+	mxArray **minMarginalsOutPtr = (nlhs > 2) ? &plhs[2] : NULL; //min-marginals
+
+	if ( !mxIsCell(unaryInPtr) ) {
+		MATLAB_ASSERT( !mxIsCell(pairwiseInPtr), "viterbiPottsMex:pairwisePotentialsWrongType", "costs can be a cell array only in the batch mode");
+		MATLAB_ASSERT( numThreadsInPtr == NULL || mxIsEmpty(numThreadsInPtr), "viterbiPottsMex:inputParameters", "numThreads can be specified only in the batch mode");
+
+		ChainProblem problem;
+		readProblem(unaryInPtr, pairwiseInPtr, problem);
+
+		// start computing
+		double* segment = NULL;
+		if ( labelsOutPtr != NULL ){
+			*labelsOutPtr = mxCreateNumericMatrix(problem.numNodes, 1, mxDOUBLE_CLASS, mxREAL);
+			segment = (double*)mxGetData( *labelsOutPtr );
+		}
+
+		// the min-marginals have the layout of the unary terms
+		ChainWorkspace workspace;
+		double energy = 0;
+		if ( minMarginalsOutPtr != NULL ){
+			*minMarginalsOutPtr = mxCreateNumericMatrix(problem.numNodes, problem.numLabels, mxDOUBLE_CLASS, mxREAL);
+			energy = solveChainMinMarginals(problem, workspace, segment, 1, (double*)mxGetData( *minMarginalsOutPtr ), 1, problem.numNodes);
+		} else {
+			energy = solveChain(problem, workspace, segment);
+		}
+
+		//output minimum value
+		if (energyOutPtr != NULL){
+			*energyOutPtr = mxCreateNumericMatrix(1, 1, mxDOUBLE_CLASS, mxREAL);
+			*(double*)mxGetData( *energyOutPtr ) = energy;
+		}
+		return;
+	}
+
+	// batch mode: independent chains are processed in parallel
+	int numChains = (int)mxGetNumberOfElements(unaryInPtr);
+	MATLAB_ASSERT( numChains >= 1, "viterbiPottsMex:unaryPotentialsWrongType", "cell array unary is empty");
+	MATLAB_ASSERT( !mxIsCell(pairwiseInPtr) || (int)mxGetNumberOfElements(pairwiseInPtr) == numChains, "viterbiPottsMex:pairwisePotentialsWrongSize", "Cell arrays unary and costs are of different sizes");
+
+	int numThreads = 0;
+	if (numThreadsInPtr != NULL && !mxIsEmpty(numThreadsInPtr)) {
+		MATLAB_ASSERT( mxIsNumeric(numThreadsInPtr) && mxGetNumberOfElements(numThreadsInPtr) == 1, "viterbiPottsMex:numThreadsWrongType", "numThreads should be a numeric scalar");
+		double numThreadsValue = mxGetScalar(numThreadsInPtr);
+		MATLAB_ASSERT( numThreadsValue >= 1 && floor(numThreadsValue) == numThreadsValue, "viterbiPottsMex:numThreadsWrongValue", "numThreads should be a positive integer");
+		numThreads = (int)numThreadsValue;
+	}
+
+	vector<ChainProblem> problems(numChains);
+	for(int iChain = 0; iChain < numChains; ++iChain) {
+		const mxArray* curUnaryInPtr = mxGetCell(unaryInPtr, iChain);
+		const mxArray* curPairwiseInPtr = mxIsCell(pairwiseInPtr) ? mxGetCell(pairwiseInPtr, iChain) : pairwiseInPtr;
+		MATLAB_ASSERT( curUnaryInPtr != NULL && curPairwiseInPtr != NULL, "viterbiPottsMex:inputParameters", "Some cell of the batch is empty");
+		readProblem(curUnaryInPtr, curPairwiseInPtr, problems[iChain]);
+	}
+
+	// outputs are allocated before the parallel part
+	mxArray* energyArray = mxCreateNumericMatrix(numChains, 1, mxDOUBLE_CLASS, mxREAL);
+	double* energy = (double*)mxGetData( energyArray );
+	if (energyOutPtr != NULL)
+		*energyOutPtr = energyArray;
+
+	vector<double*> segments(numChains, (double*)NULL);
+	if ( labelsOutPtr != NULL ){
+		*labelsOutPtr = mxCreateCellMatrix(numChains, 1);
+		for(int iChain = 0; iChain < numChains; ++iChain) {
+			mxArray* curLabels = mxCreateNumericMatrix(problems[iChain].numNodes, 1, mxDOUBLE_CLASS, mxREAL);
+			segments[iChain] = (double*)mxGetData( curLabels );
+			mxSetCell(*labelsOutPtr, iChain, curLabels);
+		}
+	}
+
+	vector<double*> minMarginals(numChains, (double*)NULL);
+	if ( minMarginalsOutPtr != NULL ){
+		*minMarginalsOutPtr = mxCreateCellMatrix(numChains, 1);
+		for(int iChain = 0; iChain < numChains; ++iChain) {
+			mxArray* curMinMarginals = mxCreateNumericMatrix(problems[iChain].numNodes, problems[iChain].numLabels, mxDOUBLE_CLASS, mxREAL);
+			minMarginals[iChain] = (double*)mxGetData( curMinMarginals );
+			mxSetCell(*minMarginalsOutPtr, iChain, curMinMarginals);
+		}
+	}
+
+	ThreadPool* pool = getThreadPool(numThreads);
+	vector<ChainWorkspace> workspaces( pool -> getNumThreads() );
+	try {
+		pool -> parallelFor(numChains, [&](int iChain, int iThread) {
+			if (minMarginals[iChain] != NULL)
+				energy[iChain] = solveChainMinMarginals(problems[iChain], workspaces[iThread], segments[iChain], 1, minMarginals[iChain], 1, problems[iChain].numNodes);
+			else
+				energy[iChain] = solveChain(problems[iChain], workspaces[iThread], segments[iChain]);
+		});
+	}
+	catch (...) {
+		mexErrMsgTaskException("viterbiPottsMex:threadPool");
+	}
+
+	if (energyOutPtr == NULL)
+		mxDestroyArray(energyArray);
+}
+
+void readProblem(const mxArray* unaryInPtr, const mxArray* pairwiseInPtr, ChainProblem& problem)
+{
 	int numNodes = 0;
 	int numLabels = 0;
-	
+
 	// get unary potentials
 	MATLAB_ASSERT(  mxGetClassID( unaryInPtr ) == mxDOUBLE_CLASS, "viterbiPottsMex:unaryPotentialsWrongType", "unaryTerms is of wrong type, expected double");
 	MATLAB_ASSERT(  mxGetNumberOfDimensions( unaryInPtr ) == 2, "viterbiPottsMex:unaryPotentialsWrongDimensionality", "unaryTerms is not 2-dimensional");
@@ -30,7 +133,7 @@ void mexFunction(int nlhs, mxArray *plhs[],
 	MATLAB_ASSERT(numLabels >= 1, "viterbiPottsMex:unaryPotentialsWrongNumLabels", "The number of labels is not positive");
 
 	double* dataCost = (double*)mxGetData(unaryInPtr);
-	
+
 
 	//get pairwise potentials
 	MATLAB_ASSERT(mxGetClassID(pairwiseInPtr) == mxDOUBLE_CLASS, "viterbiPottsMex:pairwisePotentialsWrongType", "Expected mxDOUBLE_CLASS for neighbours array");
@@ -38,88 +141,15 @@ void mexFunction(int nlhs, mxArray *plhs[],
 	MATLAB_ASSERT(mxGetPi(pairwiseInPtr) == NULL, "viterbiPottsMex:pairwisePotentialsComplex",  "Pairwise potentials should not be complex");
 
 	double* pairwiseCost = (double*)mxGetData(pairwiseInPtr);
-	
+
 	//for(int iNode = 0; iNode < numNodes - 1; ++iNode)
 	//	MATLAB_ASSERT( pairwiseCost[ iNode ] >= NULL, "viterbiPottsMex:pairwisePotentialsNegative",  "Pairwise potentials should not be negative");
-    
-	// start computing
-	vector<int> prevPosition( (numNodes - 1) * numLabels, 0 ); //caution: prevPosition and curCost are stored label-first
-	vector<double> curCost( numNodes * numLabels, 0 );
-
-	// put the first line
-	for(int iLabel = 0; iLabel < numLabels; ++iLabel)
-		curCost[ iLabel + 0 * numLabels ] = dataCost[ 0 + numNodes * iLabel ];
-
-    if (numLabels > 1) {
-        for(int iNode = 1; iNode < numNodes; ++iNode) {
-    		// find the position of the two smallest elements
-            bool firstMinFlag = (curCost[ 0 + numLabels * (iNode - 1) ] < curCost[ 1 + numLabels * (iNode - 1) ]);
-    		int minPoint = firstMinFlag ? 0 : 1;
-            int secondMinPoint = firstMinFlag ? 1 : 0;
-            
-    		for(int iLabel = 2; iLabel < numLabels; ++iLabel) {
-        		if( curCost[ iLabel + numLabels * (iNode - 1) ] < curCost[ minPoint + numLabels * (iNode - 1) ] ) {
-                    secondMinPoint = minPoint;
-            		minPoint = iLabel;
-                } else if ( curCost[ iLabel + numLabels * (iNode - 1) ] < curCost[ secondMinPoint + numLabels * (iNode - 1) ] ) {
-                    secondMinPoint = iLabel;
-                }
-            }
-
-            for(int iLabel = 0; iLabel < numLabels; ++iLabel){
-                //  cost for staying in the same position 
-    			double tmp1 = curCost[ iLabel + numLabels * (iNode - 1) ];
-                
-                // cost for coming form the minor second min
-                int moveMinPoint = (iLabel != minPoint) ? minPoint : secondMinPoint;
-        		double tmp2 =  curCost[ moveMinPoint + numLabels * (iNode - 1)] + pairwiseCost[iNode - 1];
-                
-            	if( tmp1 < tmp2 ){
-    				curCost[iLabel + numLabels * iNode] = tmp1;
-        			prevPosition[ iLabel + numLabels * (iNode - 1)] = iLabel;
-    			} else {
-        			curCost[ iLabel + numLabels * iNode] = tmp2;
-    				prevPosition[ iLabel + numLabels * (iNode - 1)] = moveMinPoint;
-    			}
-    
-        		// add the current unary
-            	curCost[iLabel + numLabels * iNode] += dataCost[iNode + numNodes * iLabel];
-            }
-		}
-	} else { // numLabels == 1
-        for(int iNode = 1; iNode < numNodes; ++iNode) {
-            curCost[iNode] = curCost[iNode - 1] + dataCost[iNode];
-            prevPosition[iNode - 1] = 0;
-        }
-    }
-
-	// find best energy
-	int minPoint = 0;
-	double energy = curCost[minPoint + numLabels * (numNodes - 1)];
-	for(int iLabel = 1; iLabel < numLabels; ++iLabel)
-		if(curCost[ iLabel + numLabels * (numNodes - 1) ] < energy ){
-			minPoint = iLabel;
-			energy = curCost[minPoint + numLabels * (numNodes - 1)];
-		}
-	
-	
-	
-	//output minimum value
-	if (energyOutPtr != NULL){
-		*energyOutPtr = mxCreateNumericMatrix(1, 1, mxDOUBLE_CLASS, mxREAL);
-		*(double*)mxGetData( *energyOutPtr ) = energy;
-	}
-
-	
-	//output minimum cut
-	if ( labelsOutPtr != NULL ){
-		*labelsOutPtr = mxCreateNumericMatrix(numNodes, 1, mxDOUBLE_CLASS, mxREAL);
-		double* segment = (double*)mxGetData( *labelsOutPtr );
-		segment[ numNodes - 1 ] = minPoint + 1;
-		for(int iNode = numNodes - 2; iNode >= 0; --iNode) {
-			minPoint = prevPosition[minPoint + numLabels * iNode];
-			segment[ iNode ] = minPoint + 1;
-		}
-	}
 
+	problem.numNodes = numNodes;
+	problem.numLabels = numLabels;
+	problem.dataCost = dataCost;
+	problem.nodeStride = 1;
+	problem.labelStride = numNodes;
+	problem.pairwiseCost = pairwiseCost;
+	problem.pairwiseStride = 1;
 }
@@ -2,6 +2,8 @@
 % 
 % energy = viterbiPottsMex(unary, costs)
 % [energy, labels] = viterbiPottsMex(unary, costs)
+% [energy, labels, minMarginals] = viterbiPottsMex(unary, costs)
+% [energy, labels, minMarginals] = viterbiPottsMex(unaryBatch, costsBatch, numThreads)
 % 
 % INPUT
 %     unary     -   input sequence, N x K double matrix, where N - number of objects, K -
@@ -14,5 +16,16 @@
 % OUTPUT
 %     energy    -   energy of the best labeling
 %     labels    -   the best labeling
+%     minMarginals  -   N x K double matrix (the layout of unary), minMarginals(i, j) is the smallest energy of the labelings
+%               with object i of label j; computed by a forward and a backward pass only if requested (about twice the cost)
+% 
+% BATCH MODE
+%     unaryBatch    -   cell array of unary matrices of numChains independent chains, the chains are processed in parallel
+%     costsBatch    -   cell array of the corresponding costs vectors (or a single vector shared by all chains)
+%     numThreads    -   the number of threads (optional); by default, the environment variable SMR_NUM_THREADS or the number of cores is used
+%   energy is then a numChains x 1 vector, labels and minMarginals are numChains x 1 cell arrays
+%   All the rows, columns or diagonals of a grid are solved in one call by viterbiGridPottsMex.
+%
+% The label loops use SSE2/AVX2/AVX-512 if the CPU supports them; the environment variable SMR_POTTS_SIMD caps the instruction set (0 - scalar code).
 %     
 % Anton Osokin (firstname.lastname@gmail.com),  22.05.2013
\ No newline at end of file
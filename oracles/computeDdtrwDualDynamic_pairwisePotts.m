@@ -0,0 +1,119 @@
+function [dualValue, subgradient, primalLabeling] = computeDdtrwDualDynamic_pairwisePotts(dataCost, vertCost, horCost, dualVars)
+%computeDdtrwDualDynamic_pairwisePotts computes the value of the dual functon of the grid DD-TRW
+%
+% Please cite the following paper if you use this method:
+%   N. Komodakis, N. Paragios, and G. Tziritas,
+%   MRF energy minimization and beyond via dual decomposition.
+%   IEEE TPAMI, vol. 33, no. 3, pp. 531-552, 2011.
+%
+% The function minimizes the Lagrangian over binary variables Y given duals variables D:
+% L(Y, D) = E_{vert}(Y^1) + E_{hor}(Y^2) + \sum_i \sum_k D_{ik} ( Y^1_{ik} - Y^2_{ik} )
+%
+%   This function keeps the messages of all the chains between the calls and recomputes only the chains
+%   (and only the parts of them) containing the nodes where the dual variables have changed.
+%   The following global variables are used: computeDdtrwDualDynamic_pairwisePotts_chainHandle, computeDdtrwDualDynamic_pairwisePotts_lastPoint
+%
+% [dualValue, subgradient, primalLabeling] = computeDdtrwDualDynamic_pairwisePotts(dataCost, vertCost, horCost, dualVars)
+%
+% INPUT
+%   dataCost   - unary potentials ( double[ numLabels x numNodes ])
+%   vertCost - vertical pairwise potentials ( double[ (heigth - 1) * width ] ), heigth * width = numNodes 
+%   horCost - horizontal pairwise potentials ( double[ heigth * (width - 1) ] ), heigth * width = numNodes
+%   dualVars   - vector of dual varuables ( double[ numNodes*numLabels x 1 ])
+%
+% OUTPUT
+%   dualValue - the value of the dual function
+%   subgradient - value of subgradient
+%   primalLabeling - the estimate of primal labeling
+%
+% CAUTION! do not forget to call computeDdtrwDualDynamic_pairwisePotts_clearGlobal after the optimization is finished
+%
+% Depends on mexWrappers/viterbiPottsMex
+%
+% To construct vertCost and horCost from sparse matrix neighbors use separateVertHorCosts.m
+
+if ~isnumeric(dataCost) || ~ismatrix(dataCost)
+    error('computeDdtrwDualDynamic_pairwisePotts:badDataCost', 'dataCost should be a matrix  numLabels x numNodes');
+end
+dataCost = double(dataCost);
+numNodes = size(dataCost, 2);
+numLabels = size(dataCost, 1);
+
+if ~isnumeric(vertCost) || ~ismatrix(vertCost) || (size(vertCost, 1) + 1) * size(vertCost, 2) ~= numNodes 
+    error('computeDdtrwDualDynamic_pairwisePotts:badVertCost', 'vertCost a matrix with real-valued elements of size (heigth - 1) x width,  heigth * width = numNodes ');
+end
+gridSize = nan(2, 1);
+gridSize(1) = size(vertCost, 1) + 1;
+gridSize(2) = size(vertCost, 2);
+
+if ~isnumeric(horCost) || ~ismatrix(horCost) || (size(horCost, 2) + 1) * size(horCost, 1) ~= numNodes 
+    error('computeDdtrwDualDynamic_pairwisePotts:badHorCost', 'horCost a matrix with real-valued elements of size heigth x (width - 1),  heigth * width = numNodes ');
+end
+if size(horCost, 2) + 1 ~= gridSize(2) || size(horCost, 1) ~= gridSize(1)
+    error('computeDdtrwDualDynamic_pairwisePotts:vertHorCostMismatch', 'vertCost and horCost are not compatible');
+end
+
+if ~isnumeric(dualVars) || ~iscolumn(dualVars) || length(dualVars) ~= numNodes * numLabels
+    error('computeDdtrwDualDynamic_pairwisePotts:badDualVars', 'dualVars should be a column vector of length numNodes*numLabels');
+end
+dualVars = double(dualVars);
+dualVars = reshape(dualVars, [numLabels, numNodes]);
+
+% after this number of runs recompute the chains from scratch (drops the chain messages cached and accumulated over the dynamic updates)
+dynamicRebuildNumber = 20;
+
+global computeDdtrwDualDynamic_pairwisePotts_chainHandle
+global computeDdtrwDualDynamic_pairwisePotts_lastPoint
+global computeDdtrwDualDynamic_pairwisePotts_dynamicNumber
+
+if isempty(computeDdtrwDualDynamic_pairwisePotts_chainHandle) || isempty(computeDdtrwDualDynamic_pairwisePotts_lastPoint) || isempty(computeDdtrwDualDynamic_pairwisePotts_dynamicNumber) ...
+        || ~iscell(computeDdtrwDualDynamic_pairwisePotts_chainHandle) || numel( computeDdtrwDualDynamic_pairwisePotts_chainHandle ) ~= 2 ...
+        || ~isequal(size(computeDdtrwDualDynamic_pairwisePotts_lastPoint), [numLabels, numNodes]) ...
+        || ~isscalar(computeDdtrwDualDynamic_pairwisePotts_dynamicNumber) || ~isnumeric(computeDdtrwDualDynamic_pairwisePotts_dynamicNumber) ...
+        || mod( computeDdtrwDualDynamic_pairwisePotts_dynamicNumber, dynamicRebuildNumber) == 0
+    % remove the chains if left
+    if iscell(computeDdtrwDualDynamic_pairwisePotts_chainHandle)
+        for iHandle = 1 : numel(computeDdtrwDualDynamic_pairwisePotts_chainHandle)
+            if ~isempty(computeDdtrwDualDynamic_pairwisePotts_chainHandle{iHandle})
+                deleteViterbiGridDynamicMex( computeDdtrwDualDynamic_pairwisePotts_chainHandle{iHandle} );
+            end
+        end
+    end
+
+    tmp = 0.5 *dataCost;
+    dataCostHor = tmp - dualVars;
+    dataCostVert = tmp + dualVars;
+
+    computeDdtrwDualDynamic_pairwisePotts_chainHandle = cell(2, 1);
+    [energyHor, labelsHor, computeDdtrwDualDynamic_pairwisePotts_chainHandle{1}] = viterbiGridDynamicMex(dataCostHor, double(horCost), 'hor');
+    [energyVert, labelsVert, computeDdtrwDualDynamic_pairwisePotts_chainHandle{2}] = viterbiGridDynamicMex(dataCostVert, double(vertCost), 'vert');
+    computeDdtrwDualDynamic_pairwisePotts_dynamicNumber = 1;
+else
+    % only the nodes with changed dual variables are passed to the chains
+    pointDifference = dualVars - computeDdtrwDualDynamic_pairwisePotts_lastPoint;
+    changedNodes = find( any(pointDifference ~= 0, 1) );
+    nodeDifference = pointDifference(:, changedNodes)';
+
+%     fprintf('Updated %f%% nodes \n', length(changedNodes) / numNodes * 100);
+
+    [energyHor, labelsHor] = updateUnaryViterbiGridDynamicMex( computeDdtrwDualDynamic_pairwisePotts_chainHandle{1}, [changedNodes(:), -nodeDifference] );
+    [energyVert, labelsVert] = updateUnaryViterbiGridDynamicMex( computeDdtrwDualDynamic_pairwisePotts_chainHandle{2}, [changedNodes(:), nodeDifference] );
+    computeDdtrwDualDynamic_pairwisePotts_dynamicNumber = computeDdtrwDualDynamic_pairwisePotts_dynamicNumber + 1;
+end
+computeDdtrwDualDynamic_pairwisePotts_lastPoint = dualVars;
+
+%% compute results
+dualValue = sum(energyVert) + sum(energyHor);
+primalLabeling = labelsVert(:);
+
+subgradient = zeros(numLabels, numNodes);
+curDiff = find( labelsVert ~= labelsHor );
+for iNodeId = 1 : length(curDiff)
+    iNode = curDiff(iNodeId);
+    subgradient( labelsVert(iNode), iNode ) = 1;
+    subgradient( labelsHor(iNode), iNode ) = -1;
+end
+
+subgradient = subgradient(:);
+
+end
@@ -0,0 +1,20 @@
+function computeDdtrwDualDynamic_pairwisePotts_clearGlobal()
+%computeDdtrwDualDynamic_pairwisePotts_clearGlobal clears global variables created by computeDdtrwDualDynamic_pairwisePotts
+
+global computeDdtrwDualDynamic_pairwisePotts_chainHandle
+global computeDdtrwDualDynamic_pairwisePotts_lastPoint
+computeDdtrwDualDynamic_pairwisePotts_lastPoint = [];
+
+if iscell(computeDdtrwDualDynamic_pairwisePotts_chainHandle)
+        for iHandle = 1 : numel(computeDdtrwDualDynamic_pairwisePotts_chainHandle)
+            if ~isempty(computeDdtrwDualDynamic_pairwisePotts_chainHandle{iHandle})
+                deleteViterbiGridDynamicMex( computeDdtrwDualDynamic_pairwisePotts_chainHandle{iHandle} )
+            end
+        end
+end
+
+clear global computeDdtrwDualDynamic_pairwisePotts_lastPoint
+clear global computeDdtrwDualDynamic_pairwisePotts_chainHandle
+clear global computeDdtrwDualDynamic_pairwisePotts_dynamicNumber
+
+end
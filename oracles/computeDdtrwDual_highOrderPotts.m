@@ -125,77 +125,24 @@ end
 
 % dualVars = reshape(dualVars, [numLabels, numNodes]);
 
-ids = reshape( 1 : prod(gridSize), [gridSize(1), gridSize(2)] );
-
 tmp = 0.5 * dataCost;
 dataCostHor = tmp + horVars;
 dataCostVert = tmp + vertVars;
 
-%% minimize horizontal chains
-labelsHor = nan( gridSize(2), gridSize(1) );
-energyHor = nan( gridSize(1), 1);
-for iRow = 1 : gridSize(1)
-    curUnary = dataCostHor(:, ids(iRow, :))';
-    [energyHor(iRow), labelsHor(:, iRow)] = viterbiPottsMex(curUnary, horCost(iRow, :)');
-end
-labelsHor = labelsHor';
-
-%% minimize vertical chains
-labelsVert = nan( gridSize(1), gridSize(2) );
-energyVert = nan( gridSize(2), 1);
-for iCol = 1 : gridSize(2)
-    curUnary = dataCostVert(:, ids(:, iCol))';
-    [energyVert(iCol), labelsVert(:, iCol)] = viterbiPottsMex(curUnary, vertCost(:, iCol));
-end
+%% minimize horizontal chains, all the rows in one call
+[energyHor, labelsHor] = viterbiGridPottsMex(dataCostHor, double(horCost), 'hor');
+
+%% minimize vertical chains, all the columns in one call
+[energyVert, labelsVert] = viterbiGridPottsMex(dataCostVert, double(vertCost), 'vert');
 
 %% minimize main diag chains
 if exist('mainDiagCost', 'var')
-    labelsMainDiag = nan( gridSize(1), gridSize(2) );
-    energyMainDiag = nan(  gridSize(1) + gridSize(2) - 1, 1);
-
-    diagIds = toeplitz(1 : gridSize(1), [1, gridSize(1) + 1 : 1 : gridSize(1) + gridSize(2) - 1 ]);
-    for iDiag = 1 : gridSize(1) + gridSize(2) - 1
-        curIds = ids( diagIds == iDiag );
-        curUnary = mainDiagVars(:, curIds)';
-        
-        curPairwiseChain = mainDiagCost( diagIds(1 : end - 1, 1 : end - 1) == iDiag );
-        
-        if ~isempty(curPairwiseChain)
-            [energyMainDiag(iDiag), curLabels] = viterbiPottsMex(curUnary, curPairwiseChain);
-            labelsMainDiag(diagIds == iDiag) = curLabels;
-        else
-            if length(curIds) > 1
-                error('Something wrong has happened with the main diag potentials');
-            end
-            [energyMainDiag(iDiag), curLabels] = min(curUnary, [], 2);
-            labelsMainDiag(curIds) = curLabels;
-        end
-    end
+    [energyMainDiag, labelsMainDiag] = viterbiGridPottsMex(mainDiagVars, double(mainDiagCost), 'mainDiag');
 end
 
 %% minimize second diag chains
 if exist('secondDiagCost', 'var')
-    labelsSecondDiag = nan( gridSize(1), gridSize(2) );
-    energySecondDiag = nan(  gridSize(1) + gridSize(2) - 1, 1);
-
-    diagIds = rot90(toeplitz(1 : gridSize(2), [1, gridSize(2) + 1 : 1 : gridSize(2) + gridSize(1) - 1 ]));
-    for iDiag = 1 : gridSize(1) + gridSize(2) - 1
-        curIds = ids( diagIds == iDiag );
-        curUnary = secondDiagVars(:, curIds)';
-        
-        curPairwiseChain = secondDiagCost( diagIds(2 : end, 1 : end - 1) == iDiag );
-        
-        if ~isempty(curPairwiseChain)
-            [energySecondDiag(iDiag), curLabels] = viterbiPottsMex(curUnary, curPairwiseChain);
-            labelsSecondDiag(diagIds == iDiag) = curLabels;
-        else
-            if length(curIds) > 1
-                error('Something wrong has happened with the second diag potentials');
-            end
-            [energySecondDiag(iDiag), curLabels] = min(curUnary, [], 2);
-            labelsSecondDiag(curIds) = curLabels;
-        end
-    end
+    [energySecondDiag, labelsSecondDiag] = viterbiGridPottsMex(secondDiagVars, double(secondDiagCost), 'secondDiag');
 end
 
 
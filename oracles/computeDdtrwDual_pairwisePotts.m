@@ -56,28 +56,15 @@ end
 dualVars = double(dualVars);
 dualVars = reshape(dualVars, [numLabels, numNodes]);
 
-ids = reshape( 1 : prod(gridSize), [gridSize(1), gridSize(2)] );
-
 tmp = 0.5 *dataCost;
 dataCostHor = tmp - dualVars;
 dataCostVert = tmp + dualVars;
 
-%% compute horizontal chains
-labelsHor = nan( gridSize(2), gridSize(1) );
-energyHor = nan( gridSize(1), 1);
-for iRow = 1 : gridSize(1)
-    curUnary = dataCostHor(:, ids(iRow, :))';
-    [energyHor(iRow), labelsHor(:, iRow)] = viterbiPottsMex(curUnary, horCost(iRow, :)');
-end
-labelsHor = labelsHor';
+%% compute horizontal chains, all the rows in one call
+[energyHor, labelsHor] = viterbiGridPottsMex(dataCostHor, double(horCost), 'hor');
 
-%% compute vertical chains
-labelsVert = nan( gridSize(1), gridSize(2) );
-energyVert = nan( gridSize(2), 1);
-for iCol = 1 : gridSize(2)
-    curUnary = dataCostVert(:, ids(:, iCol))';
-    [energyVert(iCol), labelsVert(:, iCol)] = viterbiPottsMex(curUnary, vertCost(:, iCol));
-end
+%% compute vertical chains, all the columns in one call
+[energyVert, labelsVert] = viterbiGridPottsMex(dataCostVert, double(vertCost), 'vert');
 
 %% compute results
 dualValue = sum(energyVert) + sum(energyHor);
@@ -0,0 +1,114 @@
+function [dualValue, subgradient, primalLabeling] = computeNsmrDualDynamic_pairwisePotts(dataCost, neighbors, dualVars)
+% computeNsmrDualDynamic_pairwisePotts computes the value of the dual function in NSMR method for pairwise energy with Potts potentials
+%
+% The function minimizes the NSMR Lagrangian over binary variables Y given duals variables D:
+% L(Y, D) = \sum_i \sum_p U_{ip} y_{ip} + \sum_{ij} P_{ij} \sum_{p} 0.5 * ( [ y_{ip} == 1][y_{ip} == 0] + [ y_{ip} == 0][y_{ip} == 1] ) ...
+%     +  \sum_i d_i ( \sum_p y_{ip} - 1)
+%
+%   This function makes use of dynamic QPBO to compute the updates faster:
+%   the graphs of all labels are kept between the calls and only the unary terms of the nodes with changed dual variables are updated.
+%   The following global variables are used: computeNsmrDualDynamic_pairwisePotts_qpboHandle, computeNsmrDualDynamic_pairwisePotts_lastPoint
+%
+% [dualValue, subgradient, primalLabeling]= computeNsmrDualDynamic_pairwisePotts(dataCost, neighbors, dualVars)
+%
+% INPUT
+%   dataCost   - unary potentials ( double[ numLabels x numNodes ])
+%   neighbors  - paiwise Potts potentials ( sparse double[ numNodes x numNodes ]).
+%       The function uses only upper triangle of this matrix. Can handle negative entries.
+%   dualVars   - vector of dual varuables ( double[ numNodes x 1 ])
+%
+% OUTPUT
+%   dualValue - the value of the dual function
+%   subgradient - value of subgradient
+%   primalLabeling - the estimate of primal labeling
+%
+% CAUTION! do not forget to call computeNsmrDualDynamic_pairwisePotts_clearGlobal after the optimization is finished
+%
+% Depends on mexWrappers/qpboDynamicMex
+
+% check the input
+if ~isnumeric(dataCost) || ~ismatrix(dataCost)
+    error('computeNsmrDualDynamic_pairwisePotts:badDataCost', 'dataCost should be a matrix  numLabels x numNodes');
+end
+dataCost = double(dataCost);
+numNodes = size(dataCost, 2);
+numLabels = size(dataCost, 1);
+
+if ~isnumeric(neighbors) || ~ismatrix(neighbors) || ~issparse(neighbors) || size(neighbors, 1) ~= numNodes || size(neighbors, 2) ~= numNodes
+    error('computeNsmrDualDynamic_pairwisePotts:badNeighbors', 'neighbors should be a sparse matrix numNodes x numNodes');
+end
+
+if ~isnumeric(dualVars) || ~iscolumn(dualVars) || length(dualVars) ~= numNodes
+    error('computeNsmrDualDynamic_pairwisePotts:badDualVars', 'dualVars should be a column vector of length numNodes');
+end
+dualVars = double(dualVars);
+
+% after this number of runs recompute QPBO from scratch
+dynamicQpboRebuildNumber = 20;
+
+global computeNsmrDualDynamic_pairwisePotts_qpboHandle
+global computeNsmrDualDynamic_pairwisePotts_lastPoint
+global computeNsmrDualDynamic_pairwisePotts_dynamicNumber
+
+if isempty(computeNsmrDualDynamic_pairwisePotts_qpboHandle) || isempty(computeNsmrDualDynamic_pairwisePotts_lastPoint) || isempty(computeNsmrDualDynamic_pairwisePotts_dynamicNumber)...
+        || numel( computeNsmrDualDynamic_pairwisePotts_qpboHandle ) ~= numLabels ...
+        || ~iscolumn(computeNsmrDualDynamic_pairwisePotts_lastPoint) || length( computeNsmrDualDynamic_pairwisePotts_lastPoint ) ~=  numNodes ...
+        || ~isscalar(computeNsmrDualDynamic_pairwisePotts_dynamicNumber) || ~isnumeric(computeNsmrDualDynamic_pairwisePotts_dynamicNumber) ...
+        || mod( computeNsmrDualDynamic_pairwisePotts_dynamicNumber, dynamicQpboRebuildNumber) == 0
+    % remove all graphs if left
+    if ~isempty(computeNsmrDualDynamic_pairwisePotts_qpboHandle)
+        deleteQpboDynamicMex( computeNsmrDualDynamic_pairwisePotts_qpboHandle );
+    end
+
+    % construct edges for QPBO
+    [rowNeighbor, colNeighbor, weightNeighbor] = find(neighbors);
+    deleteMask = rowNeighbor >= colNeighbor;
+    rowNeighbor( deleteMask ) = [];
+    colNeighbor( deleteMask ) = [];
+    weightNeighbor( deleteMask ) = [];
+    nEdges = length(weightNeighbor);
+    pairwiseTerms = [rowNeighbor, colNeighbor, zeros(nEdges, 1), 0.5 * weightNeighbor, 0.5 * weightNeighbor, zeros(nEdges, 1)];
+
+    % construct unary terms for QPBO
+    termEdgeWeight  = dataCost';
+    unaryTerms = cell(numLabels, 1);
+    for iLabel = 1 : numLabels
+        unaryTerms{iLabel} = [zeros(numNodes, 1), termEdgeWeight(:, iLabel) + dualVars];
+    end
+
+    % store a point
+    computeNsmrDualDynamic_pairwisePotts_lastPoint = dualVars;
+    computeNsmrDualDynamic_pairwisePotts_dynamicNumber = 1;
+
+    % the graphs of all labels are constructed in parallel
+    [subLowerBound, curLabels, computeNsmrDualDynamic_pairwisePotts_qpboHandle] = qpboDynamicMex(unaryTerms, pairwiseTerms);
+else
+    pointDifference = dualVars - computeNsmrDualDynamic_pairwisePotts_lastPoint;
+
+    changeMask = pointDifference ~= 0;
+    numChanges = sum( changeMask );
+
+    % the same update is applied to the graphs of all labels
+    unaryUpdate = [find(pointDifference), zeros( numChanges, 1 ), pointDifference( changeMask )];
+    [subLowerBound, curLabels] = updateUnaryQpboDynamicMex( computeNsmrDualDynamic_pairwisePotts_qpboHandle, unaryUpdate );
+
+    computeNsmrDualDynamic_pairwisePotts_lastPoint = dualVars;
+    computeNsmrDualDynamic_pairwisePotts_dynamicNumber = computeNsmrDualDynamic_pairwisePotts_dynamicNumber + 1;
+end
+if ~iscell(curLabels)
+    curLabels = {curLabels};
+end
+labelsQp = [curLabels{:}];
+
+dualValue = sum(subLowerBound) - sum(dualVars);
+labelsQp(labelsQp < 0) = 0.5;
+
+% get the primal estimate
+if nargout > 2
+    [~, primalLabeling] = max(labelsQp, [], 2);
+end
+
+%Compute subgradient
+subgradient = sum(labelsQp, 2) - 1;
+
+end
@@ -0,0 +1,16 @@
+function computeNsmrDualDynamic_pairwisePotts_clearGlobal()
+%computeNsmrDualDynamic_pairwisePotts_clearGlobal clears global variables created by computeNsmrDualDynamic_pairwisePotts
+
+global computeNsmrDualDynamic_pairwisePotts_qpboHandle
+global computeNsmrDualDynamic_pairwisePotts_lastPoint
+computeNsmrDualDynamic_pairwisePotts_lastPoint = [];
+
+if ~isempty(computeNsmrDualDynamic_pairwisePotts_qpboHandle)
+    deleteQpboDynamicMex( computeNsmrDualDynamic_pairwisePotts_qpboHandle );
+end
+
+clear global computeNsmrDualDynamic_pairwisePotts_lastPoint
+clear global computeNsmrDualDynamic_pairwisePotts_qpboHandle
+clear global computeNsmrDualDynamic_pairwisePotts_dynamicNumber
+
+end
@@ -1,4 +1,4 @@
-function [dualValue, subgradient, primalLabeling] = computeNsmrDual_pairwisePotts(dataCost, neighbors, dualVars)
+function [dualValue, subgradient, primalLabeling] = computeNsmrDual_pairwisePotts(dataCost, neighbors, dualVars, qpboOptions)
 % computeNsmrDual_pairwisePotts computes the value of the dual function in SMD method for pairwise energy with Potts potentials
 %
 % The function minimizes the NSMR Lagrangian over binary variables Y given duals variables D:
@@ -6,12 +6,15 @@ function [dualValue, subgradient, primalLabeling] = computeNsmrDual_pairwisePott
 %     +  \sum_i d_i ( \sum_p y_{ip} - 1)
 %
 % [dualValue, subgradient, primalLabeling]= computeNsmrDual_pairwisePotts(dataCost, neighbors, dualVars)
+% [dualValue, subgradient, primalLabeling]= computeNsmrDual_pairwisePotts(dataCost, neighbors, dualVars, qpboOptions)
 %
 % INPUT
 %   dataCost   - unary potentials ( double[ numLabels x numNodes ])
 %   neighbors  - paiwise Potts potentials ( sparse double[ numNodes x numNodes ]).
 %       The function uses only upper triangle of this matrix. Can handle negative entries.
 %   dualVars   - vector of dual varuables ( double[ numNodes x 1 ])
+%   qpboOptions - options of qpboMex (optional), e.g. to enable probing and improve rounds.
+%       Those reduce the number of unlabeled nodes, but the labels need not minimize the Lagrangian, so the subgradient becomes approximate.
 %
 % OUTPUT
 %   dualValue - the value of the dual function
@@ -39,8 +42,12 @@ if ~isnumeric(dualVars) || ~iscolumn(dualVars) || length(dualVars) ~= numNodes
 end
 dualVars = double(dualVars);
 
-subLowerBound = nan(numLabels, 1);
-labelsQp = nan(numNodes, numLabels);
+if ~exist('qpboOptions', 'var') || isempty(qpboOptions)
+    qpboOptions = struct;
+end
+if ~isstruct(qpboOptions)
+    error('computeNsmrDual_pairwisePotts:badQpboOptions', 'qpboOptions should be a structure');
+end
 
 % construct edges for a graph cut
 [rowNeighbor, colNeighbor, weightNeighbor] = find(neighbors);
@@ -54,10 +61,10 @@ pairwiseTerms = [rowNeighbor, colNeighbor, zeros(nEdges, 1), 0.5 * weightNeighbo
 % construct unary terms for a graph cut
 termEdgeWeight  = dataCost';
 
-for iLabel = 1 : numLabels
-    unaryTerms = [zeros(numNodes, 1), termEdgeWeight(:, iLabel) + dualVars];
-    [subLowerBound(iLabel), labelsQp(:, iLabel)] = qpboMex(unaryTerms, pairwiseTerms);
-end
+% the problems of all labels share the pairwise terms and are solved by a single call
+unaryTerms = zeros(numNodes, 2, numLabels);
+unaryTerms(:, 2, :) = reshape(bsxfun(@plus, termEdgeWeight, dualVars), [numNodes, 1, numLabels]);
+[subLowerBound, labelsQp] = qpboMex(unaryTerms, pairwiseTerms, qpboOptions);
 dualValue = sum(subLowerBound) - sum(dualVars);
 labelsQp(labelsQp < 0) = 0.5;
 
@@ -1,4 +1,4 @@
-function [dualValue, subgradient, primalLabeling] = computeSmrDualDynamic_highOrderPotts(dataCost, neighbors, dualVars, hoIds, hoP)
+function [dualValue, subgradient, primalLabeling] = computeSmrDualDynamic_highOrderPotts(dataCost, neighbors, dualVars, hoIds, hoP, subgradientType)
 %computeSmrDualDynamic_highOrderPotts computes the value of the SMR dual function for energy with associative pairwise Potts potentials and robust high-order Potts potentials
 %
 % The function minimizes the Lagrangian w.r.t. binary variables  Y given duals variables D:
@@ -11,7 +11,8 @@ function [dualValue, subgradient, primalLabeling] = computeSmrDualDynamic_highOr
 %   the following global variables are used: computeSmrDualDynamic_highOrderPotts_graphHandle, computeSmrDualDynamic_highOrderPotts_lastPoint
 %           
 %
-% [dualValue, subgradient, primalLabeling]= computeSmrDualDynamic_highOrderPotts(dataCost, neighbors, dualVars)
+% [dualValue, subgradient, primalLabeling]= computeSmrDualDynamic_highOrderPotts(dataCost, neighbors, dualVars, hoIds, hoP)
+% [dualValue, subgradient, primalLabeling]= computeSmrDualDynamic_highOrderPotts(dataCost, neighbors, dualVars, hoIds, hoP, subgradientType)
 %
 % INPUT
 %   dataCost   - unary potentials ( double[ numLabels x numNodes ])
@@ -19,6 +20,10 @@ function [dualValue, subgradient, primalLabeling] = computeSmrDualDynamic_highOr
 %   dualVars   - vector of dual varuables ( double[ numNodes x 1 ])
 % 	hoIds       - groups of edges, showing high-order potentials (cell[numHO, 1], each element - vector of indices)
 % 	hoP         - parameters of Robust high-order potentials (double[numHO, 2]), each row gives \gamma_max and Q; \gamma_max >= 0; Q >= 0;
+%   subgradientType - which subgradient to return if a subproblem has several minimum cuts (string, optional):
+%           'any' (default) - the cut found by the graph-cut algorithm; the subgradient can jump between equally valid values;
+%           'source', 'sink' - the source-minimal or the sink-minimal cut, i.e. the labeling with the largest or the smallest number of ones;
+%           'average' - the average of the two subgradients above
 %
 % OUTPUT
 %   dualValue - the value of the dual function
@@ -59,6 +64,18 @@ if ~isnumeric(hoP) || ~ismatrix(hoP) || size(hoP, 1) ~= numHo || size(hoP, 2) ~=
     error('computeSmrDualDynamic_highOrderPotts:badHoP', 'hoP should be a matrix numHO x 2, all elements should be positive, ');
 end
 
+if ~exist('subgradientType', 'var') || isempty(subgradientType)
+    subgradientType = 'any';
+end
+switch subgradientType
+    case {'any', 'source', 'sink'}
+        cutType = subgradientType;
+    case 'average'
+        cutType = 'both';
+    otherwise
+        error('computeSmrDualDynamic_highOrderPotts:badSubgradientType', 'subgradientType should be ''any'', ''source'', ''sink'' or ''average''');
+end
+
 subEnergy = nan(numLabels, 1);
 labelsQp = nan(numNodes, numLabels);
 
@@ -137,9 +154,9 @@ if isempty(computeSmrDualDynamic_highOrderPotts_graphHandle) || isempty(computeS
         
         [subEnergy(iLabel), curLabels ,...
             computeSmrDualDynamic_highOrderPotts_graphHandle{ iLabel }] = ...
-            graphCutDynamicMex(curUnary, nonTermEdgesWeights);
+            graphCutDynamicMex(curUnary, nonTermEdgesWeights, cutType);
         
-        labelsQp(:, iLabel) = curLabels( 1 : numNodes);
+        labelsQp(:, iLabel) = mean(curLabels( 1 : numNodes, :), 2);
     end
 else
     pointDifference = dualVars - computeSmrDualDynamic_highOrderPotts_lastPoint;
@@ -150,9 +167,9 @@ else
     unaryUpdate = [find(changeMask), pointDifference( changeMask ), zeros( numChanges, 1 )];
     for iLabel = 1 : numLabels
         
-        [subEnergy(iLabel), curLabels] = updateUnaryGraphCutDynamicMex( computeSmrDualDynamic_highOrderPotts_graphHandle{ iLabel }, unaryUpdate );
+        [subEnergy(iLabel), curLabels] = updateUnaryGraphCutDynamicMex( computeSmrDualDynamic_highOrderPotts_graphHandle{ iLabel }, unaryUpdate, cutType );
         
-        labelsQp(:, iLabel) = curLabels( 1 : numNodes);
+        labelsQp(:, iLabel) = mean(curLabels( 1 : numNodes, :), 2);
     end
     computeSmrDualDynamic_highOrderPotts_lastPoint = dualVars;
     computeSmrDualDynamic_highOrderPotts_dynamicNumber = computeSmrDualDynamic_highOrderPotts_dynamicNumber + 1;
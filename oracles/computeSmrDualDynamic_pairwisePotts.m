@@ -1,4 +1,4 @@
-function [dualValue, subgradient, primalLabeling] = computeSmrDualDynamic_pairwisePotts(dataCost, neighbors, dualVars)
+function [dualValue, subgradient, primalLabeling] = computeSmrDualDynamic_pairwisePotts(dataCost, neighbors, dualVars, subgradientType)
 % computeSmrDualDynamic_pairwisePotts computes the value of the SMR dual function for pairwise energy with assotiative Potts potentials
 %
 % The function minimizes the Lagrangian w.r.t. binary variables  Y given duals variables D:
@@ -10,11 +10,16 @@ function [dualValue, subgradient, primalLabeling] = computeSmrDualDynamic_pairwi
 %   the following global variables are used: computeSmrDualDynamic_pairwisePotts_graphHandle, computeSmrDualDynamic_pairwisePotts_lastPoint
 %
 % [dualValue, subgradient, primalLabeling]= computeSmrDualDynamic_pairwisePotts(dataCost, neighbors, dualVars)
+% [dualValue, subgradient, primalLabeling]= computeSmrDualDynamic_pairwisePotts(dataCost, neighbors, dualVars, subgradientType)
 %
 % INPUT
 %   dataCost   - unary potentials ( double[ numLabels x numNodes ])
 %   neighbors  - paiwise Potts potentials ( sparse double[ numNodes x numNodes ]). The function uses only upper triangle of this matrix.
 %   dualVars   - vector of dual varuables ( double[ numNodes x 1 ])
+%   subgradientType - which subgradient to return if a subproblem has several minimum cuts (string, optional):
+%           'any' (default) - the cut found by the graph-cut algorithm; the subgradient can jump between equally valid values;
+%           'source', 'sink' - the source-minimal or the sink-minimal cut, i.e. the labeling with the largest or the smallest number of ones;
+%           'average' - the average of the two subgradients above
 %
 % OUTPUT
 %   dualValue - the value of the dual function
@@ -44,6 +49,18 @@ if ~isnumeric(dualVars) || ~iscolumn(dualVars) || length(dualVars) ~= numNodes
 end
 dualVars = double(dualVars);
 
+if ~exist('subgradientType', 'var') || isempty(subgradientType)
+    subgradientType = 'any';
+end
+switch subgradientType
+    case {'any', 'source', 'sink'}
+        cutType = subgradientType;
+    case 'average'
+        cutType = 'both';
+    otherwise
+        error('computeSmrDualDynamic_pairwisePotts:badSubgradientType', 'subgradientType should be ''any'', ''source'', ''sink'' or ''average''');
+end
+
 subEnergy = nan(numLabels, 1);
 labelsQp = nan(numNodes, numLabels);
 
@@ -83,9 +100,10 @@ if isempty(computeSmrDualDynamic_pairwisePotts_graphHandle) || isempty(computeSm
     computeSmrDualDynamic_pairwisePotts_dynamicNumber = 1;
 
     for iLabel = 1 : numLabels
-        [subEnergy(iLabel), labelsQp(:, iLabel),...
+        [subEnergy(iLabel), curLabels,...
             computeSmrDualDynamic_pairwisePotts_graphHandle{ iLabel }] = ...
-            graphCutDynamicMex([termEdgeWeight(:, iLabel) + dualVars, zeros(numNodes, 1)], nonTermEdgesWeights);
+            graphCutDynamicMex([termEdgeWeight(:, iLabel) + dualVars, zeros(numNodes, 1)], nonTermEdgesWeights, cutType);
+        labelsQp(:, iLabel) = mean(curLabels, 2);
     end
 else
     pointDifference = dualVars - computeSmrDualDynamic_pairwisePotts_lastPoint;
@@ -97,7 +115,8 @@ else
   
     unaryUpdate = [find(pointDifference), pointDifference( changeMask ), zeros( numChanges, 1 )];
     for iLabel = 1 : numLabels
-        [subEnergy(iLabel), labelsQp(:, iLabel)] = updateUnaryGraphCutDynamicMex( computeSmrDualDynamic_pairwisePotts_graphHandle{ iLabel }, unaryUpdate );
+        [subEnergy(iLabel), curLabels] = updateUnaryGraphCutDynamicMex( computeSmrDualDynamic_pairwisePotts_graphHandle{ iLabel }, unaryUpdate, cutType );
+        labelsQp(:, iLabel) = mean(curLabels, 2);
     end
     computeSmrDualDynamic_pairwisePotts_lastPoint = dualVars;
     computeSmrDualDynamic_pairwisePotts_dynamicNumber = computeSmrDualDynamic_pairwisePotts_dynamicNumber + 1;
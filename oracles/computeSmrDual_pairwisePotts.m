@@ -1,4 +1,4 @@
-function [dualValue, subgradient, primalLabeling] = computeSmrDual_pairwisePotts(dataCost, neighbors, dualVars)
+function [dualValue, subgradient, primalLabeling] = computeSmrDual_pairwisePotts(dataCost, neighbors, dualVars, subgradientType)
 %computeSmrDual_pairwisePotts computes the value of the dual function in SMR method for pairwise energy with Potts potentials
 %
 % The function minimizes the Lagrangian over binary variables Y given duals variables D:
@@ -7,12 +7,17 @@ function [dualValue, subgradient, primalLabeling] = computeSmrDual_pairwisePotts
 %       +  \sum_i d_i ( \sum_p y_{ip} - 1)
 %
 % [dualValue, subgradient, primalLabeling]= computeSmrDual_pairwisePotts(dataCost, neighbors, dualVars)
+% [dualValue, subgradient, primalLabeling]= computeSmrDual_pairwisePotts(dataCost, neighbors, dualVars, subgradientType)
 %
 % INPUT
 %   dataCost   - unary potentials ( double[ numLabels x numNodes ])
 %   neighbors  - paiwise Potts potentials ( sparse double[ numNodes x numNodes ]). 
 %           The function uses only upper triangle of this matrix. All entries have to be non-negative.
 %   dualVars   - vector of dual varuables ( double[ numNodes x 1 ])
+%   subgradientType - which subgradient to return if a subproblem has several minimum cuts (string, optional):
+%           'any' (default) - the cut found by the graph-cut algorithm; the subgradient can jump between equally valid values;
+%           'source', 'sink' - the source-minimal or the sink-minimal cut, i.e. the labeling with the largest or the smallest number of ones;
+%           'average' - the average of the two subgradients above
 %
 % OUTPUT
 %   dualValue - the value of the dual function
@@ -40,6 +45,18 @@ if ~isnumeric(dualVars) || ~iscolumn(dualVars) || length(dualVars) ~= numNodes
 end
 dualVars = double(dualVars);
 
+if ~exist('subgradientType', 'var') || isempty(subgradientType)
+    subgradientType = 'any';
+end
+switch subgradientType
+    case {'any', 'source', 'sink'}
+        cutType = subgradientType;
+    case 'average'
+        cutType = 'both';
+    otherwise
+        error('computeSmrDual_pairwisePotts:badSubgradientType', 'subgradientType should be ''any'', ''source'', ''sink'' or ''average''');
+end
+
 subEnergy = nan(numLabels, 1);
 labelsQp = nan(numNodes, numLabels);
 
@@ -56,7 +73,8 @@ termEdgeWeight  = dataCost';
 
 % run graph cuts
 for iLabel = 1 : numLabels
-    [subEnergy(iLabel), labelsQp(:, iLabel)] = graphCutMex([termEdgeWeight(:, iLabel) + dualVars, zeros(numNodes, 1)], nonTermEdgesWeights);
+    [subEnergy(iLabel), curLabels] = graphCutMex([termEdgeWeight(:, iLabel) + dualVars, zeros(numNodes, 1)], nonTermEdgesWeights, cutType);
+    labelsQp(:, iLabel) = mean(curLabels, 2);
 end
 dualValue = sum(subEnergy) - sum(dualVars);
 